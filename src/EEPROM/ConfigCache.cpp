@@ -0,0 +1,184 @@
+#include "ConfigCache.h"
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+#include "pico/stdlib.h"
+
+/*
+   ConfigCache Module
+
+   Dirty tracking and debounced write-back of the settings (see ConfigCache.h). The values are
+   copied out of the cache before they are written, so setters are never held up by a flush
+   that is in progress. Flushes are serialized, so an older copy can never overwrite a newer
+   one written by flushAll().
+*/
+
+static const MetricDescriptor updatesDescriptor = {
+    "greenhouse_config_updates_total", "Setting changes made in the configuration cache.", MetricType::Counter };
+static const MetricDescriptor flushErrorsDescriptor = {
+    "greenhouse_config_flush_errors_total", "Settings that could not be written to the EEPROM.", MetricType::Counter };
+static const MetricDescriptor dirtyDescriptor = {
+    "greenhouse_config_dirty", "Settings changed in RAM but not yet written to the EEPROM.", MetricType::Gauge };
+
+static uint32_t nowMs() {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+ConfigCache::ConfigCache(std::shared_ptr<ConfigStore> store)
+        : store(std::move(store))
+        , flushTask(nullptr)
+{
+    updatesMetric     = g_metrics.add(updatesDescriptor);
+    flushErrorsMetric = g_metrics.add(flushErrorsDescriptor);
+    dirtyMetric       = g_metrics.add(dirtyDescriptor);
+}
+
+// ----------------------------------------------------------------------------
+// get() / set(): RAM only (a value is loaded from the store on first use)
+// ----------------------------------------------------------------------------
+size_t ConfigCache::get(ConfigKey key, void* data, size_t length) {
+    size_t k = static_cast<size_t>(key);
+    if (k >= ConfigStore::MAX_KEYS || length == 0 || length > ConfigStore::MAX_VALUE_SIZE) {
+        return 0;
+    }
+    {
+        std::lock_guard<Fmutex> exclusive(access);
+        const Entry& entry = entries[k];
+        if (entry.loaded || !store) {
+            if (!entry.loaded || entry.length != length) {
+                return 0;
+            }
+            memcpy(data, entry.value, length);
+            return length;
+        }
+    }
+
+    // Miss: read the store without holding 'access', so that get()/set() of other keys do
+    // not wait for the EEPROM. A set() of this key in the meantime wins over the stored value.
+    uint8_t value[ConfigStore::MAX_VALUE_SIZE];
+    size_t n = store->get(key, value, length);
+
+    std::lock_guard<Fmutex> exclusive(access);
+    Entry& entry = entries[k];
+    if (!entry.loaded && n) {
+        memcpy(entry.value, value, n);
+        entry.length = static_cast<uint8_t>(n);
+        entry.loaded = true;
+    }
+    if (!entry.loaded || entry.length != length) {
+        return 0;
+    }
+    memcpy(data, entry.value, length);
+    return length;
+}
+
+bool ConfigCache::set(ConfigKey key, const void* data, size_t length) {
+    size_t k = static_cast<size_t>(key);
+    if (k >= ConfigStore::MAX_KEYS || length == 0 || length > ConfigStore::MAX_VALUE_SIZE) {
+        return false;
+    }
+    {
+        std::lock_guard<Fmutex> exclusive(access);
+        Entry& entry = entries[k];
+        if (entry.loaded && entry.length == length && memcmp(entry.value, data, length) == 0) {
+            return true;
+        }
+        memcpy(entry.value, data, length);
+        entry.length = static_cast<uint8_t>(length);
+        entry.loaded = true;
+        uint32_t now = nowMs();
+        if (!entry.dirty) {
+            entry.dirty = true;
+            entry.firstChangeMs = now;
+        }
+        entry.lastChangeMs = now;
+    }
+    g_metrics.inc(updatesMetric);
+
+    TaskHandle_t task = flushTask;
+    if (task) {
+        xTaskNotifyGiveIndexed(task, WAKEUP_NOTIFICATION_INDEX);
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// flush(): write the keys that are due (flushing task)
+// ----------------------------------------------------------------------------
+uint32_t ConfigCache::flush(bool force) {
+    std::lock_guard<Fmutex> serialized(flushing);
+    uint32_t next = portMAX_DELAY;
+    uint32_t now = nowMs();
+    size_t written = 0;
+    for (size_t k = 0; k < ConfigStore::MAX_KEYS; k++) {
+        uint8_t value[ConfigStore::MAX_VALUE_SIZE];
+        size_t length;
+        {
+            std::lock_guard<Fmutex> exclusive(access);
+            Entry& entry = entries[k];
+            if (!entry.dirty) continue;
+            uint32_t due = force ? 0 : dueIn(entry, now);
+            if (due > 0) {
+                if (due < next) next = due;
+                continue;
+            }
+            memcpy(value, entry.value, entry.length);
+            length = entry.length;
+            entry.dirty = false;
+        }
+
+        if (store && store->set(static_cast<ConfigKey>(k), value, length)) {
+            written++;
+            continue;
+        }
+
+        // Keep the value dirty and try again after the quiet period, unless it was changed
+        // (and scheduled) in the meantime.
+        g_metrics.inc(flushErrorsMetric);
+        printf("[ConfigCache] Failed to write key %u, retrying\n", (unsigned)k);
+        std::lock_guard<Fmutex> exclusive(access);
+        Entry& entry = entries[k];
+        if (!entry.dirty) {
+            entry.dirty = true;
+            entry.firstChangeMs = now;
+            entry.lastChangeMs = now;
+        }
+        if (QUIET_MS < next) next = QUIET_MS;
+    }
+
+    if (written) {
+        printf("[ConfigCache] %u setting(s) written\n", (unsigned)written);
+    }
+    g_metrics.set(dirtyMetric, static_cast<float>(getDirtyCount()));
+    return next;
+}
+
+bool ConfigCache::flushAll() {
+    flush(true);
+    return getDirtyCount() == 0;
+}
+
+void ConfigCache::wait(uint32_t ms) {
+    flushTask = xTaskGetCurrentTaskHandle();
+    // A separate notification index: the flush waits on index 0 inside PicoI2C.
+    ulTaskNotifyTakeIndexed(WAKEUP_NOTIFICATION_INDEX, pdTRUE, ms == portMAX_DELAY ? portMAX_DELAY : pdMS_TO_TICKS(ms));
+}
+
+size_t ConfigCache::getDirtyCount() const {
+    std::lock_guard<Fmutex> exclusive(access);
+    size_t count = 0;
+    for (const auto& entry : entries) {
+        if (entry.dirty) count++;
+    }
+    return count;
+}
+
+uint32_t ConfigCache::dueIn(const Entry& entry, uint32_t now) {
+    uint32_t quietDue = entry.lastChangeMs + QUIET_MS;
+    uint32_t latestDue = entry.firstChangeMs + MAX_DELAY_MS;
+    uint32_t due = static_cast<int32_t>(latestDue - quietDue) < 0 ? latestDue : quietDue;
+    int32_t remaining = static_cast<int32_t>(due - now);
+    return remaining > 0 ? static_cast<uint32_t>(remaining) : 0;
+}
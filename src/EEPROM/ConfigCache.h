@@ -0,0 +1,93 @@
+#ifndef CONFIG_CACHE_H
+#define CONFIG_CACHE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "Fmutex.h"
+#include "ConfigStore.h"
+#include "metrics/Metrics.h"
+
+/*
+   ConfigCache Class
+
+   Write-behind cache in front of the ConfigStore. Setters (the UI, remote commands, the
+   Controller) only update the value in RAM, mark the key dirty and wake the flushing task;
+   they never wait for the I²C bus or an EEPROM write cycle.
+
+   The flushing task (eepromTask) writes a dirty key once it has not changed for QUIET_MS,
+   so turning the rotary encoder or a burst of remote commands costs one record per key.
+   A key that keeps changing is written at the latest MAX_DELAY_MS after its first unsaved
+   change. flushAll() writes everything at once and is called before a deliberate reset.
+
+   Reads are served from RAM; a key that has not been read or written yet is loaded from
+   the store on first use (outside the cache lock). All methods are thread-safe.
+*/
+class ConfigCache {
+public:
+    static constexpr uint32_t QUIET_MS     = 5000;   // Debounce after the last change.
+    static constexpr uint32_t MAX_DELAY_MS = 30000;  // Longest time a change stays unsaved.
+
+    explicit ConfigCache(std::shared_ptr<ConfigStore> store);
+
+    ConfigCache(const ConfigCache&) = delete;
+
+    // Copies the value of 'key' into 'data'. Returns its length, or 0 if the key has no
+    // value or its length differs from 'length'.
+    size_t get(ConfigKey key, void* data, size_t length);
+
+    // Updates the value in RAM and schedules it for writing. Returns false if the key or
+    // length is invalid.
+    bool set(ConfigKey key, const void* data, size_t length);
+
+    template <typename T>
+    bool get(ConfigKey key, T& value) {
+        return get(key, &value, sizeof(T)) == sizeof(T);
+    }
+
+    template <typename T>
+    bool set(ConfigKey key, const T& value) {
+        return set(key, &value, sizeof(T));
+    }
+
+    // Writes the dirty keys that are due (all of them if 'force'). Returns the time in ms
+    // until the next key is due, or portMAX_DELAY when nothing is dirty.
+    uint32_t flush(bool force = false);
+
+    // Writes all dirty keys now (before a reboot). Returns false if a write failed.
+    bool flushAll();
+
+    // Sleeps up to 'ms' milliseconds; set() ends the sleep early. The first call registers
+    // the calling task as the flushing task.
+    void wait(uint32_t ms);
+
+    // Number of keys with unsaved changes.
+    size_t getDirtyCount() const;
+
+private:
+    struct Entry {
+        uint8_t  value[ConfigStore::MAX_VALUE_SIZE];
+        uint8_t  length = 0;         // 0 = not loaded or no value.
+        bool     loaded = false;     // Read from the store (or set) already.
+        bool     dirty = false;
+        uint32_t firstChangeMs = 0;  // First unsaved change.
+        uint32_t lastChangeMs = 0;   // Most recent change.
+    };
+
+    std::shared_ptr<ConfigStore> store;
+    mutable Fmutex access;
+    Fmutex flushing;                   // One flush at a time (flushing task or flushAll()).
+    Entry entries[ConfigStore::MAX_KEYS];
+    volatile TaskHandle_t flushTask;   // Task blocked in wait(), woken by set().
+
+    MetricId updatesMetric;
+    MetricId flushErrorsMetric;
+    MetricId dirtyMetric;
+
+    // Time in ms until 'entry' is due for writing at 'now' (0 = due).
+    static uint32_t dueIn(const Entry& entry, uint32_t now);
+};
+
+#endif // CONFIG_CACHE_H
@@ -0,0 +1,372 @@
+#include "ConfigStore.h"
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+/*
+   ConfigStore Module
+
+   Log-structured key-value store on the external EEPROM (see ConfigStore.h for the layout).
+   Writing a value costs one record of RECORD_OVERHEAD + length bytes, i.e. one page write in
+   most cases; the header of a segment is written once per pass through the ring.
+*/
+
+static const MetricDescriptor recordsDescriptor = {
+    "greenhouse_config_records_written_total", "Records appended to the configuration store.", MetricType::Counter };
+static const MetricDescriptor rotationsDescriptor = {
+    "greenhouse_config_segment_rotations_total", "Configuration store segments reused (wear leveling).", MetricType::Counter };
+
+static constexpr uint16_t SEGMENT_MAGIC = 0x4643;         // "CF"
+
+// Previous layout: the CO₂ setpoint as a big-endian uint16 at 0x0000/0x0001.
+static constexpr uint16_t LEGACY_SETPOINT_ADDR = 0x0000;
+static constexpr uint16_t LEGACY_SETPOINT_MAX  = 1500;
+
+static void putLe16(uint8_t* p, uint16_t value) {
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static void putLe32(uint8_t* p, uint32_t value) {
+    putLe16(p, static_cast<uint16_t>(value));
+    putLe16(p + 2, static_cast<uint16_t>(value >> 16));
+}
+
+static uint16_t getLe16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t getLe32(const uint8_t* p) {
+    return getLe16(p) | (static_cast<uint32_t>(getLe16(p + 2)) << 16);
+}
+
+ConfigStore::ConfigStore(std::shared_ptr<EEPROMStorage> eeprom, uint16_t start, uint32_t size)
+        : eeprom(std::move(eeprom))
+        , start(start)
+        , segmentCount(size / SEGMENT_SIZE)
+        , head(0)
+        , headOffset(HEADER_SIZE)
+        , nextSeq(1)
+        , relocationPending(false)
+        , mounted(false)
+{
+    if (segmentCount > MAX_SEGMENTS) {
+        segmentCount = MAX_SEGMENTS;
+    }
+    recordsMetric   = g_metrics.add(recordsDescriptor);
+    rotationsMetric = g_metrics.add(rotationsDescriptor);
+}
+
+// ----------------------------------------------------------------------------
+// mount(): one scan of the region at boot.
+// ----------------------------------------------------------------------------
+/*
+    The head is the segment with the highest first sequence number. Walking the ring backwards
+    from it, the segments with decreasing first sequence numbers are the current store; they
+    are replayed from the oldest to the newest, so the index ends up with the newest record of
+    every key.
+*/
+bool ConfigStore::mount() {
+    std::lock_guard<Fmutex> exclusive(access);
+    mounted = false;
+    for (auto& entry : index) {
+        entry = IndexEntry();
+    }
+    if (!eeprom || segmentCount < 2) {
+        printf("[ConfigStore] Region too small or no EEPROM\n");
+        return false;
+    }
+
+    uint32_t firstSeq[MAX_SEGMENTS];
+    bool valid[MAX_SEGMENTS];
+    size_t newest = segmentCount;
+    for (size_t i = 0; i < segmentCount; i++) {
+        if (!readHeader(i, firstSeq[i], valid[i])) {
+            printf("[ConfigStore] EEPROM not readable\n");
+            return false;
+        }
+        if (valid[i] && (newest == segmentCount || firstSeq[i] > firstSeq[newest])) {
+            newest = i;
+        }
+    }
+
+    if (newest == segmentCount) {
+        printf("[ConfigStore] No configuration found, formatting %u segments\n", (unsigned)segmentCount);
+        if (!formatRegion()) {
+            return false;
+        }
+        mounted = true;
+        migrateLegacy();
+        return true;
+    }
+
+    size_t chain[MAX_SEGMENTS];
+    size_t chainLength = 0;
+    chain[chainLength++] = newest;
+    for (size_t k = 1; k < segmentCount; k++) {
+        size_t segment = (newest + segmentCount - k) % segmentCount;
+        if (!valid[segment] || firstSeq[segment] >= firstSeq[chain[chainLength - 1]]) break;
+        chain[chainLength++] = segment;
+    }
+
+    std::unique_ptr<uint8_t[]> buffer(new uint8_t[SEGMENT_SIZE]);
+    for (size_t i = chainLength; i-- > 0;) {
+        size_t segment = chain[i];
+        if (!eeprom->readBytes(segmentAddr(segment), buffer.get(), SEGMENT_SIZE)) {
+            printf("[ConfigStore] EEPROM not readable\n");
+            return false;
+        }
+        uint32_t seq = firstSeq[segment];
+        size_t end = scanSegment(segment, buffer.get(), seq);
+        if (i == 0) {
+            head = segment;
+            headOffset = end;
+            nextSeq = seq;
+        }
+    }
+    mounted = true;
+
+    // Completes a rotation that was interrupted by a reset.
+    relocationPending = true;
+    finishRelocation();
+
+    size_t keys = 0;
+    for (const auto& entry : index) {
+        if (entry.length) keys++;
+    }
+    printf("[ConfigStore] Mounted: %u keys, head segment %u (%u bytes used), next sequence %lu\n",
+           (unsigned)keys, (unsigned)head, (unsigned)headOffset, (unsigned long)nextSeq);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// get() / set()
+// ----------------------------------------------------------------------------
+size_t ConfigStore::get(ConfigKey key, void* data, size_t length) const {
+    std::lock_guard<Fmutex> exclusive(access);
+    size_t k = static_cast<size_t>(key);
+    if (!mounted || k >= MAX_KEYS || index[k].length == 0 || index[k].length != length) {
+        return 0;
+    }
+    if (!eeprom->readBytes(index[k].addr, static_cast<uint8_t*>(data), length)) {
+        return 0;
+    }
+    return length;
+}
+
+bool ConfigStore::set(ConfigKey key, const void* data, size_t length) {
+    std::lock_guard<Fmutex> exclusive(access);
+    size_t k = static_cast<size_t>(key);
+    if (!mounted || k >= MAX_KEYS || length == 0 || length > MAX_VALUE_SIZE) {
+        return false;
+    }
+
+    // An unchanged value costs a read, not a write cycle.
+    if (index[k].length == length) {
+        uint8_t current[MAX_VALUE_SIZE];
+        if (eeprom->readBytes(index[k].addr, current, length) && memcmp(current, data, length) == 0) {
+            return true;
+        }
+    }
+    return append(key, static_cast<const uint8_t*>(data), length);
+}
+
+bool ConfigStore::format() {
+    std::lock_guard<Fmutex> exclusive(access);
+    mounted = formatRegion();
+    return mounted;
+}
+
+bool ConfigStore::isMounted() const {
+    std::lock_guard<Fmutex> exclusive(access);
+    return mounted;
+}
+
+// ----------------------------------------------------------------------------
+// Private helpers: segments
+// ----------------------------------------------------------------------------
+uint16_t ConfigStore::segmentAddr(size_t segment) const {
+    return static_cast<uint16_t>(start + segment * SEGMENT_SIZE);
+}
+
+bool ConfigStore::readHeader(size_t segment, uint32_t& firstSeq, bool& valid) const {
+    uint8_t header[HEADER_SIZE];
+    if (!eeprom->readBytes(segmentAddr(segment), header, sizeof(header))) {
+        return false;
+    }
+    firstSeq = getLe32(header + 2);
+    valid = getLe16(header) == SEGMENT_MAGIC && getLe32(header + 6) == crc32(header, 6);
+    return true;
+}
+
+bool ConfigStore::openSegment(size_t segment) {
+    uint8_t header[HEADER_SIZE];
+    putLe16(header, SEGMENT_MAGIC);
+    putLe32(header + 2, nextSeq);
+    putLe32(header + 6, crc32(header, 6));
+    if (!eeprom->writeBytes(segmentAddr(segment), header, sizeof(header))) {
+        printf("[ConfigStore] Failed to open segment %u\n", (unsigned)segment);
+        return false;
+    }
+    head = segment;
+    headOffset = HEADER_SIZE;
+    return true;
+}
+
+/*
+    A fresh head segment is opened with a sequence number above all existing records, after the
+    headers of all other segments have been invalidated, so no older value can reappear.
+*/
+bool ConfigStore::formatRegion() {
+    for (auto& entry : index) {
+        entry = IndexEntry();
+    }
+    relocationPending = false;
+    size_t newHead = (head + 1) % segmentCount;
+    const uint8_t blank[HEADER_SIZE] = {};
+    for (size_t i = 0; i < segmentCount; i++) {
+        if (i != newHead && !eeprom->writeBytes(segmentAddr(i), blank, sizeof(blank))) {
+            printf("[ConfigStore] Failed to erase segment %u\n", (unsigned)i);
+            return false;
+        }
+    }
+    return openSegment(newHead);
+}
+
+size_t ConfigStore::scanSegment(size_t segment, const uint8_t* buffer, uint32_t& seq) {
+    size_t offset = HEADER_SIZE;
+    while (offset + RECORD_OVERHEAD <= SEGMENT_SIZE) {
+        const uint8_t* record = buffer + offset;
+        size_t key = record[0];
+        size_t length = record[1];
+        size_t size = RECORD_OVERHEAD + length;
+        if (key >= MAX_KEYS || length == 0 || length > MAX_VALUE_SIZE || offset + size > SEGMENT_SIZE
+            || getLe32(record + 2) != seq || getLe32(record + 6 + length) != crc32(record, 6 + length)) {
+            break;
+        }
+        index[key].addr = static_cast<uint16_t>(segmentAddr(segment) + offset + 6);
+        index[key].length = static_cast<uint8_t>(length);
+        seq++;
+        offset += size;
+    }
+    return offset;
+}
+
+// ----------------------------------------------------------------------------
+// Private helpers: appending and compaction
+// ----------------------------------------------------------------------------
+bool ConfigStore::append(ConfigKey key, const uint8_t* data, size_t length) {
+    if (!finishRelocation()) {
+        return false;
+    }
+    if (headOffset + RECORD_OVERHEAD + length > SEGMENT_SIZE && !rotate()) {
+        return false;
+    }
+    return appendToHead(static_cast<uint8_t>(key), data, length);
+}
+
+bool ConfigStore::appendToHead(uint8_t key, const uint8_t* data, size_t length) {
+    size_t size = RECORD_OVERHEAD + length;
+    if (headOffset + size > SEGMENT_SIZE) {
+        printf("[ConfigStore] No room for key %u in segment %u\n", key, (unsigned)head);
+        return false;
+    }
+
+    uint8_t record[RECORD_OVERHEAD + MAX_VALUE_SIZE];
+    record[0] = key;
+    record[1] = static_cast<uint8_t>(length);
+    putLe32(record + 2, nextSeq);
+    memcpy(record + 6, data, length);
+    putLe32(record + 6 + length, crc32(record, 6 + length));
+
+    uint16_t addr = static_cast<uint16_t>(segmentAddr(head) + headOffset);
+    if (!eeprom->writeBytes(addr, record, size)) {
+        // The next record is written to the same place; the torn one is never indexed.
+        printf("[ConfigStore] Failed to write key %u\n", key);
+        return false;
+    }
+    index[key].addr = static_cast<uint16_t>(addr + 6);
+    index[key].length = static_cast<uint8_t>(length);
+    headOffset += size;
+    nextSeq++;
+    g_metrics.inc(recordsMetric);
+    return true;
+}
+
+/*
+    The segment after the new head holds the oldest records; it may only be reused once its
+    current values have been appended again. Until that has succeeded, relocationPending keeps
+    appends and further rotations from running (see finishRelocation()).
+*/
+bool ConfigStore::rotate() {
+    if (!finishRelocation() || !openSegment((head + 1) % segmentCount)) {
+        return false;
+    }
+    g_metrics.inc(rotationsMetric);
+    printf("[ConfigStore] Head moved to segment %u\n", (unsigned)head);
+    relocationPending = true;
+    return finishRelocation();
+}
+
+bool ConfigStore::finishRelocation() {
+    if (!relocationPending) {
+        return true;
+    }
+    // Values relocated by an earlier attempt point into the head now and are skipped.
+    if (!relocate((head + 1) % segmentCount)) {
+        printf("[ConfigStore] Relocation of segment %u incomplete, retrying with the next write\n",
+               (unsigned)((head + 1) % segmentCount));
+        return false;
+    }
+    relocationPending = false;
+    return true;
+}
+
+bool ConfigStore::relocate(size_t segment) {
+    uint16_t begin = segmentAddr(segment);
+    uint8_t value[MAX_VALUE_SIZE];
+    for (size_t k = 0; k < MAX_KEYS; k++) {
+        const IndexEntry& entry = index[k];
+        if (entry.length == 0 || entry.addr < begin || entry.addr >= begin + SEGMENT_SIZE) {
+            continue;
+        }
+        size_t length = entry.length;
+        if (!eeprom->readBytes(entry.addr, value, length) || !appendToHead(static_cast<uint8_t>(k), value, length)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+   migrateLegacy():
+   Takes over the CO₂ setpoint of the previous fixed layout when a store is created. The old
+   bytes are left in place; they are outside the region.
+*/
+void ConfigStore::migrateLegacy() {
+    uint8_t raw[2];
+    if (!eeprom->readBytes(LEGACY_SETPOINT_ADDR, raw, sizeof(raw))) {
+        return;
+    }
+    uint16_t setpoint = static_cast<uint16_t>((raw[0] << 8) | raw[1]);
+    if (setpoint == 0 || setpoint > LEGACY_SETPOINT_MAX) {
+        return;
+    }
+    if (appendToHead(static_cast<uint8_t>(ConfigKey::Co2Setpoint), reinterpret_cast<const uint8_t*>(&setpoint),
+                     sizeof(setpoint))) {
+        printf("[ConfigStore] Migrated CO2 setpoint %u from the previous layout\n", setpoint);
+    }
+}
+
+// CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320).
+uint32_t ConfigStore::crc32(const uint8_t* data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
@@ -0,0 +1,176 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "Fmutex.h"
+#include "EEPROMStorage.h"
+#include "metrics/Metrics.h"
+
+/*
+   ConfigKey:
+   Identifiers of the persistent settings. The numbers are stored in the EEPROM, so existing
+   values must never be renumbered; new settings get the next free number (< MAX_KEYS).
+*/
+enum class ConfigKey : uint8_t {
+    Co2Setpoint      = 0,  // uint16_t, ppm.
+    SetpointSchedule = 1,  // ConfigSchedule.
+    DeliveredSeq     = 2,  // ConfigDelivered.
+};
+
+/*
+   ConfigSchedule:
+   Stored form of the Controller's setpoint schedule (see Controller::setSetpointSchedule()).
+*/
+struct ConfigSchedule {
+    uint16_t startMinute;  // Minutes after midnight UTC.
+    uint16_t endMinute;
+    uint16_t setpoint;     // ppm.
+};
+
+/*
+   ConfigDelivered:
+   Per telemetry sink, the SampleLog sequence number after the last record it accepted
+   (see TelemetryPipeline::resume()). A sink is identified by a hash of its name, so adding
+   or reordering sinks does not mix up their positions; 0 marks an unused entry.
+*/
+struct ConfigDelivered {
+    uint32_t seq[4];
+    uint16_t sink[4];
+};
+
+/*
+   ConfigStore Class
+
+   A journaled, wear-leveled key-value store for the settings, kept in a region of the external
+   EEPROM. Writing a key appends one small record; values are never rewritten in place.
+
+   On-EEPROM layout:
+     - The region is divided into segments of SEGMENT_SIZE bytes used as a ring.
+     - Every segment starts with a header { magic, first sequence number, CRC-32 }.
+     - Records follow back to back:
+         key (1) | length (1) | sequence number (4, LE) | value (length) | CRC-32 (4, LE)
+       Sequence numbers increase by one with every record across the whole store, so the
+       records of a segment are valid up to the first one with a wrong sequence number or CRC
+       (left over from an earlier use of the segment, never written, or torn by a reset). A
+       record torn between two page writes ends in stale bytes, which a 32-bit CRC rejects
+       reliably enough to be used for every record.
+
+   Wear leveling and compaction:
+     - Records are appended to the newest (head) segment; when it is full the next segment of
+       the ring becomes the head, so every segment is written equally often.
+     - The segment after the head is always kept free of current values: after moving the head,
+       the values whose newest record is in the following (oldest) segment are appended again
+       to the new head. That segment can then be reused without losing anything, also when a
+       reset interrupts the rotation (mount() completes it).
+
+   mount() reads the region once at boot and builds the in-RAM index (address and length of
+   the newest record of every key); get() then reads only the value. A fresh or foreign
+   region is formatted and the CO₂ setpoint of the previous fixed layout (0x0000/0x0001) is
+   migrated. All methods are thread-safe and must be called from tasks (see EEPROMStorage).
+*/
+class ConfigStore {
+public:
+    static constexpr size_t   SEGMENT_SIZE   = 1024;  // Multiple of the EEPROM page size.
+    static constexpr size_t   MAX_SEGMENTS   = 16;
+    static constexpr size_t   MAX_KEYS       = 24;    // Key numbers 0..MAX_KEYS-1.
+    static constexpr size_t   MAX_VALUE_SIZE = 32;
+    static constexpr size_t   HEADER_SIZE    = 10;
+    static constexpr size_t   RECORD_OVERHEAD = 10;
+
+    // start: first byte of the region, size: its length (at least two segments).
+    ConfigStore(std::shared_ptr<EEPROMStorage> eeprom, uint16_t start, uint32_t size);
+
+    ConfigStore(const ConfigStore&) = delete;
+
+    // Scans the region and builds the index (formats and migrates a fresh region).
+    // Returns false if the EEPROM could not be read or formatted.
+    bool mount();
+
+    // Copies the current value of 'key' into 'data'. Returns its length, or 0 if the key
+    // has no value or its length differs from 'length'.
+    size_t get(ConfigKey key, void* data, size_t length) const;
+
+    // Stores a new value of 'key' (1..MAX_VALUE_SIZE bytes). An unchanged value is not
+    // written again. Returns false if the value could not be written.
+    bool set(ConfigKey key, const void* data, size_t length);
+
+    template <typename T>
+    bool get(ConfigKey key, T& value) const {
+        return get(key, &value, sizeof(T)) == sizeof(T);
+    }
+
+    template <typename T>
+    bool set(ConfigKey key, const T& value) {
+        return set(key, &value, sizeof(T));
+    }
+
+    // Erases all values (writes an empty head segment).
+    bool format();
+
+    bool isMounted() const;
+
+private:
+    struct IndexEntry {
+        uint16_t addr = 0;     // EEPROM address of the value.
+        uint8_t  length = 0;   // 0 = no value.
+    };
+
+    std::shared_ptr<EEPROMStorage> eeprom;
+    mutable Fmutex access;
+    uint16_t start;
+    size_t segmentCount;
+
+    IndexEntry index[MAX_KEYS];
+    size_t   head;          // Segment that records are appended to.
+    size_t   headOffset;    // Offset of the next record in the head segment.
+    uint32_t nextSeq;       // Sequence number of the next record.
+    bool     relocationPending;  // The segment after the head may still hold current values.
+    bool     mounted;
+
+    MetricId recordsMetric;
+    MetricId rotationsMetric;
+
+    uint16_t segmentAddr(size_t segment) const;
+
+    // Reads and checks the header of 'segment'. Returns false if the EEPROM could not be read.
+    bool readHeader(size_t segment, uint32_t& firstSeq, bool& valid) const;
+
+    // Makes 'segment' the empty head segment, with the next record sequence number.
+    bool openSegment(size_t segment);
+
+    // Invalidates all segments and opens an empty head segment.
+    bool formatRegion();
+
+    // Parses the records of one segment (read into 'buffer') into the index. Returns the
+    // offset after the last valid record; 'seq' is advanced past it.
+    size_t scanSegment(size_t segment, const uint8_t* buffer, uint32_t& seq);
+
+    // Appends a record to the head segment, moving to the next segment when it is full.
+    bool append(ConfigKey key, const uint8_t* data, size_t length);
+
+    // Appends a record to the head segment, which must have room for it.
+    bool appendToHead(uint8_t key, const uint8_t* data, size_t length);
+
+    // Moves to the next segment and compacts the segment after it.
+    bool rotate();
+
+    // Completes a pending compaction of the segment after the head. Returns false (and
+    // keeps it pending) if it failed.
+    bool finishRelocation();
+
+    // Appends again the values whose newest record lies in 'segment'.
+    bool relocate(size_t segment);
+
+    void migrateLegacy();
+
+    static uint32_t crc32(const uint8_t* data, size_t length);
+
+    // The values of a full set of keys always fit into one segment, so compaction never runs
+    // out of room.
+    static_assert(MAX_KEYS * (RECORD_OVERHEAD + MAX_VALUE_SIZE) <= SEGMENT_SIZE - HEADER_SIZE,
+                  "Values of all keys must fit into one segment");
+};
+
+#endif // CONFIG_STORE_H
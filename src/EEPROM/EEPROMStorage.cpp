@@ -1,31 +1,29 @@
 #include "EEPROMStorage.h"
-#include <hardware/i2c.h>
-#include <hardware/gpio.h>
-#include <pico/time.h>
 #include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <utility>
 
 /*
    EEPROMStorage Module
 
    This module provides an abstraction layer to interface with an external I²C EEPROM.
-   It handles non-volatile storage operations such as reading and writing bytes, and also
-   provides convenience functions for storing and retrieving the CO₂ setpoint which ensures
-   that critical parameters persist across power cycles. This is part of the system’s dynamic
+   It handles non-volatile storage operations such as reading and writing bytes and blocks
+   (sequential reads, page writes with ACK polling for the end of the write cycle). The settings
+   themselves are kept in the ConfigStore on top of it, which ensures that critical parameters
+   persist across power cycles. This is part of the system’s dynamic
    resource allocation and persistence mechanism as described in the project documentation.
 */
 
-EEPROMStorage::EEPROMStorage(i2c_inst_t* i2c_instance, unsigned int sda_pin, unsigned int scl_pin, uint8_t device_address)
-        : i2c_instance(i2c_instance), sda_pin(sda_pin), scl_pin(scl_pin), device_address(device_address)
+EEPROMStorage::EEPROMStorage(std::shared_ptr<PicoI2C> i2c, uint8_t device_address, uint16_t page_size, uint32_t size)
+        : i2c(std::move(i2c)), device_address(device_address), page_size(page_size), size(size)
 {
-    // Configure the SDA and SCL GPIO pins to function as I2C.
-    gpio_set_function(sda_pin, GPIO_FUNC_I2C);
-    gpio_set_function(scl_pin, GPIO_FUNC_I2C);
-
-    // Enable internal pull-up resistors on SDA and SCL lines as required by I2C standards.
-    gpio_pull_up(sda_pin);
-    gpio_pull_up(scl_pin);
+    // A page larger than the transfer buffer is written in smaller (still aligned) parts.
+    if (this->page_size == 0 || this->page_size > MAX_PAGE_SIZE) {
+        this->page_size = MAX_PAGE_SIZE;
+    }
 
-    // Call the init method to perform any additional initialization.
+    // The bus pins are configured by PicoI2C. Call the init method to perform any additional initialization.
     init();
 }
 
@@ -34,74 +32,124 @@ void EEPROMStorage::init() {
     // Currently, this method is a placeholder for any EEPROM initialization protocols.
 }
 
+uint16_t EEPROMStorage::getPageSize() const {
+    return page_size;
+}
+
+uint32_t EEPROMStorage::getSize() const {
+    return size;
+}
+
 bool EEPROMStorage::readByte(uint16_t memAddr, uint8_t &data) {
-    // Split the 16-bit memory address into two bytes in big-endian format.
-    uint8_t addr[2] = { static_cast<uint8_t>(memAddr >> 8),
-                        static_cast<uint8_t>(memAddr & 0xFF) };
+    return readBytes(memAddr, &data, 1);
+}
 
-    // Write the memory address to the EEPROM to set the address pointer.
-    // The 'true' parameter indicates a repeated start condition without a STOP.
-    int ret = i2c_write_blocking(i2c_instance, device_address, addr, 2, true);
-    if (ret != 2) {
-        printf("EEPROMStorage: Failed to write address (ret=%d)\n", ret);
+bool EEPROMStorage::writeByte(uint16_t memAddr, uint8_t data) {
+    return writeBytes(memAddr, &data, 1);
+}
+
+/*
+   readBytes():
+   Sequential read in one combined transaction: the address pointer is set with a write, followed
+   by a repeated start and a read of all bytes; the EEPROM increments its address after every byte.
+   The calling task sleeps while the transfer runs (PicoI2C is interrupt driven).
+*/
+bool EEPROMStorage::readBytes(uint16_t memAddr, uint8_t* data, size_t length) {
+    if (length == 0) {
+        return true;
+    }
+    if (memAddr + length > size) {
+        printf("EEPROMStorage: Read of %u bytes at 0x%04X is out of range\n", (unsigned)length, memAddr);
         return false;
     }
-
-    // Read one byte of data from the EEPROM corresponding to the given memory address.
-    // The 'false' parameter sends a STOP condition after the read.
-    ret = i2c_read_blocking(i2c_instance, device_address, &data, 1, false);
-    if (ret != 1) {
-        printf("EEPROMStorage: Failed to read data (ret=%d)\n", ret);
+    if (!i2c) {
+        printf("EEPROMStorage: No I2C bus\n");
         return false;
     }
 
-    return true; // Successfully read one byte.
-}
+    // Split the 16-bit memory address into two bytes in big-endian format.
+    uint8_t addr[2] = { static_cast<uint8_t>(memAddr >> 8),
+                        static_cast<uint8_t>(memAddr & 0xFF) };
 
-bool EEPROMStorage::writeByte(uint16_t memAddr, uint8_t data) {
-    // Prepare a buffer containing the 16-bit address (big-endian) followed by the data byte.
-    uint8_t buffer[3] = { static_cast<uint8_t>(memAddr >> 8),
-                          static_cast<uint8_t>(memAddr & 0xFF),
-                          data };
-
-    // Write the address and data to the EEPROM in a single transaction.
-    int ret = i2c_write_blocking(i2c_instance, device_address, buffer, 3, false);
-    if (ret != 3) {
-        printf("EEPROMStorage: Failed to write data (ret=%d)\n", ret);
+    std::lock_guard<Fmutex> exclusive(access);
+    uint count = i2c->transaction(device_address, addr, sizeof(addr), data, length);
+    if (count != sizeof(addr) + length) {
+        printf("EEPROMStorage: Failed to read %u bytes at 0x%04X (transferred %u)\n",
+               (unsigned)length, memAddr, count);
         return false;
     }
 
-    // Wait approximately 5ms to allow the EEPROM to complete its internal write cycle.
-    sleep_ms(5);
     return true;
 }
 
 /*
-   storeCO2Setpoint():
-   This function persists the provided CO₂ setpoint value in the EEPROM.
-   It writes the 16-bit CO₂ setpoint value to addresses 0x0000 and 0x0001.
+   writeBytes():
+   Page write: up to one page of data follows the address in a single transaction. The EEPROM
+   only latches the page while the transaction runs and programs it in one write cycle after the
+   STOP, so the block is split where it crosses a page boundary and every part is followed by
+   waiting for the write cycle to complete.
 */
-bool EEPROMStorage::storeCO2Setpoint(uint16_t co2ppm) {
-    uint8_t data[2] = { static_cast<uint8_t>(co2ppm >> 8),    // Most significant byte
-                        static_cast<uint8_t>(co2ppm & 0xFF) };  // Least significant byte
-    // Write the high byte to EEPROM at address 0x0000.
-    bool ok1 = writeByte(0x0000, data[0]);
-    // Write the low byte to EEPROM at address 0x0001.
-    bool ok2 = writeByte(0x0001, data[1]);
-    return ok1 && ok2;
+bool EEPROMStorage::writeBytes(uint16_t memAddr, const uint8_t* data, size_t length) {
+    if (memAddr + length > size) {
+        printf("EEPROMStorage: Write of %u bytes at 0x%04X is out of range\n", (unsigned)length, memAddr);
+        return false;
+    }
+    if (!i2c) {
+        printf("EEPROMStorage: No I2C bus\n");
+        return false;
+    }
+
+    uint8_t buffer[2 + MAX_PAGE_SIZE];
+    std::lock_guard<Fmutex> exclusive(access);
+    while (length > 0) {
+        // Number of bytes up to the end of the current page.
+        size_t chunk = page_size - (memAddr % page_size);
+        if (chunk > length) chunk = length;
+
+        // Address (big-endian) followed by the data bytes.
+        buffer[0] = static_cast<uint8_t>(memAddr >> 8);
+        buffer[1] = static_cast<uint8_t>(memAddr & 0xFF);
+        memcpy(buffer + 2, data, chunk);
+
+        uint count = i2c->write(device_address, buffer, chunk + 2);
+        if (count != chunk + 2) {
+            printf("EEPROMStorage: Failed to write %u bytes at 0x%04X (transferred %u)\n",
+                   (unsigned)chunk, memAddr, count);
+            return false;
+        }
+        if (!waitWriteComplete()) {
+            printf("EEPROMStorage: Write cycle at 0x%04X did not complete\n", memAddr);
+            return false;
+        }
+
+        memAddr += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+    return true;
 }
 
 /*
-   loadCO2Setpoint():
-   This function reads the persisted CO₂ setpoint from the EEPROM.
-   It reads two consecutive bytes from addresses 0x0000 and 0x0001, combines them,
-   and returns the resulting 16-bit value. If reading fails, it returns a fallback value (1000).
+   waitWriteComplete():
+   The calling task sleeps for the typical write cycle time instead of spinning, then the end of the
+   cycle is detected by ACK polling: while programming, the EEPROM does not acknowledge its address,
+   so a one-byte read fails until the cycle is over. Between polls the task sleeps for a millisecond,
+   rounded up to one tick on a slower tick rate. The read only advances the address pointer, which
+   every access sets again anyway.
 */
-uint16_t EEPROMStorage::loadCO2Setpoint() {
-    uint8_t data0 = 0, data1 = 0;
-    bool ok1 = readByte(0x0000, data0);
-    bool ok2 = readByte(0x0001, data1);
-    if (!ok1 || !ok2)
-        return 1000; // Fallback value if unable to read from EEPROM.
-    return (static_cast<uint16_t>(data0) << 8) | data1;
-}
\ No newline at end of file
+static constexpr TickType_t ACK_POLL_TICKS = pdMS_TO_TICKS(1) > 0 ? pdMS_TO_TICKS(1) : 1;
+
+bool EEPROMStorage::waitWriteComplete() {
+    vTaskDelay(pdMS_TO_TICKS(WRITE_CYCLE_TYPICAL_MS));
+    TickType_t start = xTaskGetTickCount();
+    uint8_t dummy;
+    while (true) {
+        if (i2c->read(device_address, &dummy, 1) == 1) {
+            return true;
+        }
+        if (xTaskGetTickCount() - start >= pdMS_TO_TICKS(WRITE_CYCLE_TIMEOUT_MS - WRITE_CYCLE_TYPICAL_MS)) {
+            return false;
+        }
+        vTaskDelay(ACK_POLL_TICKS);
+    }
+}
@@ -2,31 +2,47 @@
 #define EEPROM_STORAGE_H
 
 #include <cstdint>
-#include "hardware/i2c.h"  // Provides definition for i2c_inst_t used for I2C communication
+#include <cstddef>
+#include <memory>
+#include "Fmutex.h"
+#include "PicoI2C.h"  // Interrupt-driven I2C driver (FreeRTOS task notification)
 
 /*
    EEPROMStorage Class
 
-   This class encapsulates the low-level operations needed to interface with an external I²C EEPROM.
-   It provides methods for reading and writing a single byte at a time using a 16-bit memory address
-   (sent in big-endian order). Furthermore, it offers convenience functions for storing and loading the
-   CO₂ setpoint, which is critical for maintaining persistent system settings across device resets.
+   This class encapsulates the low-level operations needed to interface with an external I²C EEPROM
+   (24Cxx family, 16-bit memory address sent in big-endian order). Besides single bytes it reads
+   any number of consecutive bytes in one I²C transaction and writes blocks page by page: every
+   write transaction stays inside one device page, so a block that fits into a page costs exactly
+   one internal write cycle. The end of a write cycle is detected by ACK polling (the EEPROM does
+   not acknowledge its address while it is busy) instead of waiting a fixed time. The system
+   settings are stored through the ConfigStore (ConfigStore.h) and the telemetry history through
+   the SampleLog (SampleLog.h), which use this class from different tasks. Every block access,
+   including the wait for its write cycle, holds a mutex, so a read never hits the EEPROM while
+   it is still busy with another task's write.
 */
 class EEPROMStorage {
 public:
     /**
      * @brief Constructor for EEPROMStorage.
      *
-     * Initializes the EEPROM interface by setting up the I²C hardware pins (SDA and SCL) to operate
-     * in I2C mode with internal pull-ups enabled. It then calls the init() method to perform any additional
-     * post-configuration steps.
+     * The EEPROM is accessed through the interrupt-driven PicoI2C driver, which configures the bus pins
+     * and blocks the calling task (not the CPU) while a transfer is in progress. All accesses must
+     * therefore be made from FreeRTOS tasks.
      *
-     * @param i2c_instance Pointer to the I2C hardware instance (e.g., i2c0 or i2c1) used for communication.
-     * @param sda_pin GPIO pin number used for the I²C SDA line.
-     * @param scl_pin GPIO pin number used for the I²C SCL line.
+     * @param i2c The I2C bus the EEPROM is connected to (bus 0).
      * @param device_address The 7-bit I²C address of the EEPROM device.
+     * @param page_size Write page size of the device in bytes (at most MAX_PAGE_SIZE).
+     * @param size Capacity of the device in bytes.
      */
-    EEPROMStorage(i2c_inst_t* i2c_instance, unsigned int sda_pin, unsigned int scl_pin, uint8_t device_address);
+    EEPROMStorage(std::shared_ptr<PicoI2C> i2c, uint8_t device_address, uint16_t page_size = 64, uint32_t size = 32768);
+
+    // Largest supported write page (24C512/24CM01 have 128 byte pages).
+    static constexpr uint16_t MAX_PAGE_SIZE = 128;
+    // Typical duration of a write cycle; the first ACK poll is made after this delay.
+    static constexpr uint32_t WRITE_CYCLE_TYPICAL_MS = 3;
+    // Longest time the EEPROM may stay busy after a write (datasheet maximum is 5 ms).
+    static constexpr uint32_t WRITE_CYCLE_TIMEOUT_MS = 10;
 
     /**
      * @brief Reads a single byte from the EEPROM.
@@ -44,7 +60,7 @@ public:
      * @brief Writes a single byte to the EEPROM.
      *
      * Sends a 3-byte buffer containing the 16-bit memory address (in big-endian order) followed by the data byte.
-     * Afterwards, it waits a few milliseconds to allow the EEPROM to complete its internal write cycle.
+     * Afterwards, it waits (task delay and ACK polling) until the EEPROM has completed its internal write cycle.
      *
      * @param memAddr The 16-bit memory address to write to.
      * @param data The byte value to be written.
@@ -53,30 +69,54 @@ public:
     bool writeByte(uint16_t memAddr, uint8_t data);
 
     /**
-     * @brief Persists the CO₂ setpoint by writing its 16-bit value to EEPROM.
+     * @brief Reads consecutive bytes from the EEPROM in one transaction.
      *
-     * The CO₂ setpoint is stored at two consecutive memory addresses (0x0000 and 0x0001) in big-endian order.
+     * Sets the address pointer and reads 'length' bytes in one combined transaction (write, repeated
+     * start, sequential read); the EEPROM increments its address internally.
      *
-     * @param co2ppm The CO₂ setpoint value (in ppm) to store.
-     * @return true if both bytes are written successfully, false otherwise.
+     * @param memAddr The 16-bit memory address of the first byte.
+     * @param data Output buffer for at least 'length' bytes.
+     * @param length Number of bytes to read.
+     * @return true on success, false if the range is outside the device or the transfer failed.
      */
-    bool storeCO2Setpoint(uint16_t co2ppm);
+    bool readBytes(uint16_t memAddr, uint8_t* data, size_t length);
 
     /**
-     * @brief Loads the persisted CO₂ setpoint from EEPROM.
+     * @brief Writes consecutive bytes to the EEPROM, page by page.
      *
-     * Reads two consecutive bytes from addresses 0x0000 and 0x0001 and combines them to form the 16-bit setpoint.
-     * Returns a fallback value (1000 ppm) if reading fails.
+     * The block is split at page boundaries (a page write that crosses a boundary would wrap around
+     * to the start of the page). Each part is written in one transaction. The calling task then sleeps
+     * while the EEPROM completes its write cycle and checks the end of the cycle by ACK polling.
      *
-     * @return The 16-bit CO₂ setpoint value.
+     * @param memAddr The 16-bit memory address of the first byte.
+     * @param data The bytes to write.
+     * @param length Number of bytes to write.
+     * @return true if all bytes were written, false otherwise.
      */
-    uint16_t loadCO2Setpoint();
+    bool writeBytes(uint16_t memAddr, const uint8_t* data, size_t length);
+
+    /**
+     * @brief Returns the write page size and the capacity of the device in bytes.
+     */
+    uint16_t getPageSize() const;
+    uint32_t getSize() const;
 
 private:
-    i2c_inst_t* i2c_instance;  // The I2C instance used for EEPROM communication.
-    unsigned int sda_pin;      // GPIO pin for the I²C data line.
-    unsigned int scl_pin;      // GPIO pin for the I²C clock line.
+    std::shared_ptr<PicoI2C> i2c;  // The I2C bus used for EEPROM communication.
     uint8_t device_address;    // The 7-bit I²C address of the EEPROM.
+    uint16_t page_size;        // Write page size in bytes.
+    uint32_t size;             // Capacity in bytes.
+    Fmutex access;             // One block access (and its write cycles) at a time.
+
+    /**
+     * @brief Waits until the EEPROM has completed its internal write cycle.
+     *
+     * Sleeps for the typical write cycle time, then polls the device address once per millisecond (at least one tick) until it
+     * is acknowledged again, at most WRITE_CYCLE_TIMEOUT_MS in total.
+     *
+     * @return true when the EEPROM is ready, false on timeout.
+     */
+    bool waitWriteComplete();
 
     /**
      * @brief Performs any additional initialization for the EEPROM.
@@ -86,4 +126,4 @@ private:
     void init();
 };
 
-#endif // EEPROM_STORAGE_H
\ No newline at end of file
+#endif // EEPROM_STORAGE_H
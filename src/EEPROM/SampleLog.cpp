@@ -0,0 +1,472 @@
+#include "SampleLog.h"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <mutex>
+#include <utility>
+
+#include "pico/stdlib.h"
+#include "WallClock.h"
+
+/*
+   SampleLog Module
+
+   Circular, block-structured telemetry log on the external EEPROM (see SampleLog.h for the
+   layout). The EEPROM is only written by sync(), one block at a time and without holding the
+   state mutex, so append() never waits for the I²C bus.
+*/
+
+static const MetricDescriptor blocksDescriptor = {
+    "greenhouse_sample_log_blocks_written_total", "Blocks written to the sample log.", MetricType::Counter };
+static const MetricDescriptor droppedDescriptor = {
+    "greenhouse_sample_log_dropped_total", "Samples lost before they reached the sample log.", MetricType::Counter };
+
+static constexpr uint16_t BLOCK_MAGIC = 0x4C53;            // "SL"
+static constexpr size_t   CRC_OFFSET  = 14;                // Header bytes before the CRC.
+
+// Flags, a 5-byte timestamp delta and five 5-byte value deltas.
+static constexpr size_t MAX_RECORD_SIZE = 1 + 5 + 5 * 5;
+
+// Stored resolution of co2, rh, temp, fanSpeed and setpoint.
+static constexpr float SCALES[5] = { 10.0f, 10.0f, 10.0f, 10.0f, 1.0f };
+
+static void putLe16(uint8_t* p, uint16_t value) {
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static void putLe32(uint8_t* p, uint32_t value) {
+    putLe16(p, static_cast<uint16_t>(value));
+    putLe16(p + 2, static_cast<uint16_t>(value >> 16));
+}
+
+static uint16_t getLe16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t getLe32(const uint8_t* p) {
+    return getLe16(p) | (static_cast<uint32_t>(getLe16(p + 2)) << 16);
+}
+
+static size_t putVarint(uint8_t* p, uint32_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        p[n++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    p[n++] = static_cast<uint8_t>(value);
+    return n;
+}
+
+// Returns false if the varint is truncated or longer than 32 bits.
+static bool getVarint(const uint8_t* p, size_t length, size_t& offset, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && offset < length; shift += 7) {
+        uint8_t byte = p[offset++];
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static uint32_t zigzag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+static int32_t quantize(float value, float scale) {
+    float scaled = value * scale;
+    if (!std::isfinite(scaled)) return 0;
+    if (scaled > 1e9f) return 1000000000;
+    if (scaled < -1e9f) return -1000000000;
+    return static_cast<int32_t>(lroundf(scaled));
+}
+
+static uint32_t nowMs() {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+SampleLog::SampleLog(std::shared_ptr<EEPROMStorage> eeprom, uint16_t start, uint32_t size)
+        : eeprom(std::move(eeprom))
+        , start(start)
+        , blockCount(size / BLOCK_SIZE)
+        , openSinceMs(0)
+        , openDirty(false)
+        , pendingCount(0)
+        , nextSeq(1)
+        , bootId(0)
+        , mounted(false)
+{
+    if (blockCount > MAX_BLOCKS) {
+        blockCount = MAX_BLOCKS;
+    }
+    memset(blockSeq, 0, sizeof(blockSeq));
+    memset(blockRecords, 0, sizeof(blockRecords));
+    openBlock(0);
+    blocksMetric  = g_metrics.add(blocksDescriptor);
+    droppedMetric = g_metrics.add(droppedDescriptor);
+}
+
+// ----------------------------------------------------------------------------
+// mount(): read the block headers once at boot.
+// ----------------------------------------------------------------------------
+/*
+    The newest block is the one with the highest end sequence number; the log continues in
+    the block after it, which holds the oldest records. Headers are only checked for their
+    magic here; a torn block is found by its CRC when it is read.
+*/
+bool SampleLog::mount() {
+    std::lock_guard<Fmutex> exclusive(access);
+    mounted = false;
+    if (!eeprom || blockCount < 2) {
+        printf("[SampleLog] Region too small or no EEPROM\n");
+        return false;
+    }
+
+    size_t newest = blockCount;
+    uint32_t newestEnd = 0;
+    uint16_t newestBoot = 0;
+    size_t blocks = 0;
+    for (size_t i = 0; i < blockCount; i++) {
+        uint8_t header[HEADER_SIZE];
+        if (!eeprom->readBytes(blockAddr(i), header, sizeof(header))) {
+            printf("[SampleLog] EEPROM not readable, keeping samples in RAM only\n");
+            return false;
+        }
+        uint8_t count = header[12];
+        bool valid = getLe16(header) == BLOCK_MAGIC && count > 0 && header[13] <= PAYLOAD_SIZE;
+        blockSeq[i] = getLe32(header + 4);
+        blockRecords[i] = valid ? count : 0;
+        if (!valid) continue;
+        blocks++;
+        uint32_t end = blockSeq[i] + count;
+        if (newest == blockCount || end > newestEnd) {
+            newest = i;
+            newestEnd = end;
+            newestBoot = getLe16(header + 2);
+        }
+    }
+
+    if (newest != blockCount) {
+        nextSeq = newestEnd;
+        bootId = static_cast<uint16_t>(newestBoot + 1);
+    }
+    pendingCount = 0;
+    openBlock(newest == blockCount ? 0 : (newest + 1) % blockCount);
+    mounted = true;
+
+    printf("[SampleLog] Mounted: %u blocks, next sequence %lu, boot %u\n",
+           (unsigned)blocks, (unsigned long)nextSeq, (unsigned)bootId);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// append(): encode a record into the open block (any task).
+// ----------------------------------------------------------------------------
+uint32_t SampleLog::append(const TelemetryRecord& record) {
+    std::lock_guard<Fmutex> exclusive(access);
+    uint8_t encoded[MAX_RECORD_SIZE];
+    Base base = openBase;
+    size_t length = encode(record, base, encoded);
+    if (open.length + length > PAYLOAD_SIZE || open.count == UINT8_MAX) {
+        seal();
+        base = Base();
+        length = encode(record, base, encoded);
+    }
+    memcpy(open.payload + open.length, encoded, length);
+    open.length = static_cast<uint8_t>(open.length + length);
+    open.count++;
+    openBase = base;
+    if (!openDirty) {
+        openDirty = true;
+        openSinceMs = nowMs();
+    }
+    return nextSeq++;
+}
+
+// ----------------------------------------------------------------------------
+// sync(): write sealed blocks and the due open block (pipeline task).
+// ----------------------------------------------------------------------------
+/*
+    The block is copied under the mutex and written without it. If seal() dropped it from
+    the pending blocks in the meantime (backlog full), it is still indexed, since it reached
+    the EEPROM; its position is only reused after a pass through the whole ring.
+*/
+bool SampleLog::sync() {
+    std::lock_guard<Fmutex> serialized(syncing);
+    if (!mounted) {
+        return false;
+    }
+
+    Block block;
+    while (true) {
+        {
+            std::lock_guard<Fmutex> exclusive(access);
+            if (pendingCount == 0) break;
+            block = pending[0];
+        }
+        if (!writeBlock(block)) {
+            return false;
+        }
+        std::lock_guard<Fmutex> exclusive(access);
+        if (pendingCount && pending[0].firstSeq == block.firstSeq) {
+            memmove(&pending[0], &pending[1], (pendingCount - 1) * sizeof(Block));
+            pendingCount--;
+        }
+        blockSeq[block.position] = block.firstSeq;
+        blockRecords[block.position] = block.count;
+    }
+
+    {
+        std::lock_guard<Fmutex> exclusive(access);
+        if (!openDirty || nowMs() - openSinceMs < PARTIAL_SYNC_MS) {
+            return true;
+        }
+        block = open;
+    }
+    if (!writeBlock(block)) {
+        return false;
+    }
+    std::lock_guard<Fmutex> exclusive(access);
+    if (open.firstSeq == block.firstSeq) {
+        // Records appended during the write wait for the next partial write.
+        openDirty = open.count != block.count;
+        openSinceMs = nowMs();
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// read(): records from a sequence number on (any task).
+// ----------------------------------------------------------------------------
+/*
+    For every step the block holding 'seq' (or the first one after it) is looked up in RAM:
+    the open and pending blocks are decoded directly, a block on the EEPROM is read outside
+    the mutex and checked against its index entry and CRC. A block that fails the check is
+    skipped.
+*/
+size_t SampleLog::read(uint32_t& seq, LoggedSample* out, size_t max) {
+    size_t copied = 0;
+    uint8_t buffer[BLOCK_SIZE];
+    while (copied < max) {
+        size_t position = blockCount;
+        uint32_t firstSeq = 0;
+        uint8_t count = 0;
+        {
+            std::lock_guard<Fmutex> exclusive(access);
+            if (seq >= nextSeq) break;
+
+            // RAM blocks and the EEPROM index never describe the same records.
+            const Block* ram = nullptr;
+            uint32_t best = nextSeq;
+            auto consider = [&](uint32_t first, uint8_t records) {
+                if (records && first + records > seq && first < best) {
+                    best = first;
+                    return true;
+                }
+                return false;
+            };
+            for (size_t i = 0; i < blockCount; i++) {
+                if (consider(blockSeq[i], blockRecords[i])) {
+                    position = i;
+                    firstSeq = blockSeq[i];
+                    count = blockRecords[i];
+                }
+            }
+            for (size_t i = 0; i < pendingCount; i++) {
+                if (consider(pending[i].firstSeq, pending[i].count)) ram = &pending[i];
+            }
+            if (consider(open.firstSeq, open.count)) ram = &open;
+
+            if (best == nextSeq) {
+                seq = nextSeq;
+                break;
+            }
+            if (best > seq) {
+                seq = best;              // Records before 'best' are no longer in the log.
+            }
+            if (ram && ram->firstSeq == best) {
+                size_t n = decode(ram->payload, ram->length, ram->count, ram->firstSeq,
+                                  0, true, seq, out + copied, max - copied);
+                copied += n;
+                seq = n ? seq + n : ram->firstSeq + ram->count;
+                continue;
+            }
+        }
+
+        uint32_t end = firstSeq + count;
+        if (!eeprom->readBytes(blockAddr(position), buffer, sizeof(buffer))) {
+            break;
+        }
+        uint8_t length = buffer[13];
+        bool valid = getLe16(buffer) == BLOCK_MAGIC && getLe32(buffer + 4) == firstSeq &&
+                     buffer[12] == count && length <= PAYLOAD_SIZE;
+        if (valid) {
+            uint32_t crc = crc32(buffer + HEADER_SIZE, length, crc32(buffer, CRC_OFFSET));
+            valid = crc == getLe32(buffer + CRC_OFFSET);
+        }
+        if (!valid) {
+            printf("[SampleLog] Block %u is damaged, skipping %u samples\n", (unsigned)position, count);
+            seq = end;
+            continue;
+        }
+
+        bool currentBoot = getLe16(buffer + 2) == bootId;
+        size_t n = decode(buffer + HEADER_SIZE, length, count, firstSeq, getLe32(buffer + 8),
+                          currentBoot, seq, out + copied, max - copied);
+        copied += n;
+        seq = n ? seq + n : end;
+    }
+    return copied;
+}
+
+uint32_t SampleLog::getOldestSeq() const {
+    std::lock_guard<Fmutex> exclusive(access);
+    uint32_t oldest = nextSeq;
+    auto consider = [&oldest](uint32_t first, uint8_t records) {
+        if (records && first < oldest) oldest = first;
+    };
+    for (size_t i = 0; i < blockCount; i++) {
+        consider(blockSeq[i], blockRecords[i]);
+    }
+    for (size_t i = 0; i < pendingCount; i++) {
+        consider(pending[i].firstSeq, pending[i].count);
+    }
+    consider(open.firstSeq, open.count);
+    return oldest;
+}
+
+uint32_t SampleLog::getNextSeq() const {
+    std::lock_guard<Fmutex> exclusive(access);
+    return nextSeq;
+}
+
+bool SampleLog::isMounted() const {
+    std::lock_guard<Fmutex> exclusive(access);
+    return mounted;
+}
+
+// ----------------------------------------------------------------------------
+// Private helpers
+// ----------------------------------------------------------------------------
+uint16_t SampleLog::blockAddr(size_t position) const {
+    return static_cast<uint16_t>(start + position * BLOCK_SIZE);
+}
+
+// The records of the block at 'position' are dropped from the index now: they are about to
+// be overwritten and must not be read back in between.
+void SampleLog::openBlock(size_t position) {
+    open.position = position;
+    open.firstSeq = nextSeq;
+    open.count = 0;
+    open.length = 0;
+    openBase = Base();
+    openDirty = false;
+    if (position < blockCount) {
+        blockRecords[position] = 0;
+    }
+}
+
+void SampleLog::seal() {
+    if (pendingCount == PENDING_BLOCKS) {
+        // The EEPROM has not kept up; the oldest unwritten block is lost.
+        g_metrics.inc(droppedMetric, pending[0].count);
+        printf("[SampleLog] Write backlog full, %u samples dropped\n", pending[0].count);
+        memmove(&pending[0], &pending[1], (PENDING_BLOCKS - 1) * sizeof(Block));
+        pendingCount--;
+    }
+    pending[pendingCount++] = open;
+    size_t next = open.position + 1;
+    openBlock(next < blockCount ? next : 0);
+}
+
+bool SampleLog::writeBlock(const Block& block) {
+    uint8_t buffer[BLOCK_SIZE];
+    memset(buffer, 0xFF, sizeof(buffer));
+    // UTC at boot lets records of this boot be dated after the next reset.
+    uint64_t bootUtcMs = WallClock::toUtcMs(0);
+    putLe16(buffer, BLOCK_MAGIC);
+    putLe16(buffer + 2, bootId);
+    putLe32(buffer + 4, block.firstSeq);
+    putLe32(buffer + 8, static_cast<uint32_t>(bootUtcMs / 1000));
+    buffer[12] = block.count;
+    buffer[13] = block.length;
+    memcpy(buffer + HEADER_SIZE, block.payload, block.length);
+    putLe32(buffer + CRC_OFFSET, crc32(block.payload, block.length, crc32(buffer, CRC_OFFSET)));
+
+    // Only the used part is written; the rest of the block is never read.
+    if (!eeprom->writeBytes(blockAddr(block.position), buffer, HEADER_SIZE + block.length)) {
+        printf("[SampleLog] Failed to write block %u\n", (unsigned)block.position);
+        return false;
+    }
+    g_metrics.inc(blocksMetric);
+    return true;
+}
+
+size_t SampleLog::decode(const uint8_t* payload, size_t length, uint8_t count, uint32_t firstSeq,
+                         uint32_t bootUtc, bool currentBoot, uint32_t first,
+                         LoggedSample* out, size_t max) {
+    Base base;
+    size_t offset = 0;
+    size_t copied = 0;
+    for (uint8_t i = 0; i < count && copied < max; i++) {
+        if (offset >= length) break;
+        uint8_t flags = payload[offset++];
+        uint32_t delta;
+        if (!getVarint(payload, length, offset, delta)) break;
+        base.timestampMs += delta;
+        for (int v = 0; v < 5; v++) {
+            if (!getVarint(payload, length, offset, delta)) return copied;
+            base.values[v] += unzigzag(delta);
+        }
+        uint32_t seq = firstSeq + i;
+        if (seq < first) continue;
+
+        LoggedSample& sample = out[copied++];
+        sample.seq = seq;
+        sample.currentBoot = currentBoot;
+        TelemetryRecord& r = sample.record;
+        r.timestampMs = base.timestampMs;
+        r.co2      = base.values[0] / SCALES[0];
+        r.rh       = base.values[1] / SCALES[1];
+        r.temp     = base.values[2] / SCALES[2];
+        r.fanSpeed = base.values[3] / SCALES[3];
+        r.setpoint = base.values[4] / SCALES[4];
+        r.flags    = flags;
+        if (currentBoot) {
+            sample.utcMs = WallClock::toUtcMs(r.timestampMs);
+        } else {
+            sample.utcMs = bootUtc ? static_cast<uint64_t>(bootUtc) * 1000 + r.timestampMs : 0;
+        }
+    }
+    return copied;
+}
+
+size_t SampleLog::encode(const TelemetryRecord& record, Base& base, uint8_t* out) {
+    const float values[5] = { record.co2, record.rh, record.temp, record.fanSpeed, record.setpoint };
+    size_t n = 0;
+    out[n++] = record.flags;
+    n += putVarint(out + n, record.timestampMs - base.timestampMs);
+    base.timestampMs = record.timestampMs;
+    for (int v = 0; v < 5; v++) {
+        int32_t q = quantize(values[v], SCALES[v]);
+        n += putVarint(out + n, zigzag(q - base.values[v]));
+        base.values[v] = q;
+    }
+    return n;
+}
+
+// CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320); 'crc' continues an earlier result.
+uint32_t SampleLog::crc32(const uint8_t* data, size_t length, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
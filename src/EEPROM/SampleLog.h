@@ -0,0 +1,155 @@
+#ifndef SAMPLE_LOG_H
+#define SAMPLE_LOG_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "Fmutex.h"
+#include "EEPROMStorage.h"
+#include "cloud/TelemetryRecord.h"
+#include "metrics/Metrics.h"
+
+/*
+   LoggedSample:
+   One record read back from the SampleLog.
+*/
+struct LoggedSample {
+    TelemetryRecord record;   // timestampMs counts from the boot that recorded the sample.
+    uint32_t seq;             // Sequence number in the log.
+    uint64_t utcMs;           // UTC of the sample, 0 if unknown.
+    bool currentBoot;         // Recorded since this boot (timestampMs is comparable to now).
+};
+
+/*
+   SampleLog Class
+
+   A persistent circular log of the telemetry records, kept in a region of the external
+   EEPROM, so that the history survives hours without network (the sink queues in RAM
+   hold only a few minutes) and resets.
+
+   On-EEPROM layout:
+     - The region is divided into blocks of BLOCK_SIZE bytes (two EEPROM pages) used as a
+       ring; the oldest block is overwritten when the log is full.
+     - Every block starts with a header:
+         magic (2) | boot number (2) | first sequence number (4) | boot UTC (4, seconds) |
+         record count (1) | payload length (1) | CRC-32 of header and payload (4)
+       All numbers are little-endian. The boot UTC is the wall-clock time at which the
+       boot that recorded the block started (0 while it was unknown), so records of an
+       earlier boot can still be given their UTC time.
+     - The payload holds the records, delta-encoded against the previous record of the
+       block (the first one against zero) and packed as varints:
+         flags (1) | Δtimestamp ms | Δco2 | Δrh | Δtemp | Δfan | Δsetpoint
+       The readings are stored with a resolution of 0.1 (setpoint: 1 ppm) and the deltas
+       zigzag-encoded, so a typical record takes 8-10 bytes and a block holds about a dozen.
+       Every block decodes on its own; a torn or stale block only fails its CRC.
+
+   Batching:
+     - append() only encodes the record into the open block in RAM. A full block is sealed
+       and written by sync() (pipeline task) with one block write, i.e. two page write
+       cycles for about a dozen samples instead of one per sample. The open block is also
+       written in place once it has been open for PARTIAL_SYNC_MS, which bounds the samples
+       lost by a reset. Sealed blocks wait in RAM (PENDING_BLOCKS) while the EEPROM is busy.
+     - The block is the erase/program unit of the layout: on a flash part it would be sized
+       and aligned to the erase sector, so a sector is erased once per block.
+
+   mount() reads the block headers once at boot and keeps the sequence range of every
+   block in RAM; read() then loads only the blocks it needs. Records still in RAM (open or
+   not yet written) are read from there. All methods are thread-safe and must be called
+   from tasks (see EEPROMStorage).
+*/
+class SampleLog {
+public:
+    static constexpr size_t   BLOCK_SIZE      = 128;     // Multiple of the EEPROM page size.
+    static constexpr size_t   HEADER_SIZE     = 18;
+    static constexpr size_t   PAYLOAD_SIZE    = BLOCK_SIZE - HEADER_SIZE;
+    static constexpr size_t   MAX_BLOCKS      = 192;
+    static constexpr size_t   PENDING_BLOCKS  = 4;       // Sealed blocks waiting for sync().
+    static constexpr uint32_t PARTIAL_SYNC_MS = 600000;  // Longest time a record stays in RAM only.
+
+    // start: first byte of the region, size: its length (at least two blocks).
+    SampleLog(std::shared_ptr<EEPROMStorage> eeprom, uint16_t start, uint32_t size);
+
+    SampleLog(const SampleLog&) = delete;
+
+    // Reads the block headers and continues after the newest record. Returns false if the
+    // EEPROM could not be read; records are then kept in RAM only.
+    bool mount();
+
+    // Adds a record to the open block (RAM only). Returns its sequence number.
+    uint32_t append(const TelemetryRecord& record);
+
+    // Writes the sealed blocks, and the open block once it is due. Returns false if a
+    // write failed (the block is retried with the next call).
+    bool sync();
+
+    // Copies up to 'max' records starting at sequence number 'seq' (oldest first) and
+    // advances 'seq' past them. Records that are no longer in the log are skipped, so the
+    // first record may have a larger sequence number than requested. Returns the number
+    // of records copied; 0 when 'seq' has reached getNextSeq().
+    size_t read(uint32_t& seq, LoggedSample* out, size_t max);
+
+    // Sequence numbers of the oldest record still in the log and of the next record.
+    uint32_t getOldestSeq() const;
+    uint32_t getNextSeq() const;
+
+    bool isMounted() const;
+
+private:
+    // A block in RAM: the open block or a sealed one waiting to be written.
+    struct Block {
+        size_t   position = 0;      // Index of the block in the ring.
+        uint32_t firstSeq = 0;
+        uint8_t  count = 0;
+        uint8_t  length = 0;        // Payload bytes used.
+        uint8_t  payload[PAYLOAD_SIZE];
+    };
+
+    // Values of the previous record, the base of the next delta.
+    struct Base {
+        uint32_t timestampMs = 0;
+        int32_t  values[5] = {};
+    };
+
+    std::shared_ptr<EEPROMStorage> eeprom;
+    mutable Fmutex access;
+    Fmutex syncing;                       // One sync() at a time.
+    uint16_t start;
+    size_t blockCount;
+
+    // Sequence range of every block on the EEPROM (count 0: empty, invalid or being rewritten).
+    uint32_t blockSeq[MAX_BLOCKS];
+    uint8_t  blockRecords[MAX_BLOCKS];
+
+    Block    open;                        // Block that records are appended to.
+    Base     openBase;                    // Last record of the open block.
+    uint32_t openSinceMs;                 // First record of the open block not yet on the EEPROM.
+    bool     openDirty;                   // The open block has records not yet on the EEPROM.
+    Block    pending[PENDING_BLOCKS];     // Sealed blocks, oldest first.
+    size_t   pendingCount;
+    uint32_t nextSeq;
+    uint16_t bootId;                      // Boot number written into the blocks of this boot.
+    bool     mounted;
+
+    MetricId blocksMetric;
+    MetricId droppedMetric;
+
+    uint16_t blockAddr(size_t position) const;
+
+    // Starts a new open block at 'position'.
+    void openBlock(size_t position);
+
+    // Moves the open block to the pending blocks and opens the next one.
+    void seal();
+
+    // Writes 'block' to its position. Called without holding 'access'.
+    bool writeBlock(const Block& block);
+
+    // Decodes the records of a block from 'first' on into 'out'. Returns the number copied.
+    static size_t decode(const uint8_t* payload, size_t length, uint8_t count, uint32_t firstSeq,
+                         uint32_t bootUtc, bool currentBoot, uint32_t first, LoggedSample* out, size_t max);
+
+    static size_t encode(const TelemetryRecord& record, Base& base, uint8_t* out);
+    static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0);
+};
+
+#endif // SAMPLE_LOG_H
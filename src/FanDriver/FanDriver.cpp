@@ -13,6 +13,11 @@ static float clamp(float val, float lo, float hi) {
     return val;
 }
 
+static const MetricDescriptor writesDescriptor = {
+    "greenhouse_fan_writes_total", "Fan speed register writes.", MetricType::Counter };
+static const MetricDescriptor changesDescriptor = {
+    "greenhouse_fan_speed_changes_total", "Number of times the commanded fan speed changed.", MetricType::Counter };
+
 /*
    FanDriver Class Constructor
 
@@ -24,6 +29,8 @@ FanDriver::FanDriver(std::shared_ptr<ModbusRegister> fanRegister)
         : fanReg_(fanRegister),
           currentSpeed_(0.0f)
 {
+    writesMetric_  = g_metrics.add(writesDescriptor);
+    changesMetric_ = g_metrics.add(changesDescriptor);
 }
 
 /*
@@ -59,6 +66,11 @@ void FanDriver::setFanSpeed(float percent) {
     //     printf("FanDriver: write register failed\n");
     // }
 
+    g_metrics.inc(writesMetric_);
+    if (percent != currentSpeed_) {
+        g_metrics.inc(changesMetric_);
+    }
+
     // Update the current fan speed stored for status reporting.
     currentSpeed_ = percent;
 }
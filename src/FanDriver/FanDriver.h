@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <cstdint>
+#include "metrics/Metrics.h"
 
 class ModbusRegister;
 
@@ -49,4 +50,6 @@ public:
 private:
     std::shared_ptr<ModbusRegister> fanReg_;  ///< Pointer to the Modbus register for fan speed control.
     float currentSpeed_;                      ///< Cached fan speed (in percent) as last commanded.
+    MetricId writesMetric_;                   ///< Counter of fan speed register writes.
+    MetricId changesMetric_;                  ///< Counter of fan speed changes.
 };
\ No newline at end of file
@@ -22,6 +22,11 @@ void Fmutex::lock()
 	xSemaphoreTake(mutex, portMAX_DELAY);
 }
 
+bool Fmutex::try_lock()
+{
+	return xSemaphoreTake(mutex, 0) == pdTRUE;
+}
+
 void Fmutex::unlock()
 {
 	xSemaphoreGive(mutex);
@@ -16,6 +16,7 @@ public:
 	Fmutex();
 	~Fmutex();
 	void lock();
+	bool try_lock();	// Takes the mutex only if it is free.
 	void unlock();
 private:
 	SemaphoreHandle_t mutex;
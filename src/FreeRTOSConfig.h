@@ -109,6 +109,13 @@
 /* Define the data type for stack depth; using uint32_t ensures compatibility with the RP2040 architecture */
 #define configSTACK_DEPTH_TYPE                  uint32_t
 
+/* Two notification slots per task. Index 0 belongs to the drivers that block the calling task
+   until their interrupt or callback arrives (PicoI2C, HttpsSession); worker tasks are woken on
+   WAKEUP_NOTIFICATION_INDEX (ConfigCache, TelemetryPipeline, SampleLogExport), so a wake-up can
+   never end a driver's wait early */
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES   2
+#define WAKEUP_NOTIFICATION_INDEX               1
+
 /* Define type for message buffer lengths */
 #define configMESSAGE_BUFFER_LENGTH_TYPE        size_t
 
@@ -1,5 +1,11 @@
 #include "ValveDriver.h"          // Include the header file for the ValveDriver class
 #include "hardware/gpio.h"          // Include the Pico SDK's GPIO header for digital I/O operations
+#include "pico/time.h"              // time_us_64() for measuring how long the valve is open
+
+static const MetricDescriptor openingsDescriptor = {
+    "greenhouse_valve_openings_total", "Number of times the CO2 valve was opened.", MetricType::Counter };
+static const MetricDescriptor openTimeDescriptor = {
+    "greenhouse_valve_open_milliseconds_total", "Total time the CO2 valve has been open.", MetricType::Counter };
 
 /*
  * Constructor for the ValveDriver class.
@@ -10,8 +16,11 @@
  * @param gpioPin: The GPIO pin number that is connected to the valve driver.
  */
 ValveDriver::ValveDriver(uint gpioPin)
-        : pin(gpioPin), valveOpen(false)  // Initialize the pin number and set the valve to closed (false)
+        : pin(gpioPin), valveOpen(false), openedAtUs(0)  // Initialize the pin number and set the valve to closed (false)
 {
+    openingsMetric = g_metrics.add(openingsDescriptor);
+    openTimeMetric = g_metrics.add(openTimeDescriptor);
+
     gpio_init(pin);                // Initialize the specified GPIO pin
     gpio_set_dir(pin, GPIO_OUT);   // Set the GPIO pin to output mode for controlling the valve
     gpio_put(pin, false);          // Ensure the valve is initially closed by setting the output low
@@ -25,6 +34,10 @@ ValveDriver::ValveDriver(uint gpioPin)
  */
 void ValveDriver::openValve() {
     gpio_put(pin, true);           // Set the GPIO pin high to open the valve
+    if (!valveOpen) {              // Count the opening and remember when it happened
+        openedAtUs = time_us_64();
+        g_metrics.inc(openingsMetric);
+    }
     valveOpen = true;              // Update internal state to reflect that the valve is open
 }
 
@@ -36,6 +49,9 @@ void ValveDriver::openValve() {
  */
 void ValveDriver::closeValve() {
     gpio_put(pin, false);          // Set the GPIO pin low to close the valve
+    if (valveOpen) {               // Add the time the valve was open
+        g_metrics.inc(openTimeMetric, static_cast<uint32_t>((time_us_64() - openedAtUs) / 1000));
+    }
     valveOpen = false;             // Update internal state to reflect that the valve is closed
 }
 
@@ -3,6 +3,7 @@
 
 #include <cstdint>   // Provides fixed-width integer types for consistency across platforms
 #include <cstdio>    // Standard I/O library for debugging messages (if needed)
+#include "metrics/Metrics.h"  // Counters of valve openings and open time
 
 /**
  * @brief The ValveDriver class provides an abstraction for controlling a CO₂ valve using 
@@ -56,6 +57,9 @@ public:
 private:
     uint pin;       ///< GPIO pin number used for controlling the valve.
     bool valveOpen; ///< Internal flag tracking the current state of the valve (true if open, false if closed).
+    uint64_t openedAtUs;         ///< time_us_64() when the valve was last opened.
+    MetricId openingsMetric;     ///< Counter of valve openings.
+    MetricId openTimeMetric;     ///< Counter of the total time the valve has been open (ms).
 };
 
 #endif // VALVE_DRIVER_H
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "ChangeDetector.h"
+#include <cmath>
+#include <utility>
+
+#include "pico/stdlib.h"
+
+// =============================================================================
+//                        ChangeDetector Implementation
+// =============================================================================
+
+ChangeDetector::ChangeDetector(Controller* controller, std::shared_ptr<TelemetryPipeline> pipeline,
+                               const ChangeDetectorConfig& config)
+        : controller_(controller)
+        , pipeline_(std::move(pipeline))
+        , config_(config)
+        , haveReported_(false)
+        , lastReportedMs_(0)
+        , lastStateFlags_(0)
+        , lastFanSpeed_(0.0f)
+        , lastSetpoint_(0.0f)
+        , pendingReasons_(0)
+        , latchedStateFlags_(0)
+        , emittedCount_(0)
+        , evaluatedCount_(0)
+{
+}
+
+// ----------------------------------------------------------------------------
+// evaluate(): emit a record if something changed or the heartbeat is due.
+// ----------------------------------------------------------------------------
+/*
+    State changes are latched in pendingReasons_ as soon as they are seen, because they
+    can be shorter than the rate limit (the valve is only open for two seconds). The state
+    flags seen while rate limited are latched too, so the emitted record still shows a valve
+    pulse that has already ended. Deadband crossings are measured against the last reported
+    record, so a slow drift is reported once it has accumulated beyond the deadband.
+*/
+bool ChangeDetector::evaluate() {
+    if (!controller_ || !pipeline_) return false;
+    evaluatedCount_++;
+
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    TelemetryRecord current = sample(now);
+
+    // 1) Latch state changes since the previous evaluation.
+    uint8_t stateFlags = current.flags & (TelemetryRecord::VALVE_OPEN | TelemetryRecord::SAFETY_VENT);
+    if (stateFlags != lastStateFlags_ ||
+        current.fanSpeed != lastFanSpeed_ ||
+        current.setpoint != lastSetpoint_) {
+        pendingReasons_ |= TelemetryRecord::REASON_STATE;
+    }
+    lastStateFlags_ = stateFlags;
+    latchedStateFlags_ |= stateFlags;
+    lastFanSpeed_   = current.fanSpeed;
+    lastSetpoint_   = current.setpoint;
+
+    // 2) Deadbands against the last reported record.
+    if (haveReported_ &&
+        (std::fabs(current.co2  - lastReported_.co2)  >= config_.co2Deadband ||
+         std::fabs(current.rh   - lastReported_.rh)   >= config_.rhDeadband  ||
+         std::fabs(current.temp - lastReported_.temp) >= config_.tempDeadband)) {
+        pendingReasons_ |= TelemetryRecord::REASON_DEADBAND;
+    }
+
+    // 3) Heartbeat (the first evaluation always reports).
+    uint32_t sinceLast = now - lastReportedMs_;
+    if (!haveReported_ || sinceLast >= config_.heartbeatMs) {
+        pendingReasons_ |= TelemetryRecord::REASON_HEARTBEAT;
+    }
+
+    // 4) Rate limit.
+    if (pendingReasons_ == 0 || (haveReported_ && sinceLast < config_.minIntervalMs)) {
+        return false;
+    }
+
+    current.flags |= pendingReasons_ | latchedStateFlags_;
+    pipeline_->push(current);
+    lastReported_   = current;
+    lastReportedMs_ = now;
+    haveReported_   = true;
+    pendingReasons_ = 0;
+    latchedStateFlags_ = 0;
+    emittedCount_++;
+    return true;
+}
+
+void ChangeDetector::requestReport(uint8_t reason) {
+    pendingReasons_ |= reason;
+}
+
+uint32_t ChangeDetector::getEmittedCount() const {
+    return emittedCount_;
+}
+
+uint32_t ChangeDetector::getEvaluatedCount() const {
+    return evaluatedCount_;
+}
+
+// ----------------------------------------------------------------------------
+// sample(): snapshot of the current Controller values.
+// ----------------------------------------------------------------------------
+TelemetryRecord ChangeDetector::sample(uint32_t nowMs) const {
+    TelemetryRecord record;
+    record.timestampMs = nowMs;
+    record.co2      = controller_->getCurrentCO2();
+    record.rh       = controller_->getCurrentRH();
+    record.temp     = controller_->getCurrentTemp();
+    record.fanSpeed = controller_->getCurrentFanSpeed();
+    record.setpoint = controller_->getCO2Setpoint();
+    if (controller_->isValveOpen())        record.flags |= TelemetryRecord::VALVE_OPEN;
+    if (controller_->isSafetyVentActive()) record.flags |= TelemetryRecord::SAFETY_VENT;
+    return record;
+}
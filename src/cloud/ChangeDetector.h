@@ -0,0 +1,76 @@
+#ifndef CHANGE_DETECTOR_H
+#define CHANGE_DETECTOR_H
+
+#include <cstdint>
+#include <memory>
+#include "Controller/Controller.h"
+#include "TelemetryPipeline.h"
+
+/*
+   Report-by-exception settings. A value is reported when it differs from the last
+   reported value by at least its deadband; state changes are always reported.
+*/
+struct ChangeDetectorConfig {
+    float co2Deadband  = 50.0f;           // ppm
+    float rhDeadband   = 2.0f;            // %
+    float tempDeadband = 0.5f;            // °C
+    uint32_t minIntervalMs = 5000;        // Rate limit: at most one record per interval.
+    uint32_t heartbeatMs   = 300000;      // A record is emitted at least this often.
+};
+
+/*
+   ChangeDetector Module Header
+
+   This module decides when a telemetry record is worth sending. Instead of sampling at
+   a fixed rate it is evaluated on every control cycle and appends a record to the
+   telemetry pipeline (and so to every sink) only when:
+     - CO₂, relative humidity or temperature moved beyond its deadband since the last
+       reported record,
+     - a state changed: valve opened/closed, fan speed or setpoint changed, safety vent
+       activated/deactivated (even if the change lasted shorter than the rate limit),
+     - or the heartbeat interval elapsed without any record.
+   Records are rate limited, so a fast excursion produces a record every minIntervalMs
+   rather than one per control cycle.
+
+   The module is used by sensorTask only, so it needs no locking of its own.
+*/
+class ChangeDetector {
+public:
+    ChangeDetector(Controller* controller, std::shared_ptr<TelemetryPipeline> pipeline,
+                   const ChangeDetectorConfig& config = ChangeDetectorConfig());
+
+    // Compares the current Controller values with the last reported record and pushes a
+    // new record when required. Returns true if a record was emitted.
+    bool evaluate();
+
+    // Forces a record at the next evaluate() (still rate limited), e.g. so that command
+    // acknowledgements are uploaded soon. 'reason' is one of the TelemetryRecord REASON bits.
+    void requestReport(uint8_t reason);
+
+    uint32_t getEmittedCount() const;    // Records pushed to the pipeline.
+    uint32_t getEvaluatedCount() const;  // Number of evaluate() calls.
+
+private:
+    Controller* controller_;
+    std::shared_ptr<TelemetryPipeline> pipeline_;
+    ChangeDetectorConfig config_;
+
+    TelemetryRecord lastReported_;       // Last record pushed to the pipeline.
+    bool haveReported_;
+    uint32_t lastReportedMs_;
+
+    // State seen in the previous evaluation, used to latch short state changes.
+    uint8_t lastStateFlags_;
+    float lastFanSpeed_;
+    float lastSetpoint_;
+    uint8_t pendingReasons_;             // Reasons collected while rate limited.
+    uint8_t latchedStateFlags_;          // VALVE_OPEN/SAFETY_VENT seen since the last record.
+
+    uint32_t emittedCount_;
+    uint32_t evaluatedCount_;
+
+    // Fills a record with the current Controller values.
+    TelemetryRecord sample(uint32_t nowMs) const;
+};
+
+#endif // CHANGE_DETECTOR_H
@@ -0,0 +1,159 @@
+#include "HttpJsonSink.h"
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "TlsProfile.h"
+#include "WallClock.h"
+
+// The sink is only compiled in when an endpoint is configured in http_sink_config.h.
+#ifdef HTTP_SINK_HOST
+
+// =============================================================================
+//                          HttpJsonSink Implementation
+// =============================================================================
+
+// ----------------------------------------------------------------------------
+// Constructor / Destructor
+// ----------------------------------------------------------------------------
+HttpJsonSink::HttpJsonSink(const char* host, uint16_t port, std::shared_ptr<DnsCache> dnsCache)
+        : dnsCache_(std::move(dnsCache))
+        , tlsConfig_(nullptr)
+        , lastStatusCode_(0)
+        , lastRetryAfter_(0)
+{
+#if HTTP_SINK_USE_TLS
+#ifdef HTTP_SINK_CA_DER
+    static const uint8_t trustAnchor[] = HTTP_SINK_CA_DER;
+    tlsConfig_ = createTlsClientConfig("HTTP sink", trustAnchor, sizeof(trustAnchor));
+#else
+    tlsConfig_ = createTlsClientConfig("HTTP sink", nullptr, 0);
+#endif
+    if (!tlsConfig_) {
+        return;
+    }
+#endif
+    session_ = std::make_unique<HttpsSession>(host, port, tlsConfig_, dnsCache_.get());
+}
+
+HttpJsonSink::~HttpJsonSink() {
+    // Close the connection before the configuration it uses is freed.
+    session_.reset();
+    if (tlsConfig_) {
+        altcp_tls_free_config(tlsConfig_);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// ITelemetrySink: name, pacing and batch size
+// ----------------------------------------------------------------------------
+const char* HttpJsonSink::getName() const {
+    return "http";
+}
+
+UploadSchedulerConfig HttpJsonSink::getScheduleConfig() const {
+    UploadSchedulerConfig config;
+    config.minIntervalMs = HTTP_SINK_MIN_INTERVAL_MS;
+    config.jitterPercent = HTTP_SINK_JITTER_PERCENT;
+    config.phaseWindowMs = HTTP_SINK_PHASE_WINDOW_MS;
+    config.commandPollMs = 0;
+    config.baseBackoffMs = HTTP_SINK_BASE_BACKOFF_MS;
+    config.maxBackoffMs  = HTTP_SINK_MAX_BACKOFF_MS;
+    return config;
+}
+
+size_t HttpJsonSink::getMaxBatch() const {
+    return HTTP_SINK_MAX_BATCH;
+}
+
+// ----------------------------------------------------------------------------
+// send(): post one batch as a JSON document.
+// ----------------------------------------------------------------------------
+/*
+    Records that do not fit into the body are left for the next request. The request
+    goes over the persistent session, which reconnects when the endpoint closed the
+    idle connection.
+*/
+size_t HttpJsonSink::send(const TelemetryRecord* records, size_t count) {
+    lastStatusCode_ = 0;
+    lastRetryAfter_ = 0;
+    if (!session_) {
+        printf("[HttpSink] No session available.\n");
+        return 0;
+    }
+
+    static constexpr size_t CLOSING_SIZE = 3;       // "]}" and the terminating zero.
+    size_t len = snprintf(body_, sizeof(body_), "{\"device\":\"%s\",\"records\":[", HTTP_SINK_DEVICE);
+    size_t included = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t n = formatRecord(records[i], i == 0, body_ + len, sizeof(body_) - CLOSING_SIZE - len);
+        if (n == 0) break;
+        len += n;
+        included++;
+    }
+    if (included == 0) {
+        printf("[HttpSink] Record does not fit into the request body.\n");
+        return 0;
+    }
+    len += snprintf(body_ + len, sizeof(body_) - len, "]}");
+
+    int requestLen = snprintf(request_, sizeof(request_),
+                              "POST %s HTTP/1.1\r\n"
+                              "Host: %s\r\n"
+                              "Content-Type: application/json\r\n"
+                              "Connection: keep-alive\r\n"
+                              "Content-Length: %u\r\n"
+                              "\r\n"
+                              "%s",
+                              HTTP_SINK_PATH, HTTP_SINK_HOST, (unsigned)len, body_);
+    if (requestLen >= (int)sizeof(request_)) {
+        printf("[HttpSink] Request too large for buffer.\n");
+        return 0;
+    }
+
+    if (!session_->request(request_, response_, HTTP_SINK_TIMEOUT_S)) {
+        printf("[HttpSink] No response from %s.\n", HTTP_SINK_HOST);
+        return 0;
+    }
+    lastStatusCode_ = response_.getStatusCode();
+    lastRetryAfter_ = response_.getRetryAfter();
+    if (!response_.isSuccess()) {
+        printf("[HttpSink] Endpoint answered HTTP %d.\n", lastStatusCode_);
+        return 0;
+    }
+    return included;
+}
+
+int HttpJsonSink::getLastStatusCode() const {
+    return lastStatusCode_;
+}
+
+uint32_t HttpJsonSink::getLastRetryAfter() const {
+    return lastRetryAfter_;
+}
+
+// ----------------------------------------------------------------------------
+// Private helper: formatRecord()
+// ----------------------------------------------------------------------------
+size_t HttpJsonSink::formatRecord(const TelemetryRecord& record, bool first, char* out, size_t size) {
+    char timeField[40] = "";
+    uint64_t utcMs = recordUtcMs(record);
+    if (utcMs) {
+        char iso[24];
+        WallClock::formatIso8601(utcMs, iso, sizeof(iso));
+        snprintf(timeField, sizeof(timeField), ",\"time\":\"%s\"", iso);
+    }
+
+    int n = snprintf(out, size,
+                     "%s{\"uptime_ms\":%lu%s,\"co2\":%.1f,\"rh\":%.1f,\"temp\":%.1f,"
+                     "\"fan\":%.1f,\"setpoint\":%.0f,\"flags\":%u}",
+                     first ? "" : ",", (unsigned long)record.timestampMs, timeField,
+                     record.co2, record.rh, record.temp, record.fanSpeed, record.setpoint,
+                     (unsigned)record.flags);
+    if (n < 0 || (size_t)n >= size) {
+        return 0;
+    }
+    return n;
+}
+
+#endif // HTTP_SINK_HOST
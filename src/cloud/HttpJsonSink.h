@@ -0,0 +1,64 @@
+#ifndef HTTP_JSON_SINK_H
+#define HTTP_JSON_SINK_H
+
+#include <cstdint>
+#include <memory>
+#include "lwip/altcp_tls.h"
+#include "HttpsSession.h"
+#include "HttpResponseParser.h"
+#include "ITelemetrySink.h"
+#include "DnsCache.h"
+#include "http_sink_config.h"
+
+/*
+   HttpJsonSink Module Header
+
+   Telemetry sink for a generic HTTP endpoint: every batch of records is sent as one
+   JSON POST request (format in http_sink_config.h) over a persistent keep-alive
+   connection (HttpsSession, plain HTTP or TLS). Any 2xx answer accepts the batch; a 429
+   (or 503 with Retry-After) makes the pipeline back off as the server asks.
+
+   Pointed at the local stand-in endpoint (tools/mock_telemetry_endpoint.py) it allows
+   upload throughput and failure handling to be measured without the internet.
+*/
+class HttpJsonSink : public ITelemetrySink {
+public:
+    // The DNS cache is optional; without it the host is resolved with lwIP directly.
+    HttpJsonSink(const char* host, uint16_t port = HTTP_SINK_PORT, std::shared_ptr<DnsCache> dnsCache = nullptr);
+    ~HttpJsonSink() override;
+
+    HttpJsonSink(const HttpJsonSink&) = delete;
+
+    // ------------------------------------------------------------------------
+    // ITelemetrySink
+    // ------------------------------------------------------------------------
+    const char* getName() const override;
+    UploadSchedulerConfig getScheduleConfig() const override;
+    size_t getMaxBatch() const override;
+
+    // Posts as many of the records as fit into one request body. Returns that number,
+    // or 0 if the request failed or was not answered with a 2xx status.
+    size_t send(const TelemetryRecord* records, size_t count) override;
+
+    int getLastStatusCode() const override;
+    uint32_t getLastRetryAfter() const override;
+
+private:
+    std::shared_ptr<DnsCache> dnsCache_;
+    struct altcp_tls_config* tlsConfig_;  // nullptr for plain HTTP.
+    std::unique_ptr<HttpsSession> session_;
+    HttpResponseParser response_;
+
+    int lastStatusCode_;
+    uint32_t lastRetryAfter_;
+
+    // Request body and complete request (headers + body).
+    char body_[1536];
+    char request_[1792];
+
+    // Formats one record as a JSON object into 'out'. Returns its length, or 0 if it
+    // does not fit.
+    static size_t formatRecord(const TelemetryRecord& record, bool first, char* out, size_t size);
+};
+
+#endif // HTTP_JSON_SINK_H
@@ -0,0 +1,427 @@
+#include "HttpResponseParser.h"
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <strings.h>
+
+#include "lwip/pbuf.h"
+
+// =============================================================================
+//                     HttpResponseParser Implementation
+// =============================================================================
+
+/*
+   The parser is a byte-driven state machine. Status and header lines are collected in a
+   small line buffer; body bytes are never stored, they are only passed through the
+   command token scanner. Body and chunk data are consumed in runs (as many bytes as the
+   current pbuf and the remaining length allow) rather than one state transition per byte.
+*/
+
+// ----------------------------------------------------------------------------
+// Helpers: character classes used by the command token scanner.
+// ----------------------------------------------------------------------------
+static bool isTokenNameChar(char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static bool isWordChar(char c) {
+    return isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// Characters that end a token value in plain text, URL-encoded or JSON bodies.
+static bool isValueDelimiter(char c) {
+    switch (c) {
+        case '"': case '\'': case ' ': case '\t': case '\r': case '\n':
+        case ',': case '&':  case ';': case '}':  case ']':  case '<':
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Case-insensitive comparison of a header name of known length.
+static bool headerIs(const char* name, size_t length, const char* expected) {
+    return strlen(expected) == length && strncasecmp(name, expected, length) == 0;
+}
+
+// True if the last coding of a Transfer-Encoding list ("gzip, chunked") is chunked.
+static bool lastCodingIsChunked(const char* value) {
+    const char* last = strrchr(value, ',');
+    last = last ? last + 1 : value;
+    while (*last == ' ' || *last == '\t') last++;
+    size_t length = strcspn(last, " \t;");
+    if (!headerIs(last, length, "chunked")) return false;
+    // Only whitespace may follow; chunked takes no parameters.
+    return last[length + strspn(last + length, " \t")] == '\0';
+}
+
+// ----------------------------------------------------------------------------
+// Constructor / reset()
+// ----------------------------------------------------------------------------
+HttpResponseParser::HttpResponseParser() {
+    reset();
+}
+
+void HttpResponseParser::reset() {
+    state_           = State::StatusLine;
+    statusCode_      = 0;
+    http10_          = false;
+    chunked_         = false;
+    transferEncoded_ = false;
+    haveLength_      = false;
+    keepAlive_       = false;
+    connectionClose_ = false;
+    remaining_       = 0;
+    retryAfter_      = 0;
+    bodyLength_      = 0;
+    bodyStart_[0]    = '\0';
+    lineLength_      = 0;
+    lineTruncated_   = false;
+
+    tokenState_       = TokenState::Idle;
+    prevChar_         = '\0';
+    tokenNameLength_  = 0;
+    tokenValueLength_ = 0;
+    tokenOverflow_    = false;
+    commandCount_     = 0;
+}
+
+// ----------------------------------------------------------------------------
+// feed(): process received bytes.
+// ----------------------------------------------------------------------------
+void HttpResponseParser::feed(const struct pbuf* p) {
+    // Walk the chain in place; each pbuf holds 'len' contiguous bytes.
+    for (const struct pbuf* q = p; q != nullptr; q = q->next) {
+        feed(static_cast<const char*>(q->payload), q->len);
+        if (q->len == q->tot_len) break;   // Last pbuf of this packet.
+    }
+}
+
+void HttpResponseParser::feed(const char* data, size_t length) {
+    size_t i = 0;
+    while (i < length && state_ != State::Done && state_ != State::Error) {
+        switch (state_) {
+            case State::StatusLine:
+                if (collectLine(data[i++])) {
+                    parseStatusLine();
+                    lineLength_ = 0;
+                    lineTruncated_ = false;
+                }
+                break;
+
+            case State::Headers:
+                if (collectLine(data[i++])) {
+                    if (lineLength_ == 0) {
+                        endOfHeaders();
+                    } else {
+                        parseHeaderLine();
+                    }
+                    lineLength_ = 0;
+                    lineTruncated_ = false;
+                }
+                break;
+
+            case State::BodyLength:
+            case State::ChunkData: {
+                size_t n = length - i;
+                if (n > remaining_) n = remaining_;
+                scanBody(data + i, n);
+                i += n;
+                remaining_ -= n;
+                if (remaining_ == 0) {
+                    if (state_ == State::BodyLength) {
+                        endOfBody();
+                    } else {
+                        state_ = State::ChunkDataEnd;
+                    }
+                }
+                break;
+            }
+
+            case State::BodyUntilClose:
+                scanBody(data + i, length - i);
+                i = length;
+                break;
+
+            case State::ChunkSize:
+                if (collectLine(data[i++])) {
+                    // Hex size, optionally followed by ";extension".
+                    char* end = nullptr;
+                    unsigned long size = strtoul(line_, &end, 16);
+                    lineLength_ = 0;
+                    if (end == line_) {
+                        state_ = State::Error;
+                    } else if (size == 0) {
+                        state_ = State::Trailer;
+                    } else {
+                        remaining_ = static_cast<uint32_t>(size);
+                        state_ = State::ChunkData;
+                    }
+                }
+                break;
+
+            case State::ChunkDataEnd:
+                // The CRLF that follows the chunk data.
+                if (collectLine(data[i++])) {
+                    lineLength_ = 0;
+                    state_ = State::ChunkSize;
+                }
+                break;
+
+            case State::Trailer:
+                // Trailer headers are ignored; an empty line ends the response.
+                if (collectLine(data[i++])) {
+                    bool empty = (lineLength_ == 0);
+                    lineLength_ = 0;
+                    if (empty) {
+                        endOfBody();
+                    }
+                }
+                break;
+
+            default:
+                return;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// finish(): the server closed the connection.
+// ----------------------------------------------------------------------------
+void HttpResponseParser::finish() {
+    if (state_ == State::BodyUntilClose) {
+        endOfBody();
+    } else if (state_ != State::Done) {
+        state_ = State::Error;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Results
+// ----------------------------------------------------------------------------
+bool HttpResponseParser::isComplete() const {
+    return state_ == State::Done;
+}
+
+bool HttpResponseParser::hasError() const {
+    return state_ == State::Error;
+}
+
+int HttpResponseParser::getStatusCode() const {
+    return statusCode_;
+}
+
+bool HttpResponseParser::isSuccess() const {
+    return statusCode_ >= 200 && statusCode_ < 300;
+}
+
+bool HttpResponseParser::isConnectionClose() const {
+    // HTTP/1.0 closes by default unless keep-alive was negotiated.
+    return connectionClose_ || (http10_ && !keepAlive_);
+}
+
+uint32_t HttpResponseParser::getRetryAfter() const {
+    return retryAfter_;
+}
+
+uint32_t HttpResponseParser::getBodyLength() const {
+    return bodyLength_;
+}
+
+const char* HttpResponseParser::getBodyStart() const {
+    return bodyStart_;
+}
+
+size_t HttpResponseParser::getCommandCount() const {
+    return commandCount_;
+}
+
+const HttpCommandToken& HttpResponseParser::getCommand(size_t index) const {
+    return commands_[index < commandCount_ ? index : 0];
+}
+
+const char* HttpResponseParser::findCommand(const char* name) const {
+    for (size_t i = 0; i < commandCount_; i++) {
+        if (strcmp(commands_[i].name, name) == 0) {
+            return commands_[i].value;
+        }
+    }
+    return nullptr;
+}
+
+// ----------------------------------------------------------------------------
+// Line handling
+// ----------------------------------------------------------------------------
+bool HttpResponseParser::collectLine(char c) {
+    if (c == '\n') {
+        line_[lineLength_] = '\0';
+        return true;
+    }
+    // CR is dropped; characters beyond the buffer are discarded (line truncated).
+    if (c != '\r') {
+        if (lineLength_ < sizeof(line_) - 1) {
+            line_[lineLength_++] = c;
+        } else {
+            lineTruncated_ = true;
+        }
+    }
+    return false;
+}
+
+void HttpResponseParser::parseStatusLine() {
+    // "HTTP/1.1 200 OK"
+    if (strncmp(line_, "HTTP/1.", 7) != 0 || lineLength_ < 12 || line_[8] != ' ') {
+        state_ = State::Error;
+        return;
+    }
+    http10_     = (line_[7] == '0');
+    statusCode_ = atoi(line_ + 9);
+    state_      = State::Headers;
+}
+
+void HttpResponseParser::parseHeaderLine() {
+    const char* colon = static_cast<const char*>(memchr(line_, ':', lineLength_));
+    if (!colon) return;
+
+    size_t nameLength = colon - line_;
+    const char* value = colon + 1;
+    while (*value == ' ' || *value == '\t') value++;
+
+    if (headerIs(line_, nameLength, "Content-Length")) {
+        remaining_  = strtoul(value, nullptr, 10);
+        haveLength_ = true;
+    } else if (headerIs(line_, nameLength, "Transfer-Encoding")) {
+        // The codings are applied in order, so only a list ending in chunked is framed
+        // by chunks; with any other last coding the body runs until the connection closes.
+        // A later header line continues the list, so its last coding decides.
+        if (lineTruncated_) {
+            state_ = State::Error;
+            return;
+        }
+        transferEncoded_ = true;
+        chunked_ = lastCodingIsChunked(value);
+    } else if (headerIs(line_, nameLength, "Connection")) {
+        if (strncasecmp(value, "close", 5) == 0) {
+            connectionClose_ = true;
+        } else if (strncasecmp(value, "keep-alive", 10) == 0) {
+            keepAlive_ = true;
+        }
+    } else if (headerIs(line_, nameLength, "Retry-After")) {
+        // Only the delay-seconds form is supported; an HTTP date is ignored.
+        if (isdigit(static_cast<unsigned char>(*value))) {
+            retryAfter_ = strtoul(value, nullptr, 10);
+        }
+    }
+}
+
+/*
+    Decides how the body is framed once all headers have been read:
+      - 1xx interim responses have no body; the final response follows.
+      - 204 and 304 responses never have a body.
+      - Chunked transfer encoding takes precedence over Content-Length.
+      - Any other Transfer-Encoding, or neither header, means the body extends until the
+        server closes the connection (Content-Length is ignored with a Transfer-Encoding).
+*/
+void HttpResponseParser::endOfHeaders() {
+    if (statusCode_ >= 100 && statusCode_ < 200) {
+        reset();
+        return;
+    }
+    if (statusCode_ == 204 || statusCode_ == 304) {
+        endOfBody();
+    } else if (chunked_) {
+        state_ = State::ChunkSize;
+    } else if (haveLength_ && !transferEncoded_) {
+        if (remaining_ == 0) {
+            endOfBody();
+        } else {
+            state_ = State::BodyLength;
+        }
+    } else {
+        connectionClose_ = true;
+        state_ = State::BodyUntilClose;
+    }
+}
+
+void HttpResponseParser::endOfBody() {
+    // A token value that runs up to the very end of the body is complete as well.
+    if (tokenState_ == TokenState::Value) {
+        storeToken();
+    }
+    tokenState_ = TokenState::Idle;
+    state_ = State::Done;
+}
+
+// ----------------------------------------------------------------------------
+// Command token scanner
+// ----------------------------------------------------------------------------
+/*
+    Recognises NAME=VALUE where NAME starts with an upper-case letter at a word boundary
+    and consists of upper-case letters, digits and underscores. The value runs until a
+    delimiter (quote, whitespace, '&', ',', ...). The scanner state survives between calls,
+    so a token split across two pbufs or two chunks is still found.
+*/
+void HttpResponseParser::scanBody(const char* data, size_t length) {
+    // Short answers (e.g. ThingSpeak's entry id) are kept for the caller.
+    for (size_t i = 0; i < length && bodyLength_ + i < BODY_START_SIZE - 1; i++) {
+        bodyStart_[bodyLength_ + i] = data[i];
+        bodyStart_[bodyLength_ + i + 1] = '\0';
+    }
+    bodyLength_ += length;
+    for (size_t i = 0; i < length; i++) {
+        scanChar(data[i]);
+    }
+}
+
+void HttpResponseParser::scanChar(char c) {
+    switch (tokenState_) {
+        case TokenState::Idle:
+            if (c >= 'A' && c <= 'Z' && !isWordChar(prevChar_)) {
+                tokenName_[0]    = c;
+                tokenNameLength_ = 1;
+                tokenState_      = TokenState::Name;
+            }
+            break;
+
+        case TokenState::Name:
+            if (c == '=') {
+                tokenName_[tokenNameLength_] = '\0';
+                tokenValueLength_ = 0;
+                tokenOverflow_    = false;
+                tokenState_       = TokenState::Value;
+            } else if (!isTokenNameChar(c)) {
+                tokenState_ = TokenState::Idle;
+            } else if (tokenNameLength_ < sizeof(tokenName_) - 1) {
+                tokenName_[tokenNameLength_++] = c;
+            } else {
+                // Too long for HttpCommandToken: the whole token is ignored, so a long
+                // name is never cut down to a shorter, valid one. The scanner starts
+                // again only at the next word boundary.
+                tokenState_ = TokenState::Idle;
+            }
+            break;
+
+        case TokenState::Value:
+            if (isValueDelimiter(c)) {
+                storeToken();
+                tokenState_ = TokenState::Idle;
+            } else if (tokenValueLength_ < sizeof(tokenValue_) - 1) {
+                tokenValue_[tokenValueLength_++] = c;
+            } else {
+                tokenOverflow_ = true;
+            }
+            break;
+    }
+    prevChar_ = c;
+}
+
+void HttpResponseParser::storeToken() {
+    // Empty or truncated values are not reported.
+    if (tokenOverflow_ || tokenValueLength_ == 0 || commandCount_ >= MAX_COMMANDS) {
+        return;
+    }
+    tokenValue_[tokenValueLength_] = '\0';
+    HttpCommandToken& command = commands_[commandCount_++];
+    memcpy(command.name, tokenName_, tokenNameLength_ + 1);
+    memcpy(command.value, tokenValue_, tokenValueLength_ + 1);
+}
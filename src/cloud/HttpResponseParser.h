@@ -0,0 +1,142 @@
+#ifndef HTTP_RESPONSE_PARSER_H
+#define HTTP_RESPONSE_PARSER_H
+
+#include <cstdint>
+#include <cstddef>
+
+struct pbuf;
+
+/*
+   A command token found in a response body, e.g. "SETPOINT=800" gives
+   name "SETPOINT" and value "800".
+*/
+struct HttpCommandToken {
+    char name[16];
+    char value[24];
+};
+
+/*
+   HttpResponseParser Module Header
+
+   Incremental HTTP/1.1 response parser. Received data is fed to it as it arrives,
+   either as a raw buffer or directly as an lwIP pbuf chain, which is walked in place
+   without copying it into an intermediate buffer. The parser keeps only a fixed amount
+   of state, so its memory use does not depend on the size of the response and it never
+   allocates from the heap.
+
+   Key responsibilities include:
+     - Parsing the status line and the headers that matter to the client
+       (Content-Length, Transfer-Encoding, Connection, Retry-After).
+     - Following the body framing (Content-Length, chunked transfer encoding or
+       "until the connection closes") to detect the end of the response.
+     - Scanning the body with a small state machine for command tokens of the form
+       NAME=VALUE (upper-case name, e.g. "SETPOINT=800", as sent by ThingSpeak TalkBack).
+       Tokens are recognised even when they are split across pbufs or chunks. A token
+       whose name or value does not fit into HttpCommandToken is ignored, not truncated.
+
+   Header lines longer than the internal line buffer are truncated; only the start of
+   each header line is needed to recognise the headers listed above, except for a
+   Transfer-Encoding list, whose last coding decides the framing (a truncated one makes
+   the response malformed).
+*/
+class HttpResponseParser {
+public:
+    // Maximum number of command tokens kept from one response.
+    static constexpr size_t MAX_COMMANDS = 4;
+    // Number of body bytes kept for getBodyStart().
+    static constexpr size_t BODY_START_SIZE = 16;
+
+    HttpResponseParser();
+
+    // Prepares the parser for a new response.
+    void reset();
+
+    // Feeds received data. Bytes after the end of the response are ignored.
+    void feed(const char* data, size_t length);
+    void feed(const struct pbuf* p);
+
+    // Signals that the server closed the connection. Completes a response whose body
+    // is delimited by the connection close.
+    void finish();
+
+    // ------------------------------------------------------------------------
+    // Results
+    // ------------------------------------------------------------------------
+    bool isComplete() const;          // The whole response has been received.
+    bool hasError() const;            // The response is malformed.
+    int getStatusCode() const;        // HTTP status code, 0 until the status line is parsed.
+    bool isSuccess() const;           // 2xx status.
+    bool isConnectionClose() const;   // The server will close the connection after this response.
+    uint32_t getRetryAfter() const;   // Retry-After in seconds (0 if absent or not numeric).
+    uint32_t getBodyLength() const;   // Number of body bytes received (excluding chunk framing).
+    const char* getBodyStart() const; // First BODY_START_SIZE - 1 body bytes, NUL-terminated.
+
+    size_t getCommandCount() const;
+    const HttpCommandToken& getCommand(size_t index) const;
+
+    // Returns the value of the first command token called 'name', or nullptr.
+    const char* findCommand(const char* name) const;
+
+private:
+    enum class State : uint8_t {
+        StatusLine,      // Reading "HTTP/1.1 200 OK".
+        Headers,         // Reading header lines until the empty line.
+        BodyLength,      // Body with Content-Length.
+        BodyUntilClose,  // Body delimited by connection close.
+        ChunkSize,       // Reading the hex size line of a chunk.
+        ChunkData,       // Reading chunk data.
+        ChunkDataEnd,    // Reading the CRLF after the chunk data.
+        Trailer,         // Reading trailer lines after the last chunk.
+        Done,
+        Error
+    };
+
+    enum class TokenState : uint8_t {
+        Idle,            // Looking for the start of a token name.
+        Name,            // Reading an upper-case name.
+        Value            // Reading the value after '='.
+    };
+
+    State state_;
+    int statusCode_;
+    bool http10_;
+    bool chunked_;
+    bool transferEncoded_;            // A Transfer-Encoding header was seen.
+    bool haveLength_;
+    bool keepAlive_;
+    bool connectionClose_;
+    uint32_t remaining_;              // Bytes left in the body or the current chunk.
+    uint32_t retryAfter_;
+    uint32_t bodyLength_;
+    char bodyStart_[BODY_START_SIZE];
+
+    // Current status/header/chunk-size line.
+    char line_[96];
+    size_t lineLength_;
+    bool lineTruncated_;
+
+    // Command token scanner.
+    TokenState tokenState_;
+    char prevChar_;
+    char tokenName_[sizeof(HttpCommandToken::name)];
+    char tokenValue_[sizeof(HttpCommandToken::value)];
+    size_t tokenNameLength_;
+    size_t tokenValueLength_;
+    bool tokenOverflow_;
+    HttpCommandToken commands_[MAX_COMMANDS];
+    size_t commandCount_;
+
+    // Appends a byte to line_; returns true when a complete line (without CRLF) is ready.
+    bool collectLine(char c);
+
+    void parseStatusLine();
+    void parseHeaderLine();
+    void endOfHeaders();
+    void endOfBody();
+
+    void scanBody(const char* data, size_t length);
+    void scanChar(char c);
+    void storeToken();
+};
+
+#endif // HTTP_RESPONSE_PARSER_H
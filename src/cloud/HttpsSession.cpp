@@ -0,0 +1,475 @@
+#include "HttpsSession.h"
+#include <cstdio>
+#include <cstring>
+
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "hardware/clocks.h"
+#include "lwip/pbuf.h"
+#include "lwip/dns.h"
+#include "mbedtls/ssl.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+// =============================================================================
+//                        HttpsSession Implementation
+// =============================================================================
+
+/*
+   All lwIP calls made from the requesting task are wrapped in cyw43_arch_lwip_begin/end.
+   The static callbacks run inside the lwIP thread and therefore need no extra locking.
+   The task and the callbacks share the connection state through the volatile flags
+   declared in the header.
+*/
+
+// Buckets of the handshake duration histogram (seconds).
+static const float handshakeBounds[] = { 0.25f, 0.5f, 1.0f, 2.0f, 4.0f, 8.0f };
+static const MetricDescriptor handshakeMetric = {
+    "greenhouse_tls_handshake_seconds", "TLS handshake duration (TCP connect to established).",
+    MetricType::Histogram, handshakeBounds, sizeof(handshakeBounds) / sizeof(handshakeBounds[0]) };
+
+// ----------------------------------------------------------------------------
+// Helper: CPU time consumed so far by the lwIP thread, in run-time counter units
+// (microseconds, see read_runtime_ctr()). The TLS handshake runs in this thread.
+// ----------------------------------------------------------------------------
+static uint32_t lwipThreadRunTime() {
+    static TaskHandle_t lwipThread = nullptr;
+    if (!lwipThread) {
+        lwipThread = xTaskGetHandle("tcpip_thread");
+        if (!lwipThread) return 0;
+    }
+    return ulTaskGetRunTimeCounter(lwipThread);
+}
+
+// ----------------------------------------------------------------------------
+// Constructor / Destructor
+// ----------------------------------------------------------------------------
+HttpsSession::HttpsSession(const char* hostname, uint16_t port, struct altcp_tls_config* config,
+                           DnsCache* dnsCache)
+        : hostname_(hostname)
+        , port_(port)
+        , tlsConfig_(config)
+        , dnsCache_(dnsCache)
+        , pcb_(nullptr)
+        , connected_(false)
+        , failed_(false)
+        , responseComplete_(false)
+        , requestWritten_(false)
+        , responseStarted_(false)
+        , closedByServer_(false)
+        , retrySafe_(false)
+        , pendingRequest_(nullptr)
+        , parser_(nullptr)
+        , waitingTask_(nullptr)
+        , connectCount_(0)
+        , requestCount_(0)
+        , haveTlsSession_(false)
+        , sessionOffered_(false)
+        , handshakeStartUs_(0)
+        , handshakeStartCpu_(0)
+{
+    mbedtls_ssl_session_init(&tlsSession_);
+    fullHandshakeMetric_    = g_metrics.add(handshakeMetric, "kind=\"full\"");
+    resumedHandshakeMetric_ = g_metrics.add(handshakeMetric, "kind=\"resumed\"");
+}
+
+HttpsSession::~HttpsSession() {
+    close();
+    mbedtls_ssl_session_free(&tlsSession_);
+}
+
+// ----------------------------------------------------------------------------
+// Public API
+// ----------------------------------------------------------------------------
+/*
+    A kept-alive connection may have been closed by the server while idle without us
+    noticing yet. If the exchange fails on a connection that was reused, the request is
+    retried once on a freshly opened connection so that the caller does not see the error,
+    but only when the server cannot have acted on it: the write failed, or the connection
+    was closed or reset before any byte of the response arrived. After a timeout or a
+    partial response the request may already have been processed (a bulk upload stored, a
+    TalkBack command popped), so the failure is reported instead.
+*/
+bool HttpsSession::request(const char* httpRequest, HttpResponseParser& response, int timeoutSec) {
+    bool reused = connected_;
+    if (exchange(httpRequest, response, timeoutSec)) {
+        return true;
+    }
+    if (reused && retrySafe_) {
+        printf("[HttpsSession] Request failed on reused connection, reconnecting.\n");
+        return exchange(httpRequest, response, timeoutSec);
+    }
+    return false;
+}
+
+void HttpsSession::close() {
+    cyw43_arch_lwip_begin();
+    closeConnection();
+    cyw43_arch_lwip_end();
+}
+
+bool HttpsSession::isConnected() const {
+    return connected_;
+}
+
+uint32_t HttpsSession::getConnectCount() const {
+    return connectCount_;
+}
+
+uint32_t HttpsSession::getRequestCount() const {
+    return requestCount_;
+}
+
+const TlsHandshakeStats& HttpsSession::getHandshakeStats() const {
+    return handshakeStats_;
+}
+
+// ----------------------------------------------------------------------------
+// TLS session cache helpers
+// ----------------------------------------------------------------------------
+bool HttpsSession::exportTlsSession(uint8_t* buffer, size_t size, size_t* length) const {
+    if (!haveTlsSession_) return false;
+    return mbedtls_ssl_session_save(&tlsSession_, buffer, size, length) == 0;
+}
+
+bool HttpsSession::importTlsSession(const uint8_t* buffer, size_t length) {
+    mbedtls_ssl_session_free(&tlsSession_);
+    mbedtls_ssl_session_init(&tlsSession_);
+    haveTlsSession_ = (mbedtls_ssl_session_load(&tlsSession_, buffer, length) == 0);
+    return haveTlsSession_;
+}
+
+void HttpsSession::clearTlsSession() {
+    mbedtls_ssl_session_free(&tlsSession_);
+    mbedtls_ssl_session_init(&tlsSession_);
+    haveTlsSession_ = false;
+}
+
+// ----------------------------------------------------------------------------
+// exchange(): one request/response round trip on the current or a new connection.
+// ----------------------------------------------------------------------------
+bool HttpsSession::exchange(const char* httpRequest, HttpResponseParser& response, int timeoutSec) {
+    // Reset the per-request state.
+    response.reset();
+    parser_           = &response;
+    failed_           = false;
+    responseComplete_ = false;
+    requestWritten_   = false;
+    responseStarted_  = false;
+    closedByServer_   = false;
+    retrySafe_        = false;
+    pendingRequest_   = httpRequest;
+
+    // Register this task for wake-up by the callbacks and discard any stale notification.
+    waitingTask_ = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, 0);
+
+    // Send right away on an established connection, otherwise open a new one.
+    // The request is then sent from the connected callback.
+    cyw43_arch_lwip_begin();
+    bool started = (connected_ && pcb_) ? sendPending() : open();
+    cyw43_arch_lwip_end();
+    if (!started) {
+        retrySafe_ = !requestWritten_;
+        close();
+        return false;
+    }
+
+    // Block until a callback signals completion or failure, or the deadline expires.
+    // The callbacks wake this task directly, so the request finishes as soon as the
+    // last byte of the response has been received.
+    absolute_time_t deadline = make_timeout_time_ms(timeoutSec * 1000);
+    while (!responseComplete_ && !failed_) {
+        int64_t remainingUs = absolute_time_diff_us(get_absolute_time(), deadline);
+        if (remainingUs <= 0) break;
+#if PICO_CYW43_ARCH_POLL
+        cyw43_arch_poll();
+        cyw43_arch_wait_for_work_until(deadline);
+#else
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((remainingUs + 999) / 1000));
+#endif
+    }
+
+    cyw43_arch_lwip_begin();
+    pendingRequest_ = nullptr;
+    parser_         = nullptr;
+    waitingTask_    = nullptr;
+    bool ok = responseComplete_;
+    if (!ok) {
+        printf("[HttpsSession] %s\n", failed_ ? "Request failed." : "Request timed out.");
+        retrySafe_ = !requestWritten_ || (failed_ && closedByServer_ && !responseStarted_);
+        closeConnection();
+    } else {
+        requestCount_++;
+        // Honour "Connection: close" from the server; the next request reconnects.
+        if (response.isConnectionClose()) {
+            closeConnection();
+        }
+    }
+    cyw43_arch_lwip_end();
+    return ok;
+}
+
+// ----------------------------------------------------------------------------
+// notifyWaiter(): wake the task blocked in exchange() (called from lwIP callbacks).
+// ----------------------------------------------------------------------------
+void HttpsSession::notifyWaiter() {
+    if (waitingTask_) {
+        xTaskNotifyGive(waitingTask_);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// open(): create the TLS PCB and start DNS resolution / connection.
+// ----------------------------------------------------------------------------
+bool HttpsSession::open() {
+    closeConnection();
+
+    // Without a TLS configuration the session speaks plain HTTP (local endpoints).
+    pcb_ = tlsConfig_ ? altcp_tls_new(tlsConfig_, IPADDR_TYPE_ANY) : altcp_tcp_new_ip_type(IPADDR_TYPE_ANY);
+    if (!pcb_) {
+        printf("[HttpsSession] Failed to create %s PCB\n", tlsConfig_ ? "TLS" : "TCP");
+        return false;
+    }
+    altcp_arg(pcb_, this);
+    altcp_recv(pcb_, onRecv);
+    altcp_err(pcb_, onErr);
+
+    if (tlsConfig_) {
+        // Set Server Name Indication (SNI) for the TLS handshake.
+        auto* ssl = (mbedtls_ssl_context *)altcp_tls_context(pcb_);
+        mbedtls_ssl_set_hostname(ssl, hostname_);
+
+        // Offer the session of the last successful handshake for resumption. If the
+        // server no longer knows it, mbedTLS falls back to a full handshake.
+        sessionOffered_ = haveTlsSession_ && mbedtls_ssl_set_session(ssl, &tlsSession_) == 0;
+    }
+
+    printf("[HttpsSession] Resolving hostname: %s\n", hostname_);
+    ip_addr_t server_ip;
+    err_t err = dnsCache_ ? dnsCache_->lookup(hostname_, &server_ip, onDnsFound, this)
+                          : dns_gethostbyname(hostname_, &server_ip, onDnsFound, this);
+    if (err == ERR_OK) {
+        // Host IP found in DNS cache (or hostname is a dotted IP address).
+        connectToIp(&server_ip);
+    } else if (err != ERR_INPROGRESS) {
+        printf("[HttpsSession] dns_gethostbyname failed, err=%d\n", err);
+        return false;
+    }
+    return pcb_ != nullptr;
+}
+
+// ----------------------------------------------------------------------------
+// sendPending(): write the pending request to the connection.
+// ----------------------------------------------------------------------------
+bool HttpsSession::sendPending() {
+    if (!pcb_ || !pendingRequest_) return false;
+
+    err_t err = altcp_write(pcb_, pendingRequest_, (u16_t)strlen(pendingRequest_), TCP_WRITE_FLAG_COPY);
+    if (err == ERR_OK) {
+        // Once queued, the request goes out even if the output below fails.
+        requestWritten_ = true;
+        err = altcp_output(pcb_);
+    }
+    if (err != ERR_OK) {
+        printf("[HttpsSession] Error writing data, err=%d\n", err);
+        return false;
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// closeConnection(): detach callbacks and close (or abort) the PCB.
+// ----------------------------------------------------------------------------
+void HttpsSession::closeConnection() {
+    connected_ = false;
+    if (dnsCache_) {
+        // A lookup still in progress must not call back into a later attempt.
+        dnsCache_->cancel(this);
+    }
+    if (pcb_ != nullptr) {
+        altcp_arg(pcb_, nullptr);
+        altcp_recv(pcb_, nullptr);
+        altcp_err(pcb_, nullptr);
+        err_t err = altcp_close(pcb_);
+        if (err != ERR_OK) {
+            printf("[HttpsSession] altcp_close failed %d, calling abort.\n", err);
+            altcp_abort(pcb_);
+        }
+        pcb_ = nullptr;
+    }
+}
+
+// =============================================================================
+//                         lwIP CALLBACKS (STATIC)
+// =============================================================================
+
+// ----------------------------------------------------------------------------
+// onConnected: TLS handshake finished; send the pending request.
+// ----------------------------------------------------------------------------
+err_t HttpsSession::onConnected(void* arg, struct altcp_pcb* pcb, err_t err) {
+    auto* session = static_cast<HttpsSession*>(arg);
+    if (!session) return ERR_OK;
+
+    if (err != ERR_OK) {
+        printf("[HttpsSession] connect failed %d\n", err);
+        session->failed_ = true;
+        session->notifyWaiter();
+        session->closeConnection();
+        return ERR_OK;
+    }
+
+    printf("[HttpsSession] Connected to %s, sending request.\n", session->hostname_);
+    session->connected_ = true;
+    session->connectCount_++;
+    if (session->tlsConfig_) {
+        session->onHandshakeComplete();
+    }
+    if (!session->sendPending()) {
+        session->failed_ = true;
+        session->notifyWaiter();
+    }
+    return ERR_OK;
+}
+
+// ----------------------------------------------------------------------------
+// onRecv: parse received data; a NULL pbuf means the server closed the connection.
+// ----------------------------------------------------------------------------
+/*
+    The pbuf chain is handed to the parser as it is, so the response is never copied or
+    accumulated; only the parser's fixed-size state is kept between segments.
+*/
+err_t HttpsSession::onRecv(void* arg, struct altcp_pcb* pcb, struct pbuf* p, err_t err) {
+    auto* session = static_cast<HttpsSession*>(arg);
+    if (!session) {
+        if (p) pbuf_free(p);
+        return ERR_OK;
+    }
+
+    if (!p) {
+        printf("[HttpsSession] Connection closed by remote.\n");
+        session->closedByServer_ = true;
+        if (session->parser_ && !session->responseComplete_) {
+            session->parser_->finish();
+            if (session->parser_->isComplete()) {
+                session->responseComplete_ = true;
+                session->notifyWaiter();
+            } else {
+                session->failed_ = true;
+                session->notifyWaiter();
+            }
+        }
+        session->closeConnection();
+        return ERR_OK;
+    }
+
+    if (p->tot_len > 0) {
+        // Only collect data while a request is in flight; anything else is discarded.
+        if (session->parser_ && !session->responseComplete_) {
+            session->responseStarted_ = true;
+            session->parser_->feed(p);
+            if (session->parser_->isComplete()) {
+                session->responseComplete_ = true;
+                session->notifyWaiter();
+            } else if (session->parser_->hasError()) {
+                printf("[HttpsSession] Malformed HTTP response.\n");
+                session->failed_ = true;
+                session->notifyWaiter();
+            }
+        }
+        altcp_recved(pcb, p->tot_len);
+    }
+    pbuf_free(p);
+    return ERR_OK;
+}
+
+// ----------------------------------------------------------------------------
+// onErr: the PCB has already been freed by lwIP when this is called.
+// ----------------------------------------------------------------------------
+void HttpsSession::onErr(void* arg, err_t err) {
+    auto* session = static_cast<HttpsSession*>(arg);
+    if (!session) return;
+
+    printf("[HttpsSession] Connection error: %d\n", err);
+    if (!session->connected_ && session->sessionOffered_) {
+        // The handshake failed while resuming; do not offer that session again.
+        session->clearTlsSession();
+    }
+    session->pcb_ = nullptr;
+    session->connected_ = false;
+    session->closedByServer_ = (err == ERR_RST || err == ERR_CLSD);
+    session->failed_ = true;
+    session->notifyWaiter();
+}
+
+// ----------------------------------------------------------------------------
+// onDnsFound / connectToIp: connect once the host name is resolved.
+// ----------------------------------------------------------------------------
+void HttpsSession::onDnsFound(const char* hostname, const ip_addr_t* ipaddr, void* arg) {
+    auto* session = static_cast<HttpsSession*>(arg);
+    if (!session || !session->pcb_) return;
+
+    if (ipaddr) {
+        printf("[HttpsSession] DNS resolved for %s\n", hostname);
+        session->connectToIp(ipaddr);
+    } else {
+        printf("[HttpsSession] Error resolving hostname %s\n", hostname);
+        session->failed_ = true;
+        session->notifyWaiter();
+        session->closeConnection();
+    }
+}
+
+void HttpsSession::connectToIp(const ip_addr_t* ipaddr) {
+    printf("[HttpsSession] Connecting to %s port %d\n", ipaddr_ntoa(ipaddr), port_);
+    handshakeStartUs_  = time_us_64();
+    handshakeStartCpu_ = lwipThreadRunTime();
+    err_t err = altcp_connect(pcb_, ipaddr, port_, onConnected);
+    if (err != ERR_OK) {
+        printf("[HttpsSession] Error in altcp_connect, err=%d\n", err);
+        failed_ = true;
+        notifyWaiter();
+        closeConnection();
+    }
+}
+
+// ----------------------------------------------------------------------------
+// onHandshakeComplete: measure the handshake and cache its session.
+// ----------------------------------------------------------------------------
+/*
+    A resumed handshake reuses the master secret of the session that was offered, while a
+    full handshake derives a new one. Comparing the two therefore tells which kind of
+    handshake took place, for both session-ID and session-ticket resumption.
+*/
+void HttpsSession::onHandshakeComplete() {
+    auto elapsedUs  = static_cast<uint32_t>(time_us_64() - handshakeStartUs_);
+    uint64_t cycles = static_cast<uint64_t>(lwipThreadRunTime() - handshakeStartCpu_) *
+                      (clock_get_hz(clk_sys) / 1000000);
+
+    auto* ssl = (mbedtls_ssl_context *)altcp_tls_context(pcb_);
+    bool resumed = sessionOffered_ && ssl && ssl->session &&
+                   memcmp(ssl->session->master, tlsSession_.master, sizeof(tlsSession_.master)) == 0;
+
+    if (resumed) {
+        handshakeStats_.resumedCount++;
+        handshakeStats_.lastResumedUs     = elapsedUs;
+        handshakeStats_.totalResumedUs   += elapsedUs;
+        handshakeStats_.lastResumedCycles = cycles;
+        g_metrics.observe(resumedHandshakeMetric_, elapsedUs / 1e6f);
+    } else {
+        handshakeStats_.fullCount++;
+        handshakeStats_.lastFullUs     = elapsedUs;
+        handshakeStats_.totalFullUs   += elapsedUs;
+        handshakeStats_.lastFullCycles = cycles;
+        g_metrics.observe(fullHandshakeMetric_, elapsedUs / 1e6f);
+    }
+    printf("[HttpsSession] %s handshake: %lu ms, %llu cycles\n",
+           resumed ? "Resumed" : "Full", (unsigned long)(elapsedUs / 1000), (unsigned long long)cycles);
+
+    // Keep this session for the next reconnect.
+    if (ssl) {
+        mbedtls_ssl_session_free(&tlsSession_);
+        mbedtls_ssl_session_init(&tlsSession_);
+        haveTlsSession_ = (mbedtls_ssl_get_session(ssl, &tlsSession_) == 0);
+    }
+}
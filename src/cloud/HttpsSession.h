@@ -0,0 +1,172 @@
+#ifndef HTTPS_SESSION_H
+#define HTTPS_SESSION_H
+
+#include <cstdint>
+#include "lwip/altcp_tcp.h"
+#include "lwip/altcp_tls.h"
+#include "mbedtls/ssl.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "HttpResponseParser.h"
+#include "DnsCache.h"
+#include "metrics/Metrics.h"
+
+/*
+   Handshake statistics, kept separately for full and resumed handshakes.
+   Times are wall-clock microseconds from starting the TCP connect until the TLS
+   handshake has finished. Cycles are the CPU time consumed by the lwIP thread (where
+   mbedTLS runs) during the same interval, taken from the FreeRTOS run-time counter
+   and converted to system clock cycles.
+*/
+struct TlsHandshakeStats {
+    uint32_t fullCount      = 0;   // Number of full handshakes.
+    uint32_t resumedCount   = 0;   // Number of abbreviated (resumed) handshakes.
+    uint32_t lastFullUs     = 0;   // Duration of the most recent full handshake.
+    uint32_t lastResumedUs  = 0;   // Duration of the most recent resumed handshake.
+    uint64_t totalFullUs    = 0;   // Sum of full handshake durations (for averaging).
+    uint64_t totalResumedUs = 0;   // Sum of resumed handshake durations (for averaging).
+    uint64_t lastFullCycles    = 0; // CPU cycles of the most recent full handshake.
+    uint64_t lastResumedCycles = 0; // CPU cycles of the most recent resumed handshake.
+};
+
+/*
+   HttpsSession Module Header
+
+   This module keeps one long-lived TLS connection open to a single HTTPS server and
+   sends successive HTTP/1.1 requests over it using keep-alive. The DNS lookup and the
+   TLS handshake (the expensive part on a Cortex-M0+) are only performed when the
+   connection is opened, not for every request.
+
+   Key responsibilities include:
+     - Opening the connection on demand (DNS resolution, TCP connect, TLS handshake).
+     - Writing a request and feeding the HTTP response, pbuf by pbuf, into a
+       HttpResponseParser supplied by the caller. Because the connection stays open, the
+       end of the response is detected by the parser from the headers (Content-Length or
+       chunked transfer encoding) instead of the server closing it.
+     - Reconnecting transparently when the server has closed an idle connection: a request
+       that could not be written, or whose connection was closed before any byte of the
+       response arrived, is retried once on a fresh one. A request that may have reached
+       the server (timeout, partial response) is not retried, so that a POST is never
+       executed twice; the caller sees the failure and backs off.
+     - Caching the TLS session (session ID or session ticket) of the last successful
+       handshake and offering it on reconnect, so that the server can resume the session
+       with an abbreviated handshake instead of a full key exchange.
+
+   The host name and port are given by the caller, so the same code can be pointed at a
+   local TLS stand-in server during testing. Without a TLS configuration the session
+   uses a plain TCP connection (HTTP), e.g. for an endpoint on the local network.
+*/
+class HttpsSession {
+public:
+    // ------------------------------------------------------------------------
+    // Constructor / Destructor
+    // ------------------------------------------------------------------------
+    // The TLS configuration (and the DNS cache, if given) are owned by the caller and
+    // must outlive the session; nullptr selects plain HTTP. Without a DNS cache the host
+    // is resolved with lwIP directly.
+    HttpsSession(const char* hostname, uint16_t port, struct altcp_tls_config* config,
+                 DnsCache* dnsCache = nullptr);
+
+    // Destructor closes the connection if it is still open.
+    ~HttpsSession();
+
+    HttpsSession(const HttpsSession&) = delete;
+
+    // ------------------------------------------------------------------------
+    // Request handling
+    // ------------------------------------------------------------------------
+    // Sends a complete HTTP request (headers and body) and waits for the full response.
+    // The connection is opened first if needed. The response is parsed into 'response'
+    // as it arrives. Returns true when a complete response was received within
+    // 'timeoutSec' seconds.
+    bool request(const char* httpRequest, HttpResponseParser& response, int timeoutSec);
+
+    // Closes the connection. The next request opens a new one.
+    void close();
+
+    // Returns true while a TLS connection to the server is established.
+    bool isConnected() const;
+
+    // Statistics: number of TLS connections opened and requests completed so far.
+    uint32_t getConnectCount() const;
+    uint32_t getRequestCount() const;
+
+    // Handshake timing statistics (full vs. resumed).
+    const TlsHandshakeStats& getHandshakeStats() const;
+
+    // ------------------------------------------------------------------------
+    // TLS session cache
+    // ------------------------------------------------------------------------
+    // The cached session lives in RAM. These helpers serialize it so that the owner can
+    // optionally persist it and restore it after a reboot.
+    // exportTlsSession() returns false if no session is cached or the buffer is too small.
+    bool exportTlsSession(uint8_t* buffer, size_t size, size_t* length) const;
+    bool importTlsSession(const uint8_t* buffer, size_t length);
+
+    // Drops the cached session; the next connection performs a full handshake.
+    void clearTlsSession();
+
+private:
+    const char* hostname_;                 // Server host name (or dotted IP address).
+    uint16_t port_;                        // Server TCP port (443 for HTTPS).
+    struct altcp_tls_config* tlsConfig_;   // TLS configuration shared with the owner.
+    DnsCache* dnsCache_;                   // Resolver cache shared with the owner (optional).
+
+    // --- Connection state, updated from lwIP callbacks ---
+    struct altcp_pcb* pcb_;                // Protocol Control Block of the open connection.
+    volatile bool connected_;              // TLS handshake complete and connection usable.
+    volatile bool failed_;                 // The in-flight request failed (error/close).
+    volatile bool responseComplete_;       // A complete response has been received.
+    volatile bool requestWritten_;         // The request has been queued on the connection.
+    volatile bool responseStarted_;        // At least one byte of the response has been received.
+    volatile bool closedByServer_;         // The server closed or reset the connection.
+    bool retrySafe_;                       // The last failed exchange can be repeated safely.
+
+    // --- Request/response state ---
+    const char* pendingRequest_;           // Request to send once the connection is up.
+    HttpResponseParser* parser_;           // Parser of the current request's response.
+    volatile TaskHandle_t waitingTask_;    // Task blocked in exchange(), woken by the callbacks.
+
+    uint32_t connectCount_;
+    uint32_t requestCount_;
+
+    // --- TLS session cache and handshake measurement ---
+    mbedtls_ssl_session tlsSession_;       // Session from the last successful handshake.
+    bool haveTlsSession_;                  // tlsSession_ holds a usable session.
+    bool sessionOffered_;                  // The cached session was offered on this connection.
+    uint64_t handshakeStartUs_;            // time_us_64() when the connect was started.
+    uint32_t handshakeStartCpu_;           // lwIP thread run-time counter at that moment.
+    TlsHandshakeStats handshakeStats_;
+    MetricId fullHandshakeMetric_;         // Handshake duration histograms (/metrics).
+    MetricId resumedHandshakeMetric_;
+
+    // Records timing for the handshake that just completed and caches its session.
+    void onHandshakeComplete();
+
+    // Wakes the task waiting in exchange() after failed_ or responseComplete_ was set.
+    void notifyWaiter();
+
+    // Performs a single request/response exchange without retrying. On failure, retrySafe_
+    // tells whether the server can not have processed the request.
+    bool exchange(const char* httpRequest, HttpResponseParser& response, int timeoutSec);
+
+    // Starts DNS resolution and connection. Must be called with the lwIP lock held.
+    bool open();
+
+    // Writes the pending request to the connection. Must be called with the lwIP lock held.
+    bool sendPending();
+
+    // Detaches callbacks and closes the PCB. Must be called with the lwIP lock held.
+    void closeConnection();
+
+    // ------------------------------------------------------------------------
+    // Static callbacks used by lwIP's altcp APIs.
+    // ------------------------------------------------------------------------
+    static err_t onConnected(void* arg, struct altcp_pcb* pcb, err_t err);
+    static err_t onRecv(void* arg, struct altcp_pcb* pcb, struct pbuf* p, err_t err);
+    static void onErr(void* arg, err_t err);
+    static void onDnsFound(const char* hostname, const ip_addr_t* ipaddr, void* arg);
+    void connectToIp(const ip_addr_t* ipaddr);
+};
+
+#endif // HTTPS_SESSION_H
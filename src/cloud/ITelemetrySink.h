@@ -0,0 +1,67 @@
+#ifndef ITELEMETRY_SINK_H
+#define ITELEMETRY_SINK_H
+
+#include <cstdint>
+#include <cstddef>
+#include "TelemetryRecord.h"
+#include "UploadScheduler.h"
+#include "WallClock.h"
+
+/*
+   ITelemetrySink Interface
+
+   A destination of the telemetry records produced by the ChangeDetector: ThingSpeak
+   (Cloud), a generic HTTP JSON endpoint (HttpJsonSink) or an MQTT broker (MqttChannel).
+   Sinks are registered with the TelemetryPipeline, which gives every sink its own send
+   queue and UploadScheduler, so several sinks can be active at once and a sink that is
+   offline or rate limited neither loses records nor holds up the others.
+
+   The pipeline task calls the sink methods one at a time; a sink only has to protect
+   the state it shares with its own callbacks or tasks.
+*/
+class ITelemetrySink {
+public:
+    virtual ~ITelemetrySink() = default;
+
+    // Short name used in log messages and metric labels, e.g. "thingspeak".
+    virtual const char* getName() const = 0;
+
+    // Pacing of this sink: upload interval, jitter, command polling and backoff.
+    virtual UploadSchedulerConfig getScheduleConfig() const = 0;
+
+    // Largest number of records passed to one send() call.
+    virtual size_t getMaxBatch() const = 0;
+
+    // Largest number of send() calls per upload, 0 = until the queue is empty. A sink
+    // whose endpoint accepts only one request per upload interval returns 1; the rest of
+    // the queue then waits for the next slot of its scheduler.
+    virtual size_t getMaxRequests() const { return 0; }
+
+    // Delivers records (oldest first). Returns how many of the first records the
+    // endpoint accepted; 0 means the request failed and all of them are retried later.
+    virtual size_t send(const TelemetryRecord* records, size_t count) = 0;
+
+    // Called after send() has emptied the queue, for requests that belong to an upload
+    // as a whole (e.g. fetching the next TalkBack command after a bulk update).
+    virtual void finishUpload() {}
+
+    // Called while nothing is queued, every getScheduleConfig().commandPollMs (not at
+    // all if that is 0). Returns false if the request failed.
+    virtual bool poll() { return true; }
+
+    // HTTP status and Retry-After (seconds) of the last request, used to recognize rate
+    // limiting. 0 when there was no answer or the transport has no such notion.
+    virtual int getLastStatusCode() const { return 0; }
+    virtual uint32_t getLastRetryAfter() const { return 0; }
+};
+
+// UTC time of a record in milliseconds, 0 if unknown. Records of this boot are converted
+// from their boot timestamp; records replayed from an earlier boot carry their own.
+inline uint64_t recordUtcMs(const TelemetryRecord& record) {
+    if (record.flags & TelemetryRecord::EARLIER_BOOT) {
+        return static_cast<uint64_t>(record.utcSeconds) * 1000;
+    }
+    return WallClock::toUtcMs(record.timestampMs);
+}
+
+#endif // ITELEMETRY_SINK_H
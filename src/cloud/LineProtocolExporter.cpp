@@ -0,0 +1,248 @@
+#include "LineProtocolExporter.h"
+#include <cstdio>
+#include <cstring>
+
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/tcpip.h"
+#include "WallClock.h"
+
+// =============================================================================
+//                      LineProtocolExporter Implementation
+// =============================================================================
+
+static const MetricDescriptor datagramsDescriptor = {
+    "greenhouse_line_protocol_datagrams_total", "UDP datagrams sent to the line protocol collector.", MetricType::Counter };
+static const MetricDescriptor linesDescriptor = {
+    "greenhouse_line_protocol_lines_total", "Samples sent to the line protocol collector.", MetricType::Counter };
+static const MetricDescriptor errorsDescriptor = {
+    "greenhouse_line_protocol_errors_total", "Datagrams that could not be sent (no pbuf, no route).", MetricType::Counter };
+
+// ----------------------------------------------------------------------------
+// LineWriter: bounded appending of text and numbers without printf.
+// ----------------------------------------------------------------------------
+namespace {
+class LineWriter {
+public:
+    LineWriter(char* out, size_t size) : pos(out), end(out + size), ok(true) {}
+
+    void text(const char* s) {
+        while (*s) put(*s++);
+    }
+
+    void number(uint32_t value) {
+        char digits[10];
+        size_t n = 0;
+        do {
+            digits[n++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value);
+        while (n) put(digits[--n]);
+    }
+
+    // Fixed-point value with 'decimals' (0 or 1) digits after the point, rounded.
+    void fixed(float value, int decimals) {
+        float scaled = decimals ? value * 10.0f : value;
+        bool negative = scaled < 0.0f;
+        if (negative) scaled = -scaled;
+        auto units = static_cast<uint32_t>(scaled + 0.5f);
+        if (negative && units) put('-');
+        if (decimals) {
+            number(units / 10);
+            put('.');
+            put(static_cast<char>('0' + units % 10));
+        } else {
+            number(units);
+        }
+    }
+
+    // Zero-padded to three digits (milliseconds).
+    void millis(uint32_t value) {
+        put(static_cast<char>('0' + value / 100));
+        put(static_cast<char>('0' + value / 10 % 10));
+        put(static_cast<char>('0' + value % 10));
+    }
+
+    // Number of characters written, or 0 if the output did not fit.
+    size_t length(const char* start) const {
+        return ok ? static_cast<size_t>(pos - start) : 0;
+    }
+
+private:
+    char* pos;
+    char* end;
+    bool ok;
+
+    void put(char c) {
+        if (pos < end) *pos++ = c;
+        else ok = false;
+    }
+};
+}
+
+// ----------------------------------------------------------------------------
+// Constructor / Destructor
+// ----------------------------------------------------------------------------
+LineProtocolExporter::LineProtocolExporter(const char* host, uint16_t port)
+        : port_(port)
+        , targetValid_(false)
+        , pcb_(nullptr)
+        , current_(0)
+        , batchStartMs_(0)
+{
+    for (auto& batch : batches_) {
+        batch.owner = this;
+        batch.length = 0;
+        batch.lines = 0;
+        batch.sending = false;
+    }
+    targetValid_ = ipaddr_aton(host, &target_) != 0;
+    if (!targetValid_) {
+        printf("[LineProtocol] Invalid collector address '%s'\n", host);
+    }
+    datagramsMetric_ = g_metrics.add(datagramsDescriptor);
+    linesMetric_     = g_metrics.add(linesDescriptor);
+    errorsMetric_    = g_metrics.add(errorsDescriptor);
+}
+
+LineProtocolExporter::~LineProtocolExporter() {
+    if (pcb_) {
+        cyw43_arch_lwip_begin();
+        udp_remove(pcb_);
+        cyw43_arch_lwip_end();
+    }
+}
+
+bool LineProtocolExporter::start() {
+    if (!targetValid_) return false;
+    cyw43_arch_lwip_begin();
+    pcb_ = udp_new_ip_type(IPADDR_TYPE_V4);
+    cyw43_arch_lwip_end();
+    if (!pcb_) {
+        printf("[LineProtocol] Failed to create UDP pcb\n");
+        return false;
+    }
+    printf("[LineProtocol] Exporting samples to %s:%u\n", ipaddr_ntoa(&target_), port_);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// add(): append a sample and send the batch when it is full or old enough.
+// ----------------------------------------------------------------------------
+void LineProtocolExporter::add(const ControllerSnapshot& snapshot) {
+    if (!pcb_) return;
+
+    uint64_t utcMs = WallClock::toUtcMs(snapshot.timestampMs);
+    Batch* batch = &batches_[current_];
+    size_t length = 0;
+    if (!batch->sending) {
+        length = formatLine(snapshot, utcMs, batch->buffer + batch->length, sizeof(batch->buffer) - batch->length);
+    }
+    if (length == 0 && batch->length > 0) {
+        // Batch full: send it and start a new one with this line.
+        flush();
+        batch = &batches_[current_];
+    }
+    if (batch->sending) {
+        // The lwIP thread has not sent the previous batches yet.
+        g_metrics.inc(errorsMetric_);
+        return;
+    }
+    if (length == 0) {
+        length = formatLine(snapshot, utcMs, batch->buffer, sizeof(batch->buffer));
+    }
+    if (length == 0) return;
+
+    if (batch->lines == 0) batchStartMs_ = snapshot.timestampMs;
+    batch->length += length;
+    batch->lines++;
+
+    // Lines without a timestamp are sent at once (see the header), so a batch never mixes
+    // lines with and without timestamps.
+    if (utcMs == 0 || snapshot.timestampMs - batchStartMs_ >= LINE_PROTOCOL_FLUSH_MS) {
+        flush();
+    }
+}
+
+/*
+    The batch belongs to the lwIP thread from here until onSend() has sent it; add()
+    continues with the other buffer. If the lwIP message box is full, the batch is
+    dropped like a datagram lost on the way.
+*/
+void LineProtocolExporter::flush() {
+    Batch& batch = batches_[current_];
+    if (!pcb_ || batch.length == 0 || batch.sending) return;
+
+    batch.sending = true;
+    if (tcpip_try_callback(onSend, &batch) != ERR_OK) {
+        g_metrics.inc(errorsMetric_);
+        batch.length = 0;
+        batch.lines = 0;
+        batch.sending = false;
+        return;
+    }
+    current_ = 1 - current_;
+}
+
+/*
+    The pbuf only references the batch buffer. lwIP copies the data if it has to queue
+    the packet (e.g. while ARP resolves the collector), so the buffer can be reused as
+    soon as udp_sendto() returns.
+*/
+void LineProtocolExporter::onSend(void* arg) {
+    auto* batch = static_cast<Batch*>(arg);
+    LineProtocolExporter* exporter = batch->owner;
+
+    err_t err = ERR_MEM;
+    struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, static_cast<u16_t>(batch->length), PBUF_REF);
+    if (p) {
+        p->payload = batch->buffer;
+        err = udp_sendto(exporter->pcb_, p, &exporter->target_, exporter->port_);
+        pbuf_free(p);
+    }
+
+    if (err == ERR_OK) {
+        g_metrics.inc(exporter->datagramsMetric_);
+        g_metrics.inc(exporter->linesMetric_, static_cast<uint32_t>(batch->lines));
+    } else {
+        g_metrics.inc(exporter->errorsMetric_);
+    }
+    batch->length = 0;
+    batch->lines = 0;
+    batch->sending = false;     // Last: hands the buffer back to sensorTask.
+}
+
+// ----------------------------------------------------------------------------
+// formatLine(): one sample in line protocol, terminated by '\n'.
+// ----------------------------------------------------------------------------
+size_t LineProtocolExporter::formatLine(const ControllerSnapshot& snapshot, uint64_t utcMs,
+                                        char* out, size_t size) const {
+    LineWriter line(out, size);
+    line.text(LINE_PROTOCOL_MEASUREMENT "," LINE_PROTOCOL_TAGS " co2=");
+    line.fixed(snapshot.co2, 0);
+    line.text(",rh=");
+    line.fixed(snapshot.rh, 1);
+    line.text(",temp=");
+    line.fixed(snapshot.temp, 1);
+    line.text(",pressure=");
+    line.fixed(snapshot.pressure, 0);
+    line.text(",fan=");
+    line.fixed(snapshot.fanSpeed, 1);
+    line.text(",setpoint=");
+    line.fixed(snapshot.setpoint, 0);
+    line.text(snapshot.valveOpen ? ",valve=1i" : ",valve=0i");
+    line.text(snapshot.safetyVent ? ",vent=1i" : ",vent=0i");
+    line.text(",uptime_ms=");
+    line.number(snapshot.timestampMs);
+    line.text("i");
+
+    if (utcMs) {
+        // Unix time in nanoseconds, the collector's default precision.
+        line.text(" ");
+        line.number(static_cast<uint32_t>(utcMs / 1000));
+        line.millis(static_cast<uint32_t>(utcMs % 1000));
+        line.text("000000");
+    }
+    line.text("\n");
+    return line.length(out);
+}
@@ -0,0 +1,91 @@
+#ifndef LINE_PROTOCOL_EXPORTER_H
+#define LINE_PROTOCOL_EXPORTER_H
+
+#include <cstdint>
+#include <cstddef>
+#include "lwip/udp.h"
+#include "Controller/Controller.h"
+#include "metrics/Metrics.h"
+#include "line_protocol_config.h"
+
+/*
+   LineProtocolExporter Module Header
+
+   Fire-and-forget export of the Controller samples to a collector on the local network
+   as InfluxDB line protocol over UDP, e.g.
+
+       greenhouse,device=pico co2=812,rh=45.3,temp=21.4,pressure=12,fan=40.0,setpoint=900,valve=1i,vent=0i,uptime_ms=84500i 1718000000500000000
+
+   Key properties:
+     - No TLS, no connection and no retransmission: sending a batch is one udp_sendto()
+       with a pbuf that references the batch buffer (no copy).
+     - Lines are appended to a buffer of one datagram (LINE_PROTOCOL_MAX_DATAGRAM); the
+       batch is sent when the next line would not fit or LINE_PROTOCOL_FLUSH_MS after its
+       first line.
+     - sensorTask never takes the lwIP lock: a full batch is handed to the lwIP thread
+       (tcpip_try_callback), which sends it, while the next lines go into a second
+       buffer. A sample that finds both buffers still waiting for the lwIP thread is
+       dropped and counted as an error.
+     - Numbers are formatted with integer arithmetic instead of printf("%f"), which is
+       slow without an FPU, so adding a sample costs a few hundred cycles.
+     - Lines carry a nanosecond timestamp once the wall clock is synchronized (WallClock.h).
+       Until then the collector stamps each line on arrival, so every line is sent in a
+       datagram of its own; otherwise the lines of a batch would get the same time and
+       overwrite each other.
+
+   add() and flush() are called from sensorTask only and are not thread-safe. A batch
+   handed to the lwIP thread refers to the exporter, so it is kept for the whole run.
+   Target and format are configured in line_protocol_config.h.
+*/
+class LineProtocolExporter {
+public:
+    // ------------------------------------------------------------------------
+    // Constructor / Destructor
+    // ------------------------------------------------------------------------
+    // host: dotted IPv4 address of the collector.
+    LineProtocolExporter(const char* host, uint16_t port = LINE_PROTOCOL_PORT);
+    ~LineProtocolExporter();
+
+    LineProtocolExporter(const LineProtocolExporter&) = delete;
+
+    // Creates the UDP pcb. Returns false if the host is not a valid address.
+    bool start();
+
+    // Appends a sample to the current batch and sends the batch when it is due.
+    void add(const ControllerSnapshot& snapshot);
+
+    // Sends the current batch, if any.
+    void flush();
+
+private:
+    ip_addr_t target_;
+    uint16_t port_;
+    bool targetValid_;
+    struct udp_pcb* pcb_;
+
+    // A datagram being filled by sensorTask or waiting to be sent by the lwIP thread.
+    struct Batch {
+        LineProtocolExporter* owner;
+        char buffer[LINE_PROTOCOL_MAX_DATAGRAM];
+        size_t length;
+        size_t lines;
+        volatile bool sending;        // Owned by the lwIP thread until it has been sent.
+    };
+
+    Batch batches_[2];
+    size_t current_;                  // Batch that add() appends to.
+    uint32_t batchStartMs_;
+
+    MetricId datagramsMetric_;
+    MetricId linesMetric_;
+    MetricId errorsMetric_;
+
+    // Formats one line into 'out', with a timestamp unless 'utcMs' is 0. Returns its
+    // length, or 0 if it does not fit.
+    size_t formatLine(const ControllerSnapshot& snapshot, uint64_t utcMs, char* out, size_t size) const;
+
+    // Sends a batch handed over by flush() (lwIP thread).
+    static void onSend(void* arg);
+};
+
+#endif // LINE_PROTOCOL_EXPORTER_H
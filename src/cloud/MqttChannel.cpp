@@ -0,0 +1,361 @@
+#include "MqttChannel.h"
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/dns.h"
+#include "task.h"
+
+#include "TlsProfile.h"
+#include "mqtt_config.h"
+
+// The channel is only compiled in when a broker is configured in mqtt_config.h.
+#ifdef MQTT_BROKER_HOST
+
+// =============================================================================
+//                         MqttChannel Implementation
+// =============================================================================
+
+/*
+   As in HttpsSession, lwIP calls made from the MQTT task are wrapped in
+   cyw43_arch_lwip_begin/end, while the static callbacks run inside the lwIP thread.
+   The callbacks never touch the Controller directly; commands are handed over to the
+   controller task through the CommandQueue.
+*/
+
+// ----------------------------------------------------------------------------
+// Constructor / Destructor
+// ----------------------------------------------------------------------------
+MqttChannel::MqttChannel(std::shared_ptr<CommandQueue> commands, std::shared_ptr<DnsCache> dnsCache)
+        : commands_(std::move(commands))
+        , dnsCache_(std::move(dnsCache))
+        , client_(nullptr)
+        , tlsConfig_(nullptr)
+        , state_(State::Disconnected)
+        , lastAttempt_(0)
+        , inCommandTopic_(false)
+        , payloadLength_(0)
+        , ackInFlight_(false)
+        , ackSeq_(0)
+        , ackCount_(0)
+        , commandCount_(0)
+        , publishCount_(0)
+{
+#if MQTT_USE_TLS
+#ifdef MQTT_CA_DER
+    static const uint8_t trustAnchor[] = MQTT_CA_DER;
+    tlsConfig_ = createTlsClientConfig("MQTT", trustAnchor, sizeof(trustAnchor));
+#else
+    tlsConfig_ = createTlsClientConfig("MQTT", nullptr, 0);
+#endif
+#endif
+    cyw43_arch_lwip_begin();
+    client_ = mqtt_client_new();
+    if (client_) {
+        mqtt_set_inpub_callback(client_, onIncomingPublish, onIncomingData, this);
+    }
+    cyw43_arch_lwip_end();
+    if (!client_) {
+        printf("[MQTT] Failed to create MQTT client.\n");
+    }
+}
+
+MqttChannel::~MqttChannel() {
+    cyw43_arch_lwip_begin();
+    if (dnsCache_) {
+        dnsCache_->cancel(this);
+    }
+    if (client_) {
+        mqtt_disconnect(client_);
+        mqtt_client_free(client_);
+        client_ = nullptr;
+    }
+    cyw43_arch_lwip_end();
+    if (tlsConfig_) {
+        altcp_tls_free_config(tlsConfig_);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// connect(): resolve the broker and start connecting.
+// ----------------------------------------------------------------------------
+/*
+    The connection is asynchronous: this only starts the DNS lookup (or the connect if
+    the address is already known). onConnection() reports the result. A new attempt is
+    made at most every MQTT_RECONNECT_DELAY_MS so that a missing broker does not keep
+    the network busy.
+*/
+void MqttChannel::connect() {
+    if (!client_ || state_ != State::Disconnected) return;
+
+    TickType_t now = xTaskGetTickCount();
+    if (lastAttempt_ != 0 && (now - lastAttempt_) < pdMS_TO_TICKS(MQTT_RECONNECT_DELAY_MS)) {
+        return;
+    }
+    lastAttempt_ = now;
+
+    printf("[MQTT] Resolving broker %s\n", MQTT_BROKER_HOST);
+    state_ = State::Resolving;
+    ip_addr_t brokerIp;
+    cyw43_arch_lwip_begin();
+    err_t err = dnsCache_ ? dnsCache_->lookup(MQTT_BROKER_HOST, &brokerIp, onDnsFound, this)
+                          : dns_gethostbyname(MQTT_BROKER_HOST, &brokerIp, onDnsFound, this);
+    if (err == ERR_OK) {
+        connectToIp(&brokerIp);
+    } else if (err != ERR_INPROGRESS) {
+        printf("[MQTT] dns_gethostbyname failed, err=%d\n", err);
+        state_ = State::Disconnected;
+    }
+    cyw43_arch_lwip_end();
+}
+
+bool MqttChannel::isConnected() const {
+    return state_ == State::Connected;
+}
+
+// ----------------------------------------------------------------------------
+// ITelemetrySink: name, pacing and batch size
+// ----------------------------------------------------------------------------
+const char* MqttChannel::getName() const {
+    return "mqtt";
+}
+
+UploadSchedulerConfig MqttChannel::getScheduleConfig() const {
+    UploadSchedulerConfig config;
+    config.minIntervalMs = MQTT_MIN_PUBLISH_INTERVAL_MS;
+    config.jitterPercent = 10;
+    config.phaseWindowMs = MQTT_MIN_PUBLISH_INTERVAL_MS;
+    config.commandPollMs = 0;                     // Commands arrive by subscription.
+    config.baseBackoffMs = MQTT_RECONNECT_DELAY_MS;
+    config.maxBackoffMs  = 60000;
+    return config;
+}
+
+size_t MqttChannel::getMaxBatch() const {
+#if MQTT_PAYLOAD_CBOR
+    return MQTT_MAX_BATCH;
+#else
+    return 1;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// send(): publish queued records (CBOR batch or CSV).
+// ----------------------------------------------------------------------------
+/*
+    QoS 0: a record counts as delivered once lwIP has queued the publish. If the batch
+    does not fit into the payload buffer, fewer records are encoded and the rest is
+    published with the next call. The CBOR timestamps are deltas of the boot time, so a
+    batch also ends where the records of one boot end (records replayed from the sample
+    log carry EARLIER_BOOT).
+*/
+size_t MqttChannel::send(const TelemetryRecord* records, size_t count) {
+    if (!isConnected() || count == 0) return 0;
+
+#if MQTT_PAYLOAD_CBOR
+    for (size_t i = 1; i < count; i++) {
+        if (records[i].timestampMs < records[i - 1].timestampMs ||
+            (records[i].flags ^ records[0].flags) & TelemetryRecord::EARLIER_BOOT) {
+            count = i;
+            break;
+        }
+    }
+    uint8_t payload[256];
+    size_t len = 0;
+    while (count > 0 && (len = codec_.encode(records, count, payload, sizeof(payload))) == 0) {
+        count /= 2;
+    }
+    if (len == 0) return 0;
+#else
+    const TelemetryRecord& r = records[0];
+    char payload[64];
+    int len = snprintf(payload, sizeof(payload), "%.0f,%.1f,%.1f,%.0f,%.0f",
+                       r.co2, r.rh, r.temp, r.fanSpeed, r.setpoint);
+    count = 1;
+#endif
+
+    cyw43_arch_lwip_begin();
+    err_t err = mqtt_publish(client_, MQTT_TELEMETRY_TOPIC, payload, (u16_t)len, 0, 0, nullptr, nullptr);
+    cyw43_arch_lwip_end();
+    if (err != ERR_OK) {
+        printf("[MQTT] Publish failed, err=%d\n", err);
+        return 0;
+    }
+    publishCount_++;
+    return count;
+}
+
+const TelemetryCodecStats& MqttChannel::getCodecStats() const {
+    return codec_.getStats();
+}
+
+// ----------------------------------------------------------------------------
+// publishAcks(): report executed commands to the sender.
+// ----------------------------------------------------------------------------
+/*
+    Only one ack publish is outstanding at a time. The acks are removed from the command
+    queue in onAckPublished() once the broker confirmed them; if the connection is lost
+    before that they are published again after the reconnect (popAcks() ignores acks that
+    were already removed).
+*/
+bool MqttChannel::publishAcks() {
+    if (!isConnected() || !commands_ || ackInFlight_ || !commands_->hasAcks()) return false;
+
+    CommandAck acks[CommandQueue::MAX_ACKS];
+    uint32_t firstSeq = 0;
+    size_t count = commands_->peekAcks(acks, CommandQueue::MAX_ACKS, firstSeq);
+    char payload[CommandQueue::MAX_ACKS * 24 + 1];
+    size_t len = CommandQueue::formatAcks(acks, count, payload, sizeof(payload));
+
+    ackSeq_ = firstSeq;
+    ackCount_ = count;
+    ackInFlight_ = true;
+    cyw43_arch_lwip_begin();
+    err_t err = mqtt_publish(client_, MQTT_ACK_TOPIC, payload, (u16_t)len, 1, 0, onAckPublished, this);
+    cyw43_arch_lwip_end();
+    if (err != ERR_OK) {
+        printf("[MQTT] Ack publish failed, err=%d\n", err);
+        ackInFlight_ = false;
+        return false;
+    }
+    printf("[MQTT] Published acks: %s\n", payload);
+    return true;
+}
+
+void MqttChannel::onAckPublished(void* arg, err_t result) {
+    auto* channel = static_cast<MqttChannel*>(arg);
+    if (!channel) return;
+
+    if (result == ERR_OK) {
+        channel->commands_->popAcks(channel->ackSeq_, channel->ackCount_);
+    }
+    channel->ackInFlight_ = false;
+}
+
+// ----------------------------------------------------------------------------
+// queueCommand(): submit a command payload (lwIP thread).
+// ----------------------------------------------------------------------------
+/*
+    Payloads use the TalkBack command format, e.g. "ID=4 SETPOINT=900 FAN=30" (see
+    commands/Command.h). A bare number is still accepted as a setpoint. The command
+    queue validates the commands; rejected ones are acknowledged as such.
+*/
+void MqttChannel::queueCommand(const char* payload) {
+    char text[sizeof(payload_) + 9];
+    if (payload[0] >= '0' && payload[0] <= '9') {
+        snprintf(text, sizeof(text), "SETPOINT=%s", payload);
+        payload = text;
+    }
+    if (!commands_) return;
+
+    size_t rejected = 0;
+    size_t queued = commands_->submitText(payload, CommandSource::Mqtt, &rejected);
+    if (queued == 0 && rejected == 0) {
+        printf("[MQTT] Unknown command: %s\n", payload);
+    }
+    commandCount_ += queued;
+}
+
+// =============================================================================
+//                         lwIP CALLBACKS (STATIC)
+// =============================================================================
+
+void MqttChannel::onDnsFound(const char* hostname, const ip_addr_t* ipaddr, void* arg) {
+    auto* channel = static_cast<MqttChannel*>(arg);
+    if (!channel) return;
+
+    if (ipaddr) {
+        channel->connectToIp(ipaddr);
+    } else {
+        printf("[MQTT] Error resolving hostname %s\n", hostname);
+        channel->state_ = State::Disconnected;
+    }
+}
+
+void MqttChannel::connectToIp(const ip_addr_t* ipaddr) {
+    struct mqtt_connect_client_info_t info;
+    memset(&info, 0, sizeof(info));
+    info.client_id   = MQTT_CLIENT_ID;
+    info.client_user = MQTT_USERNAME;
+    info.client_pass = MQTT_PASSWORD;
+    info.keep_alive  = MQTT_KEEP_ALIVE_S;
+    // The broker publishes this retained status if the connection is lost.
+    info.will_topic  = MQTT_STATUS_TOPIC;
+    info.will_msg    = "offline";
+    info.will_qos    = 1;
+    info.will_retain = 1;
+#if MQTT_USE_TLS
+    info.tls_config  = tlsConfig_;
+#endif
+
+    printf("[MQTT] Connecting to %s port %d\n", ipaddr_ntoa(ipaddr), MQTT_BROKER_PORT);
+    state_ = State::Connecting;
+    err_t err = mqtt_client_connect(client_, ipaddr, MQTT_BROKER_PORT, onConnection, this, &info);
+    if (err != ERR_OK) {
+        printf("[MQTT] mqtt_client_connect failed, err=%d\n", err);
+        state_ = State::Disconnected;
+    }
+}
+
+void MqttChannel::onConnection(mqtt_client_t* client, void* arg, mqtt_connection_status_t status) {
+    auto* channel = static_cast<MqttChannel*>(arg);
+    if (!channel) return;
+
+    if (status != MQTT_CONNECT_ACCEPTED) {
+        printf("[MQTT] Disconnected, status=%d\n", (int)status);
+        channel->state_ = State::Disconnected;
+        // Pending publishes are dropped with the connection; acks are sent again.
+        channel->ackInFlight_ = false;
+        return;
+    }
+
+    printf("[MQTT] Connected to broker.\n");
+    channel->state_ = State::Connected;
+    mqtt_subscribe(client, MQTT_COMMAND_TOPIC, 1, onSubscribed, channel);
+    mqtt_publish(client, MQTT_STATUS_TOPIC, "online", 6, 1, 1, nullptr, nullptr);
+}
+
+void MqttChannel::onSubscribed(void* arg, err_t result) {
+    if (result != ERR_OK) {
+        printf("[MQTT] Subscribe to %s failed, err=%d\n", MQTT_COMMAND_TOPIC, result);
+    } else {
+        printf("[MQTT] Subscribed to %s\n", MQTT_COMMAND_TOPIC);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// onIncomingPublish / onIncomingData: collect a command payload.
+// ----------------------------------------------------------------------------
+/*
+    lwIP reports the topic first and then delivers the payload in one or more fragments,
+    the last one flagged with MQTT_DATA_FLAG_LAST. Payloads longer than payload_ are
+    commands we do not understand and are discarded.
+*/
+void MqttChannel::onIncomingPublish(void* arg, const char* topic, u32_t totalLength) {
+    auto* channel = static_cast<MqttChannel*>(arg);
+    if (!channel) return;
+
+    channel->inCommandTopic_ = (strcmp(topic, MQTT_COMMAND_TOPIC) == 0) &&
+                               totalLength < sizeof(channel->payload_);
+    channel->payloadLength_ = 0;
+}
+
+void MqttChannel::onIncomingData(void* arg, const u8_t* data, u16_t length, u8_t flags) {
+    auto* channel = static_cast<MqttChannel*>(arg);
+    if (!channel || !channel->inCommandTopic_) return;
+
+    size_t space = sizeof(channel->payload_) - 1 - channel->payloadLength_;
+    size_t n = length < space ? length : space;
+    memcpy(channel->payload_ + channel->payloadLength_, data, n);
+    channel->payloadLength_ += n;
+
+    if (flags & MQTT_DATA_FLAG_LAST) {
+        channel->payload_[channel->payloadLength_] = '\0';
+        channel->inCommandTopic_ = false;
+        channel->queueCommand(channel->payload_);
+    }
+}
+
+#endif // MQTT_BROKER_HOST
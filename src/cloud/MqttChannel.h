@@ -0,0 +1,118 @@
+#ifndef MQTT_CHANNEL_H
+#define MQTT_CHANNEL_H
+
+#include <cstdint>
+#include <memory>
+#include "FreeRTOS.h"
+#include "lwip/apps/mqtt.h"
+#include "lwip/altcp_tls.h"
+#include "TelemetryCodec.h"
+#include "ITelemetrySink.h"
+#include "DnsCache.h"
+#include "commands/CommandQueue.h"
+
+/*
+   MqttChannel Module Header
+
+   This module provides an MQTT connection to a broker as a low-latency alternative to
+   polling ThingSpeak TalkBack over HTTPS. It uses lwIP's MQTT client, optionally over
+   altcp_tls, and is driven by mqttTask.
+
+   Key responsibilities include:
+     - Resolving the broker host name and (re)connecting with a configurable delay.
+     - Acting as the MQTT sink of the TelemetryPipeline: the queued telemetry records are
+       published as a compact CBOR batch (TelemetryCodec) or as CSV text. While the
+       broker is unreachable the records wait in the sink's queue.
+     - Subscribing to the command topic. Commands arrive in the lwIP thread and are
+       submitted to the CommandQueue, which the controller task executes within one
+       control cycle (one broker round trip instead of up to a minute).
+     - Publishing command acknowledgements on the ack topic (QoS 1); they are removed
+       from the CommandQueue once the broker has confirmed them.
+     - Publishing a retained status ("online"/"offline" via last will).
+
+   Broker host, port, TLS and topics are configured in mqtt_config.h. connect() and
+   publishAcks() are called from mqttTask, the sink methods from the pipeline task.
+*/
+class MqttChannel : public ITelemetrySink {
+public:
+    // ------------------------------------------------------------------------
+    // Constructor / Destructor
+    // ------------------------------------------------------------------------
+    // The DNS cache is optional; without it the broker is resolved with lwIP directly.
+    MqttChannel(std::shared_ptr<CommandQueue> commands, std::shared_ptr<DnsCache> dnsCache = nullptr);
+    ~MqttChannel() override;
+
+    MqttChannel(const MqttChannel&) = delete;
+
+    // ------------------------------------------------------------------------
+    // Called from mqttTask
+    // ------------------------------------------------------------------------
+    // Starts a connection attempt if disconnected and the reconnect delay has elapsed.
+    void connect();
+
+    // Returns true while the broker has accepted the connection.
+    bool isConnected() const;
+
+    // Publishes pending command acknowledgements on the ack topic. Returns true if acks
+    // were published.
+    bool publishAcks();
+
+    // ------------------------------------------------------------------------
+    // ITelemetrySink (pipeline task)
+    // ------------------------------------------------------------------------
+    const char* getName() const override;
+    UploadSchedulerConfig getScheduleConfig() const override;
+
+    // MQTT_MAX_BATCH records per CBOR message, one per CSV message.
+    size_t getMaxBatch() const override;
+
+    // Publishes the records on the telemetry topic (QoS 0). Returns the number of records
+    // handed to lwIP, 0 while disconnected or if lwIP's output queue is full.
+    size_t send(const TelemetryRecord* records, size_t count) override;
+
+    // Payload size and encode time statistics of the CBOR telemetry.
+    const TelemetryCodecStats& getCodecStats() const;
+
+private:
+    enum class State : uint8_t { Disconnected, Resolving, Connecting, Connected };
+
+    std::shared_ptr<CommandQueue> commands_;
+    std::shared_ptr<DnsCache> dnsCache_;
+    mqtt_client_t* client_;
+    struct altcp_tls_config* tlsConfig_;  // nullptr when MQTT_USE_TLS is 0.
+    volatile State state_;
+    TickType_t lastAttempt_;
+
+    // Incoming publish being received (the payload may arrive in several fragments).
+    bool inCommandTopic_;
+    char payload_[64];
+    size_t payloadLength_;
+
+    TelemetryCodec codec_;
+
+    // Ack publish waiting for the broker's PUBACK (one at a time).
+    volatile bool ackInFlight_;
+    uint32_t ackSeq_;
+    size_t ackCount_;
+
+    uint32_t commandCount_;
+    uint32_t publishCount_;
+
+    // Submits a complete command payload to the command queue.
+    void queueCommand(const char* payload);
+
+    // Starts the MQTT connection once the broker address is known (lwIP thread).
+    void connectToIp(const ip_addr_t* ipaddr);
+
+    // ------------------------------------------------------------------------
+    // Static callbacks used by lwIP's DNS and MQTT APIs (run in the lwIP thread).
+    // ------------------------------------------------------------------------
+    static void onDnsFound(const char* hostname, const ip_addr_t* ipaddr, void* arg);
+    static void onConnection(mqtt_client_t* client, void* arg, mqtt_connection_status_t status);
+    static void onSubscribed(void* arg, err_t result);
+    static void onIncomingPublish(void* arg, const char* topic, u32_t totalLength);
+    static void onIncomingData(void* arg, const u8_t* data, u16_t length, u8_t flags);
+    static void onAckPublished(void* arg, err_t result);
+};
+
+#endif // MQTT_CHANNEL_H
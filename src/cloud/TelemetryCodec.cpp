@@ -0,0 +1,255 @@
+#include "TelemetryCodec.h"
+#include <cmath>
+
+#if PICO_ON_DEVICE
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#endif
+
+// =============================================================================
+//                         TelemetryCodec Implementation
+// =============================================================================
+
+// CBOR major types used by the format.
+static constexpr uint8_t CBOR_UNSIGNED = 0;
+static constexpr uint8_t CBOR_NEGATIVE = 1;
+static constexpr uint8_t CBOR_ARRAY    = 4;
+
+// Number of values in a sample array.
+static constexpr size_t FIRST_SAMPLE_ITEMS = 6;
+static constexpr size_t DELTA_SAMPLE_ITEMS = 7;
+
+// ----------------------------------------------------------------------------
+// Output cursor with overflow tracking.
+// ----------------------------------------------------------------------------
+struct CborWriter {
+    uint8_t* out;
+    size_t size;
+    size_t pos;
+    bool overflow;
+};
+
+static void putByte(CborWriter& w, uint8_t b) {
+    if (w.pos < w.size) {
+        w.out[w.pos] = b;
+    } else {
+        w.overflow = true;
+    }
+    w.pos++;
+}
+
+// Writes a CBOR head: major type and argument in the shortest form.
+static void putHead(CborWriter& w, uint8_t major, uint32_t value) {
+    uint8_t type = major << 5;
+    if (value < 24) {
+        putByte(w, type | value);
+    } else if (value <= 0xFF) {
+        putByte(w, type | 24);
+        putByte(w, value);
+    } else if (value <= 0xFFFF) {
+        putByte(w, type | 25);
+        putByte(w, value >> 8);
+        putByte(w, value);
+    } else {
+        putByte(w, type | 26);
+        putByte(w, value >> 24);
+        putByte(w, value >> 16);
+        putByte(w, value >> 8);
+        putByte(w, value);
+    }
+}
+
+static void putInt(CborWriter& w, int32_t value) {
+    if (value >= 0) {
+        putHead(w, CBOR_UNSIGNED, static_cast<uint32_t>(value));
+    } else {
+        // CBOR negative integers encode -1 - n.
+        putHead(w, CBOR_NEGATIVE, static_cast<uint32_t>(-1 - value));
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Input cursor.
+// ----------------------------------------------------------------------------
+struct CborReader {
+    const uint8_t* data;
+    size_t length;
+    size_t pos;
+};
+
+static bool getHead(CborReader& r, uint8_t& major, uint32_t& value) {
+    if (r.pos >= r.length) return false;
+    uint8_t initial = r.data[r.pos++];
+    major = initial >> 5;
+    uint8_t info = initial & 0x1F;
+    size_t extra;
+    if (info < 24) {
+        value = info;
+        return true;
+    } else if (info == 24) {
+        extra = 1;
+    } else if (info == 25) {
+        extra = 2;
+    } else if (info == 26) {
+        extra = 4;
+    } else {
+        return false;   // 64-bit and indefinite lengths are not used by the format.
+    }
+    if (r.pos + extra > r.length) return false;
+    value = 0;
+    for (size_t i = 0; i < extra; i++) {
+        value = (value << 8) | r.data[r.pos++];
+    }
+    return true;
+}
+
+static bool getInt(CborReader& r, int32_t& value) {
+    uint8_t major;
+    uint32_t arg;
+    if (!getHead(r, major, arg)) return false;
+    if (major == CBOR_UNSIGNED) {
+        value = static_cast<int32_t>(arg);
+    } else if (major == CBOR_NEGATIVE) {
+        value = -1 - static_cast<int32_t>(arg);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool getArray(CborReader& r, uint32_t& items) {
+    uint8_t major;
+    return getHead(r, major, items) && major == CBOR_ARRAY;
+}
+
+// ----------------------------------------------------------------------------
+// Fixed-point conversion of a record.
+// ----------------------------------------------------------------------------
+struct FixedSample {
+    int32_t co2, rh, temp, fan, setpoint;
+};
+
+static FixedSample toFixed(const TelemetryRecord& r) {
+    FixedSample f;
+    f.co2      = static_cast<int32_t>(lroundf(r.co2));
+    f.rh       = static_cast<int32_t>(lroundf(r.rh * 10.0f));
+    f.temp     = static_cast<int32_t>(lroundf(r.temp * 10.0f));
+    f.fan      = static_cast<int32_t>(lroundf(r.fanSpeed * 10.0f));
+    f.setpoint = static_cast<int32_t>(lroundf(r.setpoint));
+    return f;
+}
+
+static void fromFixed(const FixedSample& f, TelemetryRecord& r) {
+    r.co2      = static_cast<float>(f.co2);
+    r.rh       = f.rh / 10.0f;
+    r.temp     = f.temp / 10.0f;
+    r.fanSpeed = f.fan / 10.0f;
+    r.setpoint = static_cast<float>(f.setpoint);
+}
+
+// ----------------------------------------------------------------------------
+// encode()
+// ----------------------------------------------------------------------------
+size_t TelemetryCodec::encode(const TelemetryRecord* records, size_t count, uint8_t* out, size_t size) {
+#if PICO_ON_DEVICE
+    uint64_t start = time_us_64();
+#endif
+    CborWriter w{out, size, 0, false};
+
+    putHead(w, CBOR_ARRAY, static_cast<uint32_t>(count + 2));
+    putInt(w, SCHEMA_VERSION);
+    putHead(w, CBOR_UNSIGNED, count ? records[0].timestampMs : 0);
+
+    FixedSample prev{};
+    for (size_t i = 0; i < count; i++) {
+        FixedSample cur = toFixed(records[i]);
+        if (i == 0) {
+            putHead(w, CBOR_ARRAY, FIRST_SAMPLE_ITEMS);
+            putInt(w, cur.co2);
+            putInt(w, cur.rh);
+            putInt(w, cur.temp);
+            putInt(w, cur.fan);
+            putInt(w, cur.setpoint);
+        } else {
+            // Deltas between the rounded values, so rounding errors do not accumulate.
+            putHead(w, CBOR_ARRAY, DELTA_SAMPLE_ITEMS);
+            putHead(w, CBOR_UNSIGNED, records[i].timestampMs - records[i - 1].timestampMs);
+            putInt(w, cur.co2 - prev.co2);
+            putInt(w, cur.rh - prev.rh);
+            putInt(w, cur.temp - prev.temp);
+            putInt(w, cur.fan - prev.fan);
+            putInt(w, cur.setpoint - prev.setpoint);
+        }
+        putHead(w, CBOR_UNSIGNED, records[i].flags);
+        prev = cur;
+    }
+
+    if (w.overflow) {
+        return 0;
+    }
+
+    stats_.batches++;
+    stats_.samples    += count;
+    stats_.bytes      += w.pos;
+    stats_.lastBytes   = w.pos;
+    stats_.lastSamples = count;
+#if PICO_ON_DEVICE
+    stats_.lastUs     = static_cast<uint32_t>(time_us_64() - start);
+    stats_.lastCycles = stats_.lastUs * (clock_get_hz(clk_sys) / 1000000);
+#endif
+    return w.pos;
+}
+
+// ----------------------------------------------------------------------------
+// decode()
+// ----------------------------------------------------------------------------
+bool TelemetryCodec::decode(const uint8_t* data, size_t length, TelemetryRecord* out, size_t max, size_t& count) {
+    CborReader r{data, length, 0};
+    count = 0;
+
+    uint32_t items;
+    int32_t version;
+    uint8_t major;
+    uint32_t timestamp;
+    if (!getArray(r, items) || items < 2) return false;
+    if (!getInt(r, version) || version != SCHEMA_VERSION) return false;
+    if (!getHead(r, major, timestamp) || major != CBOR_UNSIGNED) return false;
+
+    FixedSample cur{};
+    for (uint32_t i = 0; i < items - 2; i++) {
+        uint32_t fields;
+        if (!getArray(r, fields)) return false;
+        if (i == 0) {
+            if (fields != FIRST_SAMPLE_ITEMS) return false;
+            if (!getInt(r, cur.co2) || !getInt(r, cur.rh) || !getInt(r, cur.temp) ||
+                !getInt(r, cur.fan) || !getInt(r, cur.setpoint)) return false;
+        } else {
+            uint32_t dt;
+            FixedSample d;
+            if (fields != DELTA_SAMPLE_ITEMS) return false;
+            if (!getHead(r, major, dt) || major != CBOR_UNSIGNED) return false;
+            if (!getInt(r, d.co2) || !getInt(r, d.rh) || !getInt(r, d.temp) ||
+                !getInt(r, d.fan) || !getInt(r, d.setpoint)) return false;
+            timestamp    += dt;
+            cur.co2      += d.co2;
+            cur.rh       += d.rh;
+            cur.temp     += d.temp;
+            cur.fan      += d.fan;
+            cur.setpoint += d.setpoint;
+        }
+        uint32_t flags;
+        if (!getHead(r, major, flags) || major != CBOR_UNSIGNED) return false;
+
+        if (count < max) {
+            TelemetryRecord& rec = out[count++];
+            rec.timestampMs = timestamp;
+            fromFixed(cur, rec);
+            rec.flags = static_cast<uint8_t>(flags);
+        }
+    }
+    return r.pos == r.length;
+}
+
+const TelemetryCodecStats& TelemetryCodec::getStats() const {
+    return stats_;
+}
@@ -0,0 +1,350 @@
+#include "TelemetryPipeline.h"
+#include <cstdio>
+#include <mutex>
+#include <utility>
+
+#include "pico/stdlib.h"
+#include "pico/rand.h"
+
+// =============================================================================
+//                       TelemetryPipeline Implementation
+// =============================================================================
+
+static const MetricDescriptor sentDescriptor = {
+    "greenhouse_telemetry_sent_total", "Telemetry records accepted by a sink.", MetricType::Counter };
+static const MetricDescriptor droppedDescriptor = {
+    "greenhouse_telemetry_dropped_total", "Telemetry records dropped because a sink queue was full.", MetricType::Counter };
+static const MetricDescriptor replayedDescriptor = {
+    "greenhouse_telemetry_replayed_total", "Telemetry records queued again from the sample log.", MetricType::Counter };
+static const MetricDescriptor failuresDescriptor = {
+    "greenhouse_telemetry_failures_total", "Failed or rate-limited sink requests.", MetricType::Counter };
+static const MetricDescriptor queuedDescriptor = {
+    "greenhouse_telemetry_queued", "Telemetry records waiting in a sink queue.", MetricType::Gauge };
+
+static uint32_t nowMs() {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+TelemetryPipeline::TelemetryPipeline()
+        : sinkCount_(0)
+        , serviceTask_(nullptr)
+{
+}
+
+// ----------------------------------------------------------------------------
+// addSink(): register a sink with its own queue and scheduler.
+// ----------------------------------------------------------------------------
+bool TelemetryPipeline::addSink(std::shared_ptr<ITelemetrySink> sink, size_t capacity, size_t highWater) {
+    if (!sink || sinkCount_ >= MAX_SINKS) {
+        return false;
+    }
+    Sink& entry = sinks_[sinkCount_];
+    entry.queue = std::make_unique<TelemetryQueue>(capacity, highWater);
+    // Every sink gets its own seed, so their phases are independent as well.
+    entry.scheduler = std::make_unique<UploadScheduler>(get_rand_32(), nowMs(), sink->getScheduleConfig());
+
+    char labels[MetricsRegistry::MAX_LABELS];
+    snprintf(labels, sizeof(labels), "sink=\"%s\"", sink->getName());
+    entry.sentMetric     = g_metrics.add(sentDescriptor, labels);
+    entry.droppedMetric  = g_metrics.add(droppedDescriptor, labels);
+    entry.replayedMetric = g_metrics.add(replayedDescriptor, labels);
+    entry.failuresMetric = g_metrics.add(failuresDescriptor, labels);
+    entry.queuedMetric   = g_metrics.add(queuedDescriptor, labels);
+
+    entry.id = sinkId(sink->getName());
+    entry.sink = std::move(sink);
+    sinkCount_++;
+    printf("[Telemetry] Sink %s added (queue of %u records).\n", entry.sink->getName(), (unsigned)capacity);
+    return true;
+}
+
+void TelemetryPipeline::setLog(std::shared_ptr<SampleLog> log) {
+    std::lock_guard<Fmutex> exclusive(spill_);
+    log_ = std::move(log);
+}
+
+// ----------------------------------------------------------------------------
+// resume(): continue every sink at its persisted position in the log.
+// ----------------------------------------------------------------------------
+/*
+    A sink with records left in the log starts out spilling from its position, so
+    replay() queues them before the first new record. A position beyond the end of the
+    log (records that were still in RAM at the reset) or without a saved value starts at
+    the end; one before the oldest record in the log starts at the oldest. Positions are
+    only kept while the log is on the EEPROM; otherwise its sequence numbers start over
+    with every boot.
+*/
+void TelemetryPipeline::resume(std::shared_ptr<ConfigCache> cursors) {
+    std::lock_guard<Fmutex> exclusive(spill_);
+    if (!log_ || !log_->isMounted() || !cursors) {
+        return;
+    }
+    cursors_ = std::move(cursors);
+
+    ConfigDelivered saved = {};
+    bool found = cursors_->get(ConfigKey::DeliveredSeq, saved);
+    uint32_t end = log_->getNextSeq();
+    for (size_t i = 0; i < sinkCount_; i++) {
+        Sink& entry = sinks_[i];
+        entry.queuedEnd = end;
+        for (size_t k = 0; found && k < MAX_SINKS; k++) {
+            uint32_t seq = saved.seq[k];
+            if (saved.sink[k] != entry.id || seq >= end) {
+                continue;
+            }
+            if (seq < log_->getOldestSeq()) {
+                seq = log_->getOldestSeq();  // The log has overwritten the rest.
+            }
+            entry.spilling = true;
+            entry.replaySeq = seq;
+            entry.queuedEnd = seq;
+            printf("[Telemetry] %s: %lu samples from before the reset left to send.\n",
+                   entry.sink->getName(), (unsigned long)(end - seq));
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// push(): hand a record to every sink (producer task).
+// ----------------------------------------------------------------------------
+/*
+    A sink that is spilling gets nothing here; replay() queues the record from the log
+    once the records before it have been queued.
+*/
+bool TelemetryPipeline::push(const TelemetryRecord& record) {
+    bool ok = true;
+    {
+        std::lock_guard<Fmutex> exclusive(spill_);
+        uint32_t seq = log_ ? log_->append(record) : 0;
+        for (size_t i = 0; i < sinkCount_; i++) {
+            Sink& entry = sinks_[i];
+            if (entry.spilling) {
+                continue;
+            }
+            if (log_ && entry.queue->size() >= entry.queue->capacity()) {
+                entry.spilling = true;
+                entry.replaySeq = seq;
+                printf("[Telemetry] %s queue full, keeping new samples in the sample log.\n",
+                       entry.sink->getName());
+                continue;
+            }
+            entry.queuedEnd = seq + 1;
+            if (!entry.queue->push(record)) {
+                printf("[Telemetry] %s queue full, oldest sample dropped (%lu dropped so far).\n",
+                       entry.sink->getName(), (unsigned long)entry.queue->getDroppedCount());
+                ok = false;
+            }
+        }
+    }
+
+    TaskHandle_t task = serviceTask_;
+    if (task) {
+        xTaskNotifyGiveIndexed(task, WAKEUP_NOTIFICATION_INDEX);
+    }
+    return ok;
+}
+
+// ----------------------------------------------------------------------------
+// service(): serve the sinks that are due (pipeline task).
+// ----------------------------------------------------------------------------
+uint32_t TelemetryPipeline::service() {
+    uint32_t delayMs = CHECK_PERIOD_MS;
+    if (log_) {
+        // Full blocks go to the EEPROM here, so push() never waits for it.
+        log_->sync();
+    }
+    for (size_t i = 0; i < sinkCount_; i++) {
+        Sink& entry = sinks_[i];
+        serve(entry, nowMs());
+        if (entry.spilling) {
+            replay(entry);
+        }
+
+        uint32_t dropped = entry.queue->getDroppedCount();
+        g_metrics.inc(entry.droppedMetric, dropped - entry.reportedDropped);
+        entry.reportedDropped = dropped;
+        g_metrics.set(entry.queuedMetric, static_cast<float>(entry.queue->size()));
+
+        uint32_t due = entry.scheduler->getDelayMs(nowMs(), entry.queue->size() > 0);
+        if (due < delayMs) delayMs = due;
+    }
+    return delayMs;
+}
+
+void TelemetryPipeline::wait(uint32_t ms) {
+    serviceTask_ = xTaskGetCurrentTaskHandle();
+    // A separate notification index: the sinks' I/O and the sample log's EEPROM accesses wait
+    // on index 0 (HttpsSession, PicoI2C).
+    ulTaskNotifyTakeIndexed(WAKEUP_NOTIFICATION_INDEX, pdTRUE, pdMS_TO_TICKS(ms));
+}
+
+size_t TelemetryPipeline::getSinkCount() const {
+    return sinkCount_;
+}
+
+size_t TelemetryPipeline::getPending(size_t index) const {
+    if (index >= sinkCount_) {
+        return 0;
+    }
+    const Sink& entry = sinks_[index];
+    std::lock_guard<Fmutex> exclusive(spill_);
+    size_t pending = entry.queue->size();
+    if (entry.spilling) {
+        pending += log_->getNextSeq() - entry.replaySeq;
+    }
+    return pending;
+}
+
+// ----------------------------------------------------------------------------
+// serve(): upload, poll or wait, and report the outcome to the scheduler.
+// ----------------------------------------------------------------------------
+void TelemetryPipeline::serve(Sink& entry, uint32_t now) {
+    ITelemetrySink* sink = entry.sink.get();
+    bool pending = entry.queue->size() > 0;
+    UploadAction action = entry.scheduler->next(now, pending, entry.queue->isHighWater());
+    if (action == UploadAction::Wait) {
+        return;
+    }
+
+    bool ok = action == UploadAction::Upload ? upload(entry) : sink->poll();
+
+    uint32_t retryAfter = sink->getLastRetryAfter();
+    UploadOutcome outcome = UploadScheduler::classify(ok, sink->getLastStatusCode(), retryAfter);
+    now = nowMs();
+    entry.scheduler->report(now, outcome, retryAfter);
+    if (outcome != UploadOutcome::Success) {
+        g_metrics.inc(entry.failuresMetric);
+        printf("[Telemetry] %s: %s, %u records queued, backing off for %lu s (%lu failure(s), interval %lu s).\n",
+               sink->getName(), outcome == UploadOutcome::RateLimited ? "rate limited" : "request failed",
+               (unsigned)entry.queue->size(),
+               (unsigned long)(entry.scheduler->getDelayMs(now, true) / 1000),
+               (unsigned long)entry.scheduler->getFailureStreak(),
+               (unsigned long)(entry.scheduler->getIntervalMs() / 1000));
+    }
+}
+
+// ----------------------------------------------------------------------------
+// upload(): drain the queue of one sink in batches.
+// ----------------------------------------------------------------------------
+/*
+    Records are peeked, sent and only then popped, so a failed request leaves them in
+    the queue for the next attempt. A sink may accept fewer records than offered (e.g.
+    when they do not fit into one request); the rest is offered again in the next batch.
+    A sink with getMaxRequests() stops after that many requests and sends the rest in its
+    next upload slot.
+*/
+bool TelemetryPipeline::upload(Sink& entry) {
+    ITelemetrySink* sink = entry.sink.get();
+    size_t maxBatch = sink->getMaxBatch();
+    if (maxBatch == 0 || maxBatch > MAX_BATCH) maxBatch = MAX_BATCH;
+    size_t maxRequests = sink->getMaxRequests();
+    size_t requests = 0;
+
+    TelemetryRecord batch[MAX_BATCH];
+    uint32_t firstSeq = 0;
+    size_t sent = 0;
+    bool ok = true;
+
+    while (ok) {
+        size_t n = entry.queue->peek(batch, maxBatch, firstSeq);
+        if (n == 0) break;
+        size_t accepted = sink->send(batch, n);
+        if (accepted == 0) {
+            ok = false;
+            break;
+        }
+        if (accepted > n) accepted = n;
+        entry.queue->pop(firstSeq, accepted);
+        sent += accepted;
+        if (maxRequests && ++requests >= maxRequests) break;   // The rest waits for the next slot.
+    }
+    g_metrics.inc(entry.sentMetric, sent);
+
+    if (sent && cursors_) {
+        saveCursors();
+    }
+
+    if (ok) {
+        sink->finishUpload();
+        printf("[Telemetry] %s: %u records sent.\n", sink->getName(), (unsigned)sent);
+    }
+    return ok;
+}
+
+// ----------------------------------------------------------------------------
+// replay(): refill the queue of a spilling sink from the log.
+// ----------------------------------------------------------------------------
+/*
+    Records are read in batches until the queue is full or the sink has caught up with the
+    log. Whether it has caught up is decided under spill_, so a concurrent push() either
+    still finds the sink spilling (and the record is read here next time) or queues it
+    itself. Records the log has overwritten before they were read are counted as dropped.
+*/
+void TelemetryPipeline::replay(Sink& entry) {
+    LoggedSample samples[MAX_BATCH];
+    size_t replayed = 0;
+    uint32_t lost = 0;
+    while (true) {
+        size_t room = entry.queue->capacity() - entry.queue->size();
+        if (room > MAX_BATCH) room = MAX_BATCH;
+        if (room == 0) break;
+        uint32_t seq = entry.replaySeq;
+        size_t n = log_->read(seq, samples, room);
+        for (size_t i = 0; i < n; i++) {
+            TelemetryRecord& record = samples[i].record;
+            if (!samples[i].currentBoot) {
+                // Its timestamp counts from an earlier boot; the sinks use the UTC time instead.
+                record.flags |= TelemetryRecord::EARLIER_BOOT;
+                record.utcSeconds = static_cast<uint32_t>(samples[i].utcMs / 1000);
+            }
+            entry.queue->push(record);
+        }
+        lost += (seq - entry.replaySeq) - n;
+        entry.replaySeq = seq;
+        entry.queuedEnd = seq;
+        replayed += n;
+        if (n < room) break;
+    }
+    g_metrics.inc(entry.replayedMetric, replayed);
+    if (lost) {
+        g_metrics.inc(entry.droppedMetric, lost);
+        printf("[Telemetry] %s: %lu samples were overwritten in the sample log before replay.\n",
+               entry.sink->getName(), (unsigned long)lost);
+    }
+
+    std::lock_guard<Fmutex> exclusive(spill_);
+    if (entry.replaySeq == log_->getNextSeq()) {
+        entry.spilling = false;
+        printf("[Telemetry] %s caught up with the sample log.\n", entry.sink->getName());
+    }
+}
+
+// ----------------------------------------------------------------------------
+// saveCursors(): persist the log position of every sink (pipeline task).
+// ----------------------------------------------------------------------------
+/*
+    A sink's queue holds the records just before queuedEnd, so everything before them has
+    been accepted. The ConfigCache only updates RAM here; eepromTask writes the value
+    once uploads pause for its debounce time, and at least every MAX_DELAY_MS.
+*/
+void TelemetryPipeline::saveCursors() {
+    ConfigDelivered delivered = {};
+    {
+        std::lock_guard<Fmutex> exclusive(spill_);
+        for (size_t i = 0; i < sinkCount_; i++) {
+            const Sink& entry = sinks_[i];
+            delivered.sink[i] = entry.id;
+            delivered.seq[i] = entry.queuedEnd - static_cast<uint32_t>(entry.queue->size());
+        }
+    }
+    cursors_->set(ConfigKey::DeliveredSeq, delivered);
+}
+
+uint16_t TelemetryPipeline::sinkId(const char* name) {
+    uint32_t hash = 2166136261u;          // FNV-1a.
+    for (; *name; name++) {
+        hash = (hash ^ static_cast<uint8_t>(*name)) * 16777619u;
+    }
+    uint16_t id = static_cast<uint16_t>(hash ^ (hash >> 16));
+    return id ? id : 1;
+}
@@ -0,0 +1,136 @@
+#ifndef TELEMETRY_PIPELINE_H
+#define TELEMETRY_PIPELINE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "TelemetryRecord.h"
+#include "TelemetryQueue.h"
+#include "UploadScheduler.h"
+#include "ITelemetrySink.h"
+#include "Fmutex.h"
+#include "EEPROM/SampleLog.h"
+#include "EEPROM/ConfigCache.h"
+#include "metrics/Metrics.h"
+
+/*
+   TelemetryPipeline Module Header
+
+   Fans the telemetry records of the ChangeDetector out to all registered sinks
+   (ThingSpeak, HTTP JSON endpoint, MQTT broker, see ITelemetrySink.h).
+
+   Key properties:
+     - Every sink has its own TelemetryQueue (store-and-forward) and UploadScheduler
+       (pacing, jitter, rate limiting, backoff). A failing or rate-limited sink keeps its
+       records and backs off, while the other sinks continue to deliver.
+     - push() appends a record to every queue and wakes the pipeline task, so sinks with
+       a short upload interval (MQTT) send within milliseconds instead of waiting for the
+       next check.
+     - service() runs in the pipeline task (cloudTask). For every sink that is due it
+       drains the queue in batches of at most getMaxBatch() records, removing records only
+       after the sink accepted them, or lets the sink poll for commands when nothing is
+       queued. Sinks are served one after the other; a slow sink delays the others by at
+       most one request timeout, after which it backs off.
+     - With a SampleLog (setLog()) every record is also appended to the persistent log.
+       A sink whose queue is full then stops taking records from push() instead of
+       dropping the oldest ones: the records stay in the log, and service() refills the
+       queue from it in order as the sink catches up (offline periods of hours). Only
+       records that the log itself has overwritten in the meantime are lost.
+     - With resume() the position of every sink in the log is persisted as well, so after
+       a reset each sink replays the records it had not yet accepted, with the UTC time
+       of their boot (EARLIER_BOOT). Positions are saved through the write-behind
+       ConfigCache, so a reset may cause records of the last seconds to be sent twice, but
+       none is skipped.
+     - Records sent, records dropped because a queue was full, records replayed from the
+       log, failed requests and the queue fill level are exported per sink in the metrics
+       registry.
+
+   Sinks and the log are added, and resume() is called, in setupTask before the tasks
+   start; push() may then be called from any task, service() and wait() from the pipeline
+   task only.
+*/
+class TelemetryPipeline {
+public:
+    static constexpr size_t MAX_SINKS = 4;
+    static constexpr size_t MAX_BATCH = 16;          // Records per send() call.
+    static constexpr uint32_t CHECK_PERIOD_MS = 5000; // Longest sleep of the pipeline task.
+
+    TelemetryPipeline();
+
+    TelemetryPipeline(const TelemetryPipeline&) = delete;
+
+    // Registers a sink with a send queue of 'capacity' records that counts as full at
+    // 'highWater'. Returns false if MAX_SINKS sinks are registered already.
+    bool addSink(std::shared_ptr<ITelemetrySink> sink, size_t capacity = 120, size_t highWater = 90);
+
+    // Keeps every record in 'log' as well and lets sinks that fall behind replay from it.
+    void setLog(std::shared_ptr<SampleLog> log);
+
+    // Loads the persisted log positions of the sinks from 'cursors' (ConfigKey::DeliveredSeq)
+    // and lets every sink replay the records logged before this boot that it had not
+    // accepted yet. From then on the positions are saved after every upload. Call after
+    // setLog() and addSink().
+    void resume(std::shared_ptr<ConfigCache> cursors);
+
+    // Appends a record to the queue of every sink. Returns false if a queue was full and
+    // its oldest record was dropped.
+    bool push(const TelemetryRecord& record);
+
+    // Serves every sink that is due. Returns the time in ms until a sink is due next
+    // (at most CHECK_PERIOD_MS).
+    uint32_t service();
+
+    // Sleeps up to 'ms' milliseconds; push() ends the sleep early.
+    void wait(uint32_t ms);
+
+    // Number of registered sinks, and the records waiting in the queue of sink 'index'
+    // (including records still to be replayed from the log).
+    size_t getSinkCount() const;
+    size_t getPending(size_t index) const;
+
+private:
+    struct Sink {
+        std::shared_ptr<ITelemetrySink> sink;
+        std::unique_ptr<TelemetryQueue> queue;
+        std::unique_ptr<UploadScheduler> scheduler;
+        uint32_t reportedDropped = 0;     // Queue drops already added to droppedMetric.
+        bool spilling = false;            // Queue was full; new records wait in the log.
+        uint32_t replaySeq = 0;           // Next log record to queue while spilling.
+        uint32_t queuedEnd = 0;           // Log sequence number after the last queued record.
+        uint16_t id = 0;                  // Hash of the sink name (ConfigDelivered).
+        MetricId sentMetric = -1;
+        MetricId droppedMetric = -1;
+        MetricId replayedMetric = -1;
+        MetricId failuresMetric = -1;
+        MetricId queuedMetric = -1;
+    };
+
+    Sink sinks_[MAX_SINKS];
+    size_t sinkCount_;
+    std::shared_ptr<SampleLog> log_;
+    std::shared_ptr<ConfigCache> cursors_;
+    mutable Fmutex spill_;                // Log appends and the spilling state of the sinks.
+    volatile TaskHandle_t serviceTask_;   // Task blocked in wait(), woken by push().
+
+    // Sends all queued records of 'entry'. Returns true unless a request failed.
+    bool upload(Sink& entry);
+
+    // Performs the action that the scheduler of 'entry' asks for at 'nowMs'.
+    void serve(Sink& entry, uint32_t nowMs);
+
+    // Refills the queue of a spilling sink from the log.
+    void replay(Sink& entry);
+
+    // Stores the log position of every sink after the records it has accepted.
+    void saveCursors();
+
+    // Non-zero 16-bit hash of a sink name.
+    static uint16_t sinkId(const char* name);
+
+    static_assert(sizeof(ConfigDelivered::sink) / sizeof(ConfigDelivered::sink[0]) >= MAX_SINKS,
+                  "ConfigDelivered must hold the position of every sink");
+};
+
+#endif // TELEMETRY_PIPELINE_H
@@ -0,0 +1,76 @@
+#include "TelemetryQueue.h"
+#include <mutex>
+
+/*
+   TelemetryQueue Module
+
+   Ring buffer of telemetry records protected by a FreeRTOS mutex (Fmutex).
+   Records are only removed with pop() once they have been delivered, which gives
+   the store-and-forward behaviour used by the Cloud module.
+*/
+
+TelemetryQueue::TelemetryQueue(size_t capacity, size_t highWater)
+        : buffer(capacity > 0 ? capacity : 1)
+        , highWater(highWater < capacity ? highWater : capacity)
+        , head(0)
+        , count(0)
+        , headSeq(0)
+        , dropped(0)
+{
+}
+
+bool TelemetryQueue::push(const TelemetryRecord& record) {
+    std::lock_guard<Fmutex> exclusive(access);
+    bool room = count < buffer.size();
+    if (!room) {
+        // Queue full: drop the oldest record so that the newest data is kept.
+        head = (head + 1) % buffer.size();
+        headSeq++;
+        count--;
+        dropped++;
+    }
+    buffer[(head + count) % buffer.size()] = record;
+    count++;
+    return room;
+}
+
+size_t TelemetryQueue::peek(TelemetryRecord* out, size_t max, uint32_t& firstSeq) const {
+    std::lock_guard<Fmutex> exclusive(access);
+    firstSeq = headSeq;
+    size_t n = max < count ? max : count;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = buffer[(head + i) % buffer.size()];
+    }
+    return n;
+}
+
+void TelemetryQueue::pop(uint32_t firstSeq, size_t n) {
+    std::lock_guard<Fmutex> exclusive(access);
+    // Number of the peeked records that are still at the head of the queue.
+    uint32_t endSeq = firstSeq + static_cast<uint32_t>(n);
+    int32_t remaining = static_cast<int32_t>(endSeq - headSeq);
+    if (remaining <= 0) return;
+    size_t k = static_cast<size_t>(remaining) < count ? static_cast<size_t>(remaining) : count;
+    head = (head + k) % buffer.size();
+    headSeq += k;
+    count -= k;
+}
+
+size_t TelemetryQueue::size() const {
+    std::lock_guard<Fmutex> exclusive(access);
+    return count;
+}
+
+size_t TelemetryQueue::capacity() const {
+    return buffer.size();
+}
+
+bool TelemetryQueue::isHighWater() const {
+    std::lock_guard<Fmutex> exclusive(access);
+    return count >= highWater;
+}
+
+uint32_t TelemetryQueue::getDroppedCount() const {
+    std::lock_guard<Fmutex> exclusive(access);
+    return dropped;
+}
@@ -0,0 +1,63 @@
+#ifndef TELEMETRY_QUEUE_H
+#define TELEMETRY_QUEUE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "Fmutex.h"
+#include "TelemetryRecord.h"
+
+/*
+   TelemetryQueue Class
+
+   A bounded FIFO of telemetry records used for store-and-forward uploads. Samples are
+   appended by the producer and removed by the uploader only after the server has
+   accepted them, so samples taken while the network is down are not lost.
+
+   The storage is allocated once in the constructor. When the queue is full the oldest
+   record is dropped to make room for the newest one (and counted), so the queue always
+   holds the most recent history. isHighWater() lets the uploader flush early before
+   records start to be dropped (backpressure).
+
+   All methods are thread-safe; the queue is shared between the sampling task and the
+   uploading task.
+*/
+class TelemetryQueue {
+public:
+    // capacity: maximum number of buffered records.
+    // highWater: fill level at which isHighWater() starts returning true.
+    explicit TelemetryQueue(size_t capacity = 120, size_t highWater = 90);
+
+    TelemetryQueue(const TelemetryQueue&) = delete;
+
+    // Appends a record. Returns false if the oldest record had to be dropped.
+    bool push(const TelemetryRecord& record);
+
+    // Copies up to 'max' of the oldest records into 'out' without removing them.
+    // 'firstSeq' receives the sequence number of the first copied record.
+    // Returns the number of records copied.
+    size_t peek(TelemetryRecord* out, size_t max, uint32_t& firstSeq) const;
+
+    // Removes the records returned by a previous peek() once they have been uploaded.
+    // Records that were already dropped in the meantime are skipped, so newer records
+    // are never removed by mistake.
+    void pop(uint32_t firstSeq, size_t count);
+
+    size_t size() const;
+    size_t capacity() const;
+    bool isHighWater() const;
+
+    // Number of records dropped because the queue was full.
+    uint32_t getDroppedCount() const;
+
+private:
+    mutable Fmutex access;
+    std::vector<TelemetryRecord> buffer;  // Ring buffer storage.
+    size_t highWater;
+    size_t head;                          // Index of the oldest record.
+    size_t count;                         // Number of records stored.
+    uint32_t headSeq;                     // Sequence number of the oldest record.
+    uint32_t dropped;
+};
+
+#endif // TELEMETRY_QUEUE_H
@@ -0,0 +1,34 @@
+#ifndef TELEMETRY_RECORD_H
+#define TELEMETRY_RECORD_H
+
+#include <cstdint>
+
+/*
+   TelemetryRecord
+
+   One timestamped telemetry sample as uploaded to the cloud. The timestamp is taken when
+   the sample is recorded, not when it is uploaded, so that samples buffered while offline
+   keep their original time. A sample replayed from the sample log after a reset carries
+   EARLIER_BOOT; its timestampMs counts from that boot, so its time is in utcSeconds.
+*/
+struct TelemetryRecord {
+    uint32_t timestampMs = 0;   // Milliseconds since boot when the sample was taken.
+    float co2      = 0.0f;      // CO₂ concentration (ppm).                 -> field1
+    float rh       = 0.0f;      // Relative humidity (%).                   -> field2
+    float temp     = 0.0f;      // Temperature (°C).                        -> field3
+    float fanSpeed = 0.0f;      // Commanded fan speed (%).                 -> field4
+    float setpoint = 0.0f;      // CO₂ setpoint (ppm).                      -> field5
+    uint8_t flags  = 0;         // Actuator state and report reason bits.  -> field6
+    uint32_t utcSeconds = 0;    // UTC of an EARLIER_BOOT sample, 0 if unknown.
+
+    // Bits of 'flags'.
+    static constexpr uint8_t VALVE_OPEN       = 0x01;  // CO₂ valve open when sampled.
+    static constexpr uint8_t SAFETY_VENT      = 0x02;  // High-CO₂ safety override active.
+    static constexpr uint8_t EARLIER_BOOT     = 0x04;  // Recorded before the last reset (see utcSeconds).
+    static constexpr uint8_t REASON_DEADBAND  = 0x10;  // A value moved beyond its deadband.
+    static constexpr uint8_t REASON_STATE     = 0x20;  // Valve, fan, safety or setpoint changed.
+    static constexpr uint8_t REASON_HEARTBEAT = 0x40;  // Nothing changed; periodic heartbeat.
+    static constexpr uint8_t REASON_COMMAND   = 0x80;  // Remote commands executed (carries their acks).
+};
+
+#endif // TELEMETRY_RECORD_H
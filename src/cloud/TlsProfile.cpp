@@ -0,0 +1,20 @@
+#include "TlsProfile.h"
+#include <cstdio>
+
+struct altcp_tls_config* createTlsClientConfig(const char* name, const uint8_t* trustAnchor, size_t length) {
+    struct altcp_tls_config* config;
+    if (trustAnchor && length > 0) {
+        // lwIP parses the CA and requires verification of the server certificate.
+        config = altcp_tls_create_config_client(trustAnchor, length);
+        if (config) {
+            printf("[TLS] %s: server certificate verification enabled.\n", name);
+        }
+    } else {
+        config = altcp_tls_create_config_client(nullptr, 0);
+        printf("[TLS] WARNING: %s: no trust anchor configured, server is not authenticated!\n", name);
+    }
+    if (!config) {
+        printf("[TLS] %s: failed to create TLS config.\n", name);
+    }
+    return config;
+}
@@ -0,0 +1,25 @@
+#ifndef TLS_PROFILE_H
+#define TLS_PROFILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include "lwip/altcp_tls.h"
+
+/*
+   TLS Profile Helper
+
+   Creates the client TLS configuration used by the cloud connections (HttpsSession,
+   MqttChannel). The cipher suites, curves and speed options of the profile are fixed at
+   compile time in ipstack/mbedtls_config.h; this helper adds the trust anchor.
+
+   The trust anchor is a DER-encoded CA certificate stored as a const array, so it stays
+   in flash and is parsed once without PEM/base64 decoding. With a trust anchor the server
+   certificate chain and host name (SNI) are verified and the handshake fails otherwise.
+   Without one (length 0) the connection is encrypted but the server is NOT authenticated;
+   a warning is printed so that this is not left unnoticed.
+
+   'name' is only used in log messages. Returns nullptr on failure.
+*/
+struct altcp_tls_config* createTlsClientConfig(const char* name, const uint8_t* trustAnchor, size_t length);
+
+#endif // TLS_PROFILE_H
@@ -0,0 +1,146 @@
+#include "UploadScheduler.h"
+
+// =============================================================================
+//                        UploadScheduler Implementation
+// =============================================================================
+
+// Longer Retry-After values are cut to a day (and kept well clear of 32-bit overflow).
+static constexpr uint32_t MAX_RETRY_AFTER_S = 86400;
+
+// True once 'nowMs' has reached 'targetMs' (wrap-around safe for differences < 24 days).
+static bool reached(uint32_t nowMs, uint32_t targetMs) {
+    return static_cast<int32_t>(nowMs - targetMs) >= 0;
+}
+
+// Milliseconds from 'nowMs' until 'targetMs', 0 if already reached.
+static uint32_t until(uint32_t nowMs, uint32_t targetMs) {
+    return reached(nowMs, targetMs) ? 0 : targetMs - nowMs;
+}
+
+UploadScheduler::UploadScheduler(uint32_t seed, uint32_t nowMs, const UploadSchedulerConfig& config)
+        : config_(config)
+        , random_(seed ? seed : 0x9E3779B9u)
+        , intervalMs_(config.minIntervalMs)
+        , holdUntilMs_(nowMs)
+        , held_(false)
+        , failures_(0)
+{
+    // Randomized phase: the first upload or poll happens somewhere in the phase window.
+    uint32_t phase = random(config_.phaseWindowMs);
+    nextUploadMs_ = nowMs + phase;
+    nextPollMs_   = nowMs + phase;
+}
+
+// ----------------------------------------------------------------------------
+// next(): decide between uploading, polling for commands and waiting.
+// ----------------------------------------------------------------------------
+UploadAction UploadScheduler::next(uint32_t nowMs, bool pending, bool highWater) const {
+    if (isHeld(nowMs)) {
+        return UploadAction::Wait;
+    }
+    if (pending) {
+        return (highWater || reached(nowMs, nextUploadMs_)) ? UploadAction::Upload : UploadAction::Wait;
+    }
+    if (config_.commandPollMs == 0) {
+        return UploadAction::Wait;
+    }
+    return reached(nowMs, nextPollMs_) ? UploadAction::PollCommands : UploadAction::Wait;
+}
+
+uint32_t UploadScheduler::getDelayMs(uint32_t nowMs, bool pending) const {
+    if (isHeld(nowMs)) {
+        return until(nowMs, holdUntilMs_);
+    }
+    if (!pending && config_.commandPollMs == 0) {
+        return UINT32_MAX;
+    }
+    return until(nowMs, pending ? nextUploadMs_ : nextPollMs_);
+}
+
+// ----------------------------------------------------------------------------
+// report(): adapt the schedule to the outcome of the last request.
+// ----------------------------------------------------------------------------
+/*
+    Success:     the failure streak ends, a raised interval shrinks towards the minimum,
+                 and the next upload and poll are scheduled a jittered interval ahead.
+    Failed:      hold for a random value between half and all of the exponential backoff.
+    RateLimited: double the interval and hold for at least Retry-After (or the new
+                 interval if the server gave none), plus a random share of it so that
+                 the devices limited together do not all return at the same moment.
+*/
+void UploadScheduler::report(uint32_t nowMs, UploadOutcome outcome, uint32_t retryAfterS) {
+    switch (outcome) {
+        case UploadOutcome::Success:
+            failures_ = 0;
+            held_ = false;
+            if (intervalMs_ > config_.minIntervalMs) {
+                intervalMs_ -= (intervalMs_ - config_.minIntervalMs + 3) / 4;
+            }
+            nextUploadMs_ = nowMs + jittered(intervalMs_);
+            nextPollMs_   = nowMs + jittered(config_.commandPollMs);
+            break;
+
+        case UploadOutcome::Failed: {
+            if (failures_ < 31) failures_++;
+            uint32_t backoff = config_.baseBackoffMs;
+            for (uint32_t i = 1; i < failures_ && backoff < config_.maxBackoffMs; i++) {
+                backoff *= 2;
+            }
+            if (backoff > config_.maxBackoffMs) backoff = config_.maxBackoffMs;
+            hold(nowMs, backoff / 2 + random(backoff / 2 + 1));
+            break;
+        }
+
+        case UploadOutcome::RateLimited: {
+            intervalMs_ = intervalMs_ < config_.maxBackoffMs / 2 ? intervalMs_ * 2 : config_.maxBackoffMs;
+            uint32_t wait = intervalMs_;
+            if (retryAfterS > 0) {
+                wait = retryAfterS < MAX_RETRY_AFTER_S ? retryAfterS * 1000 : MAX_RETRY_AFTER_S * 1000;
+            }
+            hold(nowMs, jittered(wait));
+            break;
+        }
+    }
+}
+
+UploadOutcome UploadScheduler::classify(bool ok, int statusCode, uint32_t retryAfterS) {
+    if (ok) return UploadOutcome::Success;
+    if (statusCode == 429 || (statusCode == 503 && retryAfterS > 0)) return UploadOutcome::RateLimited;
+    return UploadOutcome::Failed;
+}
+
+uint32_t UploadScheduler::getIntervalMs() const {
+    return intervalMs_;
+}
+
+uint32_t UploadScheduler::getFailureStreak() const {
+    return failures_;
+}
+
+bool UploadScheduler::isHeld(uint32_t nowMs) const {
+    return held_ && !reached(nowMs, holdUntilMs_);
+}
+
+// ----------------------------------------------------------------------------
+// Private helpers
+// ----------------------------------------------------------------------------
+uint32_t UploadScheduler::random(uint32_t range) {
+    // xorshift32 (Marsaglia); plenty for spreading a fleet, not for cryptography.
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 17;
+    random_ ^= random_ << 5;
+    return range ? static_cast<uint32_t>((static_cast<uint64_t>(random_) * range) >> 32) : 0;
+}
+
+uint32_t UploadScheduler::jittered(uint32_t ms) {
+    uint64_t spread = static_cast<uint64_t>(ms) * config_.jitterPercent / 100;
+    return ms + random(static_cast<uint32_t>(spread > 0xFFFFFFFFu - ms ? 0xFFFFFFFFu - ms : spread));
+}
+
+void UploadScheduler::hold(uint32_t nowMs, uint32_t delayMs) {
+    held_ = true;
+    holdUntilMs_ = nowMs + delayMs;
+    // Whatever was due resumes when the hold ends.
+    nextUploadMs_ = holdUntilMs_;
+    nextPollMs_   = holdUntilMs_;
+}
@@ -0,0 +1,111 @@
+#ifndef UPLOAD_SCHEDULER_H
+#define UPLOAD_SCHEDULER_H
+
+#include <cstdint>
+#include "thingspeak_config.h"
+
+/*
+   Upload pacing settings. The defaults (ThingSpeak) come from thingspeak_config.h; other
+   sinks set their own (see ITelemetrySink::getScheduleConfig()).
+*/
+struct UploadSchedulerConfig {
+    uint32_t minIntervalMs = UPLOAD_MIN_INTERVAL_MS;   // Shortest time between uploads.
+    uint32_t jitterPercent = UPLOAD_JITTER_PERCENT;    // Random lengthening of each interval.
+    uint32_t phaseWindowMs = UPLOAD_PHASE_WINDOW_MS;   // Random delay of the first contact.
+    uint32_t commandPollMs = UPLOAD_COMMAND_POLL_MS;   // Command poll period while idle (0 = none).
+    uint32_t baseBackoffMs = UPLOAD_BASE_BACKOFF_MS;   // Backoff after the first failure.
+    uint32_t maxBackoffMs  = UPLOAD_MAX_BACKOFF_MS;    // Longest backoff / upload interval.
+};
+
+// Result of a request, as reported to the scheduler.
+enum class UploadOutcome : uint8_t {
+    Success,        // 2xx answer.
+    Failed,         // No answer (DNS, TLS, timeout) or an error status.
+    RateLimited     // HTTP 429, or 503 with Retry-After.
+};
+
+// What the pipeline should do with a sink now.
+enum class UploadAction : uint8_t {
+    Wait,
+    Upload,         // Upload the queued samples.
+    PollCommands    // Nothing to upload; fetch pending commands (e.g. TalkBack).
+};
+
+/*
+   UploadScheduler Module Header
+
+   This module decides when a telemetry sink contacts its server. Many units running the
+   same firmware and powered up together would otherwise upload at the same moments for
+   as long as they run, and all retry at once after a server outage. The scheduler
+   spreads that load:
+     - Randomized phase: the first contact after boot waits a random offset within
+       phaseWindowMs, so devices started together do not meet at the server.
+     - Jittered period: every interval is minIntervalMs (or the adapted interval, see
+       below) lengthened by a random 0..jitterPercent, so the phases keep drifting apart
+       instead of settling into lockstep.
+     - Rate-limit awareness: a 429 (or 503 with Retry-After) holds all requests for at
+       least the Retry-After time plus a random share of it, and doubles the upload
+       interval (up to maxBackoffMs). Each successful request afterwards shrinks the
+       interval by a quarter of its excess over minIntervalMs, so the device settles at a
+       rate the server accepts (additive decrease after a multiplicative increase).
+     - Adaptive backoff: consecutive failures hold all requests for baseBackoffMs,
+       doubled with every further failure up to maxBackoffMs, of which a random half is
+       applied ("equal jitter"), so recovering servers are not hit by a synchronized
+       wave of retries.
+   A sink queue at its high-water mark is uploaded before the regular interval
+   ends, but never during a backoff or Retry-After hold.
+
+   The module only does arithmetic on the millisecond times passed in and has its own
+   pseudo-random generator (xorshift32, seeded by the caller), so it does not depend on
+   FreeRTOS or the Pico SDK and its behaviour for a whole fleet can be simulated on a
+   host. Times are compared with wrap-around arithmetic. Every sink of the
+   TelemetryPipeline has a scheduler of its own, used by the pipeline task only, so it
+   needs no locking.
+*/
+class UploadScheduler {
+public:
+    // 'seed' should differ between devices (e.g. from the hardware random generator).
+    UploadScheduler(uint32_t seed, uint32_t nowMs,
+                    const UploadSchedulerConfig& config = UploadSchedulerConfig());
+
+    // Returns what to do at 'nowMs', given whether samples are waiting ('pending') and
+    // whether the queue is at its high-water mark.
+    UploadAction next(uint32_t nowMs, bool pending, bool highWater) const;
+
+    // Milliseconds until next() may return something other than Wait (0 if already,
+    // UINT32_MAX if nothing is pending and the sink does not poll).
+    uint32_t getDelayMs(uint32_t nowMs, bool pending) const;
+
+    // Records the outcome of the request started for the last action.
+    void report(uint32_t nowMs, UploadOutcome outcome, uint32_t retryAfterS = 0);
+
+    // Classifies a request result from its success flag, HTTP status (0 if there was no
+    // answer) and Retry-After value in seconds.
+    static UploadOutcome classify(bool ok, int statusCode, uint32_t retryAfterS);
+
+    uint32_t getIntervalMs() const;      // Current (adapted) upload interval without jitter.
+    uint32_t getFailureStreak() const;   // Consecutive failed requests.
+    bool isHeld(uint32_t nowMs) const;   // A backoff or Retry-After hold is in effect.
+
+private:
+    UploadSchedulerConfig config_;
+    uint32_t random_;                    // xorshift32 state, never 0.
+
+    uint32_t intervalMs_;                // Upload interval, raised by rate limiting.
+    uint32_t nextUploadMs_;              // Earliest regular upload.
+    uint32_t nextPollMs_;                // Next command poll while idle.
+    uint32_t holdUntilMs_;               // No request before this (when held_).
+    bool held_;
+    uint32_t failures_;
+
+    // Uniformly distributed value in 0..range-1 (0 if range is 0).
+    uint32_t random(uint32_t range);
+
+    // 'ms' lengthened by a random 0..jitterPercent.
+    uint32_t jittered(uint32_t ms);
+
+    // Holds all requests until nowMs + delayMs.
+    void hold(uint32_t nowMs, uint32_t delayMs);
+};
+
+#endif // UPLOAD_SCHEDULER_H
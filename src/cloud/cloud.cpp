@@ -1,53 +1,84 @@
 #include "cloud.h"
 #include <cstdio>
 #include <cstring>
-#include <string>
-#include <cstdlib>      // for std::strtof
+#include <utility>
 
 #include "pico/stdlib.h"
-#include "pico/cyw43_arch.h"
-#include "lwip/pbuf.h"
-#include "lwip/altcp_tcp.h"
 #include "lwip/altcp_tls.h"
-#include "lwip/dns.h"
 #include "FreeRTOS.h"
 #include "task.h"
 
+#include "TlsProfile.h"
+#include "WallClock.h"
+#include "metrics/Metrics.h"
 #include "thingspeak_config.h"   // Defines THINGSPEAK_WRITE_API_KEY and THINGSPEAK_TALKBACK_API_KEY
 
+#ifndef THINGSPEAK_CHANNEL_ID
+#error "THINGSPEAK_CHANNEL_ID must be set to the channel of THINGSPEAK_WRITE_API_KEY (thingspeak_config.h)"
+#endif
+
 // =============================================================================
 //                           Cloud Module Implementation
 // =============================================================================
 
 /*
-   The Cloud module establishes a secure TLS connection to a remote server (ThingSpeak)
+   The Cloud module keeps a secure TLS connection to a remote server (ThingSpeak) open
    to transmit sensor data and receive remote commands. It uses the LWIP altcp_tls APIs
-   integrated with the FreeRTOS scheduling system.
-   
-   This module retrieves sensor data via the Controller instance, constructs an HTTP POST
-   request, and dispatches it securely. It then parses the HTTP response for any commands
-   (e.g., a new CO₂ setpoint) to update the system.
+   (wrapped by HttpsSession) integrated with the FreeRTOS scheduling system.
+
+   The TelemetryPipeline puts the telemetry records into the queue of this sink
+   (report-by-exception) and hands them to send() in batches. Each batch is uploaded with
+   one bulk update request; afterwards the next TalkBack command is fetched over the same
+   connection. Commands (e.g., a new CO₂ setpoint) are queued for the controller task, and
+   their acknowledgements travel back in the status field of a later upload.
 */
 
+static MetricId requestsOkMetric = -1;
+static MetricId requestsFailedMetric = -1;
+static MetricId requestsLimitedMetric = -1;
+
+static const MetricDescriptor requestsDescriptor = {
+    "greenhouse_cloud_requests_total", "ThingSpeak requests by outcome.", MetricType::Counter };
+
 // ----------------------------------------------------------------------------
 // Constructor
 // ----------------------------------------------------------------------------
-Cloud::Cloud(Controller* controller)
+Cloud::Cloud(Controller* controller, std::shared_ptr<CommandQueue> commands,
+             std::shared_ptr<DnsCache> dnsCache)
         : controller_(controller)   // Save pointer to the Controller for sensor data access
+        , commands_(std::move(commands)) // Queue that executes TalkBack commands
+        , dnsCache_(std::move(dnsCache)) // Cache of resolved server addresses
         , tls_config_(nullptr)        // TLS config will be created below
+        , lastStatusCode_(0)
+        , lastRetryAfter_(0)
+        , lastUploadedMs_(0)
 {
-    // Initialize the TLS configuration for the client. Optionally, a CA certificate
-    // can be used if available. Here, we pass a null pointer to use a minimal config.
-    tls_config_ = altcp_tls_create_config_client(nullptr, 0);
+    // Initialize the TLS configuration for the client. The server is authenticated
+    // against the trust anchor from thingspeak_config.h if one is configured.
+#ifdef THINGSPEAK_CA_DER
+    static const uint8_t trustAnchor[] = THINGSPEAK_CA_DER;
+    tls_config_ = createTlsClientConfig("ThingSpeak", trustAnchor, sizeof(trustAnchor));
+#else
+    tls_config_ = createTlsClientConfig("ThingSpeak", nullptr, 0);
+#endif
     if (!tls_config_) {
-        printf("Failed to create altcp_tls_config in Cloud constructor!\n");
+        return;
     }
+
+    requestsOkMetric      = g_metrics.add(requestsDescriptor, "outcome=\"success\"");
+    requestsFailedMetric  = g_metrics.add(requestsDescriptor, "outcome=\"failed\"");
+    requestsLimitedMetric = g_metrics.add(requestsDescriptor, "outcome=\"rate_limited\"");
+
+    // The session keeps one connection to the server open between updates.
+    session_ = std::make_unique<HttpsSession>(THINGSPEAK_HOST, THINGSPEAK_PORT, tls_config_, dnsCache_.get());
 }
 
 // ----------------------------------------------------------------------------
 // Destructor
 // ----------------------------------------------------------------------------
 Cloud::~Cloud() {
+    // Close the connection before the configuration it uses is freed.
+    session_.reset();
     if (tls_config_) {
         // Free the TLS configuration, which in turn frees the underlying mbedTLS structure.
         altcp_tls_free_config(tls_config_);
@@ -56,373 +87,293 @@ Cloud::~Cloud() {
 }
 
 // ----------------------------------------------------------------------------
-// Public method: updateSensorData()
-// ----------------------------------------------------------------------------- 
-/*
-    This function handles transmitting sensor data to ThingSpeak by:
-    1. Retrieving current sensor values from the Controller.
-    2. Constructing the HTTP POST body with sensor fields and geolocation data.
-    3. Building a full HTTP POST request.
-    4. Sending the request over a TLS-secured connection.
-    5. Parsing the response from the server for any new setpoint command.
-*/
-bool Cloud::updateSensorData() {
-    // If TLS configuration is not available, log an error and return failure.
-    if (!tls_config_) {
-        printf("[Cloud] No TLS config available. Cannot update.\n");
-        return false;
-    }
+// ITelemetrySink: name, pacing and batch size
+// ----------------------------------------------------------------------------
+const char* Cloud::getName() const {
+    return "thingspeak";
+}
 
-    // Retrieve sensor data from the controller.
-    float field1 = controller_->getCurrentCO2();
-    float field2 = controller_->getCurrentRH();
-    float field3 = controller_->getCurrentTemp();
-    float field4 = controller_->getCurrentFanSpeed();
-    float field5 = controller_->getCO2Setpoint();
-
-    // Build the POST body with sensor data and additional static parameters.
-    // The body uses URL-encoded parameters and includes API keys, sensor fields,
-    // latitude/longitude data, and a status message.
-    char body[512];
-    snprintf(body, sizeof(body),
-             "api_key=%s"
-             "&talkback_key=%s"
-             "&field1=%.2f"
-             "&field2=%.2f"
-             "&field3=%.2f"
-             "&field4=%.2f"
-             "&field5=%.2f"
-             "&lat=60.1699"
-             "&long=24.9384"
-             "&status=Update%%20from%%20Helsinki",
-             THINGSPEAK_WRITE_API_KEY,
-             THINGSPEAK_TALKBACK_API_KEY,
-             field1, field2, field3, field4, field5);
-
-    // Define server information.
-    const char* serverName = "api.thingspeak.com";
-    int contentLength = (int)strlen(body);
-
-    // Create the complete HTTP POST request including headers.
-    char requestBuffer[1024];
-    snprintf(requestBuffer, sizeof(requestBuffer),
-             "POST /update.json HTTP/1.1\r\n"
-             "Host: %s\r\n"
-             "Content-Type: application/x-www-form-urlencoded\r\n"
-             "Connection: close\r\n"
-             "Content-Length: %d\r\n"
-             "\r\n"
-             "%s",
-             serverName, contentLength, body);
+UploadSchedulerConfig Cloud::getScheduleConfig() const {
+    return UploadSchedulerConfig();
+}
 
-    // Perform the TLS request using our helper function.
-    // The timeout parameter is set to 15 seconds.
-    std::string response = performTLSRequest(serverName, requestBuffer, 15 /* timeout in seconds */);
-    printf("ThingSpeak response:\n%s\n", response.c_str());
+size_t Cloud::getMaxBatch() const {
+    return MAX_BATCH;
+}
 
-    if (!response.empty()) {
-        printf("[Cloud] ThingSpeak update (and command execution) successful.\n");
-        // Parse the HTTP response to check for any new setpoint commands.
-        parseAndPrintSetpoint(response);
-        return true;
-    } else {
-        printf("[Cloud] ThingSpeak update failed.\n");
+// ----------------------------------------------------------------------------
+// Public method: poll()
+// ----------------------------------------------------------------------------
+/*
+    Fetches the next TalkBack command without uploading telemetry. Used while no samples
+    are pending so that remote commands still arrive when the readings are stable.
+*/
+bool Cloud::poll() {
+    if (!tls_config_) {
+        printf("[Cloud] No TLS config available. Cannot poll commands.\n");
         return false;
     }
+    return fetchTalkBackCommand();
 }
 
 // ----------------------------------------------------------------------------
-// Helper method: parseAndPrintSetpoint()
-// ----------------------------------------------------------------------------
+// Public method: send()
+// -----------------------------------------------------------------------------
 /*
-    This function scans the HTTP response for a token "SETPOINT=".
-    If found, it extracts the numeric value, validates it, and updates
-    the Controller's CO₂ setpoint accordingly.
+    This function uploads one batch of queued samples to ThingSpeak by:
+    1. Building a bulk-update JSON request for the batch.
+    2. Sending the request over the persistent TLS session.
+    3. Returning how many samples the server accepted; the pipeline removes them from
+       the queue and hands over the next batch.
+    If a request fails the samples stay queued for the next attempt.
 */
-void Cloud::parseAndPrintSetpoint(const std::string& response) {
-    const std::string token = "SETPOINT=";
-    size_t pos = response.find(token);
-    if (pos == std::string::npos) {
-        // Token not found; no command to adjust the setpoint.
-        printf("[Cloud] No SETPOINT command found.\n");
-        return;
+size_t Cloud::send(const TelemetryRecord* records, size_t count) {
+    // If TLS configuration is not available, log an error and return failure.
+    if (!tls_config_) {
+        printf("[Cloud] No TLS config available. Cannot update.\n");
+        return 0;
     }
-    // Short delay, which may be necessary due to asynchronous FreeRTOS timing.
-    vTaskDelay(100);
-    size_t start = pos + token.size();
-    size_t end   = response.find_first_of("\" \r\n", start);
-    if (end == std::string::npos) {
-        end = response.size();
+    if (count == 0) {
+        return 0;
     }
 
-    // Extract the portion corresponding to the new setpoint value.
-    std::string setpointValue = response.substr(start, end - start);
-    printf("[Cloud] TalkBack command found: SETPOINT=%s\n", setpointValue.c_str());
-
-    // Convert extracted string to a float.
-    float newSetpoint = std::strtof(setpointValue.c_str(), nullptr);
-    // Validate the setpoint value; must be in a safe range.
-    if (newSetpoint <= 0.0f or newSetpoint > 1500.0f) {
-        printf("[Cloud] Warning: invalid setpoint value received (%s), ignoring.\n", setpointValue.c_str());
-        return;
+    size_t uploaded = postBulkUpdate(records, count);
+    if (uploaded) {
+        printf("[Cloud] ThingSpeak update successful (%u samples).\n", (unsigned)uploaded);
+    } else {
+        printf("[Cloud] ThingSpeak update failed.\n");
     }
+    return uploaded;
+}
 
-    // Update the controller's CO₂ setpoint with the new valid value.
-    controller_->setCO2Setpoint(newSetpoint);
-    printf("[Cloud] Controller setpoint updated to %.2f\n", newSetpoint);
+void Cloud::finishUpload() {
+    // Bulk updates do not execute TalkBack commands, so fetch the next one separately
+    // over the same connection.
+    fetchTalkBackCommand();
 }
 
 // ----------------------------------------------------------------------------
-// Private helper: performTLSRequest()
+// Private helper: postBulkUpdate()
 // ----------------------------------------------------------------------------
 /*
-    This function performs a complete TLS request cycle:
-      1. Create a TLS client state.
-      2. Initiate the connection and TLS handshake.
-      3. Send the HTTP request.
-      4. Wait until the connection is complete or an error occurs.
-      5. Return the full HTTP response as a std::string.
+    Sends a batch of samples in one ThingSpeak bulk_update JSON request. Once the wall
+    clock is synchronized each entry carries its UTC recording time ("created_at");
+    before that it carries "delta_t", the number of seconds since the previous entry, so
+    that at least the spacing of the samples is preserved. Pending command acks go into
+    the "status" of the first entry. Entries that do not fit into the request body are
+    left for the next request.
 */
-std::string Cloud::performTLSRequest(const char *server, const char *request, int timeout) {
-    // Allocate memory for the TLS client state structure.
-    TLS_CLIENT_T *state = (TLS_CLIENT_T*)calloc(1, sizeof(TLS_CLIENT_T));
-    if (!state) {
-        printf("[Cloud] Failed to allocate TLS_CLIENT_T.\n");
-        return std::string();
-    }
-    // Initialize state members.
-    state->pcb          = nullptr;
-    state->complete     = false;
-    state->error        = 0;
-    state->http_request = request;
-    state->timeout      = timeout;
-    state->cloudInstance = this; // Store pointer to Cloud instance for callbacks.
-
-    // Initiate the TLS connection. This will handle DNS resolution and TLS handshake.
-    if (!tlsClientOpen(server, state)) {
-        free(state);
-        return std::string();
+size_t Cloud::postBulkUpdate(const TelemetryRecord* records, size_t count) {
+    static constexpr size_t CLOSING_SIZE = 3;       // "]}" and the terminating zero.
+    int len = snprintf(body_, sizeof(body_),
+                       "{\"write_api_key\":\"%s\",\"updates\":[", THINGSPEAK_WRITE_API_KEY);
+
+    char acks[160];
+    char statusField[180] = "";
+    uint32_t ackSeq = 0;
+    size_t ackCount = formatAckStatus(acks, sizeof(acks), false, ackSeq);
+    if (ackCount) {
+        snprintf(statusField, sizeof(statusField), ",\"status\":\"%s\"", acks);
     }
 
-    // Wait until the TLS request is complete or an error occurs.
-    while(!state->complete) {
-#if PICO_CYW43_ARCH_POLL
-        // If using the Pico's cyw43 architecture polling mode.
-        cyw43_arch_poll();
-        cyw43_arch_wait_for_work_until(make_timeout_time_ms(1000));
-#else
-        // Use FreeRTOS delay if polling is not enabled.
-        vTaskDelay(pdMS_TO_TICKS(1000));
-#endif
-    }
+    size_t included = 0;
+    for (size_t i = 0; i < count; i++) {
+        const TelemetryRecord& r = records[i];
+        char timeField[48];
+        uint64_t utcMs = recordUtcMs(r);
+        if (utcMs) {
+            char iso[24];
+            WallClock::formatIso8601(utcMs, iso, sizeof(iso));
+            snprintf(timeField, sizeof(timeField), "\"created_at\":\"%s\"", iso);
+        } else {
+            uint32_t deltaMs = r.timestampMs - (i == 0 ? lastUploadedMs_ : records[i - 1].timestampMs);
+            if (i == 0 && lastUploadedMs_ == 0) deltaMs = 0;
+            snprintf(timeField, sizeof(timeField), "\"delta_t\":%lu", (unsigned long)(deltaMs / 1000));
+        }
 
-    std::string ret = state->response; // Capture the response.
-    int err = state->error;
-    free(state);  // Free the allocated state.
+        size_t room = sizeof(body_) - CLOSING_SIZE - len;
+        int n = snprintf(body_ + len, room,
+                         "%s{%s,\"field1\":%.2f,\"field2\":%.2f,\"field3\":%.2f,"
+                         "\"field4\":%.2f,\"field5\":%.2f,\"field6\":%u%s}",
+                         i ? "," : "", timeField,
+                         r.co2, r.rh, r.temp, r.fanSpeed, r.setpoint, (unsigned)r.flags,
+                         i ? "" : statusField);
+        if (n < 0 || (size_t)n >= room) break;
+        len += n;
+        included++;
+    }
+    if (included == 0) {
+        printf("[Cloud] Bulk update body too large.\n");
+        return 0;
+    }
+    len += snprintf(body_ + len, sizeof(body_) - len, "]}");
 
-    if (err == 0) {
-        return ret;
-    } else {
-        return std::string();
+    char path[64];
+    snprintf(path, sizeof(path), "/channels/%s/bulk_update.json", THINGSPEAK_CHANNEL_ID);
+    if (!postRequest(path, "application/json")) {
+        return 0;
+    }
+    lastUploadedMs_ = records[included - 1].timestampMs;
+    if (ackCount) {
+        commands_->popAcks(ackSeq, ackCount);
     }
+    return included;
 }
 
-// =============================================================================
-//                       TLS CLIENT CALLBACKS (STATIC)
-// =============================================================================
-
+// ----------------------------------------------------------------------------
+// Private helper: fetchTalkBackCommand()
+// ----------------------------------------------------------------------------
 /*
-   The following static functions serve as callback handlers for TLS events
-   on the LWIP stack. They manage connection establishment, data transmission,
-   reception, errors, and connection closure.
+    Executes (fetches and removes) the next command in the TalkBack queue and queues it.
 */
+bool Cloud::fetchTalkBackCommand() {
+    snprintf(body_, sizeof(body_), "api_key=%s", THINGSPEAK_TALKBACK_API_KEY);
 
-// ----------------------------------------------------------------------------
-// tlsClientClose: Closes the TLS connection gracefully.
-// ----------------------------------------------------------------------------
-err_t Cloud::tlsClientClose(TLS_CLIENT_T *state) {
-    if (!state) return ERR_OK;
-
-    state->complete = true;
-    err_t err = ERR_OK;
-
-    if (state->pcb != NULL) {
-        altcp_arg(state->pcb, NULL);
-        altcp_poll(state->pcb, NULL, 0);
-        altcp_recv(state->pcb, NULL);
-        altcp_err(state->pcb, NULL);
-        err = altcp_close(state->pcb);
-        if (err != ERR_OK) {
-            printf("[Cloud] altcp_close failed %d, calling abort.\n", err);
-            altcp_abort(state->pcb);
-            err = ERR_ABRT;
-        }
-        state->pcb = NULL;
+    char path[64];
+    snprintf(path, sizeof(path), "/talkbacks/%d/commands/execute.json", TalkBackID);
+    if (!postRequest(path, "application/x-www-form-urlencoded")) {
+        return false;
     }
-    return err;
+    submitCommands(response_);
+    return true;
 }
 
 // ----------------------------------------------------------------------------
-// tlsClientConnected: Callback when TLS connection is successfully established.
+// Private helper: postRequest()
 // ----------------------------------------------------------------------------
-err_t Cloud::tlsClientConnected(void *arg, struct altcp_pcb *pcb, err_t err) {
-    auto *state = (TLS_CLIENT_T*)arg;
-    if (!state) return ERR_OK;
-
-    if (err != ERR_OK) {
-        printf("[Cloud] connect failed %d\n", err);
-        tlsClientClose(state);
-        return ERR_OK;
+/*
+    Wraps the body prepared in body_ into an HTTP/1.1 POST request with keep-alive and
+    sends it over the persistent session. The response is parsed into response_.
+    Returns false on failure or a non-2xx status.
+*/
+bool Cloud::postRequest(const char* path, const char* contentType) {
+    int len = snprintf(request_, sizeof(request_),
+                       "POST %s HTTP/1.1\r\n"
+                       "Host: %s\r\n"
+                       "Content-Type: %s\r\n"
+                       "Connection: keep-alive\r\n"
+                       "Content-Length: %d\r\n"
+                       "\r\n"
+                       "%s",
+                       path, THINGSPEAK_HOST, contentType, (int)strlen(body_), body_);
+    if (len >= (int)sizeof(request_)) {
+        printf("[Cloud] Request too large for buffer.\n");
+        return false;
     }
 
-    printf("[Cloud] Connected to server, sending request.\n");
-    // Write the HTTP request over the established TLS connection.
-    err_t werr = altcp_write(state->pcb, state->http_request, (u16_t)strlen(state->http_request), TCP_WRITE_FLAG_COPY);
-    if (werr != ERR_OK) {
-        printf("[Cloud] Error writing data, err=%d\n", werr);
-        tlsClientClose(state);
-        return werr;
+    // Perform the TLS request using our helper function.
+    // The timeout parameter is set to 15 seconds.
+    lastStatusCode_ = 0;
+    lastRetryAfter_ = 0;
+    if (!performTLSRequest(request_, 15 /* timeout in seconds */)) {
+        g_metrics.inc(requestsFailedMetric);
+        return false;
     }
-    return ERR_OK;
+    lastStatusCode_ = response_.getStatusCode();
+    lastRetryAfter_ = response_.getRetryAfter();
+    printf("[Cloud] ThingSpeak response: HTTP %d, %lu body bytes, %u command(s)\n",
+           lastStatusCode_, (unsigned long)response_.getBodyLength(),
+           (unsigned)response_.getCommandCount());
+
+    // Only accept successful responses (2xx).
+    if (response_.isSuccess()) {
+        g_metrics.inc(requestsOkMetric);
+        return true;
+    }
+    if (lastStatusCode_ == 429 || (lastStatusCode_ == 503 && lastRetryAfter_ > 0)) {
+        printf("[Cloud] Server is rate limiting (HTTP %d, Retry-After %lu s).\n",
+               lastStatusCode_, (unsigned long)lastRetryAfter_);
+        g_metrics.inc(requestsLimitedMetric);
+    } else {
+        g_metrics.inc(requestsFailedMetric);
+    }
+    return false;
 }
 
 // ----------------------------------------------------------------------------
-// tlsClientPoll: Callback for polling the TLS connection (e.g., on timeout).
+// Public method: getHandshakeStats()
 // ----------------------------------------------------------------------------
-err_t Cloud::tlsClientPoll(void *arg, struct altcp_pcb *pcb) {
-    auto *state = (TLS_CLIENT_T*)arg;
-    if (!state) return ERR_OK;
-
-    printf("[Cloud] TLS connection timed out.\n");
-    state->error = PICO_ERROR_TIMEOUT;
-    return tlsClientClose(state);
+TlsHandshakeStats Cloud::getHandshakeStats() const {
+    return session_ ? session_->getHandshakeStats() : TlsHandshakeStats();
 }
 
-// ----------------------------------------------------------------------------
-// tlsClientErr: Callback for reporting errors on the TLS connection.
-// ----------------------------------------------------------------------------
-void Cloud::tlsClientErr(void *arg, err_t err) {
-    auto *state = (TLS_CLIENT_T*)arg;
-    if (!state) return;
+int Cloud::getLastStatusCode() const {
+    return lastStatusCode_;
+}
 
-    printf("[Cloud] tlsClientErr: %d\n", err);
-    state->error = PICO_ERROR_GENERIC;
-    tlsClientClose(state);
+uint32_t Cloud::getLastRetryAfter() const {
+    return lastRetryAfter_;
 }
 
 // ----------------------------------------------------------------------------
-// tlsClientRecv: Callback when data is received from the TLS connection.
+// Helper method: submitCommands()
 // ----------------------------------------------------------------------------
 /*
-   This function is invoked by the LWIP stack when data is received. It appends the
-   received data from the pbuf to the state's response string and acknowledges reception.
+    This function hands the command tokens that the response parser extracted from the
+    HTTP response body (e.g. "ID=17 SETPOINT=900" from TalkBack) to the command queue,
+    which validates them; the controller task executes them.
 */
-err_t Cloud::tlsClientRecv(void *arg, struct altcp_pcb *pcb, struct pbuf *p, err_t err) {
-    auto *state = (TLS_CLIENT_T*)arg;
-    if (!state) return ERR_OK;
-
-    if (!p) {
-        printf("[Cloud] Connection closed by remote.\n");
-        return tlsClientClose(state);
+void Cloud::submitCommands(const HttpResponseParser& response) {
+    size_t count = response.getCommandCount();
+    if (count == 0 || !commands_) {
+        // No tokens found; nothing to execute.
+        printf("[Cloud] No TalkBack command found.\n");
+        return;
     }
 
-    if (p->tot_len > 0) {
-        // Allocate a temporary buffer to copy the data.
-        char *buf = (char*)malloc(p->tot_len + 1);
-        if (buf) {
-            pbuf_copy_partial(p, buf, p->tot_len, 0);
-            buf[p->tot_len] = '\0';
-            // Append received data to the response.
-            state->response.append(buf, p->tot_len);
-            free(buf);
-        }
-        // Inform LWIP that the data has been received.
-        altcp_recved(pcb, p->tot_len);
+    CommandToken tokens[HttpResponseParser::MAX_COMMANDS];
+    for (size_t i = 0; i < count; i++) {
+        const HttpCommandToken& command = response.getCommand(i);
+        tokens[i] = CommandToken{command.name, command.value};
     }
-    // Free the received pbuf.
-    pbuf_free(p);
-    return ERR_OK;
+    size_t rejected = 0;
+    size_t queued = commands_->submit(tokens, count, CommandSource::TalkBack, &rejected);
+    printf("[Cloud] TalkBack: %u command(s) queued, %u rejected\n", (unsigned)queued, (unsigned)rejected);
 }
 
 // ----------------------------------------------------------------------------
-// tlsClientConnectToServerIp: Initiates connection to the server using its IP address.
+// Helper method: formatAckStatus()
 // ----------------------------------------------------------------------------
-void Cloud::tlsClientConnectToServerIp(const ip_addr_t *ipaddr, TLS_CLIENT_T *state) {
-    if (!state || !ipaddr) return;
-
-    err_t err;
-    u16_t port = 443;  // Default HTTPS port.
-    printf("[Cloud] Connecting to %s port %d\n", ipaddr_ntoa(ipaddr), port);
-    err = altcp_connect(state->pcb, ipaddr, port, tlsClientConnected);
-    if (err != ERR_OK) {
-        printf("[Cloud] Error in altcp_connect, err=%d\n", err);
-        tlsClientClose(state);
+/*
+    Acks look like "17=done,fan=out_of_range". In a URL-encoded body the '=' and ','
+    are percent-encoded; the other characters need no encoding.
+*/
+size_t Cloud::formatAckStatus(char* out, size_t size, bool urlEncode, uint32_t& firstSeq) const {
+    if (!commands_ || !commands_->hasAcks()) {
+        return 0;
     }
-}
-
-// ----------------------------------------------------------------------------
-// tlsClientDnsFound: DNS callback invoked when hostname is resolved.
-// ----------------------------------------------------------------------------
-void Cloud::tlsClientDnsFound(const char* hostname, const ip_addr_t *ipaddr, void *arg) {
-    auto *state = (TLS_CLIENT_T*)arg;
-    if (!state) return;
-
-    if (ipaddr) {
-        printf("[Cloud] DNS resolved for %s\n", hostname);
-        tlsClientConnectToServerIp(ipaddr, state);
-    } else {
-        printf("[Cloud] Error resolving hostname %s\n", hostname);
-        tlsClientClose(state);
+    CommandAck acks[ACKS_PER_UPLOAD];
+    size_t count = commands_->peekAcks(acks, ACKS_PER_UPLOAD, firstSeq);
+    char text[ACKS_PER_UPLOAD * 24 + 1];
+    CommandQueue::formatAcks(acks, count, text, sizeof(text));
+
+    size_t length = 0;
+    for (const char* c = text; *c; c++) {
+        const char* piece = !urlEncode ? nullptr : (*c == '=' ? "%3D" : (*c == ',' ? "%2C" : nullptr));
+        size_t n = piece ? 3 : 1;
+        if (length + n >= size) {
+            return 0;    // Does not fit; send no acks rather than a cut-off list.
+        }
+        if (piece) memcpy(out + length, piece, 3);
+        else out[length] = *c;
+        length += n;
     }
+    out[length] = '\0';
+    return count;
 }
 
 // ----------------------------------------------------------------------------
-// tlsClientOpen: Establishes a new TLS connection to the specified hostname.
+// Private helper: performTLSRequest()
 // ----------------------------------------------------------------------------
 /*
-   This function creates a new TLS client Protocol Control Block (PCB), sets up required
-   callbacks, and initiates DNS resolution and connection to the server.
+    This function performs a request over the persistent HTTPS session:
+      1. The session reuses the open TLS connection, or opens a new one
+         (DNS resolution and TLS handshake) if the previous one was closed.
+      2. Send the HTTP request.
+      3. Parse the response into response_ as it arrives, until it is complete or an
+         error occurs.
+      4. Return true if a complete response was received.
 */
-bool Cloud::tlsClientOpen(const char *hostname, TLS_CLIENT_T *state) {
-    // Ensure we have valid state and a valid TLS configuration.
-    if (!state || !state->cloudInstance || !state->cloudInstance->tls_config_) {
-        printf("[Cloud] tlsClientOpen: invalid state or config\n");
-        return false;
-    }
-    // Retrieve TLS config from the Cloud instance.
-    struct altcp_tls_config* cfg = state->cloudInstance->tls_config_;
-    // Create a new TLS PCB using the provided configuration.
-    state->pcb = altcp_tls_new(cfg, IPADDR_TYPE_ANY);
-    if (!state->pcb) {
-        printf("[Cloud] Failed to create TLS PCB\n");
-        return false;
-    }
-
-    // Set the argument for callbacks to use our TLS client state.
-    altcp_arg(state->pcb, state);
-    // Set polling callback with an interval based on the timeout.
-    altcp_poll(state->pcb, tlsClientPoll, (u8_t)(state->timeout * 2));
-    // Set receive callback to handle incoming data.
-    altcp_recv(state->pcb, tlsClientRecv);
-    // Set error callback to handle connection errors.
-    altcp_err(state->pcb, tlsClientErr);
-
-    // Set Server Name Indication (SNI) for secure TLS handshake.
-    mbedtls_ssl_set_hostname((mbedtls_ssl_context *)altcp_tls_context(state->pcb), hostname);
-
-    // Begin DNS resolution. If result is cached, connect immediately.
-    printf("[Cloud] Resolving hostname: %s\n", hostname);
-    ip_addr_t server_ip;
-    cyw43_arch_lwip_begin();
-    err_t err = dns_gethostbyname(hostname, &server_ip, tlsClientDnsFound, state);
-    if (err == ERR_OK) {
-        // Host IP found in DNS cache.
-        tlsClientConnectToServerIp(&server_ip, state);
-    } else if (err != ERR_INPROGRESS) {
-        printf("[Cloud] dns_gethostbyname failed, err=%d\n", err);
-        tlsClientClose(state);
-    }
-    cyw43_arch_lwip_end();
-
-    return (err == ERR_OK || err == ERR_INPROGRESS);
-}
\ No newline at end of file
+bool Cloud::performTLSRequest(const char *request, int timeout) {
+    return session_ && session_->request(request, response_, timeout);
+}
@@ -1,113 +1,158 @@
 #ifndef CLOUD_H
 #define CLOUD_H
 
-#include <string>
 #include <memory>
 #include "pico/stdlib.h"
 #include "lwip/altcp_tcp.h"
 #include "lwip/altcp_tls.h"
 #include "Controller/Controller.h"
+#include "HttpsSession.h"
+#include "HttpResponseParser.h"
+#include "ITelemetrySink.h"
+#include "DnsCache.h"
+#include "commands/CommandQueue.h"
+#include "thingspeak_config.h"
 
 /*
    Cloud Module Header
 
    This module handles secure TLS communications with a remote server (e.g., ThingSpeak)
    for both uploading sensor data and receiving remote commands. It leverages LWIP’s
-   altcp_tls APIs to perform a TLS handshake over a TCP connection and integrates with
-   FreeRTOS for real-time operation.
+   altcp_tls APIs (through HttpsSession) to keep a TLS connection open between updates
+   and integrates with FreeRTOS for real-time operation.
 
    Key responsibilities include:
-     - Retrieving sensor data from the Controller instance.
-     - Building an HTTP POST request with sensor and location data.
+     - Acting as the ThingSpeak sink of the TelemetryPipeline, which hands it batches of
+       the queued telemetry records and removes them once they were accepted
+       (store-and-forward: samples survive failed uploads and offline periods).
+     - Building an HTTP POST request with a batch of queued samples.
      - Transmitting the request over a TLS-secured channel.
-     - Receiving and parsing the HTTP response for any remote commands (e.g., new CO₂ setpoint).
+     - Receiving and parsing the HTTP response for any remote commands (e.g., new CO₂ setpoint)
+       and handing them to the CommandQueue; polling TalkBack while nothing is uploaded.
+     - Carrying the acknowledgements of executed commands in the ThingSpeak "status" field
+       of the next upload.
+     - Reporting the HTTP status and Retry-After of each request, so that the pipeline can
+       back off when ThingSpeak is rate limiting.
 */
-class Cloud {
+class Cloud : public ITelemetrySink {
 public:
     // ------------------------------------------------------------------------
     // Constructor / Destructor
     // ------------------------------------------------------------------------
-    // The constructor receives a pointer to the Controller for accessing sensor data.
-    explicit Cloud(Controller* controller);
+    // The constructor receives a pointer to the Controller for accessing sensor data,
+    // the command queue that receives TalkBack commands and the DNS cache used to resolve
+    // the server.
+    Cloud(Controller* controller, std::shared_ptr<CommandQueue> commands,
+          std::shared_ptr<DnsCache> dnsCache = nullptr);
 
-    // Destructor frees TLS configuration resources.
-    ~Cloud();
+    // Destructor closes the session and frees TLS configuration resources.
+    ~Cloud() override;
 
     // ------------------------------------------------------------------------
-    // Public method to update sensor data (and process TalkBack commands)
+    // ITelemetrySink
     // ------------------------------------------------------------------------
+    const char* getName() const override;
+
+    // ThingSpeak pacing from thingspeak_config.h (UPLOAD_*).
+    UploadSchedulerConfig getScheduleConfig() const override;
+
+    // MAX_BATCH (one bulk update).
+    size_t getMaxBatch() const override;
+
     // This method:
-    //   - Retrieves current sensor values from the controller.
-    //   - Builds an HTTP POST request (including sensor data, API keys, and location).
+    //   - Builds a ThingSpeak bulk_update JSON request for the batch.
     //   - Sends the data to the ThingSpeak server over a TLS connection.
-    //   - Parses the response to check for a new setpoint command.
-    // Returns true if successful, otherwise false.
-    bool updateSensorData();
+    // Returns the number of samples the server accepted, 0 on failure.
+    size_t send(const TelemetryRecord* records, size_t count) override;
+
+    // Bulk updates do not execute TalkBack commands, so the next one is fetched once
+    // the queue has been uploaded.
+    void finishUpload() override;
+
+    // Fetches the next TalkBack command without uploading telemetry (used while no
+    // samples are pending). Returns true if the request succeeded.
+    bool poll() override;
+
+    // HTTP status of the last request, 0 if no complete response was received.
+    int getLastStatusCode() const override;
+
+    // Retry-After of the last response in seconds, 0 if absent.
+    uint32_t getLastRetryAfter() const override;
+
+    // ------------------------------------------------------------------------
+    // Diagnostics
+    // ------------------------------------------------------------------------
+    // Returns TLS handshake timings (full vs. resumed) of the ThingSpeak session.
+    TlsHandshakeStats getHandshakeStats() const;
 
 private:
     Controller* controller_; // Pointer to central Controller for sensor data and setpoint updates.
+    std::shared_ptr<CommandQueue> commands_; // Receives TalkBack commands, supplies their acks.
+    std::shared_ptr<DnsCache> dnsCache_;    // Resolver cache for the server host name.
 
     // Global TLS configuration used for all TLS connections created by this class.
     struct altcp_tls_config* tls_config_;
 
+    // Persistent HTTPS connection to the ThingSpeak server. Kept open between updates
+    // (HTTP/1.1 keep-alive) so that the TLS handshake is not repeated every minute.
+    std::unique_ptr<HttpsSession> session_;
+
     // ------------------------------------------------------------------------
     // Helper to perform a complete TLS request
     // ------------------------------------------------------------------------
     // This method handles:
-    //   - Initiating the TLS connection (including DNS resolution and handshake).
-    //   - Sending the provided HTTP request.
-    //   - Waiting for a complete response.
-    // Returns the HTTP response as a std::string.
-    std::string performTLSRequest(const char *server, const char *request, int timeout);
+    //   - Sending the provided HTTP request over the persistent session
+    //     (the session connects or reconnects as needed).
+    //   - Waiting for a complete response, which is parsed into response_.
+    // Returns true if a complete response was received.
+    bool performTLSRequest(const char *request, int timeout);
 
-    // ------------------------------------------------------------------------
-    // Internals for TLS connection state and callback functions
-    // ------------------------------------------------------------------------
-    // TLS_CLIENT_T holds the state of an ongoing TLS request.
-    struct TLS_CLIENT_T {
-        struct altcp_pcb *pcb;       // Protocol Control Block for the TLS connection.
-        bool complete;               // Flag indicating completion of the request.
-        int error;                   // Error code (if any) from the TLS operations.
-        const char *http_request;    // Pointer to the HTTP request string to be sent.
-        int timeout;                 // Timeout for the request in seconds.
-        std::string response;        // Buffer to accumulate the HTTP response.
-        Cloud *cloudInstance;        // Back-reference to the Cloud instance, if needed in callbacks.
-    };
+    // Parser holding the status and command tokens of the last response.
+    HttpResponseParser response_;
+
+    // Status and Retry-After of the last request (the parser keeps stale values when a
+    // request fails before the response arrives).
+    int lastStatusCode_;
+    uint32_t lastRetryAfter_;
 
     // ------------------------------------------------------------------------
-    // Static TLS callbacks used by LWIP's altcp_tls APIs.
-    // These functions manage connection closure, data sending, receiving, polling, and error handling.
+    // Request builders
     // ------------------------------------------------------------------------
-    // Closes the TLS connection gracefully.
-    static err_t tlsClientClose(TLS_CLIENT_T *state);
-    
-    // Called when a connection is successfully established; sends the HTTP request.
-    static err_t tlsClientConnected(void *arg, struct altcp_pcb *pcb, err_t err);
-    
-    // Poll callback triggered periodically for timeouts.
-    static err_t tlsClientPoll(void *arg, struct altcp_pcb *pcb);
-    
-    // Error callback invoked by LWIP on a connection error.
-    static void tlsClientErr(void *arg, err_t err);
-    
-    // Receive callback that accumulates incoming data and appends it to the response.
-    static err_t tlsClientRecv(void *arg, struct altcp_pcb *pcb, struct pbuf *p, err_t err);
-    
-    // Attempts to connect to the server using its resolved IP address.
-    static void tlsClientConnectToServerIp(const ip_addr_t *ipaddr, TLS_CLIENT_T *state);
-    
-    // DNS resolution callback; called when hostname resolution is complete.
-    static void tlsClientDnsFound(const char* hostname, const ip_addr_t *ipaddr, void *arg);
-    
-    // Initiates a new TLS connection; creates the PCB and sets up callbacks.
-    static bool tlsClientOpen(const char *hostname, TLS_CLIENT_T *state);
+    // Maximum number of samples sent in one bulk update request.
+    static constexpr size_t MAX_BATCH = 16;
+
+    // Buffers for the request body and the complete request (headers + body).
+    char body_[2048];
+    char request_[2304];
+
+    // Timestamp of the last sample accepted by the server (for bulk delta_t values).
+    uint32_t lastUploadedMs_;
+
+    // Command acknowledgements sent with one upload (all of them fit into the status field).
+    static constexpr size_t ACKS_PER_UPLOAD = 6;
+
+    // Formats the oldest pending acks for the status field ('=' and ',' percent-encoded if
+    // 'urlEncode'). Returns the number of acks included; pass it to popAcks() with
+    // 'firstSeq' once the upload succeeded.
+    size_t formatAckStatus(char* out, size_t size, bool urlEncode, uint32_t& firstSeq) const;
+
+    // Sends the body in body_ as a POST request to 'path'. Returns true if the server
+    // answered with a 2xx status; the response is then available in response_.
+    bool postRequest(const char* path, const char* contentType);
+
+    // Uploads a batch of samples with /channels/<id>/bulk_update.json. Returns the number
+    // of samples uploaded (as many as fit into the request body), or 0 on failure.
+    size_t postBulkUpdate(const TelemetryRecord* records, size_t count);
+
+    // Executes the next TalkBack command and queues it.
+    bool fetchTalkBackCommand();
 
     // ------------------------------------------------------------------------
-    // Helper to parse remote command from the HTTP response.
+    // Helper to hand remote commands from the HTTP response to the command queue.
     // ------------------------------------------------------------------------
-    // This function extracts the "SETPOINT=" command from the response (if present)
-    // and updates the controller's CO₂ setpoint accordingly.
-    void parseAndPrintSetpoint(const std::string& response);
+    // This function submits the command tokens of the parsed response (if any); they are
+    // validated there and executed by the controller task.
+    void submitCommands(const HttpResponseParser& response);
 };
 
 #endif // CLOUD_H
@@ -0,0 +1,62 @@
+#ifndef GREENHOUSE_HTTP_SINK_CONFIG_H
+#define GREENHOUSE_HTTP_SINK_CONFIG_H
+
+// -----------------------------------------------------------------------------
+// HTTP JSON Sink Configuration:
+// Telemetry records are POSTed as JSON to an HTTP(S) endpoint, alongside the ThingSpeak
+// upload, with their own queue, pacing and backoff (see TelemetryPipeline.h). The sink
+// is only built into the system when HTTP_SINK_HOST is defined.
+//
+// For testing and benchmarking against the local stand-in endpoint on the development PC:
+//   - run:    python3 tools/mock_telemetry_endpoint.py --port 8080
+//             (--fail 0.2 answers 20 % of the requests with 500, --limit 0.1 answers
+//             10 % with 429 and Retry-After, --delay 2 holds every answer for 2 s),
+//   - define HTTP_SINK_HOST as the PC's IP address and keep HTTP_SINK_USE_TLS 0,
+//   - the script prints every request and the records per second it received.
+// -----------------------------------------------------------------------------
+
+// Endpoint host name or dotted IP address. Leave undefined to disable the sink.
+//#define HTTP_SINK_HOST "192.168.1.10"
+
+// Use TLS (1) or plain HTTP (0).
+#ifndef HTTP_SINK_USE_TLS
+#define HTTP_SINK_USE_TLS 0
+#endif
+
+// Endpoint TCP port.
+#ifndef HTTP_SINK_PORT
+#if HTTP_SINK_USE_TLS
+#define HTTP_SINK_PORT 443
+#else
+#define HTTP_SINK_PORT 8080
+#endif
+#endif
+
+// Trust anchor of the endpoint (DER bytes of its CA certificate as a brace-enclosed list,
+// see thingspeak_config.h). Without it the TLS connection is not authenticated.
+//#define HTTP_SINK_CA_DER { 0x30, 0x82, /* ... */ }
+
+// Request path and the device name sent with every batch:
+//   {"device":"greenhouse-pico","records":[{"uptime_ms":84500,"time":"2024-06-10T12:34:56Z",
+//     "co2":812.0,"rh":45.3,"temp":21.4,"fan":40.0,"setpoint":900,"flags":33}, ...]}
+// "time" is left out until the wall clock is synchronized.
+#define HTTP_SINK_PATH   "/telemetry"
+#define HTTP_SINK_DEVICE "greenhouse-pico"
+
+// Records per request (as many as fit into the request body are sent).
+#ifndef HTTP_SINK_MAX_BATCH
+#define HTTP_SINK_MAX_BATCH 16
+#endif
+
+// Time allowed for one request, including connecting.
+#define HTTP_SINK_TIMEOUT_S 10
+
+// Pacing (see UploadScheduler.h). A local endpoint has no rate limit of its own, so
+// records are sent soon after they are recorded.
+#define HTTP_SINK_MIN_INTERVAL_MS  5000
+#define HTTP_SINK_JITTER_PERCENT   10
+#define HTTP_SINK_PHASE_WINDOW_MS  5000
+#define HTTP_SINK_BASE_BACKOFF_MS  2000
+#define HTTP_SINK_MAX_BACKOFF_MS   300000
+
+#endif // GREENHOUSE_HTTP_SINK_CONFIG_H
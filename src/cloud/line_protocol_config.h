@@ -0,0 +1,42 @@
+#ifndef GREENHOUSE_LINE_PROTOCOL_CONFIG_H
+#define GREENHOUSE_LINE_PROTOCOL_CONFIG_H
+
+// -----------------------------------------------------------------------------
+// Line Protocol Exporter Configuration:
+// Every sample is sent as an InfluxDB line-protocol record in UDP datagrams to a collector
+// on the local network (InfluxDB UDP listener or Telegraf socket_listener). There is no
+// TLS and no connection; a lost datagram is simply lost. The exporter is only built into
+// the system when LINE_PROTOCOL_HOST is defined.
+//
+// For testing with a local listener on the development PC:
+//   - define LINE_PROTOCOL_HOST as the PC's IP address,
+//   - watch the datagrams:  nc -klu 8089        (or: socat -u UDP-RECV:8089 -)
+//   - Telegraf:             [[inputs.socket_listener]]
+//                             service_address = "udp://:8089"
+//                             data_format = "influx"
+// -----------------------------------------------------------------------------
+
+// Collector IPv4 address (dotted). Leave undefined to disable the exporter.
+//#define LINE_PROTOCOL_HOST "192.168.1.10"
+
+// Collector UDP port (8089 is the usual InfluxDB/Telegraf UDP port).
+#ifndef LINE_PROTOCOL_PORT
+#define LINE_PROTOCOL_PORT 8089
+#endif
+
+// Measurement name and tag set written at the start of every line.
+#define LINE_PROTOCOL_MEASUREMENT "greenhouse"
+#define LINE_PROTOCOL_TAGS        "device=pico"
+
+// Largest datagram payload: a 1500 byte Ethernet/Wi-Fi MTU minus the IPv4 and UDP
+// headers, so a batch is never fragmented.
+#ifndef LINE_PROTOCOL_MAX_DATAGRAM
+#define LINE_PROTOCOL_MAX_DATAGRAM 1472
+#endif
+
+// A batch is sent at the latest this long after its first sample, even if not full.
+#ifndef LINE_PROTOCOL_FLUSH_MS
+#define LINE_PROTOCOL_FLUSH_MS 5000
+#endif
+
+#endif // GREENHOUSE_LINE_PROTOCOL_CONFIG_H
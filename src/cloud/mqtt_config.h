@@ -0,0 +1,75 @@
+#ifndef GREENHOUSE_MQTT_CONFIG_H
+#define GREENHOUSE_MQTT_CONFIG_H
+
+// -----------------------------------------------------------------------------
+// MQTT Configuration:
+// The MQTT channel publishes telemetry to a broker and receives remote commands on a
+// subscribed topic as soon as they are published, instead of waiting for the next
+// ThingSpeak update. It is only built into the system when MQTT_BROKER_HOST is defined.
+//
+// For testing against a local broker (e.g. mosquitto on the development PC):
+//   - define MQTT_BROKER_HOST as the PC's IP address, MQTT_BROKER_PORT 1883 and
+//     MQTT_USE_TLS 0 (or use port 8883 with a TLS listener),
+//   - watch telemetry:   mosquitto_sub -h <pc> -t 'greenhouse/#' -v
+//   - send a setpoint:   mosquitto_pub -h <pc> -t greenhouse/cmd -m 'ID=1 SETPOINT=900'
+// -----------------------------------------------------------------------------
+
+// Broker host name or dotted IP address. Leave undefined to disable MQTT.
+//#define MQTT_BROKER_HOST "192.168.1.10"
+
+// Use TLS for the broker connection (1) or plain TCP (0).
+#ifndef MQTT_USE_TLS
+#define MQTT_USE_TLS 1
+#endif
+
+// Broker TCP port: 8883 for MQTT over TLS, 1883 for plain MQTT.
+#ifndef MQTT_BROKER_PORT
+#if MQTT_USE_TLS
+#define MQTT_BROKER_PORT 8883
+#else
+#define MQTT_BROKER_PORT 1883
+#endif
+#endif
+
+// Trust anchor of the broker (DER bytes of its CA certificate as a brace-enclosed list,
+// see thingspeak_config.h). Without it the TLS connection is not authenticated.
+//#define MQTT_CA_DER { 0x30, 0x82, /* ... */ }
+
+// Client identifier and optional credentials (nullptr when the broker allows anonymous access).
+#define MQTT_CLIENT_ID "greenhouse-pico"
+#define MQTT_USERNAME  nullptr
+#define MQTT_PASSWORD  nullptr
+
+// Topics:
+//   telemetry - the records of the telemetry pipeline (report-by-exception, see
+//               ChangeDetector.h); a CBOR batch (see TelemetryCodec.h) when
+//               MQTT_PAYLOAD_CBOR is 1, otherwise CSV text "co2,rh,temp,fan,setpoint"
+//               (one record per message).
+//               View CBOR with: mosquitto_sub -t greenhouse/telemetry -F %x
+//   command   - commands in the same NAME=VALUE form as TalkBack, e.g. "ID=1 SETPOINT=900"
+//               (see commands/Command.h).
+//   ack       - acknowledgements of executed commands, e.g. "1=done" (QoS 1).
+//   status    - retained "online" on connect; the broker publishes "offline" (last will)
+//               if the connection is lost.
+#define MQTT_TELEMETRY_TOPIC "greenhouse/telemetry"
+#define MQTT_COMMAND_TOPIC   "greenhouse/cmd"
+#define MQTT_ACK_TOPIC       "greenhouse/ack"
+#define MQTT_STATUS_TOPIC    "greenhouse/status"
+
+// Telemetry payload format: 1 = compact CBOR, 0 = CSV text.
+#ifndef MQTT_PAYLOAD_CBOR
+#define MQTT_PAYLOAD_CBOR 1
+#endif
+
+// Shortest time between telemetry publishes, and the number of queued records that
+// are combined into one CBOR message.
+#define MQTT_MIN_PUBLISH_INTERVAL_MS 1000
+#define MQTT_MAX_BATCH               8
+
+// MQTT keep-alive (seconds).
+#define MQTT_KEEP_ALIVE_S        60
+
+// Delay between reconnect attempts after the connection was lost.
+#define MQTT_RECONNECT_DELAY_MS  5000
+
+#endif // GREENHOUSE_MQTT_CONFIG_H
@@ -15,6 +15,67 @@
 // API key for TalkBack commands on ThingSpeak. This key allows reception of remote commands.
 #define THINGSPEAK_TALKBACK_API_KEY "SYS3WRA4JERPF0M8"
 
+// Server host name and port. Both can be overridden at build time, e.g. to point the
+// device at a local TLS stand-in server during testing (an IP address is accepted too).
+#ifndef THINGSPEAK_HOST
+#define THINGSPEAK_HOST "api.thingspeak.com"
+#endif
+#ifndef THINGSPEAK_PORT
+#define THINGSPEAK_PORT 443
+#endif
+
+// ThingSpeak channel ID that the write API key belongs to (required; the build fails
+// without it). Queued samples are uploaded in batches with
+// /channels/<id>/bulk_update.json and TalkBack commands are fetched with a separate
+// request. Can also be set at build time.
+#ifndef THINGSPEAK_CHANNEL_ID
+//#define THINGSPEAK_CHANNEL_ID "0000000"
+#endif
+
+// -----------------------------------------------------------------------------
+// Upload pacing (see UploadScheduler.h):
+// Uploads are spread over time so that a fleet of devices started together (e.g. after
+// a power cut) does not reach the server in lockstep. The first upload waits a random
+// phase offset, every later interval is lengthened by a random jitter, and failures and
+// rate-limit answers (HTTP 429, or 503 with Retry-After) back off exponentially.
+// -----------------------------------------------------------------------------
+
+// Shortest time between uploads (ThingSpeak accepts one update every 15 s per channel).
+#ifndef UPLOAD_MIN_INTERVAL_MS
+#define UPLOAD_MIN_INTERVAL_MS 20000
+#endif
+
+// Each interval is lengthened by a random 0..UPLOAD_JITTER_PERCENT percent.
+#ifndef UPLOAD_JITTER_PERCENT
+#define UPLOAD_JITTER_PERCENT 25
+#endif
+
+// The first upload after boot waits a random 0..UPLOAD_PHASE_WINDOW_MS.
+#ifndef UPLOAD_PHASE_WINDOW_MS
+#define UPLOAD_PHASE_WINDOW_MS 20000
+#endif
+
+// TalkBack commands are polled this often while there is nothing to upload.
+#ifndef UPLOAD_COMMAND_POLL_MS
+#define UPLOAD_COMMAND_POLL_MS 60000
+#endif
+
+// Backoff after the first failed request, doubled with every further failure up to
+// UPLOAD_MAX_BACKOFF_MS. The rate-limited upload interval is capped at the same value.
+#ifndef UPLOAD_BASE_BACKOFF_MS
+#define UPLOAD_BASE_BACKOFF_MS 15000
+#endif
+#ifndef UPLOAD_MAX_BACKOFF_MS
+#define UPLOAD_MAX_BACKOFF_MS 900000
+#endif
+
+// Trust anchor for api.thingspeak.com: the DER bytes of the root CA certificate that
+// issued the server certificate, as a brace-enclosed list. When defined, the server is
+// authenticated during the TLS handshake (see TlsProfile.h); export the CA from the
+// server's chain (e.g. openssl s_client -showcerts) and convert it with
+// "openssl x509 -outform der | xxd -i".
+//#define THINGSPEAK_CA_DER { 0x30, 0x82, /* ... */ }
+
 // URL endpoint for retrieving the last TalkBack command from ThingSpeak.
 #define THINGSPEAK_TALKBACK_URL "/talkbacks/54160/commands/last.json"
 
@@ -0,0 +1,70 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <cstdint>
+
+/*
+   Remote commands
+
+   Commands arrive as NAME=VALUE tokens from any transport (ThingSpeak TalkBack, MQTT,
+   the local HTTP API). An optional "ID=<n>" token before a command gives it an ID that
+   is echoed in its acknowledgement:
+
+       SETPOINT=<ppm>                       CO₂ setpoint, 1..1500 ppm (stored in EEPROM)
+       SCHEDULE=<HHMM>-<HHMM>@<ppm>         setpoint used between the two UTC times,
+       SCHEDULE=OFF                           e.g. SCHEDULE=0600-1800@1000
+       FAN=<percent> | FAN=AUTO             minimum fan speed outside the safety vent
+       INTERVAL=<ms>                        control/sampling cycle, 100..60000 ms
+       REBOOT=1                             reboot once the acknowledgement is delivered
+       DIAG=1                               print a diagnostics dump to the console
+       LOG=<severity>                       remote log threshold (0..7 or emerg..debug),
+       LOG=<Module>:<severity>                globally or for one module, e.g. LOG=Modbus:debug
+
+   e.g. "ID=17 SETPOINT=900" is acknowledged as "17=done".
+*/
+enum class CommandType : uint8_t {
+    SetSetpoint,
+    Schedule,
+    FanOverride,
+    SampleInterval,
+    Reboot,
+    Diagnostics,
+    LogLevel
+};
+
+// Transport a command arrived on (for logging).
+enum class CommandSource : uint8_t { TalkBack, Mqtt, Local };
+
+// Outcome reported in the acknowledgement.
+enum class CommandStatus : uint8_t {
+    Done,
+    Unknown,        // Unknown command name.
+    Invalid,        // Value could not be parsed.
+    OutOfRange,     // Value outside the allowed range.
+    QueueFull,      // Dropped because the execution queue was full.
+    Failed          // Execution failed.
+};
+
+/*
+   A validated command waiting in the execution queue.
+*/
+struct Command {
+    uint32_t id = 0;                 // 0 if the sender gave no ID.
+    CommandType type = CommandType::SetSetpoint;
+    CommandSource source = CommandSource::Local;
+    float value = 0.0f;              // Setpoint, fan percentage (-1 = auto), interval or severity.
+    uint16_t startMinute = 0;        // Schedule window (minutes after midnight UTC);
+    uint16_t endMinute = 0;          // start == end disables the schedule.
+    char module[16] = "";            // LOG= module; empty for the global threshold.
+};
+
+/*
+   Acknowledgement of a command, kept until a transport has delivered it.
+*/
+struct CommandAck {
+    uint32_t id = 0;
+    CommandType type = CommandType::SetSetpoint;   // Identifies commands without an ID.
+    CommandStatus status = CommandStatus::Done;
+};
+
+#endif // COMMAND_H
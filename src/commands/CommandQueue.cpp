@@ -0,0 +1,424 @@
+#include "CommandQueue.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <mutex>
+
+#include "pico/stdlib.h"
+#include "hardware/watchdog.h"
+#include "task.h"
+#include "Controller/Controller.h"
+#include "EEPROM/ConfigCache.h"
+#include "metrics/Metrics.h"
+#include "Syslog.h"
+
+// =============================================================================
+//                          CommandQueue Implementation
+// =============================================================================
+
+static constexpr float SETPOINT_MAX = 1500.0f;
+static constexpr uint32_t INTERVAL_MIN_MS = 100;
+static constexpr uint32_t INTERVAL_MAX_MS = 60000;
+
+static const MetricDescriptor commandsDescriptor = {
+    "greenhouse_commands_total", "Remote commands by outcome.", MetricType::Counter };
+
+static MetricId statusMetrics[6] = { -1, -1, -1, -1, -1, -1 };
+
+static const char* typeName(CommandType type) {
+    switch (type) {
+        case CommandType::SetSetpoint:    return "setpoint";
+        case CommandType::Schedule:       return "schedule";
+        case CommandType::FanOverride:    return "fan";
+        case CommandType::SampleInterval: return "interval";
+        case CommandType::Reboot:         return "reboot";
+        case CommandType::Diagnostics:    return "diag";
+        case CommandType::LogLevel:       return "log";
+    }
+    return "?";
+}
+
+static const char* statusName(CommandStatus status) {
+    switch (status) {
+        case CommandStatus::Done:       return "done";
+        case CommandStatus::Unknown:    return "unknown";
+        case CommandStatus::Invalid:    return "invalid";
+        case CommandStatus::OutOfRange: return "out_of_range";
+        case CommandStatus::QueueFull:  return "queue_full";
+        case CommandStatus::Failed:     return "failed";
+    }
+    return "?";
+}
+
+static const char* sourceName(CommandSource source) {
+    switch (source) {
+        case CommandSource::TalkBack: return "TalkBack";
+        case CommandSource::Mqtt:     return "MQTT";
+        case CommandSource::Local:    return "local API";
+    }
+    return "?";
+}
+
+// Parses a complete decimal number; returns false on trailing garbage.
+static bool parseNumber(const char* text, float& value) {
+    char* end = nullptr;
+    value = strtof(text, &end);
+    return end != text && *end == '\0';
+}
+
+// Parses "HHMM" into minutes after midnight.
+static bool parseClock(const char* text, uint16_t& minutes) {
+    for (int i = 0; i < 4; i++) {
+        if (text[i] < '0' || text[i] > '9') return false;
+    }
+    int hours = (text[0] - '0') * 10 + (text[1] - '0');
+    int mins  = (text[2] - '0') * 10 + (text[3] - '0');
+    if (hours > 23 || mins > 59) return false;
+    minutes = static_cast<uint16_t>(hours * 60 + mins);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Constructor / Destructor
+// ----------------------------------------------------------------------------
+CommandQueue::CommandQueue(Controller* controller, ConfigCache* settings)
+        : controller_(controller)
+        , settings_(settings)
+        , queue_(nullptr)
+        , sampleIntervalMs_(DEFAULT_INTERVAL_MS)
+        , ackHead_(0)
+        , ackCount_(0)
+        , ackHeadSeq_(0)
+        , rebootAckSeq_(0)
+        , rebootAckDelivered_(false)
+        , rebootPending_(false)
+        , rebootDeadlineMs_(0)
+{
+    queue_ = xQueueCreate(QUEUE_LENGTH, sizeof(Command));
+    if (!queue_) {
+        printf("[Commands] Failed to create the command queue.\n");
+    }
+    for (size_t i = 0; i < sizeof(statusMetrics) / sizeof(statusMetrics[0]); i++) {
+        char labels[32];
+        snprintf(labels, sizeof(labels), "status=\"%s\"", statusName(static_cast<CommandStatus>(i)));
+        statusMetrics[i] = g_metrics.add(commandsDescriptor, labels);
+    }
+}
+
+CommandQueue::~CommandQueue() {
+    if (queue_) {
+        vQueueDelete(queue_);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// parse(): one NAME=VALUE token.
+// ----------------------------------------------------------------------------
+CommandStatus CommandQueue::parse(const char* name, const char* value, Command& command) {
+    float number = 0.0f;
+
+    if (strcmp(name, "SETPOINT") == 0) {
+        command.type = CommandType::SetSetpoint;
+        if (!parseNumber(value, number)) return CommandStatus::Invalid;
+        if (number <= 0.0f || number > SETPOINT_MAX) return CommandStatus::OutOfRange;
+        command.value = number;
+
+    } else if (strcmp(name, "SCHEDULE") == 0) {
+        command.type = CommandType::Schedule;
+        if (strcmp(value, "OFF") == 0) {
+            command.startMinute = command.endMinute = 0;
+            return CommandStatus::Done;
+        }
+        // HHMM-HHMM@ppm
+        if (strlen(value) < 11 || value[4] != '-' || value[9] != '@' ||
+            !parseClock(value, command.startMinute) || !parseClock(value + 5, command.endMinute) ||
+            !parseNumber(value + 10, number)) {
+            return CommandStatus::Invalid;
+        }
+        if (command.startMinute == command.endMinute || number <= 0.0f || number > SETPOINT_MAX) {
+            return CommandStatus::OutOfRange;
+        }
+        command.value = number;
+
+    } else if (strcmp(name, "FAN") == 0) {
+        command.type = CommandType::FanOverride;
+        if (strcmp(value, "AUTO") == 0) {
+            command.value = -1.0f;
+            return CommandStatus::Done;
+        }
+        if (!parseNumber(value, number)) return CommandStatus::Invalid;
+        if (number < 0.0f || number > 100.0f) return CommandStatus::OutOfRange;
+        command.value = number;
+
+    } else if (strcmp(name, "INTERVAL") == 0) {
+        command.type = CommandType::SampleInterval;
+        if (!parseNumber(value, number)) return CommandStatus::Invalid;
+        if (number < INTERVAL_MIN_MS || number > INTERVAL_MAX_MS) return CommandStatus::OutOfRange;
+        command.value = number;
+
+    } else if (strcmp(name, "LOG") == 0) {
+        // LOG=<severity> or LOG=<Module>:<severity>
+        command.type = CommandType::LogLevel;
+        const char* severityText = value;
+        const char* colon = strchr(value, ':');
+        if (colon) {
+            size_t length = static_cast<size_t>(colon - value);
+            if (length == 0 || length >= sizeof(command.module)) return CommandStatus::Invalid;
+            memcpy(command.module, value, length);
+            command.module[length] = '\0';
+            severityText = colon + 1;
+        }
+        LogSeverity severity;
+        if (!Syslog::parseSeverity(severityText, severity)) return CommandStatus::Invalid;
+        command.value = static_cast<float>(severity);
+
+    } else if (strcmp(name, "REBOOT") == 0 || strcmp(name, "DIAG") == 0) {
+        command.type = name[0] == 'R' ? CommandType::Reboot : CommandType::Diagnostics;
+        if (strcmp(value, "1") != 0) return CommandStatus::Invalid;
+
+    } else {
+        return CommandStatus::Unknown;
+    }
+    return CommandStatus::Done;
+}
+
+// ----------------------------------------------------------------------------
+// submit(): validate and queue (any task, never blocks).
+// ----------------------------------------------------------------------------
+size_t CommandQueue::submit(const CommandToken* tokens, size_t count, CommandSource source, size_t* rejected) {
+    size_t queued = 0;
+    size_t failed = 0;
+    uint32_t id = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        // "ID=<n>" applies to the command that follows it.
+        if (strcmp(tokens[i].name, "ID") == 0) {
+            id = static_cast<uint32_t>(strtoul(tokens[i].value, nullptr, 10));
+            continue;
+        }
+
+        Command command;
+        command.id = id;
+        command.source = source;
+        CommandStatus status = parse(tokens[i].name, tokens[i].value, command);
+        id = 0;
+
+        if (status == CommandStatus::Done && (!queue_ || xQueueSendToBack(queue_, &command, 0) != pdTRUE)) {
+            status = CommandStatus::QueueFull;
+        }
+        if (status == CommandStatus::Done) {
+            printf("[Commands] Queued %s=%s from %s (id %lu)\n", tokens[i].name, tokens[i].value,
+                   sourceName(source), static_cast<unsigned long>(command.id));
+            queued++;
+            continue;
+        }
+
+        printf("[Commands] Rejected %s=%s from %s: %s\n", tokens[i].name, tokens[i].value,
+               sourceName(source), statusName(status));
+        failed++;
+        g_metrics.inc(statusMetrics[static_cast<size_t>(status)]);
+        // An unknown command without an ID cannot be matched by the sender; only log it.
+        if (status != CommandStatus::Unknown || command.id != 0) {
+            addAck(command.id, command.type, status);
+        }
+    }
+    if (rejected) *rejected = failed;
+    return queued;
+}
+
+size_t CommandQueue::submitText(const char* text, CommandSource source, size_t* rejected) {
+    static constexpr size_t MAX_TOKENS = 8;
+    char buffer[128];
+    strncpy(buffer, text, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+
+    CommandToken tokens[MAX_TOKENS];
+    size_t count = 0;
+    char* save = nullptr;
+    for (char* token = strtok_r(buffer, " ,;&\r\n", &save);
+         token && count < MAX_TOKENS;
+         token = strtok_r(nullptr, " ,;&\r\n", &save)) {
+        char* equals = strchr(token, '=');
+        if (!equals) continue;
+        *equals = '\0';
+        tokens[count++] = CommandToken{token, equals + 1};
+    }
+    return submit(tokens, count, source, rejected);
+}
+
+// ----------------------------------------------------------------------------
+// process(): execute queued commands (controller task).
+// ----------------------------------------------------------------------------
+size_t CommandQueue::process() {
+    size_t executed = 0;
+    Command command;
+    while (queue_ && xQueueReceive(queue_, &command, 0) == pdTRUE) {
+        CommandStatus status = execute(command);
+        addAck(command.id, command.type, status);
+        if (command.type == CommandType::Reboot && status == CommandStatus::Done) {
+            rebootPending_ = true;
+            rebootDeadlineMs_ = to_ms_since_boot(get_absolute_time()) + REBOOT_DELAY_MS;
+        }
+        g_metrics.inc(statusMetrics[static_cast<size_t>(status)]);
+        executed++;
+    }
+
+    if (rebootPending_) {
+        bool delivered;
+        {
+            std::lock_guard<Fmutex> exclusive(access);
+            delivered = rebootAckDelivered_;
+        }
+        uint32_t now = to_ms_since_boot(get_absolute_time());
+        if (delivered || static_cast<int32_t>(now - rebootDeadlineMs_) >= 0) {
+            if (settings_ && !settings_->flushAll()) {
+                printf("[Commands] Some settings could not be saved before the reboot.\n");
+            }
+            printf("[Commands] Rebooting on remote command.\n");
+            watchdog_reboot(0, 0, 0);
+            while (true) tight_loop_contents();
+        }
+    }
+    return executed;
+}
+
+CommandStatus CommandQueue::execute(const Command& command) {
+    printf("[Commands] Executing %s (id %lu) from %s\n", typeName(command.type),
+           static_cast<unsigned long>(command.id), sourceName(command.source));
+
+    switch (command.type) {
+        case CommandType::SetSetpoint:
+            if (!controller_) return CommandStatus::Failed;
+            controller_->setCO2Setpoint(command.value);
+            printf("[Commands] Controller setpoint updated to %.2f\n", command.value);
+            break;
+
+        case CommandType::Schedule:
+            if (!controller_) return CommandStatus::Failed;
+            controller_->setSetpointSchedule(command.startMinute, command.endMinute, command.value);
+            break;
+
+        case CommandType::FanOverride:
+            if (!controller_) return CommandStatus::Failed;
+            controller_->setFanOverride(command.value);
+            break;
+
+        case CommandType::SampleInterval:
+            sampleIntervalMs_ = static_cast<uint32_t>(command.value);
+            printf("[Commands] Control interval set to %lu ms\n", static_cast<unsigned long>(sampleIntervalMs_));
+            break;
+
+        case CommandType::Reboot:
+            // Carried out in process() once the ack is delivered.
+            break;
+
+        case CommandType::Diagnostics:
+            dumpDiagnostics();
+            break;
+
+        case CommandType::LogLevel: {
+            auto severity = static_cast<LogSeverity>(static_cast<uint8_t>(command.value));
+            if (command.module[0] == '\0') {
+                Syslog::setThreshold(severity);
+            } else if (!Syslog::setModuleThreshold(command.module, severity)) {
+                return CommandStatus::Failed;
+            }
+            printf("[Commands] Log threshold of %s set to %u\n",
+                   command.module[0] ? command.module : "all modules", static_cast<unsigned>(severity));
+            break;
+        }
+    }
+    return CommandStatus::Done;
+}
+
+uint32_t CommandQueue::getSampleIntervalMs() const {
+    return sampleIntervalMs_;
+}
+
+/*
+    The dump is the metrics registry (heap, tasks, drivers, network) in the Prometheus
+    text format, printed in small pieces so that no large buffer is needed.
+*/
+void CommandQueue::dumpDiagnostics() const {
+    printf("[Commands] ---- Diagnostics (uptime %lu s) ----\n",
+           static_cast<unsigned long>(to_ms_since_boot(get_absolute_time()) / 1000));
+    MetricsCursor cursor;
+    char buffer[160];
+    size_t length;
+    while ((length = g_metrics.render(cursor, buffer, sizeof(buffer) - 1)) > 0) {
+        buffer[length] = '\0';
+        printf("%s", buffer);
+    }
+    printf("[Commands] ---- End of diagnostics ----\n");
+}
+
+// ----------------------------------------------------------------------------
+// Acknowledgements
+// ----------------------------------------------------------------------------
+/*
+    A reboot ack counts as delivered only when popAcks() removes it. Moving past it is
+    not enough: a full ring drops the oldest ack unsent, and the reboot then waits for
+    its deadline instead.
+*/
+void CommandQueue::addAck(uint32_t id, CommandType type, CommandStatus status) {
+    std::lock_guard<Fmutex> exclusive(access);
+    if (ackCount_ == MAX_ACKS) {
+        // Full: drop the oldest ack.
+        ackHead_ = (ackHead_ + 1) % MAX_ACKS;
+        ackHeadSeq_++;
+        ackCount_--;
+    }
+    acks_[(ackHead_ + ackCount_) % MAX_ACKS] = CommandAck{id, type, status};
+    ackCount_++;
+    if (type == CommandType::Reboot && status == CommandStatus::Done) {
+        rebootAckSeq_ = ackHeadSeq_ + static_cast<uint32_t>(ackCount_) - 1;
+        rebootAckDelivered_ = false;
+    }
+}
+
+bool CommandQueue::hasAcks() const {
+    std::lock_guard<Fmutex> exclusive(access);
+    return ackCount_ > 0;
+}
+
+size_t CommandQueue::peekAcks(CommandAck* out, size_t max, uint32_t& firstSeq) const {
+    std::lock_guard<Fmutex> exclusive(access);
+    size_t n = ackCount_ < max ? ackCount_ : max;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = acks_[(ackHead_ + i) % MAX_ACKS];
+    }
+    firstSeq = ackHeadSeq_;
+    return n;
+}
+
+void CommandQueue::popAcks(uint32_t firstSeq, size_t count) {
+    std::lock_guard<Fmutex> exclusive(access);
+    // Skip acks that were already dropped since peekAcks().
+    uint32_t end = firstSeq + static_cast<uint32_t>(count);
+    while (ackCount_ > 0 && static_cast<int32_t>(end - ackHeadSeq_) > 0) {
+        if (ackHeadSeq_ == rebootAckSeq_) {
+            rebootAckDelivered_ = true;
+        }
+        ackHead_ = (ackHead_ + 1) % MAX_ACKS;
+        ackHeadSeq_++;
+        ackCount_--;
+    }
+}
+
+size_t CommandQueue::formatAcks(const CommandAck* acks, size_t count, char* out, size_t size) {
+    if (size == 0) return 0;
+    size_t length = 0;
+    out[0] = '\0';
+    for (size_t i = 0; i < count; i++) {
+        char id[12];
+        if (acks[i].id) snprintf(id, sizeof(id), "%lu", static_cast<unsigned long>(acks[i].id));
+        int n = snprintf(out + length, size - length, "%s%s=%s", length ? "," : "",
+                         acks[i].id ? id : typeName(acks[i].type), statusName(acks[i].status));
+        if (n < 0 || static_cast<size_t>(n) >= size - length) {
+            out[length] = '\0';
+            break;
+        }
+        length += static_cast<size_t>(n);
+    }
+    return length;
+}
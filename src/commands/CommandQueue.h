@@ -0,0 +1,119 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <cstdint>
+#include <cstddef>
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "Fmutex.h"
+#include "Command.h"
+
+class Controller;
+class ConfigCache;
+
+// A NAME=VALUE token handed in by a transport.
+struct CommandToken {
+    const char* name;
+    const char* value;
+};
+
+/*
+   CommandQueue Module Header
+
+   The command subsystem shared by all transports. Commands are parsed and validated
+   where they arrive, queued, and executed by the controller task (sensorTask), so the
+   Controller is only ever changed by the task that runs the control loop.
+
+   Key responsibilities include:
+     - Parsing NAME=VALUE tokens (see Command.h) with optional IDs. Commands that cannot be
+       parsed or are out of range are not queued but acknowledged as rejected at once.
+     - A bounded FreeRTOS queue of validated commands; submit() never blocks, so it can be
+       called from the lwIP thread (MQTT, local HTTP API) as well as from the cloud task.
+     - Executing the commands in process(): setpoint, setpoint schedule, fan override,
+       sampling interval, reboot, diagnostics dump and remote log threshold.
+     - Keeping acknowledgements until a transport has delivered them with the next
+       telemetry upload. As with TelemetryQueue, acks are read with peekAcks() and removed
+       with popAcks() only after the upload succeeded. When the ack ring is full the
+       oldest ack is dropped.
+
+   A reboot is delayed until its acknowledgement has been delivered (at most
+   REBOOT_DELAY_MS), so the sender learns that the command was executed. Settings that
+   are still waiting in the configuration cache are written before the reset.
+*/
+class CommandQueue {
+public:
+    static constexpr size_t QUEUE_LENGTH = 8;
+    static constexpr size_t MAX_ACKS = 16;
+    static constexpr uint32_t REBOOT_DELAY_MS = 60000;
+    static constexpr uint32_t DEFAULT_INTERVAL_MS = 500;
+
+    // 'settings' (optional) is flushed before a remote reboot.
+    explicit CommandQueue(Controller* controller, ConfigCache* settings = nullptr);
+    ~CommandQueue();
+
+    CommandQueue(const CommandQueue&) = delete;
+
+    // ------------------------------------------------------------------------
+    // Transports (any task)
+    // ------------------------------------------------------------------------
+    // Validates and queues the commands in 'tokens'. Returns the number of commands
+    // queued; 'rejected' (optional) receives the number of rejected ones.
+    size_t submit(const CommandToken* tokens, size_t count, CommandSource source, size_t* rejected = nullptr);
+
+    // Same for a text such as "ID=17 SETPOINT=900" (tokens separated by spaces, commas,
+    // semicolons, '&' or line breaks).
+    size_t submitText(const char* text, CommandSource source, size_t* rejected = nullptr);
+
+    // ------------------------------------------------------------------------
+    // Controller task
+    // ------------------------------------------------------------------------
+    // Executes all queued commands. Returns the number of commands executed.
+    size_t process();
+
+    // Control cycle set with INTERVAL= (sensorTask delay).
+    uint32_t getSampleIntervalMs() const;
+
+    // ------------------------------------------------------------------------
+    // Acknowledgements
+    // ------------------------------------------------------------------------
+    bool hasAcks() const;
+
+    // Copies up to 'max' of the oldest acks; 'firstSeq' identifies them for popAcks().
+    size_t peekAcks(CommandAck* out, size_t max, uint32_t& firstSeq) const;
+
+    // Removes acks returned by peekAcks() once they have been delivered.
+    void popAcks(uint32_t firstSeq, size_t count);
+
+    // Formats acks as "17=done,fan=out_of_range" (the command name stands in for a
+    // missing ID). Returns the length; acks that do not fit are left out.
+    static size_t formatAcks(const CommandAck* acks, size_t count, char* out, size_t size);
+
+private:
+    Controller* controller_;
+    ConfigCache* settings_;
+    QueueHandle_t queue_;
+    volatile uint32_t sampleIntervalMs_;
+
+    mutable Fmutex access;                // Protects the ack ring.
+    CommandAck acks_[MAX_ACKS];
+    size_t ackHead_;
+    size_t ackCount_;
+    uint32_t ackHeadSeq_;                 // Sequence number of the oldest ack.
+    uint32_t rebootAckSeq_;               // Ack of the last reboot command.
+    bool rebootAckDelivered_;             // Popped by popAcks(), not dropped.
+
+    // Pending reboot (controller task only).
+    bool rebootPending_;
+    uint32_t rebootDeadlineMs_;
+
+    // Parses one command token. Returns Done if 'command' is valid.
+    static CommandStatus parse(const char* name, const char* value, Command& command);
+
+    // Appends an ack and registers it if it confirms a reboot.
+    void addAck(uint32_t id, CommandType type, CommandStatus status);
+
+    CommandStatus execute(const Command& command);
+    void dumpDiagnostics() const;
+};
+
+#endif // COMMAND_QUEUE_H
@@ -4,12 +4,14 @@
 #include "./sensors/PressureSensor.h"
 #include "./FanDriver/FanDriver.h"
 #include "./ValveDriver/ValveDriver.h"
-#include "EEPROM/EEPROMStorage.h"
+#include "EEPROM/ConfigCache.h"
+#include "WallClock.h"
 #include "FreeRTOS.h"
 #include "task.h"
 #include "timers.h"
 #include <cstdio>
 #include "hardware/gpio.h"
+#include "pico/stdlib.h"
 
 /*
    The Controller module is the central decision‐maker of the Greenhouse Fertilization System.
@@ -24,22 +26,31 @@ Controller::Controller(std::shared_ptr<CO2Sensor> co2,
                        std::shared_ptr<PressureSensor> pres,
                        std::shared_ptr<FanDriver> fan,
                        std::shared_ptr<ValveDriver> valve,
-                       std::shared_ptr<EEPROMStorage> eeprom)
+                       std::shared_ptr<ConfigCache> config)
         : co2Sensor(co2)
         , thrSensor(thr)
         , presSensor(pres)
         , fan(fan)
         , valve(valve)
-        , eepromStorage(eeprom)
+        , configCache(config)
 {
-    // Initialize the CO₂ setpoint from EEPROM. If EEPROM storage is not available,
+    // Initialize the CO₂ setpoint from the configuration cache. If no setpoint is stored,
     // then a default CO₂ setpoint of 1500 ppm is used.
-    if (eepromStorage) {
-        co2Setpoint = static_cast<float>(eepromStorage->loadCO2Setpoint());
+    uint16_t storedSetpoint = 0;
+    if (configCache && configCache->get(ConfigKey::Co2Setpoint, storedSetpoint)) {
+        co2Setpoint = static_cast<float>(storedSetpoint);
         printf("[Controller] Initial CO₂ setpoint from EEPROM: %.1f\n", co2Setpoint);
     } else {
         co2Setpoint = 1500.0f; // Fallback default setpoint in ppm
-        printf("[Controller] EEPROM not available, using default CO₂ setpoint: %.1f\n", co2Setpoint);
+        printf("[Controller] No stored CO₂ setpoint, using default: %.1f\n", co2Setpoint);
+    }
+
+    // Restore the setpoint schedule, if one was set.
+    ConfigSchedule schedule{};
+    if (configCache && configCache->get(ConfigKey::SetpointSchedule, schedule)) {
+        scheduleStart = schedule.startMinute;
+        scheduleEnd = schedule.endMinute;
+        scheduleSetpoint = static_cast<float>(schedule.setpoint);
     }
 
     safetyVent = false; // Safety override flag, initially inactive
@@ -115,28 +126,31 @@ void Controller::updateControl() {
         printf("[Controller] *** CO₂ > 2000: Forcing valve closed and fan at 100%%\n");
         return; // Exit control update early since safety override is active.
     }
-    // If not in safety mode and safetyVent flag is not active, ensure fan remains off.
-    else if (!safetyVent) {
+    // If not in safety mode and safetyVent flag is not active, ensure fan remains off
+    // (or at the speed set by a remote fan override).
+    float idleFanSpeed = fanOverride >= 0.0f ? fanOverride : 0.0f;
+    float setpoint = getEffectiveSetpoint();
+    if (!safetyVent) {
         if (fan) {
-            fan->setFanSpeed(0.0f);
-            currentFanSpeed = 0.0f;
+            fan->setFanSpeed(idleFanSpeed);
+            currentFanSpeed = idleFanSpeed;
         }
-        printf("[Controller] *** CO₂ < 2000: fan at 0%%\n");
+        printf("[Controller] *** CO₂ < 2000: fan at %.0f%%\n", idleFanSpeed);
     }
 
     // If safety override was active and CO₂ falls back to or below the setpoint,
     // then clear the safety override and turn fan off.
-    if (safetyVent && currentCO2 <= co2Setpoint) {
+    if (safetyVent && currentCO2 <= setpoint) {
         if (fan) {
-            fan->setFanSpeed(0.0f);
-            currentFanSpeed = 0.0f;
+            fan->setFanSpeed(idleFanSpeed);
+            currentFanSpeed = idleFanSpeed;
         }
         safetyVent = false; // Clear safety override
     }
 
     // 3) Valve Control Logic:
     // Determine if additional CO₂ is needed based on the current CO₂ level compared to the setpoint.
-    bool needCO2 = (currentCO2 < co2Setpoint);
+    bool needCO2 = (currentCO2 < setpoint);
 
     if (needCO2) {
         // Before opening the valve, check if the 30-second cooldown period has elapsed since it was last closed.
@@ -147,7 +161,7 @@ void Controller::updateControl() {
             // Only open the valve if the cooldown period has been satisfied.
             if (elapsed >= pdMS_TO_TICKS(VALVE_COOLDOWN_MS)) {
                 valve->openValve();
-                printf("[Controller] Opening valve (CO₂=%.1f < set=%.1f)\n", currentCO2, co2Setpoint);
+                printf("[Controller] Opening valve (CO₂=%.1f < set=%.1f)\n", currentCO2, setpoint);
 
                 // Restart the one-shot timer to ensure the valve is closed automatically after 2 seconds.
                 xTimerStop(valveTimer, 0);
@@ -165,7 +179,7 @@ void Controller::updateControl() {
             valve->closeValve();
             // Update lastValveCloseTick to record the time of closing (for subsequent cooldown period).
             lastValveCloseTick = xTaskGetTickCount();
-            printf("[Controller] Valve closed early (CO₂=%.1f >= set=%.1f)\n", currentCO2, co2Setpoint);
+            printf("[Controller] Valve closed early (CO₂=%.1f >= set=%.1f)\n", currentCO2, setpoint);
             // Stop the valve timer since the valve has been closed.
             xTimerStop(valveTimer, 0);
         }
@@ -174,7 +188,7 @@ void Controller::updateControl() {
     // 4) Debug print: Print current sensor readings and actuator states for monitoring.
     printf("[Controller] CO₂=%.1f, set=%.1f, valve=%s, fan=%.1f, temp=%.1f, RH=%.1f\n",
            currentCO2,
-           co2Setpoint,
+           setpoint,
            (valve && valve->isOpen()) ? "OPEN" : "CLOSED",
            currentFanSpeed,
            currentTemp,
@@ -184,16 +198,67 @@ void Controller::updateControl() {
 /*
    setCO2Setpoint():
    This method updates the target CO₂ setpoint for the system both in the Controller instance 
-   and persistently in the EEPROM storage (if available) so that settings are retained across reboots.
+   and persistently (write-behind through the configuration cache, if available) so that settings are
+   retained across reboots.
 */
 void Controller::setCO2Setpoint(float setpoint) {
     co2Setpoint = setpoint;
-    if (eepromStorage) {
-        // Persist the new setpoint to EEPROM as a 16-bit value.
-        eepromStorage->storeCO2Setpoint(static_cast<uint16_t>(setpoint));
+    if (configCache) {
+        // Persist the new setpoint as a 16-bit value. The cache only marks it for writing;
+        // repeated changes within the debounce period end up as one EEPROM write.
+        configCache->set(ConfigKey::Co2Setpoint, static_cast<uint16_t>(setpoint));
+    }
+}
+
+/*
+   setSetpointSchedule():
+   Stores the schedule window; it is evaluated on every control update and persisted.
+*/
+void Controller::setSetpointSchedule(uint16_t startMinute, uint16_t endMinute, float setpoint) {
+    scheduleStart = startMinute;
+    scheduleEnd = endMinute;
+    scheduleSetpoint = setpoint;
+    if (startMinute == endMinute) {
+        printf("[Controller] Setpoint schedule removed\n");
+    } else {
+        printf("[Controller] Setpoint %.1f scheduled %02u:%02u-%02u:%02u UTC\n", setpoint,
+               startMinute / 60, startMinute % 60, endMinute / 60, endMinute % 60);
+    }
+    if (configCache) {
+        ConfigSchedule schedule{ startMinute, endMinute, static_cast<uint16_t>(setpoint) };
+        configCache->set(ConfigKey::SetpointSchedule, schedule);
+    }
+}
+
+/*
+   setFanOverride():
+   Applied on the next control update; the safety vent still takes precedence.
+*/
+void Controller::setFanOverride(float percent) {
+    fanOverride = percent;
+    if (percent < 0.0f) {
+        printf("[Controller] Fan returned to automatic control\n");
+    } else {
+        printf("[Controller] Fan override %.1f%%\n", percent);
     }
 }
 
+/*
+   getEffectiveSetpoint():
+   Returns the scheduled setpoint while the UTC time of day is inside the schedule window,
+   otherwise the stored setpoint.
+*/
+float Controller::getEffectiveSetpoint() const {
+    if (scheduleStart == scheduleEnd || !WallClock::isSynced()) {
+        return co2Setpoint;
+    }
+    auto minute = static_cast<uint16_t>((WallClock::nowUtcMs() / 60000) % (24 * 60));
+    bool inside = scheduleStart < scheduleEnd
+                  ? (minute >= scheduleStart && minute < scheduleEnd)
+                  : (minute >= scheduleStart || minute < scheduleEnd);   // Spans midnight.
+    return inside ? scheduleSetpoint : co2Setpoint;
+}
+
 /*
    getCO2Setpoint(), getCurrentCO2(), getCurrentTemp(), getCurrentRH(), getCurrentPressure(), getCurrentFanSpeed():
    These methods return the current target setpoint and most recent sensor readings or actuator statuses.
@@ -228,4 +293,30 @@ float Controller::getCurrentFanSpeed() const {
 */
 bool Controller::isValveOpen() const {
     return valve && valve->isOpen();
-}
\ No newline at end of file
+}
+
+/*
+   isSafetyVentActive():
+   Returns true while the high-CO₂ safety override is venting the greenhouse.
+*/
+bool Controller::isSafetyVentActive() const {
+    return safetyVent;
+}
+
+/*
+   getSnapshot():
+   Collects the current readings and actuator state into a single structure.
+*/
+ControllerSnapshot Controller::getSnapshot() const {
+    ControllerSnapshot snapshot;
+    snapshot.timestampMs = to_ms_since_boot(get_absolute_time());
+    snapshot.co2        = currentCO2;
+    snapshot.temp       = currentTemp;
+    snapshot.rh         = currentRH;
+    snapshot.pressure   = currentPressure;
+    snapshot.fanSpeed   = currentFanSpeed;
+    snapshot.setpoint   = getEffectiveSetpoint();
+    snapshot.valveOpen  = isValveOpen();
+    snapshot.safetyVent = safetyVent;
+    return snapshot;
+}
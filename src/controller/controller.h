@@ -2,6 +2,7 @@
 #define CONTROLLER_H
 
 #include <memory>
+#include <cstdint>
 #include "FreeRTOS.h"
 #include "timers.h"
 
@@ -15,21 +16,40 @@
    a FreeRTOS one-shot timer to automatically close the valve after a predetermined time.
 */
 
+/*
+   ControllerSnapshot:
+   A copy of the Controller's current readings and actuator state, taken at one instant.
+   Used by modules that publish the state (e.g. the status server) so that they work on
+   a consistent set of values instead of calling each getter separately.
+*/
+struct ControllerSnapshot {
+    uint32_t timestampMs = 0;  // Milliseconds since boot when the snapshot was taken.
+    float co2       = 0.0f;    // ppm
+    float temp      = 0.0f;    // °C
+    float rh        = 0.0f;    // %
+    float pressure  = 0.0f;    // Pa
+    float fanSpeed  = 0.0f;    // %
+    float setpoint  = 0.0f;    // ppm
+    bool valveOpen  = false;
+    bool safetyVent = false;
+};
+
 // Forward declarations of sensor and driver classes for interfacing with hardware.
 class CO2Sensor;
 class TempRHSensor;
 class PressureSensor;
 class FanDriver;
 class ValveDriver;
-class EEPROMStorage;
+class ConfigCache;
 
 class Controller {
 public:
     /*
        Constructor:
        Initializes the Controller with shared pointers to the sensor modules (CO₂, TempRH, Pressure)
-       and the actuator drivers (Fan, Valve) as well as EEPROM storage for persistence. It also loads 
-       the initial CO₂ setpoint from EEPROM if available, otherwise uses a default value. Additionally,
+       and the actuator drivers (Fan, Valve) as well as the configuration cache for persistence. It also
+       loads the CO₂ setpoint and the setpoint schedule from it if available, otherwise uses a
+       default setpoint. Additionally,
        it creates a one-shot FreeRTOS timer (valveTimer) to automatically close the valve after 2 seconds 
        of being open.
     */
@@ -38,7 +58,7 @@ public:
                std::shared_ptr<PressureSensor> pres,
                std::shared_ptr<FanDriver> fan,
                std::shared_ptr<ValveDriver> valve,
-               std::shared_ptr<EEPROMStorage> eeprom);
+               std::shared_ptr<ConfigCache> config);
 
     /*
        updateControl():
@@ -55,19 +75,41 @@ public:
 
     /*
        setCO2Setpoint():
-       Updates the target CO₂ setpoint and persists it in EEPROM so that the system remembers the setting
-       across power cycles.
+       Updates the target CO₂ setpoint and persists it so that the system remembers the setting across
+       power cycles. The value is only written to the configuration cache; eepromTask saves it to the
+       EEPROM later, so the caller never waits for the EEPROM.
     */
     void setCO2Setpoint(float setpoint);
 
+    /*
+       setSetpointSchedule():
+       Uses 'setpoint' instead of the stored setpoint between two times of day (minutes after
+       midnight UTC; the window may span midnight). The schedule only applies while the wall
+       clock is synchronized. startMinute == endMinute removes the schedule. The schedule is
+       persisted like the setpoint.
+    */
+    void setSetpointSchedule(uint16_t startMinute, uint16_t endMinute, float setpoint);
+
+    /*
+       setFanOverride():
+       Runs the fan at 'percent' instead of switching it off while the safety vent is not
+       active. A negative value returns the fan to automatic control.
+    */
+    void setFanOverride(float percent);
+
     // Getter methods to retrieve the current CO₂ setpoint and most recent sensor and actuator readings.
     float getCO2Setpoint() const;
+    float getEffectiveSetpoint() const;   // Setpoint in force now (schedule applied).
     float getCurrentCO2() const;
     float getCurrentTemp() const;
     float getCurrentRH() const;
     float getCurrentPressure() const;
     float getCurrentFanSpeed() const;
     bool  isValveOpen() const;
+    bool  isSafetyVentActive() const;
+
+    // Returns all of the above in one snapshot.
+    ControllerSnapshot getSnapshot() const;
 
 private:
     // --- Shared pointers to sensor and driver objects ---
@@ -76,7 +118,7 @@ private:
     std::shared_ptr<PressureSensor>  presSensor;     // Differential pressure sensor via I²C.
     std::shared_ptr<FanDriver>       fan;            // Fan driver that controls fan speed via Modbus.
     std::shared_ptr<ValveDriver>     valve;          // Valve driver for CO₂ valve control via GPIO.
-    std::shared_ptr<EEPROMStorage>   eepromStorage;  // EEPROM for persistent storage of parameters.
+    std::shared_ptr<ConfigCache>     configCache;    // Persistent settings (write-behind to the EEPROM).
 
     // --- Control setpoints and state variables ---
     float co2Setpoint;         // Target CO₂ concentration in ppm.
@@ -88,6 +130,12 @@ private:
 
     bool  safetyVent       = false; // Flag to indicate if safety override is active.
 
+    // --- Remote command state (see setSetpointSchedule() and setFanOverride()) ---
+    float    fanOverride       = -1.0f; // Fan speed outside the safety vent; negative = automatic.
+    uint16_t scheduleStart     = 0;     // Schedule window in minutes after midnight UTC;
+    uint16_t scheduleEnd       = 0;     // start == end means no schedule.
+    float    scheduleSetpoint  = 0.0f;
+
     // --- FreeRTOS timer for auto-closing the CO₂ valve ---
     TimerHandle_t valveTimer;  // One-shot timer that closes the valve after 2s.
     
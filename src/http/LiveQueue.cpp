@@ -0,0 +1,49 @@
+#include "LiveQueue.h"
+
+LiveQueue::LiveQueue() {
+    reset();
+}
+
+void LiveQueue::reset() {
+    head = 0;
+    count = 0;
+    samplePending = false;
+}
+
+bool LiveQueue::pushSample(const ControllerSnapshot& newSample) {
+    bool replaced = samplePending;
+    sample = newSample;
+    samplePending = true;
+    return !replaced;
+}
+
+bool LiveQueue::pushEvent(const LiveEvent& event) {
+    bool room = count < CAPACITY;
+    if (!room) {
+        // Full: drop the oldest event.
+        head = (head + 1) % CAPACITY;
+        count--;
+    }
+    events[(head + count) % CAPACITY] = event;
+    count++;
+    return room;
+}
+
+bool LiveQueue::popEvent(LiveEvent& event) {
+    if (count == 0) return false;
+    event = events[head];
+    head = (head + 1) % CAPACITY;
+    count--;
+    return true;
+}
+
+bool LiveQueue::popSample(ControllerSnapshot& out) {
+    if (!samplePending) return false;
+    out = sample;
+    samplePending = false;
+    return true;
+}
+
+bool LiveQueue::isEmpty() const {
+    return count == 0 && !samplePending;
+}
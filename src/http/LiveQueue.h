@@ -0,0 +1,56 @@
+#ifndef LIVE_QUEUE_H
+#define LIVE_QUEUE_H
+
+#include <cstdint>
+#include <cstddef>
+#include "Controller/Controller.h"
+
+/*
+   An actuator or state change pushed to live stream clients.
+*/
+struct LiveEvent {
+    enum class Kind : uint8_t { Valve, Fan, SafetyVent, Setpoint } kind;
+    uint32_t timestampMs;
+    float value;              // 1/0 for valve and safety vent, % for fan, ppm for setpoint.
+};
+
+/*
+   LiveQueue Class
+
+   The bounded send queue of one live stream client. It holds at most CAPACITY events and
+   a single sample:
+     - a new sample replaces a sample that has not been sent yet (coalescing), so a slow
+       client receives fewer but always the most recent readings;
+     - when the event ring is full the oldest event is dropped.
+   The queue therefore never grows, however slowly the client reads.
+
+   The class does no locking; the status server accesses it under its own mutex.
+*/
+class LiveQueue {
+public:
+    static constexpr size_t CAPACITY = 8;
+
+    LiveQueue();
+
+    // Empties the queue.
+    void reset();
+
+    // Returns false if an unsent sample was replaced.
+    bool pushSample(const ControllerSnapshot& sample);
+    // Returns false if the oldest event had to be dropped.
+    bool pushEvent(const LiveEvent& event);
+
+    // Events are returned before the sample.
+    bool popEvent(LiveEvent& event);
+    bool popSample(ControllerSnapshot& sample);
+    bool isEmpty() const;
+
+private:
+    LiveEvent events[CAPACITY];
+    size_t head;
+    size_t count;
+    ControllerSnapshot sample;
+    bool samplePending;
+};
+
+#endif // LIVE_QUEUE_H
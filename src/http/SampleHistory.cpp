@@ -0,0 +1,82 @@
+#include "SampleHistory.h"
+#include <mutex>
+#include <cstring>
+
+/*
+   SampleHistory Module
+
+   Ring buffer of one-minute rollups. Minutes without any snapshot are simply absent,
+   so each rollup carries its own start time.
+*/
+
+static constexpr uint32_t MS_PER_MINUTE = 60000;
+
+SampleHistory::SampleHistory()
+        : head(0)
+        , count(0)
+{
+    memset(buckets, 0, sizeof(buckets));
+}
+
+void SampleHistory::add(const ControllerSnapshot& snapshot) {
+    std::lock_guard<Fmutex> exclusive(access);
+    uint32_t minute = snapshot.timestampMs / MS_PER_MINUTE;
+
+    Bucket* bucket = count > 0 ? &buckets[(head + count - 1) % HISTORY_MINUTES] : nullptr;
+    if (!bucket || bucket->minute != minute) {
+        // Start a new minute, overwriting the oldest one when the ring is full.
+        if (count == HISTORY_MINUTES) {
+            head = (head + 1) % HISTORY_MINUTES;
+            count--;
+        }
+        bucket = &buckets[(head + count) % HISTORY_MINUTES];
+        count++;
+        bucket->minute  = minute;
+        bucket->samples = 0;
+        bucket->valveOpenings = 0;
+        bucket->co2Min  = bucket->co2Max  = snapshot.co2;
+        bucket->rhMin   = bucket->rhMax   = snapshot.rh;
+        bucket->tempMin = bucket->tempMax = snapshot.temp;
+        bucket->co2Sum = bucket->rhSum = bucket->tempSum = bucket->fanSum = 0.0f;
+    }
+
+    bucket->samples++;
+    if (snapshot.valveOpen) bucket->valveOpenings++;
+    if (snapshot.co2 < bucket->co2Min)   bucket->co2Min = snapshot.co2;
+    if (snapshot.co2 > bucket->co2Max)   bucket->co2Max = snapshot.co2;
+    if (snapshot.rh < bucket->rhMin)     bucket->rhMin = snapshot.rh;
+    if (snapshot.rh > bucket->rhMax)     bucket->rhMax = snapshot.rh;
+    if (snapshot.temp < bucket->tempMin) bucket->tempMin = snapshot.temp;
+    if (snapshot.temp > bucket->tempMax) bucket->tempMax = snapshot.temp;
+    bucket->co2Sum  += snapshot.co2;
+    bucket->rhSum   += snapshot.rh;
+    bucket->tempSum += snapshot.temp;
+    bucket->fanSum  += snapshot.fanSpeed;
+}
+
+size_t SampleHistory::size() const {
+    std::lock_guard<Fmutex> exclusive(access);
+    return count;
+}
+
+bool SampleHistory::getRollup(size_t index, SampleRollup& out) const {
+    std::lock_guard<Fmutex> exclusive(access);
+    if (index >= count) return false;
+    const Bucket& bucket = buckets[(head + index) % HISTORY_MINUTES];
+    float n = bucket.samples > 0 ? static_cast<float>(bucket.samples) : 1.0f;
+
+    out.startMs = bucket.minute * MS_PER_MINUTE;
+    out.samples = bucket.samples;
+    out.co2Min  = bucket.co2Min;
+    out.co2Avg  = bucket.co2Sum / n;
+    out.co2Max  = bucket.co2Max;
+    out.rhMin   = bucket.rhMin;
+    out.rhAvg   = bucket.rhSum / n;
+    out.rhMax   = bucket.rhMax;
+    out.tempMin = bucket.tempMin;
+    out.tempAvg = bucket.tempSum / n;
+    out.tempMax = bucket.tempMax;
+    out.fanAvg  = bucket.fanSum / n;
+    out.valveOpenings = bucket.valveOpenings;
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef SAMPLE_HISTORY_H
+#define SAMPLE_HISTORY_H
+
+#include <cstdint>
+#include <cstddef>
+#include "Fmutex.h"
+#include "Controller/Controller.h"
+
+/*
+   One minute of readings reduced to minimum, average and maximum.
+*/
+struct SampleRollup {
+    uint32_t startMs = 0;         // Milliseconds since boot at the start of the minute.
+    uint16_t samples = 0;         // Number of snapshots in the minute.
+    float co2Min  = 0.0f, co2Avg  = 0.0f, co2Max  = 0.0f;
+    float rhMin   = 0.0f, rhAvg   = 0.0f, rhMax   = 0.0f;
+    float tempMin = 0.0f, tempAvg = 0.0f, tempMax = 0.0f;
+    float fanAvg  = 0.0f;
+    uint16_t valveOpenings = 0;   // Snapshots in which the valve was open.
+};
+
+/*
+   SampleHistory Class
+
+   Keeps per-minute rollups of the Controller snapshots for the last HISTORY_MINUTES
+   minutes in a fixed ring buffer, so that the status server can report recent history
+   without storing the individual samples.
+
+   add() is called by sensorTask; getRollup() by the lwIP thread while a /history response
+   is rendered. Both hold the mutex only to update or copy one rollup.
+*/
+class SampleHistory {
+public:
+    static constexpr size_t HISTORY_MINUTES = 60;
+
+    SampleHistory();
+
+    SampleHistory(const SampleHistory&) = delete;
+
+    // Adds a snapshot to the rollup of its minute, starting a new minute when needed.
+    void add(const ControllerSnapshot& snapshot);
+
+    // Number of rollups available (including the minute in progress).
+    size_t size() const;
+
+    // Copies rollup 'index' (0 = oldest). Returns false if the index is out of range.
+    bool getRollup(size_t index, SampleRollup& out) const;
+
+private:
+    // Accumulated sums of the rollups; averages are computed when copied.
+    struct Bucket {
+        uint32_t minute;
+        uint16_t samples;
+        uint16_t valveOpenings;
+        float co2Min, co2Max, co2Sum;
+        float rhMin, rhMax, rhSum;
+        float tempMin, tempMax, tempSum;
+        float fanSum;
+    };
+
+    mutable Fmutex access;
+    Bucket buckets[HISTORY_MINUTES];
+    size_t head;      // Index of the oldest bucket.
+    size_t count;     // Number of buckets in use.
+};
+
+#endif // SAMPLE_HISTORY_H
@@ -0,0 +1,130 @@
+#include "SampleLogExport.h"
+#include <mutex>
+#include <utility>
+
+/*
+   SampleLogExport Module
+
+   A batch request is a state change plus a task notification. The task may be woken
+   without a request (a request that close() withdrew), so it always checks the state
+   before reading.
+*/
+
+SampleLogExport::SampleLogExport(std::shared_ptr<SampleLog> log)
+        : log(std::move(log))
+        , state(State::Idle)
+        , active(false)
+        , nextSeq(0)
+        , endSeq(0)
+        , count(0)
+        , end(false)
+        , task(nullptr)
+        , readyCallback(nullptr)
+        , readyArg(nullptr)
+{
+}
+
+void SampleLogExport::setReadyCallback(void (*callback)(void* arg), void* arg) {
+    readyCallback = callback;
+    readyArg = arg;
+}
+
+bool SampleLogExport::open() {
+    {
+        std::lock_guard<Fmutex> exclusive(access);
+        // A withdrawn batch that is still being read keeps the buffer busy as well.
+        if (active || state != State::Idle) {
+            return false;
+        }
+        active = true;
+        nextSeq = log->getOldestSeq();
+        endSeq = log->getNextSeq();
+        count = 0;
+        end = false;
+        state = State::Requested;
+    }
+    wake();
+    return true;
+}
+
+size_t SampleLogExport::peek(const LoggedSample*& samples, bool& last) const {
+    std::lock_guard<Fmutex> exclusive(access);
+    samples = batch;
+    last = false;
+    if (state != State::Ready) {
+        return 0;
+    }
+    last = end;
+    return count;
+}
+
+void SampleLogExport::consume() {
+    {
+        std::lock_guard<Fmutex> exclusive(access);
+        if (state != State::Ready || end) {
+            return;
+        }
+        state = State::Requested;
+    }
+    wake();
+}
+
+void SampleLogExport::close() {
+    std::lock_guard<Fmutex> exclusive(access);
+    active = false;
+    // A batch being read is dropped by the task when it is done.
+    if (state != State::Reading) {
+        state = State::Idle;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// run(): body of logExportTask.
+// ----------------------------------------------------------------------------
+void SampleLogExport::run() {
+    task = xTaskGetCurrentTaskHandle();
+    while (true) {
+        readBatch();
+        // Index 0 is taken by the EEPROM reads (PicoI2C).
+        ulTaskNotifyTakeIndexed(WAKEUP_NOTIFICATION_INDEX, pdTRUE, portMAX_DELAY);
+    }
+}
+
+void SampleLogExport::readBatch() {
+    uint32_t seq;
+    size_t max;
+    {
+        std::lock_guard<Fmutex> exclusive(access);
+        if (state != State::Requested) {
+            return;
+        }
+        state = State::Reading;
+        seq = nextSeq;
+        max = endSeq - seq < BATCH_SIZE ? endSeq - seq : BATCH_SIZE;
+    }
+
+    // 'batch' belongs to this task until the state is Ready.
+    size_t n = max ? log->read(seq, batch, max) : 0;
+
+    {
+        std::lock_guard<Fmutex> exclusive(access);
+        if (!active) {
+            state = State::Idle;
+            return;
+        }
+        count = n;
+        nextSeq = seq;
+        end = n == 0 || seq >= endSeq;
+        state = State::Ready;
+    }
+    if (readyCallback) {
+        readyCallback(readyArg);
+    }
+}
+
+void SampleLogExport::wake() {
+    TaskHandle_t handle = task;
+    if (handle) {
+        xTaskNotifyGiveIndexed(handle, WAKEUP_NOTIFICATION_INDEX);
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef SAMPLE_LOG_EXPORT_H
+#define SAMPLE_LOG_EXPORT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "Fmutex.h"
+#include "EEPROM/SampleLog.h"
+
+/*
+   SampleLogExport Class
+
+   Reads the SampleLog for the status server's /samples.csv export. The log lives on the
+   I²C EEPROM, and the status server runs in the lwIP thread, which must never wait for the
+   bus. The reads are therefore done by a task of their own (logExportTask): the lwIP thread
+   asks for the next batch, the task reads it into a buffer and reports that it is ready,
+   and the lwIP thread formats it from the buffer.
+
+   One export runs at a time; it covers the records that were in the log when it was
+   opened, oldest first. A batch is either owned by the task (requested, being read) or by
+   the lwIP thread (ready), and only the state changes are made under the mutex, so neither
+   side holds it while reading the EEPROM or formatting.
+
+   open(), peek(), consume() and close() are called from the lwIP thread, run() is the body
+   of logExportTask.
+*/
+class SampleLogExport {
+public:
+    static constexpr size_t BATCH_SIZE = 8;   // Records read per request.
+
+    explicit SampleLogExport(std::shared_ptr<SampleLog> log);
+
+    SampleLogExport(const SampleLogExport&) = delete;
+
+    // Called (from logExportTask) when a batch is ready. Set before the tasks start.
+    void setReadyCallback(void (*callback)(void* arg), void* arg);
+
+    // Starts an export of the whole log and requests its first batch. Returns false if an
+    // export is running already.
+    bool open();
+
+    // Points 'samples' at the batch that is ready. Returns the number of records, 0 while
+    // the batch is still being read. 'last' is set with the last batch of the export.
+    size_t peek(const LoggedSample*& samples, bool& last) const;
+
+    // Releases the batch returned by peek() and requests the next one.
+    void consume();
+
+    // Ends the export (also while a batch is being read).
+    void close();
+
+    // Serves the batch requests; never returns.
+    void run();
+
+private:
+    enum class State : uint8_t { Idle, Requested, Reading, Ready };
+
+    std::shared_ptr<SampleLog> log;
+    mutable Fmutex access;
+    State state;
+    bool active;                      // An export is open.
+    uint32_t nextSeq;                 // Next record to read.
+    uint32_t endSeq;                  // Log position when the export was opened.
+    LoggedSample batch[BATCH_SIZE];
+    size_t count;                     // Records in 'batch'.
+    bool end;                         // 'batch' is the last one.
+    volatile TaskHandle_t task;       // logExportTask, woken for every request.
+    void (*readyCallback)(void*);
+    void* readyArg;
+
+    // Reads the requested batch, if there is one.
+    void readBatch();
+
+    // Wakes logExportTask.
+    void wake();
+};
+
+#endif // SAMPLE_LOG_EXPORT_H
@@ -0,0 +1,1096 @@
+#include "StatusServer.h"
+#include "WebSocket.h"
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+#include <mutex>
+#include <utility>
+
+#include "pico/stdlib.h"
+#include "lwip/tcpip.h"
+#include "WallClock.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+// =============================================================================
+//                          StatusServer Implementation
+// =============================================================================
+
+/*
+   All connection data is only touched in the lwIP thread (the TCP callbacks), so it needs
+   no locking. The snapshot and the history are shared with sensorTask and are copied out
+   under their mutexes before rendering. The exceptions are the 'live' flag and the
+   LiveQueue of each connection, which sensorTask fills in publish(); they are accessed
+   under 'access'. publish() never calls lwIP directly; it queues onFlush() to the lwIP
+   thread with tcpip_try_callback(), and the poll callback retries if that fails. The
+   sample log export is handed over the same way (onLogReady()).
+*/
+
+// A connection that makes no progress for this many poll intervals (0.5 s each) is closed.
+static constexpr uint8_t POLL_INTERVAL = 1;
+static constexpr uint8_t MAX_IDLE_POLLS = 20;
+
+static constexpr const char* CONTENT_JSON = "application/json";
+static constexpr const char* CONTENT_TEXT = "text/plain; charset=utf-8";
+static constexpr const char* CONTENT_METRICS = "text/plain; version=0.0.4";
+static constexpr const char* CONTENT_CSV = "text/csv";
+
+static const MetricDescriptor liveClientsDescriptor = {
+    "greenhouse_live_clients", "Connected live stream (WebSocket) clients.", MetricType::Gauge };
+static const MetricDescriptor liveMessagesDescriptor = {
+    "greenhouse_live_messages_total", "Messages sent to live stream clients.", MetricType::Counter };
+static const MetricDescriptor liveDroppedDescriptor = {
+    "greenhouse_live_dropped_events_total", "Events dropped because a live client fell behind.", MetricType::Counter };
+static const MetricDescriptor liveCoalescedDescriptor = {
+    "greenhouse_live_coalesced_samples_total", "Samples replaced by a newer one before being sent.", MetricType::Counter };
+
+static const MetricDescriptor requestsDescriptor = {
+    "greenhouse_http_requests_total", "Requests answered by the status server.", MetricType::Counter };
+static const MetricDescriptor rejectedDescriptor = {
+    "greenhouse_http_rejected_total", "Status server connections refused because all were busy.", MetricType::Counter };
+
+// Live stream messages taken from the queue per rendering step; together with a sample
+// and a pong they always fit into the transmit buffer.
+static constexpr size_t LIVE_EVENTS_PER_STEP = 3;
+
+// snprintf() that returns the number of characters actually stored in 'out'.
+template<typename... Args>
+static size_t format(char* out, size_t size, const char* fmt, Args... args) {
+    if (size == 0) return 0;
+    int n = snprintf(out, size, fmt, args...);
+    if (n < 0) return 0;
+    return static_cast<size_t>(n) < size ? static_cast<size_t>(n) : size - 1;
+}
+
+// Appends a WebSocket text frame whose payload is formatted in place. Returns false (and
+// writes nothing) if the frame does not fit.
+template<typename... Args>
+static bool appendTextFrame(char* out, size_t size, size_t& length, const char* fmt, Args... args) {
+    if (size - length <= WebSocket::MAX_HEADER_SIZE) return false;
+    char* payload = out + length + WebSocket::MAX_HEADER_SIZE;
+    size_t room = size - length - WebSocket::MAX_HEADER_SIZE;
+    int n = snprintf(payload, room, fmt, args...);
+    if (n < 0 || static_cast<size_t>(n) >= room) return false;
+
+    uint8_t header[WebSocket::MAX_HEADER_SIZE];
+    size_t headerLength = WebSocket::frameHeader(WebSocket::Text, static_cast<size_t>(n), header);
+    memmove(out + length + headerLength, payload, static_cast<size_t>(n));
+    memcpy(out + length, header, headerLength);
+    length += headerLength + static_cast<size_t>(n);
+    return true;
+}
+
+// Appends a WebSocket control frame (payload of at most 125 bytes).
+static bool appendControlFrame(char* out, size_t size, size_t& length, uint8_t opcode,
+                               const uint8_t* payload, size_t payloadLength) {
+    uint8_t header[WebSocket::MAX_HEADER_SIZE];
+    size_t headerLength = WebSocket::frameHeader(opcode, payloadLength, header);
+    if (headerLength + payloadLength > size - length) return false;
+    memcpy(out + length, header, headerLength);
+    memcpy(out + length + headerLength, payload, payloadLength);
+    length += headerLength + payloadLength;
+    return true;
+}
+
+// UTC milliseconds of a boot timestamp as a JSON value ("null" until the clock is synced).
+static const char* utcJson(uint32_t bootMs, char* out, size_t size) {
+    uint64_t utcMs = WallClock::toUtcMs(bootMs);
+    if (utcMs == 0) return "null";
+    snprintf(out, size, "%llu", static_cast<unsigned long long>(utcMs));
+    return out;
+}
+
+// ISO 8601 UTC time of a boot timestamp for the rollup export (empty until synced).
+static const char* utcText(uint32_t bootMs, char* out, size_t size) {
+    uint64_t utcMs = WallClock::toUtcMs(bootMs);
+    if (utcMs == 0 || WallClock::formatIso8601(utcMs, out, size) == 0) out[0] = '\0';
+    return out;
+}
+
+static const char* eventName(LiveEvent::Kind kind) {
+    switch (kind) {
+        case LiveEvent::Kind::Valve:      return "valve";
+        case LiveEvent::Kind::Fan:        return "fan";
+        case LiveEvent::Kind::SafetyVent: return "safety_vent";
+        case LiveEvent::Kind::Setpoint:   return "setpoint";
+    }
+    return "unknown";
+}
+
+static size_t renderHeader(char* out, size_t size, const char* status, const char* contentType) {
+    return format(out, size,
+                  "HTTP/1.0 %s\r\n"
+                  "Content-Type: %s\r\n"
+                  "Cache-Control: no-store\r\n"
+                  "Connection: close\r\n"
+                  "\r\n",
+                  status, contentType);
+}
+
+// Room reserved in front of a chunk's data for its size line, up to "FFFF\r\n".
+static constexpr size_t CHUNK_SIZE_LINE = 6;
+
+/*
+    Completes a chunk whose 'length' bytes of data were written at out + CHUNK_SIZE_LINE:
+    the size line is moved in front of them and CRLF appended (the caller keeps room for
+    it). Returns the length of the chunk.
+*/
+static size_t frameChunk(char* out, size_t length) {
+    char sizeLine[CHUNK_SIZE_LINE + 1];
+    size_t sizeLength = format(sizeLine, sizeof(sizeLine), "%X\r\n", static_cast<unsigned>(length));
+    memmove(out + sizeLength, out + CHUNK_SIZE_LINE, length);
+    memcpy(out, sizeLine, sizeLength);
+    memcpy(out + sizeLength + length, "\r\n", 2);
+    return sizeLength + length + 2;
+}
+
+// Chunked transfer encoding requires an HTTP/1.1 response.
+static size_t renderChunkedHeader(char* out, size_t size, const char* contentType, const char* filename) {
+    return format(out, size,
+                  "HTTP/1.1 200 OK\r\n"
+                  "Content-Type: %s\r\n"
+                  "Content-Disposition: attachment; filename=\"%s\"\r\n"
+                  "Transfer-Encoding: chunked\r\n"
+                  "Cache-Control: no-store\r\n"
+                  "Connection: close\r\n"
+                  "\r\n",
+                  contentType, filename);
+}
+
+// ----------------------------------------------------------------------------
+// Constructor / Destructor
+// ----------------------------------------------------------------------------
+StatusServer::StatusServer(uint16_t port)
+        : port_(port)
+        , listener_(nullptr)
+        , haveSnapshot_(false)
+        , flushScheduled_(false)
+{
+    requestsMetric_      = g_metrics.add(requestsDescriptor);
+    rejectedMetric_      = g_metrics.add(rejectedDescriptor);
+    liveClientsMetric_   = g_metrics.add(liveClientsDescriptor);
+    liveMessagesMetric_  = g_metrics.add(liveMessagesDescriptor);
+    liveDroppedMetric_   = g_metrics.add(liveDroppedDescriptor);
+    liveCoalescedMetric_ = g_metrics.add(liveCoalescedDescriptor);
+    for (auto& conn : connections_) {
+        conn = Connection();
+        conn.owner = this;
+    }
+}
+
+StatusServer::~StatusServer() {
+    for (auto& conn : connections_) {
+        if (conn.inUse && conn.pcb) {
+            tcp_arg(conn.pcb, nullptr);
+            tcp_abort(conn.pcb);
+        }
+    }
+    if (listener_) {
+        tcp_close(listener_);
+    }
+}
+
+void StatusServer::setCommandQueue(std::shared_ptr<CommandQueue> commands) {
+    commands_ = std::move(commands);
+}
+
+void StatusServer::setSampleLogExport(std::shared_ptr<SampleLogExport> logExport) {
+    logExport_ = std::move(logExport);
+    if (logExport_) {
+        logExport_->setReadyCallback(onLogReady, this);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// start()
+// ----------------------------------------------------------------------------
+bool StatusServer::start() {
+    struct tcp_pcb* pcb = tcp_new_ip_type(IPADDR_TYPE_ANY);
+    if (!pcb) {
+        printf("[StatusServer] Error creating PCB.\n");
+        return false;
+    }
+    if (tcp_bind(pcb, IP_ANY_TYPE, port_) != ERR_OK) {
+        printf("[StatusServer] Failed to bind to port %u\n", port_);
+        tcp_close(pcb);
+        return false;
+    }
+    listener_ = tcp_listen_with_backlog(pcb, MAX_CONNECTIONS);
+    if (!listener_) {
+        printf("[StatusServer] Failed to listen on port %u\n", port_);
+        tcp_close(pcb);
+        return false;
+    }
+    tcp_arg(listener_, this);
+    tcp_accept(listener_, onAccept);
+    printf("[StatusServer] Listening on port %u\n", port_);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Snapshot
+// ----------------------------------------------------------------------------
+/*
+    State changes are derived from consecutive snapshots. sensorTask publishes every
+    500 ms, so even the short valve pulses show up as an open and a close event.
+*/
+static size_t detectEvents(const ControllerSnapshot& previous, const ControllerSnapshot& current,
+                           LiveEvent* events) {
+    size_t count = 0;
+    uint32_t t = current.timestampMs;
+    if (current.valveOpen != previous.valveOpen) {
+        events[count++] = LiveEvent{LiveEvent::Kind::Valve, t, current.valveOpen ? 1.0f : 0.0f};
+    }
+    if (current.fanSpeed != previous.fanSpeed) {
+        events[count++] = LiveEvent{LiveEvent::Kind::Fan, t, current.fanSpeed};
+    }
+    if (current.safetyVent != previous.safetyVent) {
+        events[count++] = LiveEvent{LiveEvent::Kind::SafetyVent, t, current.safetyVent ? 1.0f : 0.0f};
+    }
+    if (current.setpoint != previous.setpoint) {
+        events[count++] = LiveEvent{LiveEvent::Kind::Setpoint, t, current.setpoint};
+    }
+    return count;
+}
+
+void StatusServer::publish(const ControllerSnapshot& snapshot) {
+    LiveEvent events[4];
+    uint32_t dropped = 0;
+    uint32_t coalesced = 0;
+    bool scheduleFlush = false;
+    {
+        std::lock_guard<Fmutex> exclusive(access);
+        size_t eventCount = haveSnapshot_ ? detectEvents(snapshot_, snapshot, events) : 0;
+        snapshot_ = snapshot;
+        haveSnapshot_ = true;
+
+        bool anyLive = false;
+        for (auto& conn : connections_) {
+            if (!conn.live) continue;
+            anyLive = true;
+            for (size_t i = 0; i < eventCount; i++) {
+                if (!conn.queue.pushEvent(events[i])) dropped++;
+            }
+            if (!conn.queue.pushSample(snapshot)) coalesced++;
+        }
+        if (anyLive && !flushScheduled_) {
+            flushScheduled_ = true;
+            scheduleFlush = true;
+        }
+    }
+    history_.add(snapshot);
+
+    if (dropped)   g_metrics.inc(liveDroppedMetric_, dropped);
+    if (coalesced) g_metrics.inc(liveCoalescedMetric_, coalesced);
+    if (scheduleFlush && tcpip_try_callback(onFlush, this) != ERR_OK) {
+        // The lwIP message box is full; the poll callback sends the data instead.
+        std::lock_guard<Fmutex> exclusive(access);
+        flushScheduled_ = false;
+    }
+}
+
+size_t StatusServer::liveClientCount() const {
+    size_t count = 0;
+    for (const auto& conn : connections_) {
+        if (conn.live) count++;
+    }
+    return count;
+}
+
+bool StatusServer::getSnapshot(ControllerSnapshot& out) const {
+    std::lock_guard<Fmutex> exclusive(access);
+    out = snapshot_;
+    return haveSnapshot_;
+}
+
+uint32_t StatusServer::getRequestCount() const {
+    return g_metrics.getCounter(requestsMetric_);
+}
+
+uint32_t StatusServer::getRejectedCount() const {
+    return g_metrics.getCounter(rejectedMetric_);
+}
+
+// ----------------------------------------------------------------------------
+// Request parsing
+// ----------------------------------------------------------------------------
+/*
+    Only the request line ("GET /status HTTP/1.1") selects the route. A query string after
+    the path is accepted and ignored, except for POST /command, where it holds the commands.
+*/
+StatusServer::Route StatusServer::parseRequest(const char* line) const {
+    bool post = strncmp(line, "POST ", 5) == 0;
+    if (!post && strncmp(line, "GET ", 4) != 0) {
+        return Route::BadMethod;
+    }
+    const char* path = line + (post ? 5 : 4);
+    size_t length = strcspn(path, " ?\r\n");
+
+    auto matches = [path, length](const char* name) {
+        return strlen(name) == length && strncmp(path, name, length) == 0;
+    };
+
+    if (matches("/command")) {
+        if (!post) return Route::BadMethod;
+        return commands_ ? Route::Command : Route::Unavailable;
+    }
+    if (post) return Route::BadMethod;
+
+    Route route;
+    if (matches("/") || matches("/status"))  route = Route::Status;
+    else if (matches("/history"))            route = Route::History;
+    else if (matches("/rollups.csv"))        route = Route::RollupCsv;
+    else if (matches("/samples.csv"))        return logExport_ ? Route::LogCsv : Route::NotFound;
+    else if (matches("/metrics"))            route = Route::Metrics;
+    else if (matches("/live"))               return Route::Live;
+    else                                     return Route::NotFound;
+
+    // Nothing to show before the first control cycle.
+    ControllerSnapshot snapshot;
+    if (route != Route::Metrics && !getSnapshot(snapshot)) {
+        return Route::Unavailable;
+    }
+    return route;
+}
+
+/*
+    The request is processed one line at a time, so it needs no buffer for the complete
+    header block. Lines longer than the line buffer are truncated; only the request line,
+    the two WebSocket headers and the Authorization header of POST /command are of
+    interest and they are short (a truncated Authorization header is rejected).
+*/
+bool StatusServer::receiveRequest(Connection& conn, struct pbuf* p) {
+    for (struct pbuf* q = p; q != nullptr; q = q->next) {
+        const char* data = static_cast<const char*>(q->payload);
+        for (u16_t i = 0; i < q->len; i++) {
+            char c = data[i];
+            if (c == '\n') {
+                if (conn.lineLength > 0 && conn.line[conn.lineLength - 1] == '\r') conn.lineLength--;
+                conn.line[conn.lineLength] = '\0';
+                bool endOfHeaders = conn.haveRequestLine && conn.lineLength == 0;
+                processHeaderLine(conn);
+                conn.lineLength = 0;
+                conn.lineOverflow = false;
+                if (endOfHeaders) return true;
+            } else if (conn.lineLength < sizeof(conn.line) - 1) {
+                conn.line[conn.lineLength++] = c;
+            } else {
+                conn.lineOverflow = true;
+            }
+        }
+    }
+    return false;
+}
+
+void StatusServer::processHeaderLine(Connection& conn) {
+    const char* line = conn.line;
+    if (!conn.haveRequestLine) {
+        conn.route = parseRequest(line);
+        conn.haveRequestLine = true;
+        // A cut-off request line could hold a cut-off command; it is answered with
+        // 400 and nothing queued.
+        if (conn.route == Route::Command && !conn.lineOverflow) {
+            storeQuery(conn, line);
+        }
+        return;
+    }
+    if ((conn.route != Route::Live && conn.route != Route::Command) || line[0] == '\0') return;
+
+    const char* colon = strchr(line, ':');
+    if (!colon) return;
+    const char* value = colon + 1;
+    while (*value == ' ') value++;
+    size_t nameLength = static_cast<size_t>(colon - line);
+
+    if (conn.route == Route::Command) {
+        if (nameLength == 13 && strncasecmp(line, "Authorization", 13) == 0 && !conn.lineOverflow) {
+            conn.authorized = checkToken(value);
+        }
+        return;
+    }
+
+    if (nameLength == 17 && strncasecmp(line, "Sec-WebSocket-Key", 17) == 0 && !conn.lineOverflow) {
+        strncpy(conn.wsKey, value, sizeof(conn.wsKey) - 1);
+        conn.wsKey[sizeof(conn.wsKey) - 1] = '\0';
+    } else if (nameLength == 7 && strncasecmp(line, "Upgrade", 7) == 0) {
+        conn.upgrade = strncasecmp(value, "websocket", 9) == 0;
+    }
+}
+
+void StatusServer::storeQuery(Connection& conn, const char* line) {
+    const char* query = strchr(line, '?');
+    if (!query) return;
+    query++;
+    size_t length = strcspn(query, " ");
+    memcpy(conn.query, query, length);
+    conn.query[length] = '\0';
+}
+
+/*
+    Compares the whole token even after a mismatch, so the response time does not tell
+    how much of a guessed token was right.
+*/
+bool StatusServer::checkToken(const char* value) {
+#ifdef STATUS_SERVER_COMMAND_TOKEN
+    static constexpr const char* SCHEME = "Bearer ";
+    static constexpr size_t SCHEME_LENGTH = 7;
+    if (strncasecmp(value, SCHEME, SCHEME_LENGTH) != 0) return false;
+    value += SCHEME_LENGTH;
+
+    const char* token = STATUS_SERVER_COMMAND_TOKEN;
+    size_t length = strlen(token);
+    if (length == 0 || strlen(value) != length) return false;
+    uint8_t difference = 0;
+    for (size_t i = 0; i < length; i++) {
+        difference |= static_cast<uint8_t>(value[i] ^ token[i]);
+    }
+    return difference == 0;
+#else
+    return false;
+#endif
+}
+
+/*
+    The commands are validated and queued at once; the controller task executes them
+    within one control cycle and the acks travel back with the next upload, so the
+    response only reports how many were accepted.
+*/
+void StatusServer::submitCommands(Connection& conn) {
+    conn.commandsQueued = 0;
+    conn.commandsRejected = 0;
+    if (conn.query[0] == '\0') return;
+
+    size_t rejected = 0;
+    size_t queued = commands_->submitText(conn.query, CommandSource::Local, &rejected);
+    conn.commandsQueued = static_cast<uint8_t>(queued);
+    conn.commandsRejected = static_cast<uint8_t>(rejected);
+}
+
+// ----------------------------------------------------------------------------
+// Rendering
+// ----------------------------------------------------------------------------
+/*
+    Each call renders one part of the response: the header, then either the complete body
+    (/status, error responses) or one element at a time (/history rollups, /metrics lines
+    that fit into the buffer).
+    lastStep is set with the final part.
+*/
+void StatusServer::renderStep(Connection& conn) {
+    char* out = conn.tx;
+    size_t size = sizeof(conn.tx);
+    size_t length = 0;
+    uint16_t step = conn.step++;
+
+    switch (conn.route) {
+        case Route::Status:
+            if (step == 0) {
+                length = renderHeader(out, size, "200 OK", CONTENT_JSON);
+            } else {
+                length = renderStatus(out, size);
+                conn.lastStep = true;
+            }
+            break;
+
+        case Route::History:
+            if (step == 0) {
+                length = renderHeader(out, size, "200 OK", CONTENT_JSON);
+                length += format(out + length, size - length,
+                                 "{\"uptime_ms\":%lu,\"interval_s\":60,\"minutes\":[",
+                                 static_cast<unsigned long>(to_ms_since_boot(get_absolute_time())));
+            } else {
+                bool found = false;
+                length = renderRollup(step - 1, out, size, found);
+                if (!found) {
+                    length = format(out, size, "]}\n");
+                    conn.lastStep = true;
+                }
+            }
+            break;
+
+        case Route::RollupCsv:
+            if (step == 0) {
+                length = renderChunkedHeader(out, size, CONTENT_CSV, "greenhouse-rollups.csv");
+            } else {
+                length = renderRollupChunk(conn, out, size);
+                if (length == 0) {
+                    // Last chunk: zero length, no trailers.
+                    length = format(out, size, "0\r\n\r\n");
+                    conn.lastStep = true;
+                }
+            }
+            break;
+
+        case Route::LogCsv:
+            if (step == 0) {
+                length = renderChunkedHeader(out, size, CONTENT_CSV, "greenhouse-samples.csv");
+                size_t header = format(out + length + CHUNK_SIZE_LINE, size - length - CHUNK_SIZE_LINE - 2,
+                                       "seq,uptime_ms,utc,current_boot,co2,rh,temp,fan,setpoint,flags\r\n");
+                length += frameChunk(out + length, header);
+            } else {
+                // Zero length: the next batch is still being read from the EEPROM.
+                bool done = false;
+                length = renderLogChunk(conn, out, size, done);
+                if (done) {
+                    length += format(out + length, size - length, "0\r\n\r\n");
+                    conn.lastStep = true;
+                }
+            }
+            break;
+
+        case Route::Live:
+            if (step == 0) {
+                length = renderLiveHandshake(conn, out, size);
+            } else {
+                // Zero length: nothing queued, wait for the next publish().
+                length = renderLiveFrames(conn, out, size);
+            }
+            break;
+
+        case Route::Metrics:
+            if (step == 0) {
+                length = renderHeader(out, size, "200 OK", CONTENT_METRICS);
+            } else {
+                length = g_metrics.render(conn.metrics, out, size);
+                if (length == 0) conn.lastStep = true;
+            }
+            break;
+
+        case Route::Command:
+            length = renderHeader(out, size, conn.commandsQueued ? "202 Accepted" : "400 Bad Request",
+                                  CONTENT_JSON);
+            length += format(out + length, size - length, "{\"queued\":%u,\"rejected\":%u}\n",
+                             conn.commandsQueued, conn.commandsRejected);
+            conn.lastStep = true;
+            break;
+
+        case Route::NotFound:
+            length = renderHeader(out, size, "404 Not Found", CONTENT_TEXT);
+            length += format(out + length, size - length,
+                             "Not found. Try /status, /history, /rollups.csv, /samples.csv, /metrics or /live\n");
+            conn.lastStep = true;
+            break;
+
+        case Route::BadMethod:
+            length = renderHeader(out, size, "405 Method Not Allowed", CONTENT_TEXT);
+            length += format(out + length, size - length, "Only GET is supported (and POST /command)\n");
+            conn.lastStep = true;
+            break;
+
+        case Route::BadRequest:
+            length = renderHeader(out, size, "400 Bad Request", CONTENT_TEXT);
+            length += format(out + length, size - length, "Expected a WebSocket upgrade request\n");
+            conn.lastStep = true;
+            break;
+
+        case Route::Unavailable:
+            length = renderHeader(out, size, "503 Service Unavailable", CONTENT_TEXT);
+            length += format(out + length, size - length, "No readings yet\n");
+            conn.lastStep = true;
+            break;
+
+        case Route::Busy:
+            length = renderHeader(out, size, "503 Service Unavailable", CONTENT_TEXT);
+            length += format(out + length, size - length, "Too many live stream clients\n");
+            conn.lastStep = true;
+            break;
+
+        case Route::Forbidden:
+            length = renderHeader(out, size, "403 Forbidden", CONTENT_TEXT);
+#ifdef STATUS_SERVER_COMMAND_TOKEN
+            length += format(out + length, size - length, "POST /command needs \"Authorization: Bearer <token>\"\n");
+#else
+            length += format(out + length, size - length, "POST /command is disabled (no STATUS_SERVER_COMMAND_TOKEN)\n");
+#endif
+            conn.lastStep = true;
+            break;
+
+        case Route::ExportBusy:
+            length = renderHeader(out, size, "503 Service Unavailable", CONTENT_TEXT);
+            length += format(out + length, size - length, "Another sample log export is running\n");
+            conn.lastStep = true;
+            break;
+    }
+
+    conn.txLength = length;
+    conn.txSent = 0;
+}
+
+size_t StatusServer::renderStatus(char* out, size_t size) const {
+    ControllerSnapshot s;
+    getSnapshot(s);
+    char utc[24];
+    return format(out, size,
+                  "{\"timestamp_ms\":%lu,\"utc_ms\":%s,\"co2_ppm\":%.0f,\"rh_pct\":%.1f,\"temp_c\":%.1f,"
+                  "\"pressure_pa\":%.0f,\"fan_pct\":%.1f,\"setpoint_ppm\":%.0f,"
+                  "\"valve_open\":%s,\"safety_vent\":%s}\n",
+                  static_cast<unsigned long>(s.timestampMs), utcJson(s.timestampMs, utc, sizeof(utc)),
+                  s.co2, s.rh, s.temp, s.pressure, s.fanSpeed, s.setpoint,
+                  s.valveOpen ? "true" : "false", s.safetyVent ? "true" : "false");
+}
+
+/*
+    Rollups are copied one at a time. If a new minute starts while the response is being
+    sent, the ring moves by one and a rollup may be skipped or repeated; the start times
+    in the output show this.
+*/
+size_t StatusServer::renderRollup(size_t index, char* out, size_t size, bool& found) const {
+    SampleRollup r;
+    found = history_.getRollup(index, r);
+    if (!found) return 0;
+    char utc[24];
+    return format(out, size,
+                  "%s{\"start_ms\":%lu,\"start_utc_ms\":%s,\"samples\":%u,"
+                  "\"co2\":[%.0f,%.0f,%.0f],\"rh\":[%.1f,%.1f,%.1f],\"temp\":[%.1f,%.1f,%.1f],"
+                  "\"fan_avg\":%.1f,\"valve_open\":%u}",
+                  index > 0 ? ",\n" : "\n",
+                  static_cast<unsigned long>(r.startMs), utcJson(r.startMs, utc, sizeof(utc)), r.samples,
+                  r.co2Min, r.co2Avg, r.co2Max, r.rhMin, r.rhAvg, r.rhMax,
+                  r.tempMin, r.tempAvg, r.tempMax, r.fanAvg, r.valveOpenings);
+}
+
+/*
+    Renders one chunk of the rollup export: as many complete rows as fit into the buffer,
+    preceded by the chunk size line and followed by CRLF. The rows are written after room
+    reserved for the size line, which is then moved in front of them. Returns 0 when all
+    rows have been sent.
+*/
+size_t StatusServer::renderRollupChunk(Connection& conn, char* out, size_t size) const {
+    char* body = out + CHUNK_SIZE_LINE;
+    size_t room = size - CHUNK_SIZE_LINE - 2;     // Keep space for the trailing CRLF.
+    size_t length = 0;
+
+    if (conn.row == 0) {
+        length = format(body, room,
+                        "start_ms,start_utc,samples,co2_min,co2_avg,co2_max,rh_min,rh_avg,rh_max,"
+                        "temp_min,temp_avg,temp_max,fan_avg,valve_open\r\n");
+    }
+
+    SampleRollup r;
+    char utc[24];
+    while (history_.getRollup(conn.row, r)) {
+        int n = snprintf(body + length, room - length,
+                         "%lu,%s,%u,%.0f,%.0f,%.0f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%u\r\n",
+                         static_cast<unsigned long>(r.startMs), utcText(r.startMs, utc, sizeof(utc)), r.samples,
+                         r.co2Min, r.co2Avg, r.co2Max, r.rhMin, r.rhAvg, r.rhMax,
+                         r.tempMin, r.tempAvg, r.tempMax, r.fanAvg, r.valveOpenings);
+        if (n < 0 || static_cast<size_t>(n) >= room - length) break;   // Next chunk.
+        length += static_cast<size_t>(n);
+        conn.row++;
+    }
+    if (length == 0) return 0;
+    return frameChunk(out, length);
+}
+
+/*
+    Renders one chunk of the sample log export from the batches that logExportTask has
+    read: the rows of the current batch that fit, then those of the next batch if it is
+    ready already. Returns 0 when no row could be written, i.e. the next batch is still
+    being read (onLogFlush() continues the response) or the export is complete; 'done' is
+    set once every row has been rendered, with room left for the last chunk.
+*/
+size_t StatusServer::renderLogChunk(Connection& conn, char* out, size_t size, bool& done) const {
+    static constexpr size_t LAST_CHUNK = 5;       // "0\r\n\r\n".
+    char* body = out + CHUNK_SIZE_LINE;
+    size_t room = size - CHUNK_SIZE_LINE - 2 - LAST_CHUNK;
+    size_t length = 0;
+
+    const LoggedSample* samples = nullptr;
+    bool last = false;
+    size_t count = logExport_->peek(samples, last);
+    char utc[24];
+    while (true) {
+        if (conn.row < count) {
+            const LoggedSample& s = samples[conn.row];
+            const TelemetryRecord& r = s.record;
+            if (s.utcMs == 0 || WallClock::formatIso8601(s.utcMs, utc, sizeof(utc)) == 0) utc[0] = '\0';
+            int n = snprintf(body + length, room - length,
+                             "%lu,%lu,%s,%d,%.1f,%.1f,%.1f,%.1f,%.0f,%u\r\n",
+                             static_cast<unsigned long>(s.seq), static_cast<unsigned long>(r.timestampMs),
+                             utc, s.currentBoot ? 1 : 0, r.co2, r.rh, r.temp, r.fanSpeed, r.setpoint,
+                             static_cast<unsigned>(r.flags));
+            if (n < 0 || static_cast<size_t>(n) >= room - length) break;   // Next chunk.
+            length += static_cast<size_t>(n);
+            conn.row++;
+            continue;
+        }
+        if (last) {
+            done = true;
+            break;
+        }
+        if (count == 0) break;                    // Waiting for logExportTask.
+        logExport_->consume();
+        conn.row = 0;
+        count = logExport_->peek(samples, last);
+    }
+    if (length == 0) return 0;
+    return frameChunk(out, length);
+}
+
+// ----------------------------------------------------------------------------
+// Live stream
+// ----------------------------------------------------------------------------
+/*
+    After the handshake the connection is switched to live mode and starts with the
+    current snapshot, so that a new client does not wait for the next change.
+*/
+size_t StatusServer::renderLiveHandshake(Connection& conn, char* out, size_t size) {
+    char accept[WebSocket::ACCEPT_SIZE];
+    if (!WebSocket::acceptKey(conn.wsKey, accept, sizeof(accept))) {
+        conn.lastStep = true;
+        return renderHeader(out, size, "500 Internal Server Error", CONTENT_TEXT);
+    }
+    size_t length = format(out, size,
+                           "HTTP/1.1 101 Switching Protocols\r\n"
+                           "Upgrade: websocket\r\n"
+                           "Connection: Upgrade\r\n"
+                           "Sec-WebSocket-Accept: %s\r\n"
+                           "\r\n",
+                           accept);
+    size_t clients;
+    {
+        std::lock_guard<Fmutex> exclusive(access);
+        conn.queue.reset();
+        if (haveSnapshot_) conn.queue.pushSample(snapshot_);
+        conn.live = true;
+        clients = liveClientCount();
+    }
+    g_metrics.set(liveClientsMetric_, static_cast<float>(clients));
+    printf("[StatusServer] Live stream client connected (%u active)\n", static_cast<unsigned>(clients));
+    return length;
+}
+
+/*
+    Queued messages are taken out under the mutex and formatted afterwards, so sensorTask
+    never waits for the formatting. Events go first, then the (coalesced) sample. Returns 0
+    when nothing is queued.
+*/
+size_t StatusServer::renderLiveFrames(Connection& conn, char* out, size_t size) {
+    size_t length = 0;
+    if (conn.pongPending) {
+        appendControlFrame(out, size, length, WebSocket::Pong, conn.pong, conn.pongLength);
+        conn.pongPending = false;
+    }
+    if (conn.closing) {
+        static const uint8_t normalClosure[2] = { 0x03, 0xE8 };     // Status 1000
+        appendControlFrame(out, size, length, WebSocket::Close, normalClosure, sizeof(normalClosure));
+        conn.lastStep = true;
+        return length;
+    }
+
+    LiveEvent events[LIVE_EVENTS_PER_STEP];
+    size_t eventCount = 0;
+    ControllerSnapshot sample;
+    bool haveSample = false;
+    {
+        std::lock_guard<Fmutex> exclusive(access);
+        while (eventCount < LIVE_EVENTS_PER_STEP && conn.queue.popEvent(events[eventCount])) {
+            eventCount++;
+        }
+        if (eventCount < LIVE_EVENTS_PER_STEP) {
+            haveSample = conn.queue.popSample(sample);
+        }
+    }
+
+    uint32_t messages = 0;
+    char utc[24];
+    for (size_t i = 0; i < eventCount; i++) {
+        if (appendTextFrame(out, size, length,
+                            "{\"type\":\"event\",\"t\":%lu,\"utc_ms\":%s,\"event\":\"%s\",\"value\":%.1f}",
+                            static_cast<unsigned long>(events[i].timestampMs),
+                            utcJson(events[i].timestampMs, utc, sizeof(utc)), eventName(events[i].kind),
+                            events[i].value)) {
+            messages++;
+        }
+    }
+    if (haveSample &&
+        appendTextFrame(out, size, length,
+                        "{\"type\":\"sample\",\"t\":%lu,\"utc_ms\":%s,\"co2\":%.0f,\"rh\":%.1f,\"temp\":%.1f,"
+                        "\"pressure\":%.0f,\"fan\":%.1f,\"setpoint\":%.0f,\"valve\":%d,\"vent\":%d}",
+                        static_cast<unsigned long>(sample.timestampMs),
+                        utcJson(sample.timestampMs, utc, sizeof(utc)), sample.co2, sample.rh, sample.temp,
+                        sample.pressure, sample.fanSpeed, sample.setpoint,
+                        sample.valveOpen ? 1 : 0, sample.safetyVent ? 1 : 0)) {
+        messages++;
+    }
+    if (messages) g_metrics.inc(liveMessagesMetric_, messages);
+    return length;
+}
+
+/*
+    The stream is one-way: data frames from the client are ignored, a ping is answered
+    with a pong and a close frame (or a malformed or oversized frame) ends the stream.
+*/
+void StatusServer::receiveFrames(Connection& conn, struct pbuf* p) {
+    if (p->tot_len > sizeof(conn.rx) - conn.rxLength) {
+        conn.closing = true;
+        return;
+    }
+    pbuf_copy_partial(p, conn.rx + conn.rxLength, p->tot_len, 0);
+    conn.rxLength += p->tot_len;
+
+    while (!conn.closing) {
+        WebSocket::Frame frame;
+        int used = WebSocket::parseFrame(conn.rx, conn.rxLength, sizeof(conn.rx), frame);
+        if (used == 0) break;
+        if (used < 0) {
+            conn.closing = true;
+            break;
+        }
+        if (frame.opcode == WebSocket::Close) {
+            conn.closing = true;
+        } else if (frame.opcode == WebSocket::Ping) {
+            memcpy(conn.pong, frame.payload, frame.length);
+            conn.pongLength = frame.length;
+            conn.pongPending = true;
+        }
+        conn.rxLength -= static_cast<size_t>(used);
+        memmove(conn.rx, conn.rx + used, conn.rxLength);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Transmission
+// ----------------------------------------------------------------------------
+/*
+    tcp_write() copies the data into pbufs, so the transmit buffer can be reused for the
+    next step as soon as it has been written completely. When the send buffer or the
+    segment queue is full, sending resumes from onSent() or onPoll().
+*/
+err_t StatusServer::send(Connection& conn) {
+    while (true) {
+        if (conn.txSent == conn.txLength) {
+            if (conn.lastStep) {
+                // Everything is queued; lwIP sends the rest before the FIN.
+                g_metrics.inc(requestsMetric_);
+                return closeConnection(conn);
+            }
+            // Live stream: keep at most LIVE_MAX_IN_FLIGHT bytes queued in lwIP; meanwhile
+            // newer data coalesces in the client's LiveQueue.
+            if (conn.live && static_cast<size_t>(TCP_SND_BUF - tcp_sndbuf(conn.pcb)) >= LIVE_MAX_IN_FLIGHT) break;
+            renderStep(conn);
+            if (conn.txLength == 0 && !conn.lastStep) break;
+            continue;
+        }
+
+        u16_t space = tcp_sndbuf(conn.pcb);
+        if (space == 0 || tcp_sndqueuelen(conn.pcb) >= TCP_SND_QUEUELEN) break;
+
+        size_t remaining = conn.txLength - conn.txSent;
+        u16_t length = remaining < space ? static_cast<u16_t>(remaining) : space;
+        u8_t flags = TCP_WRITE_FLAG_COPY;
+        if (length < remaining || (!conn.lastStep && !conn.live)) flags |= TCP_WRITE_FLAG_MORE;
+
+        err_t err = tcp_write(conn.pcb, conn.tx + conn.txSent, length, flags);
+        if (err == ERR_MEM) break;
+        if (err != ERR_OK) {
+            printf("[StatusServer] Write failed: %d\n", err);
+            tcp_abort(conn.pcb);
+            releaseConnection(conn);
+            return ERR_ABRT;
+        }
+        conn.txSent += length;
+        conn.idlePolls = 0;
+    }
+    tcp_output(conn.pcb);
+    return ERR_OK;
+}
+
+// ----------------------------------------------------------------------------
+// Connection management
+// ----------------------------------------------------------------------------
+StatusServer::Connection* StatusServer::allocateConnection() {
+    for (auto& conn : connections_) {
+        if (!conn.inUse) {
+            conn.inUse = true;
+            conn.responding = false;
+            conn.lastStep = false;
+            conn.route = Route::NotFound;
+            conn.step = 0;
+            conn.metrics = MetricsCursor();
+            conn.row = 0;
+            conn.idlePolls = 0;
+            conn.lineLength = 0;
+            conn.lineOverflow = false;
+            conn.haveRequestLine = false;
+            conn.upgrade = false;
+            conn.wsKey[0] = '\0';
+            conn.query[0] = '\0';
+            conn.authorized = false;
+            conn.commandsQueued = 0;
+            conn.commandsRejected = 0;
+            conn.closing = false;
+            conn.rxLength = 0;
+            conn.pongPending = false;
+            conn.txLength = 0;
+            conn.txSent = 0;
+            return &conn;
+        }
+    }
+    return nullptr;
+}
+
+void StatusServer::releaseConnection(Connection& conn) {
+    if (conn.responding && conn.route == Route::LogCsv) {
+        logExport_->close();
+    }
+    conn.inUse = false;
+    conn.pcb = nullptr;
+    if (conn.live) {
+        size_t clients;
+        {
+            std::lock_guard<Fmutex> exclusive(access);
+            conn.live = false;
+            clients = liveClientCount();
+        }
+        g_metrics.set(liveClientsMetric_, static_cast<float>(clients));
+        printf("[StatusServer] Live stream client disconnected (%u active)\n", static_cast<unsigned>(clients));
+    }
+}
+
+err_t StatusServer::closeConnection(Connection& conn) {
+    struct tcp_pcb* pcb = conn.pcb;
+    releaseConnection(conn);
+    if (!pcb) return ERR_OK;
+
+    tcp_arg(pcb, nullptr);
+    tcp_recv(pcb, nullptr);
+    tcp_sent(pcb, nullptr);
+    tcp_poll(pcb, nullptr, 0);
+    tcp_err(pcb, nullptr);
+    if (tcp_close(pcb) != ERR_OK) {
+        // Out of memory for the FIN: drop the connection instead.
+        tcp_abort(pcb);
+        return ERR_ABRT;
+    }
+    return ERR_OK;
+}
+
+// =============================================================================
+//                               CALLBACKS (STATIC)
+// =============================================================================
+
+err_t StatusServer::onAccept(void* arg, struct tcp_pcb* pcb, err_t err) {
+    auto* server = static_cast<StatusServer*>(arg);
+    if (err != ERR_OK || !pcb || !server) return ERR_VAL;
+
+    Connection* conn = server->allocateConnection();
+    if (!conn) {
+        g_metrics.inc(server->rejectedMetric_);
+        tcp_abort(pcb);
+        return ERR_ABRT;
+    }
+    conn->pcb = pcb;
+
+    // Let the cloud connections win if lwIP runs out of PCBs.
+    tcp_setprio(pcb, TCP_PRIO_MIN);
+    tcp_arg(pcb, conn);
+    tcp_recv(pcb, onRecv);
+    tcp_sent(pcb, onSent);
+    tcp_poll(pcb, onPoll, POLL_INTERVAL);
+    tcp_err(pcb, onError);
+    return ERR_OK;
+}
+
+err_t StatusServer::onRecv(void* arg, struct tcp_pcb* pcb, struct pbuf* p, err_t err) {
+    auto* conn = static_cast<Connection*>(arg);
+    if (!conn) {
+        if (p) pbuf_free(p);
+        return ERR_OK;
+    }
+    if (!p) {
+        // The client closed its side.
+        return conn->owner->closeConnection(*conn);
+    }
+    tcp_recved(pcb, p->tot_len);
+    StatusServer* server = conn->owner;
+
+    if (conn->live) {
+        server->receiveFrames(*conn, p);
+        pbuf_free(p);
+        return server->send(*conn);
+    }
+
+    if (!conn->responding && server->receiveRequest(*conn, p)) {
+        if (conn->route == Route::Live) {
+            if (!conn->upgrade || conn->wsKey[0] == '\0') {
+                conn->route = Route::BadRequest;
+            } else {
+                std::lock_guard<Fmutex> exclusive(server->access);
+                if (server->liveClientCount() >= MAX_LIVE_CLIENTS) conn->route = Route::Busy;
+            }
+        } else if (conn->route == Route::LogCsv && !server->logExport_->open()) {
+            conn->route = Route::ExportBusy;
+        } else if (conn->route == Route::Command) {
+            if (conn->authorized) {
+                server->submitCommands(*conn);
+            } else {
+                conn->route = Route::Forbidden;
+            }
+        }
+        conn->responding = true;
+        pbuf_free(p);
+        return server->send(*conn);
+    }
+    // Anything after the request (or a body) is discarded.
+    pbuf_free(p);
+    return ERR_OK;
+}
+
+err_t StatusServer::onSent(void* arg, struct tcp_pcb* pcb, u16_t len) {
+    auto* conn = static_cast<Connection*>(arg);
+    if (!conn || !conn->responding) return ERR_OK;
+    conn->idlePolls = 0;
+    return conn->owner->send(*conn);
+}
+
+err_t StatusServer::onPoll(void* arg, struct tcp_pcb* pcb) {
+    auto* conn = static_cast<Connection*>(arg);
+    if (!conn) {
+        tcp_abort(pcb);
+        return ERR_ABRT;
+    }
+    // Live streams stay open while idle; a vanished client is detected by TCP.
+    if (!conn->live && ++conn->idlePolls > MAX_IDLE_POLLS) {
+        printf("[StatusServer] Closing idle connection.\n");
+        return conn->owner->closeConnection(*conn);
+    }
+    if (conn->responding) {
+        return conn->owner->send(*conn);
+    }
+    return ERR_OK;
+}
+
+void StatusServer::onError(void* arg, err_t err) {
+    // The pcb has already been freed by lwIP.
+    auto* conn = static_cast<Connection*>(arg);
+    if (conn) {
+        conn->owner->releaseConnection(*conn);
+    }
+}
+
+void StatusServer::onFlush(void* arg) {
+    auto* server = static_cast<StatusServer*>(arg);
+    {
+        std::lock_guard<Fmutex> exclusive(server->access);
+        server->flushScheduled_ = false;
+    }
+    for (auto& conn : server->connections_) {
+        if (conn.inUse && conn.live && conn.pcb) {
+            server->send(conn);
+        }
+    }
+}
+
+void StatusServer::onLogReady(void* arg) {
+    // If the lwIP message box is full, the poll callback continues the response.
+    tcpip_try_callback(onLogFlush, arg);
+}
+
+void StatusServer::onLogFlush(void* arg) {
+    auto* server = static_cast<StatusServer*>(arg);
+    for (auto& conn : server->connections_) {
+        if (conn.inUse && conn.responding && conn.route == Route::LogCsv && conn.pcb) {
+            server->send(conn);
+        }
+    }
+}
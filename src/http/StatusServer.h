@@ -0,0 +1,238 @@
+#ifndef STATUS_SERVER_H
+#define STATUS_SERVER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "lwip/tcp.h"
+#include "Fmutex.h"
+#include "Controller/Controller.h"
+#include "SampleHistory.h"
+#include "LiveQueue.h"
+#include "SampleLogExport.h"
+#include "metrics/Metrics.h"
+#include "commands/CommandQueue.h"
+
+// TCP port of the status server.
+#ifndef STATUS_SERVER_PORT
+#define STATUS_SERVER_PORT 80
+#endif
+
+// Secret that POST /command requests must send as "Authorization: Bearer <token>".
+// Anyone on the local network can reach the server, so without a token the route is
+// disabled and answers 403.
+//#define STATUS_SERVER_COMMAND_TOKEN "change-me"
+
+/*
+   StatusServer Module Header
+
+   A small HTTP/1.0 server on lwIP's raw TCP API that shows the live state of the
+   controller on the local network, without the delay of the cloud dashboard:
+
+       GET /status    current snapshot as JSON
+       GET /history   per-minute rollups (min/avg/max) of the last hour as JSON
+       GET /metrics   the metrics registry (Metrics.h) in the Prometheus text format
+       GET /rollups.csv
+                      the same per-minute rollups (at most the last hour, one row per
+                      minute) as CSV, streamed with chunked transfer encoding; the
+                      individual samples are in /samples.csv
+       GET /samples.csv
+                      every sample in the persistent sample log (SampleLog.h, also those
+                      of earlier boots) as CSV, streamed with chunked transfer encoding
+       GET /live      WebSocket stream of every new sample and of valve, fan, safety
+                      vent and setpoint changes, as JSON text messages
+       POST /command?ID=5&SETPOINT=900
+                      queues remote commands (commands/Command.h) for the controller;
+                      202 with the number queued, the acks follow in the next upload.
+                      Requires STATUS_SERVER_COMMAND_TOKEN (403 without a valid token)
+
+   e.g.  curl http://<pico-ip>/status
+         curl -X POST -H 'Authorization: Bearer <token>' 'http://<pico-ip>/command?FAN=40'
+
+   Key properties:
+     - No heap allocation while serving. A fixed pool of MAX_CONNECTIONS connections is
+       part of the object; a connection beyond the pool is refused.
+     - Responses are rendered step by step into the connection's fixed transmit buffer
+       and copied into lwIP's pbufs with tcp_write(). The next step is rendered only when
+       the send buffer has room again (tcp_sent), so a long response never needs more
+       than one buffer of RAM. The CSV exports fill each chunk with as many rows as fit
+       into the buffer, so their memory use does not depend on the amount of history.
+     - The sample log is on the I²C EEPROM. /samples.csv never reads it in the lwIP
+       thread: logExportTask reads batches into the SampleLogExport buffer and the
+       response continues when a batch is ready. One log export runs at a time.
+     - The server runs entirely in the lwIP thread. The control tasks only hand over a
+       snapshot with publish(), which copies a few values under a mutex and never waits
+       for the network.
+     - Responses are close-delimited (Connection: close), no keep-alive.
+     - Times are given in milliseconds since boot and, once the wall clock is synchronized
+       (WallClock.h), also in UTC ("utc_ms", "start_utc"); before that the UTC fields are
+       null or empty.
+     - Each live stream client has a bounded LiveQueue: unsent samples are coalesced and
+       the oldest events dropped when the client falls behind. At most LIVE_MAX_IN_FLIGHT
+       bytes per client are handed to lwIP, so a slow client can neither stall sensorTask
+       nor use up lwIP's memory. At most MAX_LIVE_CLIENTS streams are accepted, keeping a
+       connection free for ordinary requests.
+
+   start() must be called with the lwIP lock held (cyw43_arch_lwip_begin).
+*/
+class StatusServer {
+public:
+    static constexpr size_t MAX_CONNECTIONS = 3;
+    static constexpr size_t MAX_LIVE_CLIENTS = 2;
+
+    explicit StatusServer(uint16_t port = STATUS_SERVER_PORT);
+    ~StatusServer();
+
+    StatusServer(const StatusServer&) = delete;
+
+    // Starts listening. Returns false if the port could not be opened.
+    bool start();
+
+    // Command queue that receives POST /command requests (none: the route answers 503).
+    void setCommandQueue(std::shared_ptr<CommandQueue> commands);
+
+    // Reader of the sample log for GET /samples.csv (none: the route answers 404). Call
+    // before the tasks start.
+    void setSampleLogExport(std::shared_ptr<SampleLogExport> logExport);
+
+    // Stores the latest Controller snapshot, adds it to the history and queues it (and
+    // any state changes) for the live stream clients (sensorTask).
+    void publish(const ControllerSnapshot& snapshot);
+
+    // Statistics.
+    uint32_t getRequestCount() const;    // Requests answered.
+    uint32_t getRejectedCount() const;   // Connections refused because the pool was full.
+
+private:
+    static constexpr size_t REQUEST_LINE_SIZE = 96;
+    static constexpr size_t TX_BUFFER_SIZE = 512;
+    static constexpr size_t WS_KEY_SIZE = 32;
+    static constexpr size_t WS_RX_SIZE = 64;
+    static constexpr size_t LIVE_MAX_IN_FLIGHT = 1024;
+
+    enum class Route : uint8_t {
+        Status, History, RollupCsv, LogCsv, Metrics, Live, Command,
+        NotFound, BadMethod, BadRequest, Unavailable, Busy, ExportBusy, Forbidden
+    };
+
+    struct Connection {
+        StatusServer* owner;
+        struct tcp_pcb* pcb;
+        bool inUse;
+        bool responding;                  // Request line parsed, response in progress.
+        bool lastStep;                    // The buffer holds the final part of the response.
+        Route route;
+        uint16_t step;                    // Next rendering step of the route.
+        MetricsCursor metrics;            // Progress through the metrics registry.
+        uint16_t row;                     // Next rollup of the rollup export (log export:
+                                          // next record of the current batch).
+        uint8_t idlePolls;                // Poll intervals without progress.
+
+        // Request being received (request line and headers, one line at a time).
+        char line[REQUEST_LINE_SIZE];
+        size_t lineLength;
+        bool lineOverflow;                // The current line was longer than 'line'.
+        bool haveRequestLine;
+        bool upgrade;                     // "Upgrade: websocket" seen.
+        char wsKey[WS_KEY_SIZE];          // Sec-WebSocket-Key.
+        char query[REQUEST_LINE_SIZE];    // POST /command query string, submitted once
+                                          // the headers have been checked.
+        bool authorized;                  // Valid command token seen.
+        uint8_t commandsQueued;           // POST /command results.
+        uint8_t commandsRejected;
+
+        // Live stream (WebSocket) state.
+        bool live;                        // Handshake sent; written under 'access'.
+        bool closing;                     // Send a close frame and close.
+        LiveQueue queue;                  // Guarded by 'access'.
+        uint8_t rx[WS_RX_SIZE];           // Incomplete client frame.
+        size_t rxLength;
+        bool pongPending;
+        uint8_t pong[WS_RX_SIZE];         // Payload of the last ping.
+        size_t pongLength;
+
+        char tx[TX_BUFFER_SIZE];
+        size_t txLength;
+        size_t txSent;
+    };
+
+    uint16_t port_;
+    struct tcp_pcb* listener_;
+    Connection connections_[MAX_CONNECTIONS];
+
+    mutable Fmutex access;                // Protects the snapshot and the live queues.
+    ControllerSnapshot snapshot_;
+    bool haveSnapshot_;
+    bool flushScheduled_;                 // onFlush() is queued to the lwIP thread.
+    SampleHistory history_;
+    std::shared_ptr<CommandQueue> commands_;
+    std::shared_ptr<SampleLogExport> logExport_;
+
+    MetricId requestsMetric_;
+    MetricId rejectedMetric_;
+    MetricId liveClientsMetric_;
+    MetricId liveMessagesMetric_;
+    MetricId liveDroppedMetric_;
+    MetricId liveCoalescedMetric_;
+
+    // Copies the latest snapshot. Returns false if none has been published yet.
+    bool getSnapshot(ControllerSnapshot& out) const;
+
+    // Selects the route from the request line.
+    Route parseRequest(const char* line) const;
+
+    // Keeps the query string of a POST /command request line for submitCommands().
+    void storeQuery(Connection& conn, const char* line);
+
+    // Submits the commands of a POST /command request.
+    void submitCommands(Connection& conn);
+
+    // Checks the value of an Authorization header against STATUS_SERVER_COMMAND_TOKEN.
+    static bool checkToken(const char* value);
+
+    // Consumes request bytes. Returns true when the request is complete.
+    bool receiveRequest(Connection& conn, struct pbuf* p);
+    void processHeaderLine(Connection& conn);
+
+    // Consumes WebSocket frames from a live stream client.
+    void receiveFrames(Connection& conn, struct pbuf* p);
+
+    // Number of connections in live stream mode (call with 'access' held).
+    size_t liveClientCount() const;
+
+    // Renders the next part of the response into the connection's buffer.
+    void renderStep(Connection& conn);
+    size_t renderStatus(char* out, size_t size) const;
+    size_t renderRollup(size_t index, char* out, size_t size, bool& found) const;
+    size_t renderRollupChunk(Connection& conn, char* out, size_t size) const;
+    size_t renderLogChunk(Connection& conn, char* out, size_t size, bool& done) const;
+    size_t renderLiveHandshake(Connection& conn, char* out, size_t size);
+    size_t renderLiveFrames(Connection& conn, char* out, size_t size);
+
+    // Writes as much of the response as the send buffer allows.
+    err_t send(Connection& conn);
+
+    // Releases the connection and closes (or aborts) its pcb.
+    err_t closeConnection(Connection& conn);
+    Connection* allocateConnection();
+    void releaseConnection(Connection& conn);
+
+    // ------------------------------------------------------------------------
+    // Static callbacks used by lwIP's TCP API (run in the lwIP thread).
+    // ------------------------------------------------------------------------
+    static err_t onAccept(void* arg, struct tcp_pcb* pcb, err_t err);
+    static err_t onRecv(void* arg, struct tcp_pcb* pcb, struct pbuf* p, err_t err);
+    static err_t onSent(void* arg, struct tcp_pcb* pcb, u16_t len);
+    static err_t onPoll(void* arg, struct tcp_pcb* pcb);
+    static void onError(void* arg, err_t err);
+
+    // Sends queued live stream messages (queued to the lwIP thread by publish()).
+    static void onFlush(void* arg);
+
+    // A sample log batch is ready (logExportTask); onLogReady() queues onLogFlush() to
+    // the lwIP thread, which continues the /samples.csv response.
+    static void onLogReady(void* arg);
+    static void onLogFlush(void* arg);
+};
+
+#endif // STATUS_SERVER_H
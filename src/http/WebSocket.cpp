@@ -0,0 +1,68 @@
+#include "WebSocket.h"
+#include <cstring>
+
+#include "mbedtls/sha1.h"
+#include "mbedtls/base64.h"
+
+// GUID appended to the client key by the handshake (RFC 6455, section 1.3).
+static constexpr const char* HANDSHAKE_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+bool WebSocket::acceptKey(const char* clientKey, char* out, size_t size) {
+    uint8_t digest[20];
+    mbedtls_sha1_context sha;
+    mbedtls_sha1_init(&sha);
+    bool ok = mbedtls_sha1_starts(&sha) == 0 &&
+              mbedtls_sha1_update(&sha, reinterpret_cast<const unsigned char*>(clientKey), strlen(clientKey)) == 0 &&
+              mbedtls_sha1_update(&sha, reinterpret_cast<const unsigned char*>(HANDSHAKE_GUID), strlen(HANDSHAKE_GUID)) == 0 &&
+              mbedtls_sha1_finish(&sha, digest) == 0;
+    mbedtls_sha1_free(&sha);
+    if (!ok) return false;
+
+    size_t written = 0;
+    return mbedtls_base64_encode(reinterpret_cast<unsigned char*>(out), size, &written, digest, sizeof(digest)) == 0;
+}
+
+size_t WebSocket::frameHeader(uint8_t opcode, size_t payloadLength, uint8_t* out) {
+    out[0] = 0x80 | (opcode & 0x0F);          // FIN + opcode
+    if (payloadLength < 126) {
+        out[1] = static_cast<uint8_t>(payloadLength);
+        return 2;
+    }
+    out[1] = 126;
+    out[2] = static_cast<uint8_t>(payloadLength >> 8);
+    out[3] = static_cast<uint8_t>(payloadLength);
+    return 4;
+}
+
+/*
+    Client frames must be masked (RFC 6455, section 5.1). 64-bit payload lengths are
+    rejected because no such frame can fit into the receive buffer.
+*/
+int WebSocket::parseFrame(uint8_t* data, size_t length, size_t capacity, Frame& frame) {
+    if (length < 2) return 0;
+    frame.fin    = (data[0] & 0x80) != 0;
+    frame.opcode = data[0] & 0x0F;
+    bool masked  = (data[1] & 0x80) != 0;
+    size_t payloadLength = data[1] & 0x7F;
+    size_t headerLength = 2;
+
+    if (!masked || payloadLength == 127) return -1;
+    if (payloadLength == 126) {
+        if (length < 4) return 0;
+        payloadLength = (static_cast<size_t>(data[2]) << 8) | data[3];
+        headerLength = 4;
+    }
+    headerLength += 4;                          // Masking key.
+
+    size_t total = headerLength + payloadLength;
+    if (total > capacity) return -1;
+    if (length < total) return 0;
+
+    const uint8_t* mask = data + headerLength - 4;
+    frame.payload = data + headerLength;
+    frame.length  = payloadLength;
+    for (size_t i = 0; i < payloadLength; i++) {
+        frame.payload[i] ^= mask[i % 4];
+    }
+    return static_cast<int>(total);
+}
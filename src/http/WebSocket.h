@@ -0,0 +1,52 @@
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include <cstdint>
+#include <cstddef>
+
+/*
+   WebSocket Helpers
+
+   The parts of RFC 6455 needed by the status server's live stream: computing the
+   handshake answer, writing the header of an (unmasked) server frame and parsing the
+   (masked) frames sent by a browser. Fragmented client messages are not reassembled;
+   the server only reacts to control frames (close, ping) and ignores data frames.
+*/
+class WebSocket {
+public:
+    enum Opcode : uint8_t {
+        Continuation = 0x0,
+        Text   = 0x1,
+        Binary = 0x2,
+        Close  = 0x8,
+        Ping   = 0x9,
+        Pong   = 0xA
+    };
+
+    // Length of the Sec-WebSocket-Accept value including the terminating zero.
+    static constexpr size_t ACCEPT_SIZE = 29;
+
+    // Largest frame header written by frameHeader() (payloads up to 65535 bytes).
+    static constexpr size_t MAX_HEADER_SIZE = 4;
+
+    // A client frame located by parseFrame(); the payload has already been unmasked in place.
+    struct Frame {
+        uint8_t opcode;
+        bool fin;
+        uint8_t* payload;
+        size_t length;
+    };
+
+    // Computes the Sec-WebSocket-Accept value for the client's Sec-WebSocket-Key.
+    static bool acceptKey(const char* clientKey, char* out, size_t size);
+
+    // Writes the header of a final, unmasked server frame. Returns its length (2 or 4).
+    static size_t frameHeader(uint8_t opcode, size_t payloadLength, uint8_t* out);
+
+    // Parses the first frame in 'data'. Returns the number of bytes it occupies, 0 if the
+    // frame is not complete yet, or -1 if it is malformed (e.g. unmasked) or could never
+    // fit into the caller's receive buffer of 'capacity' bytes.
+    static int parseFrame(uint8_t* data, size_t length, size_t capacity, Frame& frame);
+};
+
+#endif // WEBSOCKET_H
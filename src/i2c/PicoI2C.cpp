@@ -17,6 +17,13 @@
 #define I2C1_SDA_PIN 14
 #define I2C1_SCL_PIN 15
 
+static const MetricDescriptor transactions_desc = {
+        "greenhouse_i2c_transactions_total", "I2C transactions, per bus.", MetricType::Counter};
+static const MetricDescriptor errors_desc = {
+        "greenhouse_i2c_errors_total", "I2C transactions that transferred fewer bytes than requested.", MetricType::Counter};
+static const MetricDescriptor timeouts_desc = {
+        "greenhouse_i2c_timeouts_total", "I2C transactions that did not complete in time.", MetricType::Counter};
+
 PicoI2C *PicoI2C::i2c0_instance{nullptr};
 PicoI2C *PicoI2C::i2c1_instance{nullptr};
 
@@ -63,6 +70,11 @@ PicoI2C::PicoI2C(uint bus_nr, uint speed) :
     i2c->hw->rx_tl = 14; // RX_FIFO watermark to 15 (manual gives impression that level is one higher than reg value)
     if (bus_nr) i2c1_instance = this;
     else i2c0_instance = this;
+
+    const char *labels = bus_nr ? "bus=\"1\"" : "bus=\"0\"";
+    transactions_metric = g_metrics.add(transactions_desc, labels);
+    errors_metric = g_metrics.add(errors_desc, labels);
+    timeouts_metric = g_metrics.add(timeouts_desc, labels);
 }
 
 
@@ -144,6 +156,9 @@ uint PicoI2C::transaction(uint8_t addr, const uint8_t *wbuffer, uint wlength, ui
     }
     i2c->hw->enable = 0;
     i2c->hw->tar = addr;
+    // A NACK (e.g. EEPROM ACK polling) aborts the previous transfer; the TX FIFO stays
+    // flushed until the abort is cleared.
+    (void) i2c->hw->clr_tx_abrt;
     i2c->hw->enable = 1;
     i2c->hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_EMPTY_BITS | I2C_IC_INTR_MASK_M_RX_FULL_BITS;
     i2c->restart_on_next = false;
@@ -165,11 +180,15 @@ uint PicoI2C::transaction(uint8_t addr, const uint8_t *wbuffer, uint wlength, ui
     if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000)) == 0) {
         // timed out
         count = 0;
+        g_metrics.inc(timeouts_metric);
     } else {
         count -= rcnt + wctr;
     }
     irq_set_enabled(irqn, false);
 
+    g_metrics.inc(transactions_metric);
+    if (count != wlength + rlength) g_metrics.inc(errors_metric);
+
     // if count !=  sum of lengths transaction failed
     return count;
 }
@@ -9,6 +9,7 @@
 #include "task.h"
 #include "hardware/i2c.h"
 #include "Fmutex.h"
+#include "metrics/Metrics.h"
 
 class PicoI2C {
 public:
@@ -27,6 +28,9 @@ private:
     uint8_t *rbuf;
     uint rctr;
     uint rcnt;
+    MetricId transactions_metric;
+    MetricId errors_metric;
+    MetricId timeouts_metric;
     void tx_fill_fifo();
     void rx_fill_fifo();
 
@@ -0,0 +1,261 @@
+#include "DnsCache.h"
+#include <cstdio>
+#include <cstring>
+
+#include "pico/stdlib.h"
+#include "lwip/tcpip.h"
+
+// =============================================================================
+//                            DnsCache Implementation
+// =============================================================================
+
+/*
+   All entry data is accessed with the lwIP lock held: lookup() by contract, the resolver
+   callbacks and the refresh because they run in the lwIP thread. The refresh timer only
+   queues the refresh there; the timer service task must not block on the lwIP lock, or
+   every other software timer would wait for a busy network stack. An
+   entry with a query in progress is never reused for another host, because lwIP still
+   holds a pointer to it as the callback argument.
+*/
+
+static uint32_t nowMs() {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+// ----------------------------------------------------------------------------
+// Constructor / Destructor
+// ----------------------------------------------------------------------------
+DnsCache::DnsCache()
+        : refreshTimer_(nullptr)
+        , hits_(0)
+        , misses_(0)
+        , fallbacks_(0)
+        , refreshes_(0)
+{
+    memset(entries_, 0, sizeof(entries_));
+    for (auto& entry : entries_) {
+        entry.owner = this;
+    }
+
+    // Periodic timer that refreshes entries before they expire.
+    refreshTimer_ = xTimerCreate("DnsRefresh",
+                                 pdMS_TO_TICKS(DNS_CACHE_REFRESH_MARGIN_MS / 2),
+                                 pdTRUE,              // Auto-reload
+                                 this,
+                                 &DnsCache::refreshTimerCallback);
+    if (refreshTimer_ == nullptr || xTimerStart(refreshTimer_, 0) != pdPASS) {
+        printf("[DnsCache] Error creating refresh timer!\n");
+    }
+}
+
+DnsCache::~DnsCache() {
+    if (refreshTimer_) {
+        xTimerDelete(refreshTimer_, 0);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// lookup()
+// ----------------------------------------------------------------------------
+err_t DnsCache::lookup(const char* hostname, ip_addr_t* addr, dns_found_callback callback, void* arg) {
+    // Dotted IP addresses need no resolution.
+    if (ipaddr_aton(hostname, addr)) {
+        return ERR_OK;
+    }
+
+    Entry* entry = findOrCreate(hostname);
+    if (!entry) {
+        // Name too long or all entries busy: use the resolver directly.
+        misses_++;
+        return dns_gethostbyname(hostname, addr, callback, arg);
+    }
+
+    uint32_t now = nowMs();
+    entry->lastUsedMs = now;
+    if (entry->haveAddr && (now - entry->resolvedMs) < DNS_CACHE_TTL_MS) {
+        hits_++;
+        *addr = entry->addr;
+        return ERR_OK;
+    }
+
+    misses_++;
+    if (!entry->resolving) {
+        err_t err = resolve(*entry);
+        if (err == ERR_OK) {
+            *addr = entry->addr;
+            return ERR_OK;
+        }
+        if (err != ERR_INPROGRESS) {
+            // The query could not even be sent (no DNS server, out of memory, ...).
+            if (entry->haveAddr) {
+                fallbacks_++;
+                printf("[DnsCache] Resolver unavailable, using last known address of %s\n", hostname);
+                *addr = entry->addr;
+                return ERR_OK;
+            }
+            return err;
+        }
+    }
+
+    // Wait for the query in progress. A caller that asks again before the answer (a retry
+    // after a timeout) replaces its earlier registration, so it is called back only once.
+    for (size_t i = 0; i < entry->waiterCount; i++) {
+        if (entry->waiters[i].arg == arg) {
+            entry->waiters[i].callback = callback;
+            return ERR_INPROGRESS;
+        }
+    }
+    if (entry->waiterCount >= MAX_WAITERS) {
+        return ERR_MEM;
+    }
+    entry->waiters[entry->waiterCount++] = Waiter{callback, arg};
+    return ERR_INPROGRESS;
+}
+
+// ----------------------------------------------------------------------------
+// cancel()
+// ----------------------------------------------------------------------------
+void DnsCache::cancel(void* arg) {
+    for (Entry& entry : entries_) {
+        size_t kept = 0;
+        for (size_t i = 0; i < entry.waiterCount; i++) {
+            if (entry.waiters[i].arg != arg) {
+                entry.waiters[kept++] = entry.waiters[i];
+            }
+        }
+        entry.waiterCount = kept;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Statistics
+// ----------------------------------------------------------------------------
+uint32_t DnsCache::getHitCount() const {
+    return hits_;
+}
+
+uint32_t DnsCache::getMissCount() const {
+    return misses_;
+}
+
+uint32_t DnsCache::getFallbackCount() const {
+    return fallbacks_;
+}
+
+uint32_t DnsCache::getRefreshCount() const {
+    return refreshes_;
+}
+
+// ----------------------------------------------------------------------------
+// Entry management
+// ----------------------------------------------------------------------------
+DnsCache::Entry* DnsCache::findOrCreate(const char* hostname) {
+    if (strlen(hostname) >= MAX_HOSTNAME) return nullptr;
+
+    Entry* freeEntry = nullptr;
+    Entry* oldest = nullptr;
+    for (auto& entry : entries_) {
+        if (entry.hostname[0] == '\0') {
+            if (!freeEntry) freeEntry = &entry;
+        } else if (strcmp(entry.hostname, hostname) == 0) {
+            return &entry;
+        } else if (!entry.resolving && (!oldest || entry.lastUsedMs < oldest->lastUsedMs)) {
+            oldest = &entry;
+        }
+    }
+
+    Entry* entry = freeEntry ? freeEntry : oldest;
+    if (entry) {
+        strcpy(entry->hostname, hostname);
+        entry->haveAddr    = false;
+        entry->resolving   = false;
+        entry->waiterCount = 0;
+    }
+    return entry;
+}
+
+err_t DnsCache::resolve(Entry& entry) {
+    ip_addr_t addr;
+    entry.resolving = true;
+    err_t err = dns_gethostbyname(entry.hostname, &addr, onResolved, &entry);
+    if (err == ERR_OK) {
+        // Answered from lwIP's own table.
+        entry.resolving  = false;
+        entry.addr       = addr;
+        entry.haveAddr   = true;
+        entry.resolvedMs = nowMs();
+    } else if (err != ERR_INPROGRESS) {
+        entry.resolving = false;
+    }
+    return err;
+}
+
+/*
+    On success the new address is stored. On failure the waiters receive the last known
+    good address if there is one: the server is most likely still reachable there.
+*/
+void DnsCache::complete(Entry& entry, const ip_addr_t* ipaddr) {
+    entry.resolving = false;
+    const ip_addr_t* result = nullptr;
+    if (ipaddr) {
+        entry.addr       = *ipaddr;
+        entry.haveAddr   = true;
+        entry.resolvedMs = nowMs();
+        result = &entry.addr;
+    } else if (entry.haveAddr) {
+        fallbacks_++;
+        printf("[DnsCache] Resolving %s failed, using last known address.\n", entry.hostname);
+        result = &entry.addr;
+    } else {
+        printf("[DnsCache] Resolving %s failed.\n", entry.hostname);
+    }
+
+    // Copy the waiters first; a callback may start a new lookup on this entry.
+    Waiter waiters[MAX_WAITERS];
+    size_t count = entry.waiterCount;
+    memcpy(waiters, entry.waiters, sizeof(waiters));
+    entry.waiterCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        waiters[i].callback(entry.hostname, result, waiters[i].arg);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Background refresh
+// ----------------------------------------------------------------------------
+/*
+    Only hosts looked up within the last two TTL periods are kept fresh, so a host that is
+    no longer used simply expires.
+*/
+void DnsCache::refresh() {
+    uint32_t now = nowMs();
+    for (auto& entry : entries_) {
+        if (entry.hostname[0] == '\0' || !entry.haveAddr || entry.resolving) continue;
+        if ((now - entry.lastUsedMs) >= 2 * DNS_CACHE_TTL_MS) continue;
+        if ((now - entry.resolvedMs) + DNS_CACHE_REFRESH_MARGIN_MS < DNS_CACHE_TTL_MS) continue;
+        refreshes_++;
+        resolve(entry);
+    }
+}
+
+// =============================================================================
+//                               CALLBACKS (STATIC)
+// =============================================================================
+
+void DnsCache::onResolved(const char* hostname, const ip_addr_t* ipaddr, void* arg) {
+    auto* entry = static_cast<Entry*>(arg);
+    if (entry && entry->owner) {
+        entry->owner->complete(*entry, ipaddr);
+    }
+}
+
+void DnsCache::refreshTimerCallback(TimerHandle_t timer) {
+    auto* cache = static_cast<DnsCache*>(pvTimerGetTimerID(timer));
+    if (!cache) return;
+    // If the lwIP message box is full, the next timer period tries again.
+    tcpip_try_callback(onRefresh, cache);
+}
+
+void DnsCache::onRefresh(void* arg) {
+    static_cast<DnsCache*>(arg)->refresh();
+}
@@ -0,0 +1,110 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <cstdint>
+#include "lwip/ip_addr.h"
+#include "lwip/dns.h"
+#include "FreeRTOS.h"
+#include "timers.h"
+
+// Time an address is used without asking the resolver again.
+#ifndef DNS_CACHE_TTL_MS
+#define DNS_CACHE_TTL_MS 300000
+#endif
+
+// Entries that were used recently are refreshed this long before they expire.
+#ifndef DNS_CACHE_REFRESH_MARGIN_MS
+#define DNS_CACHE_REFRESH_MARGIN_MS 30000
+#endif
+
+/*
+   DnsCache Module Header
+
+   A small cache of resolved host names for the cloud endpoints (ThingSpeak, MQTT broker),
+   placed in front of lwIP's dns_gethostbyname().
+
+   Key responsibilities include:
+     - Answering lookups of a recently resolved host directly, without a resolver round
+       trip, for DNS_CACHE_TTL_MS. lwIP's resolver callback does not report the record's
+       TTL, so the cache uses this configured TTL; lwIP's own DNS table (which honours the
+       real TTL) is still consulted whenever the cache resolves again.
+     - Refreshing entries in the background shortly before they expire, so that lookups by
+       the cloud tasks keep hitting the cache.
+     - Falling back to the last known good address when the resolver fails or cannot be
+       reached, so that a DNS outage does not stop uploads to a server that is still up.
+     - Counting hits, misses and fallbacks.
+
+   lookup() has the same contract as dns_gethostbyname() and must be called with the lwIP
+   lock held (cyw43_arch_lwip_begin). Callbacks are invoked in the lwIP thread.
+*/
+class DnsCache {
+public:
+    DnsCache();
+    ~DnsCache();
+
+    DnsCache(const DnsCache&) = delete;
+
+    // Returns ERR_OK and fills 'addr' when the address is cached (or 'hostname' is an IP
+    // address). Returns ERR_INPROGRESS when resolution was started; 'callback' is then
+    // called with the address (or the last known good one), or nullptr on failure.
+    err_t lookup(const char* hostname, ip_addr_t* addr, dns_found_callback callback, void* arg);
+
+    // Drops the pending callbacks registered with 'arg' (the caller gave up on the lookup or
+    // is going away). Must be called with the lwIP lock held, like lookup().
+    void cancel(void* arg);
+
+    // Statistics.
+    uint32_t getHitCount() const;        // Lookups answered from the cache.
+    uint32_t getMissCount() const;       // Lookups that needed the resolver.
+    uint32_t getFallbackCount() const;   // Resolver failures answered with a stale address.
+    uint32_t getRefreshCount() const;    // Background refreshes started.
+
+private:
+    static constexpr size_t MAX_ENTRIES = 4;
+    static constexpr size_t MAX_WAITERS = 2;
+    static constexpr size_t MAX_HOSTNAME = 64;
+
+    struct Waiter {
+        dns_found_callback callback;
+        void* arg;
+    };
+
+    struct Entry {
+        DnsCache* owner;
+        char hostname[MAX_HOSTNAME];
+        ip_addr_t addr;
+        bool haveAddr;                  // 'addr' holds a (possibly expired) good address.
+        bool resolving;                 // A resolver query is in progress.
+        uint32_t resolvedMs;            // When 'addr' was last confirmed by the resolver.
+        uint32_t lastUsedMs;            // Last lookup of this host.
+        Waiter waiters[MAX_WAITERS];    // Callers waiting for the query in progress.
+        size_t waiterCount;
+    };
+
+    Entry entries_[MAX_ENTRIES];
+    TimerHandle_t refreshTimer_;
+
+    uint32_t hits_;
+    uint32_t misses_;
+    uint32_t fallbacks_;
+    uint32_t refreshes_;
+
+    // Finds the entry for 'hostname', or claims a free (or the least recently used) one.
+    Entry* findOrCreate(const char* hostname);
+
+    // Starts a resolver query for the entry. Returns ERR_OK if lwIP answered at once.
+    err_t resolve(Entry& entry);
+
+    // Stores the result of a query and notifies the waiters.
+    void complete(Entry& entry, const ip_addr_t* ipaddr);
+
+    // Refreshes recently used entries that are about to expire (lwIP thread).
+    void refresh();
+
+    static void onResolved(const char* hostname, const ip_addr_t* ipaddr, void* arg);
+    // Runs in the timer service task and queues onRefresh() to the lwIP thread.
+    static void refreshTimerCallback(TimerHandle_t timer);
+    static void onRefresh(void* arg);
+};
+
+#endif // DNS_CACHE_H
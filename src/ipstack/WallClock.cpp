@@ -0,0 +1,169 @@
+#include "WallClock.h"
+#include <cstdio>
+#include <ctime>
+
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/apps/sntp.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "metrics/Metrics.h"
+
+// =============================================================================
+//                           WallClock Implementation
+// =============================================================================
+
+// Syncs closer together than this are not used to estimate the drift (too imprecise).
+static constexpr uint64_t MIN_DRIFT_INTERVAL_US = 60ULL * 1000000ULL;
+// Largest accepted drift (crystal tolerance plus temperature), as a Q32 fraction.
+static constexpr int64_t MAX_RATE_Q32 = (500LL << 32) / 1000000LL;    // 500 ppm
+
+// Clock state; written in the lwIP thread, read by any task, always in a critical section.
+static bool synced = false;
+static uint64_t anchorTimerUs = 0;     // time_us_64() at the last sync.
+static uint64_t anchorUtcUs = 0;       // UTC at the last sync.
+static int32_t rateQ32 = 0;            // Drift correction per microsecond, Q32 fraction.
+static bool haveRate = false;          // rateQ32 holds a measurement.
+static uint64_t driftTimerUs = 0;      // Start of the current drift measurement interval.
+static uint64_t driftUtcUs = 0;
+
+static MetricId syncsMetric = -1;
+static MetricId correctionMetric = -1;
+static MetricId driftMetric = -1;
+
+static const MetricDescriptor syncsDescriptor = {
+    "greenhouse_clock_syncs_total", "NTP answers applied to the wall clock.", MetricType::Counter };
+static const MetricDescriptor correctionDescriptor = {
+    "greenhouse_clock_last_correction_seconds", "Difference between NTP time and the wall clock at the last sync.", MetricType::Gauge };
+static const MetricDescriptor driftDescriptor = {
+    "greenhouse_clock_drift_ppm", "Measured drift of the hardware timer against NTP.", MetricType::Gauge };
+
+// UTC in microseconds at hardware timer value 'timerUs' (call in a critical section).
+static uint64_t utcAt(uint64_t timerUs) {
+    int64_t elapsed = static_cast<int64_t>(timerUs - anchorTimerUs);
+    return anchorUtcUs + elapsed + ((elapsed * rateQ32) >> 32);
+}
+
+// lwIP's SNTP client calls this through SNTP_SET_SYSTEM_TIME_US (see lwipopts.h).
+extern "C" void wall_clock_set_time_us(uint32_t seconds, uint32_t microseconds) {
+    WallClock::onSntpTime(seconds, microseconds);
+}
+
+// ----------------------------------------------------------------------------
+// start(): configure the SNTP client.
+// ----------------------------------------------------------------------------
+void WallClock::start() {
+    syncsMetric      = g_metrics.add(syncsDescriptor);
+    correctionMetric = g_metrics.add(correctionDescriptor);
+    driftMetric      = g_metrics.add(driftDescriptor);
+
+    cyw43_arch_lwip_begin();
+    sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    sntp_setservername(0, WALL_CLOCK_SNTP_SERVER);
+#if SNTP_MAX_SERVERS > 1
+    sntp_setservername(1, WALL_CLOCK_SNTP_SERVER2);
+#endif
+    sntp_init();
+    cyw43_arch_lwip_end();
+    printf("[WallClock] SNTP started (%s)\n", WALL_CLOCK_SNTP_SERVER);
+}
+
+bool WallClock::isSynced() {
+    taskENTER_CRITICAL();
+    bool result = synced;
+    taskEXIT_CRITICAL();
+    return result;
+}
+
+uint64_t WallClock::nowUtcMs() {
+    uint64_t timerUs = time_us_64();
+    uint64_t utcUs = 0;
+    taskENTER_CRITICAL();
+    if (synced) utcUs = utcAt(timerUs);
+    taskEXIT_CRITICAL();
+    return utcUs / 1000;
+}
+
+/*
+    The millisecond counter wraps after 49.7 days; the timestamp is placed into the most
+    recent 2^32 ms window that does not lie in the future.
+*/
+uint64_t WallClock::toUtcMs(uint32_t bootMs) {
+    uint64_t nowMs = time_us_64() / 1000;
+    uint64_t fullMs = (nowMs & ~0xFFFFFFFFULL) | bootMs;
+    if (fullMs > nowMs && fullMs >= (1ULL << 32)) fullMs -= (1ULL << 32);
+
+    uint64_t utcUs = 0;
+    taskENTER_CRITICAL();
+    if (synced) utcUs = utcAt(fullMs * 1000);
+    taskEXIT_CRITICAL();
+    return utcUs / 1000;
+}
+
+size_t WallClock::formatIso8601(uint64_t utcMs, char* out, size_t size) {
+    time_t seconds = static_cast<time_t>(utcMs / 1000);
+    struct tm t;
+    if (!gmtime_r(&seconds, &t)) return 0;
+    size_t length = strftime(out, size, "%Y-%m-%dT%H:%M:%SZ", &t);
+    return length;
+}
+
+float WallClock::getDriftPpm() {
+    taskENTER_CRITICAL();
+    int32_t rate = rateQ32;
+    taskEXIT_CRITICAL();
+    return static_cast<float>(rate) * (1000000.0f / 4294967296.0f);
+}
+
+// ----------------------------------------------------------------------------
+// onSntpTime(): apply an NTP answer (lwIP thread).
+// ----------------------------------------------------------------------------
+/*
+    The drift is measured over the interval since the previous measurement (at least a
+    minute), comparing how far UTC and the hardware timer advanced. Every new estimate is
+    averaged with the previous one, which smooths the jitter of single NTP answers
+    (network delay); the first measurement after a step is taken as it is.
+*/
+void WallClock::onSntpTime(uint32_t seconds, uint32_t microseconds) {
+    uint64_t timerUs = time_us_64();
+    uint64_t measuredUs = static_cast<uint64_t>(seconds) * 1000000ULL + microseconds;
+    int64_t correctionUs = 0;
+    bool stepped = false;
+
+    taskENTER_CRITICAL();
+    if (synced) {
+        correctionUs = static_cast<int64_t>(measuredUs - utcAt(timerUs));
+    }
+    if (!synced || correctionUs > WALL_CLOCK_STEP_THRESHOLD_US || correctionUs < -WALL_CLOCK_STEP_THRESHOLD_US) {
+        rateQ32 = 0;
+        haveRate = false;
+        driftTimerUs = timerUs;
+        driftUtcUs = measuredUs;
+        stepped = true;
+    } else if (timerUs - driftTimerUs >= MIN_DRIFT_INTERVAL_US) {
+        int64_t interval = static_cast<int64_t>(timerUs - driftTimerUs);
+        int64_t gained = static_cast<int64_t>(measuredUs - driftUtcUs) - interval;
+        int64_t measuredRate = (gained * (1LL << 32)) / interval;
+        int64_t rate = haveRate ? (static_cast<int64_t>(rateQ32) + measuredRate) / 2 : measuredRate;
+        if (rate > MAX_RATE_Q32) rate = MAX_RATE_Q32;
+        if (rate < -MAX_RATE_Q32) rate = -MAX_RATE_Q32;
+        rateQ32 = static_cast<int32_t>(rate);
+        haveRate = true;
+        driftTimerUs = timerUs;
+        driftUtcUs = measuredUs;
+    }
+    anchorTimerUs = timerUs;
+    anchorUtcUs = measuredUs;
+    synced = true;
+    taskEXIT_CRITICAL();
+
+    g_metrics.inc(syncsMetric);
+    g_metrics.set(correctionMetric, static_cast<float>(correctionUs) / 1000000.0f);
+    g_metrics.set(driftMetric, getDriftPpm());
+    if (stepped) {
+        char text[24];
+        formatIso8601(measuredUs / 1000, text, sizeof(text));
+        printf("[WallClock] Clock set to %s (correction %lld ms)\n", text,
+               static_cast<long long>(correctionUs / 1000));
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef WALL_CLOCK_H
+#define WALL_CLOCK_H
+
+#include <cstdint>
+#include <cstddef>
+
+// NTP servers queried by lwIP's SNTP client (names are resolved through DNS).
+#ifndef WALL_CLOCK_SNTP_SERVER
+#define WALL_CLOCK_SNTP_SERVER "pool.ntp.org"
+#endif
+#ifndef WALL_CLOCK_SNTP_SERVER2
+#define WALL_CLOCK_SNTP_SERVER2 "time.google.com"
+#endif
+
+// A correction larger than this steps the clock and restarts drift estimation.
+#ifndef WALL_CLOCK_STEP_THRESHOLD_US
+#define WALL_CLOCK_STEP_THRESHOLD_US 1000000
+#endif
+
+/*
+   WallClock Module Header
+
+   UTC time for the firmware, which otherwise only knows the time since boot. lwIP's SNTP
+   client polls the NTP servers (SNTP_UPDATE_DELAY in lwipopts.h) and hands each answer to
+   onSntpTime() in the lwIP thread.
+
+   Key properties:
+     - UTC is derived from the 64-bit hardware microsecond timer: an anchor (timer value and
+       UTC at the last sync) plus the elapsed time, corrected by the measured drift of the
+       timer's crystal. The drift is estimated from the offsets of successive syncs and
+       smoothed, so between syncs the clock does not wander by the crystal's tolerance
+       (up to a few seconds per hour of a cheap crystal).
+     - A large difference (WALL_CLOCK_STEP_THRESHOLD_US, e.g. the first sync) steps the
+       clock; smaller corrections are applied at the next sync as well, so the time may
+       jump by a few milliseconds but never by more.
+     - nowUtcMs() is a short critical section plus a multiplication and can be called from
+       any task. Before the first sync it returns 0.
+     - Timestamps taken as milliseconds since boot (to_ms_since_boot()) are converted with
+       toUtcMs(), so samples recorded before the first sync still get a wall-clock time
+       once the clock is synchronized.
+
+   start() must be called after the network is up; it takes the lwIP lock itself.
+*/
+class WallClock {
+public:
+    // Configures and starts lwIP's SNTP client.
+    static void start();
+
+    // Returns true once the first NTP answer was received.
+    static bool isSynced();
+
+    // Current UTC in milliseconds since 1970-01-01, or 0 if not synced.
+    static uint64_t nowUtcMs();
+
+    // Converts a to_ms_since_boot() timestamp of this boot to UTC milliseconds, or 0 if
+    // not synced.
+    static uint64_t toUtcMs(uint32_t bootMs);
+
+    // Formats UTC milliseconds as "2024-06-10T12:34:56Z". Returns the length, or 0.
+    static size_t formatIso8601(uint64_t utcMs, char* out, size_t size);
+
+    // Measured drift of the hardware timer in parts per million (positive: timer slow).
+    static float getDriftPpm();
+
+    // Called by lwIP's SNTP client with the received time (SNTP_SET_SYSTEM_TIME_US).
+    static void onSntpTime(uint32_t seconds, uint32_t microseconds);
+};
+
+// Shorthand for WallClock::nowUtcMs().
+inline uint64_t now_utc() {
+    return WallClock::nowUtcMs();
+}
+
+#endif // WALL_CLOCK_H
@@ -67,6 +67,24 @@
 #define DHCP_DOES_ARP_CHECK         0
 #define LWIP_DHCP_DOES_ACD_CHECK    0
 
+// MQTT client (lwIP apps/mqtt) used by the optional MQTT channel and the SNTP client need
+// one extra timeout each.
+#define MEMP_NUM_SYS_TIMEOUT        (LWIP_NUM_SYS_TIMEOUT_INTERNAL + 2)
+#define MQTT_OUTPUT_RINGBUF_SIZE    512
+#define MQTT_REQ_MAX_IN_FLIGHT      4
+
+// SNTP client (lwIP apps/sntp) setting the wall clock (WallClock.h); polls once per hour.
+#include <stdint.h>
+#ifdef __cplusplus
+extern "C"
+#endif
+void wall_clock_set_time_us(uint32_t sec, uint32_t us);
+#define SNTP_SERVER_DNS             1
+#define SNTP_MAX_SERVERS            2
+#define SNTP_STARTUP_DELAY          0
+#define SNTP_UPDATE_DELAY           (60 * 60 * 1000)
+#define SNTP_SET_SYSTEM_TIME_US(sec, us) wall_clock_set_time_us((sec), (us))
+
 #ifndef NDEBUG
 #define LWIP_DEBUG                  1
 #define LWIP_STATS                  1
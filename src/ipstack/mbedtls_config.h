@@ -11,22 +11,42 @@
 #define MBEDTLS_HAVE_TIME
 
 #define MBEDTLS_CIPHER_MODE_CBC
-#define MBEDTLS_ECP_DP_SECP192R1_ENABLED
-#define MBEDTLS_ECP_DP_SECP224R1_ENABLED
+
+/* Curves: X25519 and P-256 for the key exchange (the fastest ones), P-384 only because
+   certificate chains of public CAs may be signed with it. The other curves were never
+   needed and only slowed down negotiation and bloated the image. */
 #define MBEDTLS_ECP_DP_SECP256R1_ENABLED
 #define MBEDTLS_ECP_DP_SECP384R1_ENABLED
-#define MBEDTLS_ECP_DP_SECP521R1_ENABLED
-#define MBEDTLS_ECP_DP_SECP192K1_ENABLED
-#define MBEDTLS_ECP_DP_SECP224K1_ENABLED
-#define MBEDTLS_ECP_DP_SECP256K1_ENABLED
-#define MBEDTLS_ECP_DP_BP256R1_ENABLED
-#define MBEDTLS_ECP_DP_BP384R1_ENABLED
-#define MBEDTLS_ECP_DP_BP512R1_ENABLED
 #define MBEDTLS_ECP_DP_CURVE25519_ENABLED
-#define MBEDTLS_KEY_EXCHANGE_RSA_ENABLED
 #define MBEDTLS_PKCS1_V15
-#define MBEDTLS_SHA256_SMALLER
+
+/* Speed options for the Cortex-M0+ (no hardware multiplier beyond 32x32->32):
+   - HAVE_ASM enables the Thumb-1 multiply-accumulate loops in bignum.
+   - NIST_OPTIM uses the fast modular reduction for the NIST curves.
+   - A window of 6 (instead of the default 4) and the fixed-point tables speed up
+     scalar multiplication at the cost of a few kB of RAM during the handshake.
+   MBEDTLS_SHA256_SMALLER was removed: it trades speed for flash, which is not scarce. */
+#define MBEDTLS_HAVE_ASM
+#define MBEDTLS_ECP_NIST_OPTIM
+#define MBEDTLS_ECP_WINDOW_SIZE        6
+#define MBEDTLS_ECP_FIXED_POINT_OPTIM  1
+
+/* Cipher suites offered in the ClientHello. Restricting the list keeps the handshake to
+   one ECDHE key exchange with AES-128-GCM. TLS_PROFILE_ECDSA_ONLY offers just the
+   ECDHE-ECDSA suite, for servers known to use an ECDSA certificate (e.g. a local broker);
+   the default also allows ECDHE-RSA, because public servers such as api.thingspeak.com
+   commonly present RSA certificates. */
+#ifndef TLS_PROFILE_ECDSA_ONLY
+#define TLS_PROFILE_ECDSA_ONLY 0
+#endif
+#if TLS_PROFILE_ECDSA_ONLY
+#define MBEDTLS_SSL_CIPHERSUITES MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256
+#else
+#define MBEDTLS_SSL_CIPHERSUITES MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256, \
+                                 MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256
+#endif
 #define MBEDTLS_SSL_SERVER_NAME_INDICATION
+#define MBEDTLS_SSL_SESSION_TICKETS
 #define MBEDTLS_AES_C
 #define MBEDTLS_ASN1_PARSE_C
 #define MBEDTLS_BIGNUM_C
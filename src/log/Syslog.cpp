@@ -0,0 +1,464 @@
+#include "Syslog.h"
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+#include <mutex>
+
+#include "pico/stdlib.h"
+#include "pico/stdio/driver.h"
+#include "pico/critical_section.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/udp.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "Fmutex.h"
+#include "WallClock.h"
+#include "metrics/Metrics.h"
+
+// =============================================================================
+//                             Syslog Implementation
+// =============================================================================
+
+namespace {
+
+struct Record {
+    bool used;
+    uint8_t severity;
+    uint32_t seq;                          // Order of logging; identifies the record.
+    uint32_t timestampMs;                  // to_ms_since_boot() when logged.
+    char module[Syslog::MAX_MODULE];
+    char text[SYSLOG_MAX_TEXT];
+};
+
+struct ModuleFilter {
+    char module[Syslog::MAX_MODULE];
+    uint8_t threshold;
+};
+
+// Record buffer and filters, guarded by 'lock'.
+critical_section_t lock;
+bool lockReady = false;
+Record records[SYSLOG_BUFFER_RECORDS];
+uint32_t nextSeq = 0;
+uint8_t threshold = SYSLOG_DEFAULT_THRESHOLD;
+ModuleFilter filters[Syslog::MAX_MODULE_FILTERS];
+size_t filterCount = 0;
+uint32_t sentCount = 0;
+uint32_t filteredCount = 0;
+uint32_t droppedCount = 0;
+uint32_t errorCount = 0;
+
+// Console capture. Lines are assembled here; the stdio mutex serializes printf calls.
+stdio_driver_t captureDriver;
+char line[Syslog::MAX_MODULE + SYSLOG_MAX_TEXT + 4];
+size_t lineLength = 0;
+
+// Task printing a line logged with log(); its console output is not captured again.
+Fmutex explicitAccess;
+volatile bool explicitActive = false;
+volatile TaskHandle_t explicitTask = nullptr;
+
+// UDP transport (log task only).
+ip_addr_t target;
+uint16_t targetPort = 0;
+struct udp_pcb* pcb = nullptr;
+char datagram[SYSLOG_MAX_TEXT + Syslog::MAX_MODULE + 96];
+
+// Counter values already added to the metrics registry.
+uint32_t reportedSent = 0;
+uint32_t reportedFiltered = 0;
+uint32_t reportedDropped = 0;
+uint32_t reportedErrors = 0;
+MetricId sentMetric = -1;
+MetricId filteredMetric = -1;
+MetricId droppedMetric = -1;
+MetricId errorsMetric = -1;
+
+const MetricDescriptor recordsDescriptor = {
+    "greenhouse_syslog_records_total", "Log records by outcome (sent, filtered by severity, dropped when the buffer was full).", MetricType::Counter };
+const MetricDescriptor errorsDescriptor = {
+    "greenhouse_syslog_send_errors_total", "Syslog datagrams lwIP could not send (retried later).", MetricType::Counter };
+
+const char* const severityNames[] = {
+    "emerg", "alert", "crit", "err", "warning", "notice", "info", "debug"
+};
+
+void copyString(char* out, const char* in, size_t length, size_t size) {
+    if (length > size - 1) length = size - 1;
+    memcpy(out, in, length);
+    out[length] = '\0';
+}
+
+// Threshold of 'module' (call with 'lock' held).
+uint8_t thresholdOf(const char* module) {
+    for (size_t i = 0; i < filterCount; i++) {
+        if (strcasecmp(filters[i].module, module) == 0) return filters[i].threshold;
+    }
+    return threshold;
+}
+
+/*
+    When the buffer is full, the least severe record is the victim, the oldest one among
+    equally severe records. A new record that is less severe than every buffered record
+    is dropped itself.
+*/
+void push(uint8_t severity, const char* module, size_t moduleLength, const char* text, size_t textLength) {
+    if (!lockReady) return;
+    char name[Syslog::MAX_MODULE];
+    copyString(name, module, moduleLength, sizeof(name));
+    uint32_t nowMs = to_ms_since_boot(get_absolute_time());
+
+    critical_section_enter_blocking(&lock);
+    if (severity > thresholdOf(name)) {
+        filteredCount++;
+        critical_section_exit(&lock);
+        return;
+    }
+
+    Record* slot = nullptr;
+    for (auto& r : records) {
+        if (!r.used) { slot = &r; break; }
+        if (!slot || r.severity > slot->severity ||
+            (r.severity == slot->severity && static_cast<int32_t>(r.seq - slot->seq) < 0)) {
+            slot = &r;
+        }
+    }
+    if (slot->used) {
+        droppedCount++;
+        if (slot->severity < severity) {
+            critical_section_exit(&lock);
+            return;
+        }
+    }
+    slot->used = true;
+    slot->severity = severity;
+    slot->seq = nextSeq++;
+    slot->timestampMs = nowMs;
+    memcpy(slot->module, name, sizeof(name));
+    copyString(slot->text, text, textLength, sizeof(slot->text));
+    critical_section_exit(&lock);
+}
+
+bool contains(const char* text, const char* word) {
+    size_t length = strlen(word);
+    for (const char* p = text; *p; p++) {
+        if (strncasecmp(p, word, length) == 0) return true;
+    }
+    return false;
+}
+
+// Splits a console line into module and text, guesses the severity and buffers it.
+void captureLine() {
+    line[lineLength] = '\0';
+    const char* text = line;
+    const char* module = "-";
+    size_t moduleLength = 1;
+
+    const char* end;
+    if (line[0] == '[' && (end = strchr(line, ']')) != nullptr && end - line - 1 < static_cast<int>(Syslog::MAX_MODULE)) {
+        module = line + 1;                                    // "[Cloud] ..."
+        moduleLength = static_cast<size_t>(end - module);
+        text = end + 1;
+    } else {
+        size_t word = strcspn(line, ": ");
+        if (word > 0 && word < Syslog::MAX_MODULE && line[word] == ':') {
+            module = line;                                    // "initTask: ..."
+            moduleLength = word;
+            text = line + word + 1;
+        }
+    }
+    while (*text == ' ') text++;
+    if (*text == '\0') return;
+
+    LogSeverity severity = LogSeverity::Info;
+    if (contains(text, "error") || contains(text, "fail") || contains(text, "invalid")) {
+        severity = LogSeverity::Error;
+    } else if (contains(text, "warn") || contains(text, "timeout") || contains(text, "timed out")) {
+        severity = LogSeverity::Warning;
+    }
+    push(static_cast<uint8_t>(severity), module, moduleLength, text, strlen(text));
+}
+
+// stdio driver output: called for every printf with the stdio mutex held.
+void captureChars(const char* buf, int length) {
+    if (explicitActive && xTaskGetCurrentTaskHandle() == explicitTask) return;
+    for (int i = 0; i < length; i++) {
+        char c = buf[i];
+        if (c == '\n') {
+            if (lineLength > 0) captureLine();
+            lineLength = 0;
+        } else if (c != '\r' && lineLength < sizeof(line) - 1) {
+            line[lineLength++] = c;
+        }
+    }
+}
+
+// Copies the oldest buffered record. Returns false if there is none.
+bool peekOldest(Record& out) {
+    bool found = false;
+    critical_section_enter_blocking(&lock);
+    const Record* oldest = nullptr;
+    for (const auto& r : records) {
+        if (r.used && (!oldest || static_cast<int32_t>(r.seq - oldest->seq) < 0)) oldest = &r;
+    }
+    if (oldest) {
+        out = *oldest;
+        found = true;
+    }
+    critical_section_exit(&lock);
+    return found;
+}
+
+// Removes a sent record, unless it was dropped in the meantime.
+void removeRecord(uint32_t seq) {
+    critical_section_enter_blocking(&lock);
+    for (auto& r : records) {
+        if (r.used && r.seq == seq) r.used = false;
+    }
+    sentCount++;
+    critical_section_exit(&lock);
+}
+
+// Formats a record as an RFC 5424 message: <PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID MSGID SD MSG
+size_t formatMessage(const Record& r, char* out, size_t size) {
+    char timestamp[32] = "-";
+    uint64_t utcMs = WallClock::toUtcMs(r.timestampMs);
+    if (utcMs) {
+        size_t n = WallClock::formatIso8601(utcMs, timestamp, sizeof(timestamp));
+        if (n > 0) {
+            // "...:56Z" -> "...:56.789Z"
+            snprintf(timestamp + n - 1, sizeof(timestamp) - n + 1, ".%03uZ", static_cast<unsigned>(utcMs % 1000));
+        }
+    }
+    // MSGID must be printable ASCII without spaces.
+    char msgId[Syslog::MAX_MODULE];
+    strcpy(msgId, r.module[0] ? r.module : "-");
+    for (char* p = msgId; *p; p++) {
+        if (*p <= ' ' || *p > '~') *p = '_';
+    }
+    int n = snprintf(out, size, "<%u>1 %s " SYSLOG_HOSTNAME " " SYSLOG_APP_NAME " - %s - %s",
+                     static_cast<unsigned>(SYSLOG_FACILITY * 8 + r.severity), timestamp, msgId, r.text);
+    if (n < 0) return 0;
+    return static_cast<size_t>(n) < size ? static_cast<size_t>(n) : size - 1;
+}
+
+void reportMetrics() {
+    critical_section_enter_blocking(&lock);
+    uint32_t sent = sentCount, filtered = filteredCount, dropped = droppedCount, errors = errorCount;
+    critical_section_exit(&lock);
+    g_metrics.inc(sentMetric, sent - reportedSent);
+    g_metrics.inc(filteredMetric, filtered - reportedFiltered);
+    g_metrics.inc(droppedMetric, dropped - reportedDropped);
+    g_metrics.inc(errorsMetric, errors - reportedErrors);
+    reportedSent = sent;
+    reportedFiltered = filtered;
+    reportedDropped = dropped;
+    reportedErrors = errors;
+}
+
+}
+
+// ----------------------------------------------------------------------------
+// init() / start()
+// ----------------------------------------------------------------------------
+void Syslog::init() {
+    if (lockReady) return;
+    critical_section_init(&lock);
+    lockReady = true;
+    captureDriver.out_chars = captureChars;
+    stdio_set_driver_enabled(&captureDriver, true);
+}
+
+bool Syslog::start(const char* host, uint16_t port) {
+    init();
+    if (!ipaddr_aton(host, &target)) {
+        printf("[Syslog] Invalid collector address '%s'\n", host);
+        return false;
+    }
+    targetPort = port;
+    sentMetric     = g_metrics.add(recordsDescriptor, "outcome=\"sent\"");
+    filteredMetric = g_metrics.add(recordsDescriptor, "outcome=\"filtered\"");
+    droppedMetric  = g_metrics.add(recordsDescriptor, "outcome=\"dropped\"");
+    errorsMetric   = g_metrics.add(errorsDescriptor);
+
+    cyw43_arch_lwip_begin();
+    pcb = udp_new_ip_type(IPADDR_TYPE_V4);
+    cyw43_arch_lwip_end();
+    if (!pcb) {
+        printf("[Syslog] Failed to create UDP pcb\n");
+        return false;
+    }
+    printf("[Syslog] Sending log records to %s:%u\n", host, port);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// flush(): send buffered records (log task).
+// ----------------------------------------------------------------------------
+/*
+    Nothing is printed here: the output would be captured and sent again. As in
+    LineProtocolExporter, the pbuf references the datagram buffer, which lwIP copies if
+    it has to queue the packet.
+*/
+size_t Syslog::flush() {
+    if (!pcb) return 0;
+
+    size_t sent = 0;
+    Record record;
+    while (sent < SYSLOG_BURST && peekOldest(record)) {
+        size_t length = formatMessage(record, datagram, sizeof(datagram));
+
+        err_t err = ERR_MEM;
+        cyw43_arch_lwip_begin();
+        struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, static_cast<u16_t>(length), PBUF_REF);
+        if (p) {
+            p->payload = datagram;
+            err = udp_sendto(pcb, p, &target, targetPort);
+            pbuf_free(p);
+        }
+        cyw43_arch_lwip_end();
+
+        if (err != ERR_OK) {
+            // Out of buffers or no route yet: keep the record and retry at the next flush.
+            critical_section_enter_blocking(&lock);
+            errorCount++;
+            critical_section_exit(&lock);
+            break;
+        }
+        removeRecord(record.seq);
+        sent++;
+    }
+    reportMetrics();
+    return sent;
+}
+
+// ----------------------------------------------------------------------------
+// Logging
+// ----------------------------------------------------------------------------
+/*
+    From an interrupt handler the record is only buffered. Otherwise the line is printed
+    as well; explicitTask keeps the capture driver from turning it into a second record
+    (other tasks' output is still captured). explicitAccess serializes the tasks that
+    log this way.
+*/
+void Syslog::vlog(LogSeverity severity, const char* module, const char* format, va_list args) {
+    char text[SYSLOG_MAX_TEXT];
+    int n = vsnprintf(text, sizeof(text), format, args);
+    if (n < 0) return;
+    size_t length = static_cast<size_t>(n) < sizeof(text) ? static_cast<size_t>(n) : sizeof(text) - 1;
+    if (!module) module = "-";
+    push(static_cast<uint8_t>(severity), module, strlen(module), text, length);
+
+    if (__get_current_exception() != 0) return;
+    auto print = [module, text]() {
+        explicitTask = xTaskGetCurrentTaskHandle();
+        explicitActive = true;
+        if (strcmp(module, "-") == 0) printf("%s\n", text);
+        else printf("[%s] %s\n", module, text);
+        explicitActive = false;
+    };
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+        print();
+    } else {
+        std::lock_guard<Fmutex> exclusive(explicitAccess);
+        print();
+    }
+}
+
+void Syslog::log(LogSeverity severity, const char* module, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vlog(severity, module, format, args);
+    va_end(args);
+}
+
+void Syslog::error(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vlog(LogSeverity::Error, nullptr, format, args);
+    va_end(args);
+}
+
+void Syslog::warning(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vlog(LogSeverity::Warning, nullptr, format, args);
+    va_end(args);
+}
+
+void Syslog::info(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vlog(LogSeverity::Info, nullptr, format, args);
+    va_end(args);
+}
+
+void Syslog::debug(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vlog(LogSeverity::Debug, nullptr, format, args);
+    va_end(args);
+}
+
+// ----------------------------------------------------------------------------
+// Filtering
+// ----------------------------------------------------------------------------
+void Syslog::setThreshold(LogSeverity severity) {
+    if (!lockReady) init();
+    critical_section_enter_blocking(&lock);
+    threshold = static_cast<uint8_t>(severity);
+    critical_section_exit(&lock);
+}
+
+bool Syslog::setModuleThreshold(const char* module, LogSeverity severity) {
+    if (!lockReady) init();
+    bool ok = false;
+    critical_section_enter_blocking(&lock);
+    for (size_t i = 0; i < filterCount && !ok; i++) {
+        if (strcasecmp(filters[i].module, module) == 0) {
+            filters[i].threshold = static_cast<uint8_t>(severity);
+            ok = true;
+        }
+    }
+    if (!ok && filterCount < MAX_MODULE_FILTERS) {
+        copyString(filters[filterCount].module, module, strlen(module), MAX_MODULE);
+        filters[filterCount].threshold = static_cast<uint8_t>(severity);
+        filterCount++;
+        ok = true;
+    }
+    critical_section_exit(&lock);
+    return ok;
+}
+
+void Syslog::clearModuleThresholds() {
+    if (!lockReady) init();
+    critical_section_enter_blocking(&lock);
+    filterCount = 0;
+    critical_section_exit(&lock);
+}
+
+bool Syslog::parseSeverity(const char* text, LogSeverity& severity) {
+    if (text[0] >= '0' && text[0] <= '7' && text[1] == '\0') {
+        severity = static_cast<LogSeverity>(text[0] - '0');
+        return true;
+    }
+    for (size_t i = 0; i < sizeof(severityNames) / sizeof(severityNames[0]); i++) {
+        if (strcasecmp(text, severityNames[i]) == 0) {
+            severity = static_cast<LogSeverity>(i);
+            return true;
+        }
+    }
+    // Common long forms.
+    if (strcasecmp(text, "error") == 0)    { severity = LogSeverity::Error; return true; }
+    if (strcasecmp(text, "critical") == 0) { severity = LogSeverity::Critical; return true; }
+    if (strcasecmp(text, "warn") == 0)     { severity = LogSeverity::Warning; return true; }
+    return false;
+}
+
+uint32_t Syslog::getDroppedCount() {
+    if (!lockReady) return 0;
+    critical_section_enter_blocking(&lock);
+    uint32_t dropped = droppedCount;
+    critical_section_exit(&lock);
+    return dropped;
+}
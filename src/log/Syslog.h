@@ -0,0 +1,103 @@
+#ifndef SYSLOG_H
+#define SYSLOG_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdarg>
+#include "syslog_config.h"
+
+// Syslog severities (RFC 5424); a lower value is more severe.
+enum class LogSeverity : uint8_t {
+    Emergency = 0,
+    Alert     = 1,
+    Critical  = 2,
+    Error     = 3,
+    Warning   = 4,
+    Notice    = 5,
+    Info      = 6,
+    Debug     = 7
+};
+
+/*
+   Syslog Module Header
+
+   Remote logging for deployed units, where nobody watches the UART console. Log records
+   are buffered in RAM and sent as RFC 5424 syslog messages over UDP to the collector
+   configured in syslog_config.h, e.g.
+
+       <134>1 2024-06-10T12:34:56.789Z greenhouse-pico greenhouse - Cloud - ThingSpeak update successful (3 samples).
+
+   Key properties:
+     - init() installs an additional stdio driver, so every printf line becomes a record
+       without changing the existing code. The module is taken from the "[Module]" prefix
+       used throughout the firmware (or a "name:" prefix) and becomes the MSGID. Lines
+       mentioning an error or failure are logged as Error, warnings and timeouts as
+       Warning, everything else as Info. log() records an explicit severity; it prints the
+       line on the console as well and may also be called from interrupt handlers (the
+       record is then only buffered, not printed).
+     - Records below the severity threshold are discarded when they are logged. The
+       threshold can be changed at runtime, globally or per module (LOG= command, see
+       commands/Command.h).
+     - Up to SYSLOG_BUFFER_RECORDS records wait in a fixed buffer. When it is full, the
+       least severe (and among those the oldest) record is dropped to make room, so a slow
+       or unreachable collector loses debug and info output before warnings and errors.
+     - flush() is called by the log task and sends buffered records in bursts of at most
+       SYSLOG_BURST datagrams, one message per datagram as RFC 5426 requires. A record is
+       removed only after lwIP accepted it; if lwIP is out of buffers the burst stops
+       and the record is retried at the next flush.
+     - Records store the time since boot; the UTC timestamp is added when the record is
+       sent, so records logged before the wall clock was synchronized get a correct
+       time too. Until then the TIMESTAMP field is "-" (NILVALUE).
+     - Records sent, filtered and dropped are counted in the metrics registry.
+
+   Buffering is protected by a spin lock with interrupts disabled, so logging never
+   blocks and is safe from any task or interrupt handler.
+*/
+class Syslog {
+public:
+    static constexpr size_t MAX_MODULE = 16;
+    static constexpr size_t MAX_MODULE_FILTERS = 8;
+
+    // Starts capturing the console output into the record buffer. Call once, early
+    // (records are kept until the collector can be reached).
+    static void init();
+
+    // Creates the UDP socket to the collector once the network is up. Returns false if
+    // 'host' is not a valid dotted IPv4 address.
+    static bool start(const char* host, uint16_t port = SYSLOG_PORT);
+
+    // Sends up to SYSLOG_BURST buffered records (log task). Returns the number sent.
+    static size_t flush();
+
+    // Logs a record with an explicit severity and module.
+    static void log(LogSeverity severity, const char* module, const char* format, ...)
+            __attribute__((format(printf, 3, 4)));
+    static void vlog(LogSeverity severity, const char* module, const char* format, va_list args);
+
+    // Shorthands without a module (MSGID "-").
+    static void error(const char* format, ...) __attribute__((format(printf, 1, 2)));
+    static void warning(const char* format, ...) __attribute__((format(printf, 1, 2)));
+    static void info(const char* format, ...) __attribute__((format(printf, 1, 2)));
+    static void debug(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+    // ------------------------------------------------------------------------
+    // Filtering
+    // ------------------------------------------------------------------------
+    // Records less severe than 'threshold' are discarded (unless a module filter applies).
+    static void setThreshold(LogSeverity threshold);
+
+    // Sets the threshold of one module (case-insensitive). Returns false if the filter
+    // table is full.
+    static bool setModuleThreshold(const char* module, LogSeverity threshold);
+
+    // Removes all module filters.
+    static void clearModuleThresholds();
+
+    // Parses "3", "err", "WARNING", "debug", ... Returns false if unknown.
+    static bool parseSeverity(const char* text, LogSeverity& severity);
+
+    // Records dropped because the buffer was full.
+    static uint32_t getDroppedCount();
+};
+
+#endif // SYSLOG_H
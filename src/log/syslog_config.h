@@ -0,0 +1,56 @@
+#ifndef GREENHOUSE_SYSLOG_CONFIG_H
+#define GREENHOUSE_SYSLOG_CONFIG_H
+
+// -----------------------------------------------------------------------------
+// Syslog Configuration:
+// The console output (every printf line) and the records logged with Syslog::log() are
+// sent as RFC 5424 syslog messages over UDP (RFC 5426) to a collector on the local
+// network. The UART console keeps working as before. Remote logging is only built into
+// the system when SYSLOG_HOST is defined.
+//
+// For testing with a local listener on the development PC:
+//   - define SYSLOG_HOST as the PC's IP address and SYSLOG_PORT 5514,
+//   - watch the messages:   nc -klu 5514        (or: socat -u UDP-RECV:5514 -)
+//   - rsyslog:              module(load="imudp") input(type="imudp" port="5514")
+// -----------------------------------------------------------------------------
+
+// Collector IPv4 address (dotted). Leave undefined to disable remote logging.
+//#define SYSLOG_HOST "192.168.1.10"
+
+// Collector UDP port (514 is the standard syslog port).
+#ifndef SYSLOG_PORT
+#define SYSLOG_PORT 514
+#endif
+
+// HOSTNAME and APP-NAME fields of every message.
+#define SYSLOG_HOSTNAME "greenhouse-pico"
+#define SYSLOG_APP_NAME "greenhouse"
+
+// Facility code: 16 = local0.
+#define SYSLOG_FACILITY 16
+
+// Records more severe than or equal to this are sent unless a module filter says
+// otherwise (0 = emergency ... 7 = debug). Changed at runtime with the LOG= command.
+#ifndef SYSLOG_DEFAULT_THRESHOLD
+#define SYSLOG_DEFAULT_THRESHOLD 6
+#endif
+
+// Records buffered while the collector cannot be reached. When the buffer is full the
+// least severe record is dropped first.
+#ifndef SYSLOG_BUFFER_RECORDS
+#define SYSLOG_BUFFER_RECORDS 32
+#endif
+
+// Longest message text kept per record; longer lines are cut off.
+#define SYSLOG_MAX_TEXT 96
+
+// The log task sends buffered records every SYSLOG_FLUSH_MS, at most SYSLOG_BURST
+// datagrams at a time.
+#ifndef SYSLOG_FLUSH_MS
+#define SYSLOG_FLUSH_MS 1000
+#endif
+#ifndef SYSLOG_BURST
+#define SYSLOG_BURST 8
+#endif
+
+#endif // GREENHOUSE_SYSLOG_CONFIG_H
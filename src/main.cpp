@@ -24,6 +24,17 @@
 #include "./Controller/Controller.h"  // Contains Controller class for central decision-making
 #include "UI/ui.h"                    // Declares the UI class for OLED display and rotary encoder
 #include "cloud/cloud.h"              // Contains Cloud class for secure remote communication
+#include "cloud/MqttChannel.h"        // Optional MQTT telemetry and command channel
+#include "cloud/mqtt_config.h"        // MQTT broker configuration (MQTT_BROKER_HOST enables the channel)
+#include "http/StatusServer.h"         // Local HTTP status API (/status, /history, /metrics)
+#include "http/SampleLogExport.h"      // Sample log reader for the status server's /samples.csv
+#include "commands/CommandQueue.h"     // Remote commands shared by TalkBack, MQTT and the local API
+#include "log/Syslog.h"                // Remote syslog transport (SYSLOG_HOST in log/syslog_config.h)
+#include "cloud/LineProtocolExporter.h" // Optional UDP line-protocol export to a local collector
+#include "cloud/line_protocol_config.h" // Collector configuration (LINE_PROTOCOL_HOST enables the exporter)
+#include "cloud/HttpJsonSink.h"       // Optional telemetry sink for a generic HTTP JSON endpoint
+#include "cloud/http_sink_config.h"   // Endpoint configuration (HTTP_SINK_HOST enables the sink)
+#include "metrics/SystemMetrics.h"     // Heap, task and Controller metrics for /metrics
 #include "PicoOsUart.h"               // Wrapper for UART operations on Pico board (used by Modbus)
 #include "ssd1306os.h"                // Driver for the SSD1306 OLED display over I2C
 #include "PicoI2C.h"                  // Abstraction for I2C communication on the Pico
@@ -34,10 +45,14 @@
 #include "./FanDriver/FanDriver.h"    // Driver for fan control via Modbus register
 #include "./ValveDriver/ValveDriver.h"// Driver for CO₂ valve control using GPIO
 #include "EEPROM/EEPROMStorage.h"     // Driver for external EEPROM storage (for persisting setpoints)
+#include "EEPROM/ConfigStore.h"       // Journaled key-value store for the settings on the EEPROM
+#include "EEPROM/ConfigCache.h"       // Write-behind cache of the settings, flushed by eepromTask
+#include "EEPROM/SampleLog.h"         // Persistent telemetry history on the EEPROM
 #include "ModbusClient.h"             // Provides Modbus RTU client functionality over UART
 #include "ModbusRegister.h"           // Represents a Modbus register for sensor/actuator data
 #include "systemTasks/init-data.h."   // Global initialization structure definition
 #include "IPStack.h"                  // Provides network stack abstractions
+#include "WallClock.h"                // UTC time from SNTP for timestamps
 #include "cloud/cloud.h"              // Duplicate include; ensures Cloud module is defined (may be guarded)
 #include "Controller/Controller.h"    // Duplicate include; ensures Controller module is defined 
 #include "FreeRTOS.h"
@@ -86,6 +101,14 @@ static void setupTask(void *param) {
         // Optionally add code to handle connection failure (retry logic, error reporting, etc.)
     }
 
+    // Start SNTP; samples get wall-clock timestamps once the first NTP answer arrives.
+    WallClock::start();
+
+#ifdef SYSLOG_HOST
+    // Open the socket to the syslog collector; records buffered since boot are sent by syslogTask.
+    Syslog::start(SYSLOG_HOST);
+#endif
+
     ///////////////////////////////////////////////////////////////////////////////
     // Rotary Encoder Initialization
     ///////////////////////////////////////////////////////////////////////////////
@@ -123,10 +146,8 @@ static void setupTask(void *param) {
     // I2C and UART Setup for sensors, display and EEPROM storage.
     ///////////////////////////////////////////////////////////////////////////////
 
-    // 1) Initialize I2C instance for EEPROM:
-    // Use the Pico SDK's global I2C instance 'i2c0' at 400kHz
-    i2c_inst_t* eepromI2C = i2c0;
-    i2c_init(eepromI2C, 400000);
+    // 1) Create an I2C object for the EEPROM (bus 0 at 400kHz, SDA/SCL on EEPROM_SDA_PIN/EEPROM_SCL_PIN)
+    auto i2cEeprom = std::make_shared<PicoI2C>(0, 400000);
 
     // Create an I2C object to be used by the display and pressure sensor
     auto i2cDispPres = std::make_shared<PicoI2C>(1, 400000);  // Using I2C bus instance 1
@@ -181,8 +202,18 @@ static void setupTask(void *param) {
     // with I2C address 0x3C and a display resolution of 128x64 pixels.
     auto display = std::make_shared<ssd1306os>(i2cDispPres, 0x3C, 128, 64);
 
-    // Initialize EEPROM storage using I2C0, with designated SDA and SCL pins, and the device's I2C address.
-    auto eepromStore = std::make_shared<EEPROMStorage>(eepromI2C, EEPROM_SDA_PIN, EEPROM_SCL_PIN, EEPROM_DEVICE_ADDRESS);
+    // Initialize EEPROM storage on I2C bus 0 with the device's I2C address, page size and capacity.
+    auto eepromStore = std::make_shared<EEPROMStorage>(i2cEeprom, EEPROM_DEVICE_ADDRESS, EEPROM_PAGE_SIZE, EEPROM_SIZE_BYTES);
+
+    // Mount the configuration store (one scan of its EEPROM region) before the Controller loads its settings.
+    auto configStore = std::make_shared<ConfigStore>(eepromStore, CONFIG_STORE_START, CONFIG_STORE_SIZE);
+    configStore->mount();
+    // Settings are changed in RAM and written to the store by eepromTask (debounced).
+    auto configCache = std::make_shared<ConfigCache>(configStore);
+
+    // Mount the sample log that keeps the telemetry history on the EEPROM while a sink is offline.
+    auto sampleLog = std::make_shared<SampleLog>(eepromStore, SAMPLE_LOG_START, SAMPLE_LOG_SIZE);
+    sampleLog->mount();
 
     // Create a Modbus register for the Fan Driver at device address 1, register offset 0.
     auto produal_reg = std::make_shared<ModbusRegister>(rtu_client, 1, 0);
@@ -195,10 +226,64 @@ static void setupTask(void *param) {
     auto valveDriver = std::make_shared<ValveDriver>(27);
 
     // Instantiate the main Controller object that aggregates sensor data and controls actuators.
-    auto controller = std::make_shared<Controller>(co2Sensor, thrSensor, presSensor, fanDriver, valveDriver, eepromStore);
-
-    // Create the Cloud module instance for remote cloud communications, passing the controller pointer.
-    auto cloud = new Cloud(controller.get());
+    auto controller = std::make_shared<Controller>(co2Sensor, thrSensor, presSensor, fanDriver, valveDriver, configCache);
+
+    // Register the metrics that are collected when /metrics is scraped (heap, tasks, readings).
+    registerSystemMetrics(controller.get());
+
+    // Create the telemetry pipeline that hands every sample to the sinks; each sink gets its own
+    // bounded queue (store-and-forward) and upload schedule.
+    auto telemetryPipeline = std::make_shared<TelemetryPipeline>();
+    // Every record is also logged; a sink whose queue is full catches up from the log later.
+    telemetryPipeline->setLog(sampleLog);
+
+    // Create the change detector that records a sample only when a value moves beyond its
+    // deadband, a state changes, or the heartbeat interval elapses (report-by-exception).
+    auto changeDetector = std::make_shared<ChangeDetector>(controller.get(), telemetryPipeline);
+
+    // Create the command queue: every transport submits remote commands to it, sensorTask
+    // executes them and the acknowledgements travel back with the next upload.
+    auto commands = std::make_shared<CommandQueue>(controller.get(), configCache.get());
+
+    // Create the DNS cache shared by the cloud connections (TTL, background refresh, last-good fallback).
+    auto dnsCache = std::make_shared<DnsCache>();
+
+    // Create the Cloud module instance for remote cloud communications, passing the controller pointer,
+    // and register it as the ThingSpeak sink.
+    auto cloud = std::make_shared<Cloud>(controller.get(), commands, dnsCache);
+    telemetryPipeline->addSink(cloud);
+
+#ifdef HTTP_SINK_HOST
+    // Register the generic HTTP JSON endpoint as a further sink (only when configured).
+    telemetryPipeline->addSink(std::make_shared<HttpJsonSink>(HTTP_SINK_HOST, HTTP_SINK_PORT, dnsCache));
+#endif
+#ifdef MQTT_BROKER_HOST
+    // Create the MQTT channel for low-latency remote commands and register it as the MQTT sink
+    // (only when a broker is configured).
+    auto mqtt = std::make_shared<MqttChannel>(commands, dnsCache);
+    telemetryPipeline->addSink(mqtt, 60, 45);
+#endif
+    // Continue every sink at its persisted position in the sample log, so samples that were not
+    // delivered before the reset are sent now.
+    telemetryPipeline->resume(configCache);
+
+    // Create the local HTTP status server (/status, /history, /metrics, POST /command) and start listening.
+    auto statusServer = std::make_shared<StatusServer>();
+    statusServer->setCommandQueue(commands);
+    // /samples.csv streams the sample log; logExportTask reads it, so the lwIP thread never waits for I2C.
+    auto logExport = std::make_shared<SampleLogExport>(sampleLog);
+    statusServer->setSampleLogExport(logExport);
+    cyw43_arch_lwip_begin();
+    statusServer->start();
+    cyw43_arch_lwip_end();
+
+#ifdef LINE_PROTOCOL_HOST
+    // Create the UDP exporter that sends every sample to the local collector (only when configured).
+    auto lineExporter = std::make_shared<LineProtocolExporter>(LINE_PROTOCOL_HOST);
+    if (lineExporter->start()) {
+        g_initData.lineExporter = lineExporter;
+    }
+#endif
 
     // Instantiate the UI module to handle updating the OLED display and processing rotary encoder inputs.
     auto ui = std::make_shared<UI>(display, controller);
@@ -211,9 +296,16 @@ static void setupTask(void *param) {
 
     // Populate global initialization data structure so that other tasks can access shared objects.
     g_initData.eepromStore = eepromStore;
+    g_initData.configStore = configStore;
+    g_initData.configCache = configCache;
+    g_initData.sampleLog   = sampleLog;
     g_initData.controller  = controller;
     g_initData.ui          = ui;
     g_initData.sensorList  = sensorList;
+    g_initData.telemetryPipeline = telemetryPipeline;
+    g_initData.changeDetector = changeDetector;
+    g_initData.statusServer   = statusServer;
+    g_initData.commands       = commands;
 
     ///////////////////////////////////////////////////////////////////////////////
     // Create FreeRTOS Tasks for various functionalities
@@ -221,14 +313,24 @@ static void setupTask(void *param) {
 
     // Create rotaryEventTask to process asynchronous rotary encoder events from the ISR.
     xTaskCreate(rotaryEventTask, "RotaryEventTask", 256, ui.get(), tskIDLE_PRIORITY+1, nullptr);
-    // Create cloudTask to handle secure TLS communications for remote data reporting and command updates.
-    xTaskCreate(cloudTask, "cloudTask",  2048, cloud, tskIDLE_PRIORITY+1, nullptr);
-    // Create initTask to load stored EEPROM data (e.g., CO₂ setpoint) and initialize Controller/UI.
+    // Create cloudTask to run the telemetry pipeline (secure TLS uploads to ThingSpeak and the other sinks).
+    xTaskCreate(cloudTask, "cloudTask",  2048, telemetryPipeline.get(), tskIDLE_PRIORITY+1, nullptr);
+#ifdef MQTT_BROKER_HOST
+    // Create mqttTask for the broker connection and low-latency remote commands (only when a broker is configured).
+    xTaskCreate(mqttTask, "mqttTask", 1024, mqtt.get(), tskIDLE_PRIORITY+2, nullptr);
+#endif
+#ifdef SYSLOG_HOST
+    // Create syslogTask to ship the buffered log records to the remote collector (only when configured).
+    xTaskCreate(syslogTask, "SyslogTask", 512, nullptr, tskIDLE_PRIORITY+1, nullptr);
+#endif
+    // Create initTask to hand the stored settings (e.g., CO₂ setpoint) to the UI.
     xTaskCreate(initTask,   "InitTask",   1024, &g_initData,    tskIDLE_PRIORITY+3, nullptr);
-    // Create eepromTask to handle periodic EEPROM operations for persistence.
-    xTaskCreate(eepromTask, "EepromTask", 256,  eepromStore.get(), tskIDLE_PRIORITY+1, nullptr);
-    // Create sensorTask to periodically read sensor data and update the Controller.
-    xTaskCreate(sensorTask, "SensorTask", 512,  &g_initData,     tskIDLE_PRIORITY+1, nullptr);
+    // Create eepromTask to write changed settings to the EEPROM in the background.
+    xTaskCreate(eepromTask, "EepromTask", 512,  configCache.get(), tskIDLE_PRIORITY+1, nullptr);
+    // Create the task that reads the sample log for the status server's export.
+    xTaskCreate(logExportTask, "LogExportTask", 512, logExport.get(), tskIDLE_PRIORITY+1, nullptr);
+    // Create sensorTask to periodically read sensor data, execute remote commands and update the Controller.
+    xTaskCreate(sensorTask, "SensorTask", 768,  &g_initData,     tskIDLE_PRIORITY+1, nullptr);
     // Create uiTask to manage the OLED display and local user interactions.
     xTaskCreate(uiTask,     "UITask",     256,  ui.get(),       tskIDLE_PRIORITY+1, nullptr);
 
@@ -246,6 +348,10 @@ static void setupTask(void *param) {
 int main() {
     // Initialize standard I/O (needed for printf over UART/USB)
     stdio_init_all();
+#ifdef SYSLOG_HOST
+    // Capture the console output from the start, so the boot messages reach the collector too.
+    Syslog::init();
+#endif
     printf("==== Greenhouse Controller Boot ====\n");
 
     // Create the setupTask with a higher priority to ensure system initialization occurs before any dependent tasks.
@@ -30,10 +30,22 @@
 // The external EEPROM, which is used to persist critical parameters (e.g., CO₂ setpoint),
 // is connected on I2C bus 0.
 #define EEPROM_DEVICE_ADDRESS 0x50  // 7-bit I2C address of the EEPROM module
+#define EEPROM_PAGE_SIZE      64    // Write page size in bytes (24C256: 64, 24C512: 128)
+#define EEPROM_SIZE_BYTES     32768 // Capacity of the EEPROM in bytes (24C256)
+
+// EEPROM layout:
+// 0x0000-0x0001: CO₂ setpoint of the previous fixed layout (read once for migration).
+// 0x1000-0x2FFF: configuration store (journaled key-value records, 8 segments of 1 KiB).
+#define CONFIG_STORE_START 0x1000
+#define CONFIG_STORE_SIZE  0x2000
+// 0x3000-0x7FFF: sample log (telemetry history for offline periods, 160 blocks of 128 bytes).
+#define SAMPLE_LOG_START   0x3000
+#define SAMPLE_LOG_SIZE    0x5000
 
 
 // I2C0 Bus Pins for EEPROM:
-// These pins are dedicated to the EEPROM module, ensuring non-volatile storage of settings.
+// These pins are dedicated to the EEPROM module, ensuring non-volatile storage of settings
+// (PicoI2C configures them for bus 0).
 #define EEPROM_SDA_PIN 16  // Pin used for I²C0 data line (SDA) for EEPROM communication
 #define EEPROM_SCL_PIN 17  // Pin used for I²C0 clock line (SCL) for EEPROM communication
 
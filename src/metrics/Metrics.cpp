@@ -0,0 +1,278 @@
+#include "Metrics.h"
+#include <cstdio>
+#include <cstring>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+// =============================================================================
+//                        MetricsRegistry Implementation
+// =============================================================================
+
+/*
+   Metric values are written by many tasks and read by the lwIP thread while rendering.
+   Every access copies or updates a single metric inside a short critical section, which
+   is cheaper than a mutex and never blocks the writer. Registration also runs in a
+   critical section because it reorders order_.
+*/
+
+MetricsRegistry g_metrics;
+
+static const char* typeName(MetricType type) {
+    switch (type) {
+        case MetricType::Counter:   return "counter";
+        case MetricType::Gauge:     return "gauge";
+        case MetricType::Histogram: return "histogram";
+    }
+    return "untyped";
+}
+
+// snprintf() into the remaining space; returns false (and writes nothing) if the text does
+// not fit completely.
+template<typename... Args>
+static bool append(char* out, size_t size, size_t& length, const char* fmt, Args... args) {
+    int n = snprintf(out + length, size - length, fmt, args...);
+    if (n < 0 || static_cast<size_t>(n) >= size - length) return false;
+    length += static_cast<size_t>(n);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Constructor
+// ----------------------------------------------------------------------------
+MetricsRegistry::MetricsRegistry()
+        : metricCount_(0)
+        , histogramCount_(0)
+        , collectorCount_(0)
+{
+    memset(metrics_, 0, sizeof(metrics_));
+    memset(histograms_, 0, sizeof(histograms_));
+    memset(order_, 0, sizeof(order_));
+}
+
+// ----------------------------------------------------------------------------
+// Registration
+// ----------------------------------------------------------------------------
+/*
+    The new metric is inserted into order_ right after the last metric of the same family,
+    so that all samples of a family are rendered together under one HELP/TYPE header.
+*/
+MetricId MetricsRegistry::add(const MetricDescriptor& descriptor, const char* labels) {
+    if (!labels) labels = "";
+    MetricId id = -1;
+
+    taskENTER_CRITICAL();
+    for (size_t i = 0; i < metricCount_; i++) {
+        if (metrics_[i].descriptor == &descriptor && strcmp(metrics_[i].labels, labels) == 0) {
+            id = static_cast<MetricId>(i);
+            break;
+        }
+    }
+    bool histogram = descriptor.type == MetricType::Histogram;
+    if (id < 0 && metricCount_ < MAX_METRICS && (!histogram || histogramCount_ < MAX_HISTOGRAMS)) {
+        id = static_cast<MetricId>(metricCount_);
+        Metric& metric = metrics_[id];
+        metric.descriptor = &descriptor;
+        strncpy(metric.labels, labels, MAX_LABELS - 1);
+        metric.labels[MAX_LABELS - 1] = '\0';
+        metric.hidden = false;
+        metric.histogram = histogram ? static_cast<int8_t>(histogramCount_++) : -1;
+
+        size_t insertAt = metricCount_;
+        for (size_t i = 0; i < metricCount_; i++) {
+            if (metrics_[order_[i]].descriptor == &descriptor) insertAt = i + 1;
+        }
+        memmove(&order_[insertAt + 1], &order_[insertAt], metricCount_ - insertAt);
+        order_[insertAt] = static_cast<uint8_t>(id);
+        metricCount_++;
+    }
+    taskEXIT_CRITICAL();
+
+    if (id < 0) {
+        printf("[Metrics] Registry full, %s not registered.\n", descriptor.name);
+    }
+    return id;
+}
+
+bool MetricsRegistry::addCollector(Collector collector, void* context) {
+    bool added = false;
+    taskENTER_CRITICAL();
+    if (collectorCount_ < MAX_COLLECTORS) {
+        collectors_[collectorCount_] = collector;
+        collectorContexts_[collectorCount_] = context;
+        collectorCount_++;
+        added = true;
+    }
+    taskEXIT_CRITICAL();
+    return added;
+}
+
+// ----------------------------------------------------------------------------
+// Updates
+// ----------------------------------------------------------------------------
+bool MetricsRegistry::valid(MetricId id) const {
+    return id >= 0 && static_cast<size_t>(id) < metricCount_;
+}
+
+void MetricsRegistry::inc(MetricId id, uint32_t amount) {
+    if (!valid(id)) return;
+    taskENTER_CRITICAL();
+    metrics_[id].counter += amount;
+    taskEXIT_CRITICAL();
+}
+
+void MetricsRegistry::set(MetricId id, float value) {
+    if (!valid(id)) return;
+    taskENTER_CRITICAL();
+    metrics_[id].gauge = value;
+    taskEXIT_CRITICAL();
+}
+
+void MetricsRegistry::observe(MetricId id, float value) {
+    if (!valid(id) || metrics_[id].histogram < 0) return;
+    const MetricDescriptor* descriptor = metrics_[id].descriptor;
+    size_t bucket = 0;
+    while (bucket < descriptor->boundCount && bucket < MAX_BUCKETS && value > descriptor->bounds[bucket]) {
+        bucket++;
+    }
+    taskENTER_CRITICAL();
+    Histogram& histogram = histograms_[metrics_[id].histogram];
+    histogram.buckets[bucket]++;
+    histogram.count++;
+    histogram.sum += value;
+    taskEXIT_CRITICAL();
+}
+
+void MetricsRegistry::setLabels(MetricId id, const char* labels) {
+    if (!valid(id)) return;
+    taskENTER_CRITICAL();
+    strncpy(metrics_[id].labels, labels ? labels : "", MAX_LABELS - 1);
+    metrics_[id].labels[MAX_LABELS - 1] = '\0';
+    metrics_[id].hidden = false;
+    taskEXIT_CRITICAL();
+}
+
+void MetricsRegistry::hide(MetricId id) {
+    if (!valid(id)) return;
+    taskENTER_CRITICAL();
+    metrics_[id].hidden = true;
+    taskEXIT_CRITICAL();
+}
+
+uint32_t MetricsRegistry::getCounter(MetricId id) const {
+    if (!valid(id)) return 0;
+    return metrics_[id].counter;
+}
+
+// ----------------------------------------------------------------------------
+// Rendering
+// ----------------------------------------------------------------------------
+/*
+    Lines of a metric:
+      0          "# HELP" and "# TYPE" (first visible metric of a family only)
+      1          the value (counter, gauge)
+      1..n+1     cumulative buckets, the last one le="+Inf" (histogram)
+      n+2, n+3   _sum and _count (histogram)
+*/
+bool MetricsRegistry::renderLine(const Metric& metric, const Histogram& histogram, bool firstOfFamily,
+                                 uint8_t line, char* out, size_t size, size_t& length) const {
+    const MetricDescriptor& d = *metric.descriptor;
+    const char* open  = metric.labels[0] ? "{" : "";
+    const char* close = metric.labels[0] ? "}" : "";
+    length = 0;
+
+    if (line == 0) {
+        if (!firstOfFamily) return true;
+        if (!append(out, size, length, "# HELP %s %s\n# TYPE %s %s\n", d.name, d.help, d.name, typeName(d.type))) {
+            length = SIZE_MAX;
+        }
+        return true;
+    }
+
+    bool fits;
+    if (d.type == MetricType::Counter) {
+        if (line > 1) return false;
+        fits = append(out, size, length, "%s%s%s%s %lu\n", d.name, open, metric.labels, close,
+                      static_cast<unsigned long>(metric.counter));
+    } else if (d.type == MetricType::Gauge) {
+        if (line > 1) return false;
+        fits = append(out, size, length, "%s%s%s%s %g\n", d.name, open, metric.labels, close,
+                      static_cast<double>(metric.gauge));
+    } else {
+        size_t bounds = d.boundCount < MAX_BUCKETS ? d.boundCount : MAX_BUCKETS;
+        size_t index = line - 1;
+        const char* sep = metric.labels[0] ? "," : "";
+        if (index <= bounds) {
+            uint32_t cumulative = 0;
+            for (size_t i = 0; i <= index; i++) cumulative += histogram.buckets[i];
+            if (index < bounds) {
+                fits = append(out, size, length, "%s_bucket{%s%sle=\"%g\"} %lu\n", d.name, metric.labels, sep,
+                              static_cast<double>(d.bounds[index]), static_cast<unsigned long>(cumulative));
+            } else {
+                fits = append(out, size, length, "%s_bucket{%s%sle=\"+Inf\"} %lu\n", d.name, metric.labels, sep,
+                              static_cast<unsigned long>(histogram.count));
+            }
+        } else if (index == bounds + 1) {
+            fits = append(out, size, length, "%s_sum%s%s%s %g\n", d.name, open, metric.labels, close,
+                          static_cast<double>(histogram.sum));
+        } else if (index == bounds + 2) {
+            fits = append(out, size, length, "%s_count%s%s%s %lu\n", d.name, open, metric.labels, close,
+                          static_cast<unsigned long>(histogram.count));
+        } else {
+            return false;
+        }
+    }
+    if (!fits) length = SIZE_MAX;
+    return true;
+}
+
+/*
+    A line that does not fit ends the call; it is rendered first on the next call. A line
+    that does not even fit into an empty buffer is skipped so that rendering cannot stall.
+*/
+size_t MetricsRegistry::render(MetricsCursor& cursor, char* out, size_t size) {
+    if (cursor.position == 0 && cursor.line == 0) {
+        for (size_t i = 0; i < collectorCount_; i++) {
+            collectors_[i](collectorContexts_[i]);
+        }
+    }
+
+    size_t length = 0;
+    while (cursor.position < metricCount_) {
+        Metric metric;
+        Histogram histogram;
+        bool firstOfFamily = true;
+
+        taskENTER_CRITICAL();
+        metric = metrics_[order_[cursor.position]];
+        if (metric.histogram >= 0) {
+            histogram = histograms_[metric.histogram];
+        } else {
+            memset(&histogram, 0, sizeof(histogram));
+        }
+        for (size_t i = cursor.position; i > 0; i--) {
+            const Metric& previous = metrics_[order_[i - 1]];
+            if (previous.descriptor != metric.descriptor) break;
+            if (!previous.hidden) {
+                firstOfFamily = false;
+                break;
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        size_t lineLength = 0;
+        if (metric.hidden ||
+            !renderLine(metric, histogram, firstOfFamily, cursor.line, out + length, size - length, lineLength)) {
+            cursor.position++;
+            cursor.line = 0;
+            continue;
+        }
+        if (lineLength == SIZE_MAX) {
+            if (length > 0) break;
+            lineLength = 0;        // Too long for the buffer: skip it.
+        }
+        length += lineLength;
+        cursor.line++;
+    }
+    return length;
+}
@@ -0,0 +1,132 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <cstdint>
+#include <cstddef>
+
+/*
+   Kind of a metric, as reported in the "# TYPE" line of the Prometheus text format.
+*/
+enum class MetricType : uint8_t { Counter, Gauge, Histogram };
+
+/*
+   Static description of a metric family. Modules define their descriptors as constants
+   and register one metric per label set, e.g.
+
+       static const MetricDescriptor modbusErrors = {
+           "greenhouse_modbus_errors_total", "Failed Modbus requests.", MetricType::Counter };
+
+   Histogram bucket bounds are upper bounds in ascending order (at most MAX_BUCKETS);
+   the +Inf bucket is added automatically.
+*/
+struct MetricDescriptor {
+    const char* name;
+    const char* help;
+    MetricType type;
+    const float* bounds = nullptr;
+    uint8_t boundCount = 0;
+};
+
+// Handle of a registered metric; negative when registration failed.
+using MetricId = int16_t;
+
+// Position of an unfinished render() pass.
+struct MetricsCursor {
+    uint16_t position = 0;    // Index into the sorted metric order.
+    uint8_t line = 0;         // Line within the metric (header, buckets, sum, count).
+};
+
+/*
+   MetricsRegistry Module Header
+
+   A fixed-size registry of counters, gauges and histograms describing the firmware
+   internals, rendered in the Prometheus text exposition format by the status server
+   (GET /metrics).
+
+   Key properties:
+     - All storage is statically sized (MAX_METRICS metrics, MAX_HISTOGRAMS histograms).
+       Modules register their metrics once at start-up and keep the returned MetricId;
+       registering the same descriptor and labels again returns the existing id.
+     - Updates (inc(), set(), observe()) are a few instructions inside a critical section,
+       so they can be called from any task, including time-critical driver code.
+     - Metrics are kept ordered by family, so render() is a single pass over the fixed
+       arrays. It produces whole lines only and continues where it stopped, so the output
+       can be streamed through a small buffer.
+     - Values that are cheaper to read on demand (heap, task statistics, Controller
+       readings) are refreshed by collector functions at the start of each render pass.
+
+   A metric can be hidden with hide(), e.g. an unused label slot; it is then skipped.
+*/
+class MetricsRegistry {
+public:
+    static constexpr size_t MAX_METRICS = 128;
+    static constexpr size_t MAX_HISTOGRAMS = 10;
+    static constexpr size_t MAX_BUCKETS = 8;
+    static constexpr size_t MAX_LABELS = 32;
+    static constexpr size_t MAX_COLLECTORS = 6;
+
+    using Collector = void (*)(void* context);
+
+    MetricsRegistry();
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+
+    // Registers a metric with an optional label set (e.g. "slave=\"240\""). Returns -1 if
+    // the registry is full.
+    MetricId add(const MetricDescriptor& descriptor, const char* labels = nullptr);
+
+    // Registers a function that refreshes gauges before each render pass.
+    bool addCollector(Collector collector, void* context);
+
+    // Updates.
+    void inc(MetricId id, uint32_t amount = 1);
+    void set(MetricId id, float value);
+    void observe(MetricId id, float value);
+
+    // Changes the label set of a metric and shows it again (used by collectors).
+    void setLabels(MetricId id, const char* labels);
+    void hide(MetricId id);
+
+    uint32_t getCounter(MetricId id) const;
+
+    // Renders the next lines into 'out'. Start with a default cursor; returns 0 when
+    // all metrics have been rendered.
+    size_t render(MetricsCursor& cursor, char* out, size_t size);
+
+private:
+    struct Metric {
+        const MetricDescriptor* descriptor;
+        char labels[MAX_LABELS];
+        bool hidden;
+        int8_t histogram;      // Index into histograms_ for histograms, otherwise -1.
+        uint32_t counter;
+        float gauge;
+    };
+
+    struct Histogram {
+        uint32_t buckets[MAX_BUCKETS + 1];   // Non-cumulative counts; last is +Inf.
+        uint32_t count;
+        float sum;
+    };
+
+    Metric metrics_[MAX_METRICS];
+    Histogram histograms_[MAX_HISTOGRAMS];
+    uint8_t order_[MAX_METRICS];             // Metric ids grouped by family.
+    size_t metricCount_;
+    size_t histogramCount_;
+
+    Collector collectors_[MAX_COLLECTORS];
+    void* collectorContexts_[MAX_COLLECTORS];
+    size_t collectorCount_;
+
+    bool valid(MetricId id) const;
+
+    // Renders one line of the metric; returns false when the metric has no such line.
+    bool renderLine(const Metric& metric, const Histogram& histogram, bool firstOfFamily,
+                    uint8_t line, char* out, size_t size, size_t& length) const;
+};
+
+// The registry shared by all modules.
+extern MetricsRegistry g_metrics;
+
+#endif // METRICS_H
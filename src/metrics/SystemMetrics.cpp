@@ -0,0 +1,164 @@
+#include "SystemMetrics.h"
+#include "Metrics.h"
+#include <cstdio>
+#include <mutex>
+
+#include "pico/stdlib.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "Fmutex.h"
+
+// =============================================================================
+//                         System metrics (collected on scrape)
+// =============================================================================
+
+// Number of tasks that can be reported; the firmware runs about a dozen.
+static constexpr size_t MAX_TASKS = 16;
+
+static const MetricDescriptor uptimeMetric = {
+    "greenhouse_uptime_seconds", "Time since boot.", MetricType::Gauge };
+static const MetricDescriptor heapFreeMetric = {
+    "greenhouse_heap_free_bytes", "Free FreeRTOS heap.", MetricType::Gauge };
+static const MetricDescriptor heapMinFreeMetric = {
+    "greenhouse_heap_min_free_bytes", "Lowest free FreeRTOS heap since boot.", MetricType::Gauge };
+static const MetricDescriptor taskCountMetric = {
+    "greenhouse_tasks", "Number of FreeRTOS tasks.", MetricType::Gauge };
+static const MetricDescriptor taskCpuMetric = {
+    "greenhouse_task_cpu_percent", "CPU share of the task since the previous scrape.", MetricType::Gauge };
+static const MetricDescriptor taskStackMetric = {
+    "greenhouse_task_stack_free_bytes", "Stack high-water mark: stack never used by the task.", MetricType::Gauge };
+
+static const MetricDescriptor co2Metric = {
+    "greenhouse_co2_ppm", "Measured CO2 concentration.", MetricType::Gauge };
+static const MetricDescriptor rhMetric = {
+    "greenhouse_relative_humidity_percent", "Measured relative humidity.", MetricType::Gauge };
+static const MetricDescriptor tempMetric = {
+    "greenhouse_temperature_celsius", "Measured temperature.", MetricType::Gauge };
+static const MetricDescriptor pressureMetric = {
+    "greenhouse_pressure_pascal", "Measured differential pressure.", MetricType::Gauge };
+static const MetricDescriptor fanMetric = {
+    "greenhouse_fan_speed_percent", "Commanded fan speed.", MetricType::Gauge };
+static const MetricDescriptor setpointMetric = {
+    "greenhouse_co2_setpoint_ppm", "CO2 setpoint.", MetricType::Gauge };
+static const MetricDescriptor valveMetric = {
+    "greenhouse_valve_open", "1 while the CO2 valve is open.", MetricType::Gauge };
+static const MetricDescriptor safetyVentMetric = {
+    "greenhouse_safety_vent", "1 while the high-CO2 safety ventilation is active.", MetricType::Gauge };
+
+/*
+   Ids of the registered metrics and the run-time counters of the previous scrape, used to
+   compute the CPU share of each task over the scrape interval.
+*/
+static struct {
+    Controller* controller;
+    MetricId uptime, heapFree, heapMinFree, taskCount;
+    MetricId cpu[MAX_TASKS];
+    MetricId stack[MAX_TASKS];
+    MetricId co2, rh, temp, pressure, fan, setpoint, valve, safetyVent;
+
+    TaskStatus_t status[MAX_TASKS];
+    UBaseType_t lastTaskNumber[MAX_TASKS];
+    uint32_t lastRunTime[MAX_TASKS];
+    size_t lastCount;
+    uint32_t lastTotalRunTime;
+} sys;
+
+// Scrapes run in the lwIP thread (Prometheus) and in the sensor task (DIAG command); one at
+// a time may use sys.status and the run-time counters of the previous scrape. The lwIP
+// thread must not wait for a DIAG dump, so a scrape that finds it taken skips the task
+// metrics and reports those of the scrape in progress.
+static Fmutex scrape;
+
+static uint32_t previousRunTime(UBaseType_t taskNumber) {
+    for (size_t i = 0; i < sys.lastCount; i++) {
+        if (sys.lastTaskNumber[i] == taskNumber) return sys.lastRunTime[i];
+    }
+    return 0;
+}
+
+/*
+    Task metrics occupy a fixed set of slots whose labels are set to the task names on
+    every scrape; unused slots are hidden. The run-time counter is 32 bits of microseconds,
+    so the differences stay correct across one wrap (about 71 minutes between scrapes).
+*/
+static void collectTasks() {
+    std::unique_lock<Fmutex> exclusive(scrape, std::try_to_lock);
+    if (!exclusive.owns_lock()) {
+        return;
+    }
+    uint32_t totalRunTime = 0;
+    UBaseType_t count = uxTaskGetSystemState(sys.status, MAX_TASKS, &totalRunTime);
+    g_metrics.set(sys.taskCount, static_cast<float>(uxTaskGetNumberOfTasks()));
+
+    uint32_t elapsed = totalRunTime - sys.lastTotalRunTime;
+    char labels[MetricsRegistry::MAX_LABELS];
+    for (size_t i = 0; i < MAX_TASKS; i++) {
+        if (i >= count) {
+            g_metrics.hide(sys.cpu[i]);
+            g_metrics.hide(sys.stack[i]);
+            continue;
+        }
+        const TaskStatus_t& task = sys.status[i];
+        snprintf(labels, sizeof(labels), "task=\"%s\"", task.pcTaskName);
+        g_metrics.setLabels(sys.cpu[i], labels);
+        g_metrics.setLabels(sys.stack[i], labels);
+
+        uint32_t used = task.ulRunTimeCounter - previousRunTime(task.xTaskNumber);
+        g_metrics.set(sys.cpu[i], elapsed > 0 ? 100.0f * used / elapsed : 0.0f);
+        g_metrics.set(sys.stack[i], static_cast<float>(task.usStackHighWaterMark * sizeof(StackType_t)));
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        sys.lastTaskNumber[i] = sys.status[i].xTaskNumber;
+        sys.lastRunTime[i] = sys.status[i].ulRunTimeCounter;
+    }
+    sys.lastCount = count;
+    sys.lastTotalRunTime = totalRunTime;
+}
+
+static void collect(void*) {
+    g_metrics.set(sys.uptime, to_ms_since_boot(get_absolute_time()) / 1000.0f);
+    g_metrics.set(sys.heapFree, static_cast<float>(xPortGetFreeHeapSize()));
+    g_metrics.set(sys.heapMinFree, static_cast<float>(xPortGetMinimumEverFreeHeapSize()));
+    collectTasks();
+
+    if (sys.controller) {
+        ControllerSnapshot s = sys.controller->getSnapshot();
+        g_metrics.set(sys.co2, s.co2);
+        g_metrics.set(sys.rh, s.rh);
+        g_metrics.set(sys.temp, s.temp);
+        g_metrics.set(sys.pressure, s.pressure);
+        g_metrics.set(sys.fan, s.fanSpeed);
+        g_metrics.set(sys.setpoint, s.setpoint);
+        g_metrics.set(sys.valve, s.valveOpen ? 1.0f : 0.0f);
+        g_metrics.set(sys.safetyVent, s.safetyVent ? 1.0f : 0.0f);
+    }
+}
+
+void registerSystemMetrics(Controller* controller) {
+    sys.controller  = controller;
+    sys.uptime      = g_metrics.add(uptimeMetric);
+    sys.heapFree    = g_metrics.add(heapFreeMetric);
+    sys.heapMinFree = g_metrics.add(heapMinFreeMetric);
+    sys.taskCount   = g_metrics.add(taskCountMetric);
+
+    char labels[MetricsRegistry::MAX_LABELS];
+    for (size_t i = 0; i < MAX_TASKS; i++) {
+        snprintf(labels, sizeof(labels), "slot=\"%u\"", static_cast<unsigned>(i));
+        sys.cpu[i]   = g_metrics.add(taskCpuMetric, labels);
+        sys.stack[i] = g_metrics.add(taskStackMetric, labels);
+        g_metrics.hide(sys.cpu[i]);
+        g_metrics.hide(sys.stack[i]);
+    }
+
+    sys.co2        = g_metrics.add(co2Metric);
+    sys.rh         = g_metrics.add(rhMetric);
+    sys.temp       = g_metrics.add(tempMetric);
+    sys.pressure   = g_metrics.add(pressureMetric);
+    sys.fan        = g_metrics.add(fanMetric);
+    sys.setpoint   = g_metrics.add(setpointMetric);
+    sys.valve      = g_metrics.add(valveMetric);
+    sys.safetyVent = g_metrics.add(safetyVentMetric);
+
+    g_metrics.addCollector(collect, nullptr);
+}
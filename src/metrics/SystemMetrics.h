@@ -0,0 +1,20 @@
+#ifndef SYSTEM_METRICS_H
+#define SYSTEM_METRICS_H
+
+#include "Controller/Controller.h"
+
+/*
+   SystemMetrics
+
+   Registers the metrics that are read on demand when /metrics is scraped:
+     - uptime, free heap and the lowest free heap since boot,
+     - CPU share of each FreeRTOS task since the previous scrape and its stack
+       high-water mark (unused stack in bytes),
+     - the Controller readings and setpoint.
+
+   Driver counters (Modbus, I2C, valve, fan, TLS) are registered by the drivers themselves.
+   Call once from setupTask after the Controller has been created.
+*/
+void registerSystemMetrics(Controller* controller);
+
+#endif // SYSTEM_METRICS_H
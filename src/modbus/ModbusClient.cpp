@@ -4,6 +4,19 @@
 
 #include "ModbusClient.h"
 #include "pico/time.h"
+#include <cstdio>
+
+static const float latency_bounds[] = {0.01f, 0.02f, 0.05f, 0.1f, 0.2f, 0.5f, 1.0f};
+
+static const MetricDescriptor requests_metric = {
+        "greenhouse_modbus_requests_total", "Modbus requests sent, per server address.", MetricType::Counter};
+static const MetricDescriptor errors_metric = {
+        "greenhouse_modbus_errors_total", "Failed Modbus requests (including timeouts).", MetricType::Counter};
+static const MetricDescriptor timeouts_metric = {
+        "greenhouse_modbus_timeouts_total", "Modbus requests without a response.", MetricType::Counter};
+static const MetricDescriptor latency_metric = {
+        "greenhouse_modbus_latency_seconds", "Modbus request round trip time.", MetricType::Histogram,
+        latency_bounds, sizeof(latency_bounds) / sizeof(latency_bounds[0])};
 
 ModbusClient::ModbusClient(std::shared_ptr<PicoOsUart> uart_) : uart(uart_) {
     platform_conf.transport = NMBS_TRANSPORT_RTU;
@@ -62,37 +75,74 @@ int32_t ModbusClient::uart_transport_write(const uint8_t *buf, uint16_t count, i
 }
 
 void ModbusClient::set_destination_rtu_address(uint8_t address) {
+    destination = address;
     nmbs_set_destination_rtu_address(&nmbs, address);
 }
 
+// Metrics are registered when a server address is used for the first time
+ModbusClient::ServerMetrics *ModbusClient::server_metrics(uint8_t address) {
+    for (int i = 0; i < server_count; ++i) {
+        if (servers[i].address == address) return &servers[i];
+    }
+    if (server_count >= max_servers) return nullptr;
+    char labels[16];
+    snprintf(labels, sizeof(labels), "slave=\"%u\"", address);
+    ServerMetrics &m = servers[server_count++];
+    m.address = address;
+    m.requests = g_metrics.add(requests_metric, labels);
+    m.errors = g_metrics.add(errors_metric, labels);
+    m.timeouts = g_metrics.add(timeouts_metric, labels);
+    m.latency = g_metrics.add(latency_metric, labels);
+    return &m;
+}
+
+nmbs_error ModbusClient::record(nmbs_error err, uint64_t start_us) {
+    ServerMetrics *m = server_metrics(destination);
+    if (m) {
+        g_metrics.inc(m->requests);
+        if (err != NMBS_ERROR_NONE) g_metrics.inc(m->errors);
+        if (err == NMBS_ERROR_TIMEOUT) g_metrics.inc(m->timeouts);
+        g_metrics.observe(m->latency, (time_us_64() - start_us) / 1e6f);
+    }
+    return err;
+}
+
 nmbs_error ModbusClient::read_coils(uint16_t address, uint16_t quantity, nmbs_bitfield coils_out) {
-    return nmbs_read_coils(&nmbs,address,quantity,coils_out);
+    uint64_t start = time_us_64();
+    return record(nmbs_read_coils(&nmbs,address,quantity,coils_out), start);
 }
 
 nmbs_error ModbusClient::read_discrete_inputs(uint16_t address, uint16_t quantity, nmbs_bitfield inputs_out) {
-    return nmbs_read_discrete_inputs(&nmbs, address, quantity, inputs_out);
+    uint64_t start = time_us_64();
+    return record(nmbs_read_discrete_inputs(&nmbs, address, quantity, inputs_out), start);
 }
 
 nmbs_error ModbusClient::read_holding_registers(uint16_t address, uint16_t quantity, uint16_t *registers_out) {
-    return nmbs_read_holding_registers(&nmbs, address, quantity, registers_out);
+    uint64_t start = time_us_64();
+    return record(nmbs_read_holding_registers(&nmbs, address, quantity, registers_out), start);
 }
 
 nmbs_error ModbusClient::read_input_registers(uint16_t address, uint16_t quantity, uint16_t *registers_out) {
-    return nmbs_read_input_registers(&nmbs, address, quantity, registers_out);
+    uint64_t start = time_us_64();
+    return record(nmbs_read_input_registers(&nmbs, address, quantity, registers_out), start);
 }
 
 nmbs_error ModbusClient::write_single_coil(uint16_t address, bool value) {
-    return nmbs_write_single_coil(&nmbs, address, value);
+    uint64_t start = time_us_64();
+    return record(nmbs_write_single_coil(&nmbs, address, value), start);
 }
 
 nmbs_error ModbusClient::write_single_register(uint16_t address, uint16_t value) {
-    return nmbs_write_single_register(&nmbs, address, value);
+    uint64_t start = time_us_64();
+    return record(nmbs_write_single_register(&nmbs, address, value), start);
 }
 
 nmbs_error ModbusClient::write_multiple_coils(uint16_t address, uint16_t quantity, const nmbs_bitfield coils) {
-    return nmbs_write_multiple_coils(&nmbs, address, quantity, coils);
+    uint64_t start = time_us_64();
+    return record(nmbs_write_multiple_coils(&nmbs, address, quantity, coils), start);
 }
 
 nmbs_error ModbusClient::write_multiple_registers(uint16_t address, uint16_t quantity, const uint16_t *registers) {
-    return nmbs_write_multiple_registers(&nmbs, address, quantity, registers);
+    uint64_t start = time_us_64();
+    return record(nmbs_write_multiple_registers(&nmbs, address, quantity, registers), start);
 }
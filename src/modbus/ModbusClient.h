@@ -8,6 +8,7 @@
 #include <memory>
 #include "nanomodbus.h"
 #include "PicoOsUart.h"
+#include "metrics/Metrics.h"
 
 // Wrapper class does not implement full nanomodbus API
 // addresses are wire addresses (numbering starts from zero)
@@ -24,12 +25,29 @@ public:
     nmbs_error write_multiple_coils(uint16_t address, uint16_t quantity, const nmbs_bitfield coils);
     nmbs_error write_multiple_registers(uint16_t address, uint16_t quantity, const uint16_t* registers);
 private:
+    // Request, error and latency metrics of one server (slave) address
+    struct ServerMetrics {
+        uint8_t address;
+        MetricId requests;
+        MetricId errors;
+        MetricId timeouts;
+        MetricId latency;
+    };
+    static constexpr int max_servers = 6;
+
+    // updates the metrics of the current destination after a request
+    nmbs_error record(nmbs_error err, uint64_t start_us);
+    ServerMetrics *server_metrics(uint8_t address);
+
     static int32_t uart_transport_write(const uint8_t *buf, uint16_t count, int32_t byte_timeout_ms, void *arg);
     static int32_t uart_transport_read(uint8_t *buf, uint16_t count, int32_t byte_timeout_ms, void *arg);
 
     std::shared_ptr<PicoOsUart> uart;
     nmbs_platform_conf platform_conf{};
     nmbs_t nmbs{};
+    uint8_t destination{1};
+    ServerMetrics servers[max_servers]{};
+    int server_count{0};
 };
 
 
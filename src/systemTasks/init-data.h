@@ -3,8 +3,16 @@
 
 #include <memory>                        // For smart pointers like std::shared_ptr
 #include "EEPROM/EEPROMStorage.h"        // Provides interface for non-volatile storage via external EEPROM
+#include "EEPROM/ConfigStore.h"          // Journaled key-value store for the settings on the EEPROM
+#include "EEPROM/ConfigCache.h"          // Write-behind cache of the settings, flushed by eepromTask
+#include "EEPROM/SampleLog.h"            // Persistent telemetry history on the EEPROM
 #include "./Controller/Controller.h"     // Defines the Controller class that manages sensor data and actuation logic
 #include "UI/ui.h"                       // Defines the UI class that manages the on-device display and user interactions
+#include "cloud/TelemetryPipeline.h"     // Fan-out of telemetry samples to the sinks, one queue per sink
+#include "cloud/ChangeDetector.h"        // Report-by-exception filter that feeds the telemetry pipeline
+#include "http/StatusServer.h"           // Local HTTP status API fed with Controller snapshots
+#include "cloud/LineProtocolExporter.h"  // Optional UDP line-protocol export to a local collector
+#include "commands/CommandQueue.h"       // Remote commands shared by all transports
 #include <vector>                        // For standard container std::vector
 
 /**
@@ -13,19 +21,35 @@
  * This structure aggregates pointers to essential system modules that are initialized
  * during the startup phase. It includes:
  *   - EEPROMStorage for persistent storage of critical parameters.
+ *   - ConfigStore holding the settings (CO₂ setpoint, schedule) on the EEPROM.
+ *   - ConfigCache through which the settings are read and changed without waiting for the EEPROM.
+ *   - SampleLog keeping the telemetry history on the EEPROM for sinks that were offline.
  *   - Controller, the central decision-making module that processes sensor data
  *     and commands actuators.
  *   - UI, the module responsible for user interactions and display.
  *   - A pointer to a vector of sensor objects that implement the ISensor interface.
+ *   - TelemetryPipeline holding the samples that wait for upload, per sink.
+ *   - ChangeDetector deciding when a new telemetry sample is recorded.
+ *   - StatusServer publishing the current snapshot and history on the local network.
+ *   - LineProtocolExporter sending every sample to a local collector (nullptr when disabled).
+ *   - CommandQueue holding remote commands until sensorTask executes them.
  *
  * This structure is populated during system initialization (setupTask) and then
  * passed to other components that require access to these shared objects.
  */
 struct InitDataStruct {
     std::shared_ptr<EEPROMStorage> eepromStore;           ///< Pointer to the EEPROM storage module for persistence.
+    std::shared_ptr<ConfigStore> configStore;             ///< Pointer to the persistent settings store.
+    std::shared_ptr<ConfigCache> configCache;             ///< Pointer to the write-behind settings cache.
+    std::shared_ptr<SampleLog> sampleLog;                 ///< Pointer to the persistent telemetry log.
     std::shared_ptr<Controller> controller;               ///< Pointer to the Controller module responsible for control logic.
     std::shared_ptr<UI> ui;                               ///< Pointer to the UI module handling local user interface.
     std::vector<std::shared_ptr<ISensor>>* sensorList;    ///< Pointer to a vector containing all sensor modules implementing ISensor.
+    std::shared_ptr<TelemetryPipeline> telemetryPipeline; ///< Pointer to the pipeline delivering samples to the sinks.
+    std::shared_ptr<ChangeDetector> changeDetector;       ///< Pointer to the report-by-exception telemetry filter.
+    std::shared_ptr<StatusServer> statusServer;           ///< Pointer to the local HTTP status server.
+    std::shared_ptr<LineProtocolExporter> lineExporter;   ///< Pointer to the UDP line-protocol exporter, if configured.
+    std::shared_ptr<CommandQueue> commands;               ///< Pointer to the remote command queue.
 };
 
 #endif // INIT_DATA_H
\ No newline at end of file
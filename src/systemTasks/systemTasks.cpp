@@ -8,9 +8,15 @@
 #include "controller/Controller.h"  // Controller module header
 #include "UI/ui.h"                  // User Interface module header
 #include "cloud/cloud.h"            // Cloud connectivity module header
+#include "cloud/TelemetryPipeline.h" // Telemetry fan-out to the sinks, served by cloudTask
+#include "cloud/MqttChannel.h"      // MQTT telemetry/command channel header
+#include "cloud/mqtt_config.h"      // MQTT broker and topic configuration
 #include "FanDriver/FanDriver.h"      // Fan driver module header
 #include "ValveDriver/ValveDriver.h"  // Valve driver module header
-#include "EEPROM/EEPROMStorage.h"   // EEPROM storage module header
+#include "EEPROM/ConfigCache.h"     // Write-behind cache of the persistent settings
+#include "http/SampleLogExport.h"   // Sample log reader for the status server's CSV export
+#include "commands/CommandQueue.h"  // Remote command queue executed by sensorTask
+#include "log/Syslog.h"             // Remote syslog transport
 #include "init-data.h"              // Shared initialization data structure header
 #include "rot/GpioEvent.h"          // GPIO event definitions for rotary encoder events
 #include "queue.h"                  // FreeRTOS queue API
@@ -22,9 +28,12 @@ extern QueueHandle_t xGpioQueue;     // Externally declared global queue handle
 // -----------------------------------------------------------------------------
 //
 // This task interfaces with all sensor modules (e.g., CO₂, Temperature, Humidity, Pressure).
-// It invokes each sensor's readSensor() method and thereafter calls the controller's updateControl()
-// to update the system control logic based on fresh sensor readings.
-// The sensor read cycle operates periodically with a 500 ms delay.
+// It invokes each sensor's readSensor() method, executes the remote commands queued by the transports
+// and thereafter calls the controller's updateControl() to update the system control logic based on
+// fresh sensor readings. Finally the change detector
+// compares the new values with the last reported ones and queues a telemetry record if needed, and
+// the status server (and the line-protocol exporter, if configured) receives a snapshot of the new state.
+// The sensor read cycle operates periodically with a 500 ms delay (changeable with INTERVAL=).
 void sensorTask(void *param) {
     // Log task start and current task name for debugging purposes.
     printf("sensorTask started in task: %s\n", pcTaskGetName(nullptr));
@@ -34,6 +43,10 @@ void sensorTask(void *param) {
     // Extract the pointer to the sensor list and the controller instance.
     auto sensorList = initData->sensorList;
     auto ctrl       = initData->controller;
+    auto detector   = initData->changeDetector;
+    auto status     = initData->statusServer;
+    auto exporter   = initData->lineExporter;
+    auto commands   = initData->commands;
 
     printf("_______SENSOR TASK______\n");
 
@@ -48,13 +61,36 @@ void sensorTask(void *param) {
             }
         }
 
-        // 2) Invoke controller's updateControl() method to process new sensor readings.
+        // 2) Execute queued remote commands, then invoke controller's updateControl() method to
+        //    process new sensor readings with the new settings. A record is requested so that
+        //    the acknowledgements go out with the next upload.
+        if (commands && commands->process() > 0 && detector) {
+            detector->requestReport(TelemetryRecord::REASON_COMMAND);
+        }
         if (ctrl) {
             ctrl->updateControl();
         }
 
-        // 3) Delay for 500 ms (converted to ticks) before the next sensor reading cycle.
-        vTaskDelay(pdMS_TO_TICKS(500));
+        // 3) Queue a telemetry record if a value left its deadband, a state changed or the
+        //    heartbeat is due.
+        if (detector) {
+            detector->evaluate();
+        }
+
+        // 4) Hand a snapshot to the local status server (copied, never waits for the network)
+        //    and to the UDP exporter, which batches it and sends a datagram when one is due.
+        if (ctrl) {
+            ControllerSnapshot snapshot = ctrl->getSnapshot();
+            if (status) {
+                status->publish(snapshot);
+            }
+            if (exporter) {
+                exporter->add(snapshot);
+            }
+        }
+
+        // 5) Delay for the control interval (500 ms unless changed by a command).
+        vTaskDelay(pdMS_TO_TICKS(commands ? commands->getSampleIntervalMs() : CommandQueue::DEFAULT_INTERVAL_MS));
     }
 }
 
@@ -86,56 +122,72 @@ void uiTask(void *param) {
 // eepromTask
 // -----------------------------------------------------------------------------
 //
-// This task handles background operations relating to EEPROM storage, such as periodic maintenance.
-// It starts after an initial delay, then loops with a long delay between cycles to minimize resource usage.
+// This task writes the settings changed in the configuration cache to the EEPROM. It sleeps
+// until a setting changes (the cache wakes it) and then writes every setting once it has been
+// unchanged for the debounce period, so the tasks that change settings never wait for EEPROM
+// write cycles and repeated changes cost one write.
 void eepromTask(void *param) {
     // Print task start message with task name for debugging.
     printf("eepromTask started in task: %s\n", pcTaskGetName(nullptr));
-    // Cast parameter to EEPROMStorage pointer.
-    auto eeprom = static_cast<EEPROMStorage*>(param);
-    if (!eeprom) {
-        printf("eepromTask: invalid EEPROM pointer\n");
-        // Terminate task if EEPROM pointer is invalid.
+    // Cast parameter to ConfigCache pointer.
+    auto cache = static_cast<ConfigCache*>(param);
+    if (!cache) {
+        printf("eepromTask: invalid configuration cache pointer\n");
+        // Terminate task if the cache pointer is invalid.
         vTaskDelete(nullptr);
         return;
     }
 
-    // Initial delay of 5 seconds before starting background EEPROM operations.
-    vTaskDelay(pdMS_TO_TICKS(5000));
+    // Initial delay of 5 seconds (registers this task with the cache; a change ends it early).
+    cache->wait(5000);
     while (true) {
-        // Insert periodic EEPROM operations here, if needed (e.g., data validation, periodic writes).
-        vTaskDelay(pdMS_TO_TICKS(50000)); // Delay of 50 seconds between cycles.
+        uint32_t delayMs = cache->flush();
+        cache->wait(delayMs);
     }
 }
 
+// -----------------------------------------------------------------------------
+// logExportTask
+// -----------------------------------------------------------------------------
+//
+// This task reads the sample log for the status server's /samples.csv export. It sleeps until the
+// server requests the next batch of records, reads it from the EEPROM into the export's buffer and
+// lets the server continue the response, so the lwIP thread never blocks on the I2C bus.
+void logExportTask(void *param) {
+    printf("logExportTask started in task: %s\n", pcTaskGetName(nullptr));
+    auto logExport = static_cast<SampleLogExport*>(param);
+    if (!logExport) {
+        printf("logExportTask: invalid sample log export pointer\n");
+        vTaskDelete(nullptr);
+        return;
+    }
+    logExport->run();
+}
+
 // -----------------------------------------------------------------------------
 // initTask
 // -----------------------------------------------------------------------------
 //
 // The initTask is responsible for system initialization routines.
-// It reads the stored CO₂ setpoint from EEPROM and synchronizes this value with both 
-// the Controller (for control logic) and the UI (for display).
+// The Controller has loaded the CO₂ setpoint from the configuration store when it was created;
+// this task synchronizes that value with the UI (for display).
 // After completing initialization, the task deletes itself.
 void initTask(void *param) {
     printf("initTask started in task: %s\n", pcTaskGetName(nullptr));
     // Cast parameter to the shared InitDataStruct structure.
     auto initData   = static_cast<InitDataStruct*>(param);
-    auto eeprom     = initData->eepromStore;
     auto controller = initData->controller;
     auto ui         = initData->ui;
 
     printf("initTask: Starting initialization...\n");
-    // Load the CO₂ setpoint from the EEPROM storage.
-    uint16_t sp = eeprom->loadCO2Setpoint();
-    printf("initTask: read CO2 setpoint from EEPROM = %u\n", sp);
-
-    // Update the Controller's CO₂ setpoint.
     if (controller) {
-        controller->setCO2Setpoint(static_cast<float>(sp));
-    }
-    // Update the UI's local setpoint copy.
-    if (ui) {
-        ui->setLocalSetpoint(static_cast<float>(sp));
+        float sp = controller->getCO2Setpoint();
+        printf("initTask: stored CO2 setpoint = %.0f\n", sp);
+
+        // Update the UI's local setpoint copy.
+        if (ui) {
+            ui->setLocalSetpoint(sp);
+        }
     }
     printf("initTask: Initialization complete.\n");
 
@@ -184,30 +236,86 @@ void rotaryEventTask(void *param) {
 // cloudTask
 // -----------------------------------------------------------------------------
 //
-// This task manages cloud connectivity and sends sensor data to a remote server.
-// It calls the updateSensorData() method of the Cloud module periodically (every 60 seconds).
+// This task runs the telemetry pipeline: it delivers the records queued for each sink (ThingSpeak,
+// and the HTTP JSON endpoint and MQTT broker when configured) and lets ThingSpeak poll for TalkBack
+// commands. Telemetry records are queued by the change detector in sensorTask (report-by-exception).
+// When each sink is contacted is decided by its own UploadScheduler: pending records are sent once per
+// jittered upload interval of the sink (at least 20 seconds for ThingSpeak, its rate limit), or earlier
+// when the sink's queue reaches its high-water mark. While the readings are stable nothing is uploaded;
+// TalkBack commands are then still polled about every 60 seconds so that remote setpoint changes keep
+// arriving. The first contact after boot is delayed by a random phase offset, and failures and
+// rate-limit answers back off (see UploadScheduler.h), so a fleet of greenhouses does not hit the
+// servers in lockstep. The task sleeps until the next sink is due, or until a new record arrives.
+// It also writes the filled blocks of the sample log to the EEPROM, and while a sink has been offline
+// for longer than its queue lasts, it replays the missed records from the log as the sink catches up.
 // The Cloud module uses secure TLS connections for data transmission and remote command handling.
 void cloudTask(void* param) {
     printf("cloudTask started in task: %s\n", pcTaskGetName(nullptr));
 
-    // Cast parameter to Cloud pointer.
-    Cloud* cloud = static_cast<Cloud*>(param);
-    if (!cloud) {
-        printf("[cloudTask] ERROR: No valid Cloud pointer!\n");
+    // Cast parameter to TelemetryPipeline pointer.
+    auto pipeline = static_cast<TelemetryPipeline*>(param);
+    if (!pipeline) {
+        printf("[cloudTask] ERROR: No valid TelemetryPipeline pointer!\n");
         vTaskDelete(nullptr);
         return;
     }
 
-    // Main loop: periodically update sensor data to the cloud.
+    // Main loop: serve the sinks that are due, then sleep until the next one is.
     while (true) {
-        // Call the cloud update function to transmit sensor data.
-        if (cloud->updateSensorData()) {
-            printf("[cloudTask] Sensor data updated successfully.\n");
-        } else {
-            printf("[cloudTask] Failed to update sensor data.\n");
+        uint32_t delayMs = pipeline->service();
+        pipeline->wait(delayMs ? delayMs : 1);
+    }
+}
+
+#ifdef MQTT_BROKER_HOST
+// -----------------------------------------------------------------------------
+// mqttTask
+// -----------------------------------------------------------------------------
+//
+// This task drives the MQTT channel. It (re)connects to the broker when needed and checks for command
+// acknowledgements several times a second. Commands received on the command topic go straight to the
+// command queue (from the lwIP thread) and are executed by sensorTask; their acks are published here as
+// soon as they appear. The telemetry is published by cloudTask through the telemetry pipeline; the
+// record that sensorTask requests after executing commands confirms the new state to the sender.
+void mqttTask(void* param) {
+    printf("mqttTask started in task: %s\n", pcTaskGetName(nullptr));
+
+    auto mqtt = static_cast<MqttChannel*>(param);
+    if (!mqtt) {
+        printf("[mqttTask] ERROR: No valid MqttChannel pointer!\n");
+        vTaskDelete(nullptr);
+        return;
+    }
+
+    const TickType_t ackCheckPeriod = pdMS_TO_TICKS(250);
+
+    while (true) {
+        if (!mqtt->isConnected()) {
+            mqtt->connect();
         }
+        mqtt->publishAcks();
+        vTaskDelay(ackCheckPeriod);
+    }
+}
+#endif // MQTT_BROKER_HOST
+
+#ifdef SYSLOG_HOST
+// -----------------------------------------------------------------------------
+// syslogTask
+// -----------------------------------------------------------------------------
+//
+// This task ships the log records that the Syslog module collected from the console output to the
+// remote collector. Every SYSLOG_FLUSH_MS it sends a burst of at most SYSLOG_BURST datagrams; while
+// a backlog remains (e.g. the boot messages) the bursts follow each other more quickly, so the
+// network is never flooded and a slow link leaves the records in the buffer, where the least
+// severe ones are dropped first.
+void syslogTask(void* param) {
+    const TickType_t flushPeriod   = pdMS_TO_TICKS(SYSLOG_FLUSH_MS);
+    const TickType_t backlogPeriod = pdMS_TO_TICKS(50);
 
-        // Wait for 60 seconds before the next cloud update.
-        vTaskDelay(pdMS_TO_TICKS(60000));
+    while (true) {
+        size_t sent = Syslog::flush();
+        vTaskDelay(sent == SYSLOG_BURST ? backlogPeriod : flushPeriod);
     }
-}
\ No newline at end of file
+}
+#endif // SYSLOG_HOST
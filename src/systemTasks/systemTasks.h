@@ -16,21 +16,25 @@ struct InitDataStruct;
  * These task functions are designed as part of the Greenhouse Fertilization System.
  * They are created and managed under FreeRTOS and are responsible for different aspects of system operation:
  *
- * 1. initTask: Initializes persistent system parameters from EEPROM and synchronizes them with the Controller and UI.
+ * 1. initTask: Synchronizes the persistent system parameters loaded by the Controller with the UI.
  * 2. sensorTask: Periodically reads environmental sensor data and updates control logic accordingly.
  * 3. controlTask: (Prototype provided) Responsible for system control loop execution (possibly integrated into another module).
  * 4. uiTask: Refreshes and updates the on-device user interface (OLED display) with system status.
- * 5. eepromTask: Handles background EEPROM operations related to system persistence and maintenance.
+ * 5. eepromTask: Writes changed settings from the configuration cache to the EEPROM (debounced write-behind).
  * 6. rotaryEventTask: Processes asynchronous events from the rotary encoder, enabling real-time user interaction.
- * 7. cloudTask: Manages secure TLS communications to send sensor data to a remote server and to retrieve remote commands.
+ * 7. cloudTask: Runs the telemetry pipeline, delivering sensor data to every sink (ThingSpeak over TLS, optional HTTP
+ *    and MQTT) and retrieving remote commands.
+ * 8. mqttTask: Keeps the optional MQTT broker connection, submits commands as they arrive and publishes their acks.
+ * 9. syslogTask: Sends the buffered log records to the optional remote syslog collector.
+ * 10. logExportTask: Reads the sample log from the EEPROM in batches for the status server's CSV export.
  *
  * These tasks interact via FreeRTOS queues, timers, and shared data structures to achieve reliable real-time operation.
  */
 
 // -----------------------------------------------------------------------------
 // initTask:
-// Performs initial system setup by loading persistent parameters (e.g., CO₂ setpoint) from EEPROM,
-// and synchronizes those values with the Controller (for data processing/actuation) and UI (for display).
+// Performs initial system setup: the persistent parameters (e.g., CO₂ setpoint) that the Controller
+// loaded from the configuration store are synchronized with the UI (for display).
 void initTask(void* param);
 
 // -----------------------------------------------------------------------------
@@ -53,8 +57,8 @@ void uiTask(void* param);
 
 // -----------------------------------------------------------------------------
 // eepromTask:
-// Handles background operations related to EEPROM storage, ensuring that critical parameters
-// (like CO₂ setpoints) are periodically checked and maintained in persistent memory.
+// Writes the settings (like the CO₂ setpoint) that changed in the configuration cache to the
+// EEPROM once they have been unchanged for a short while. 'param' is the ConfigCache.
 void eepromTask(void* param);
 
 // -----------------------------------------------------------------------------
@@ -65,8 +69,28 @@ void rotaryEventTask(void *param);
 
 // -----------------------------------------------------------------------------
 // cloudTask:
-// Manages secure cloud communications, sending sensor data to a remote server and retrieving remote commands
-// over a TLS-secured connection. This task typically operates periodically (e.g., every 60 seconds).
+// Runs the telemetry pipeline (param: TelemetryPipeline*), sending sensor data to each sink when its schedule
+// says so and retrieving remote commands over a TLS-secured connection. The task sleeps until the next sink
+// is due or a new record arrives.
 void cloudTask(void* param);
 
+// -----------------------------------------------------------------------------
+// mqttTask:
+// Maintains the MQTT broker connection (only created when MQTT_BROKER_HOST is configured), submits remote
+// commands as soon as they are received and publishes their acknowledgements. Telemetry goes out through the
+// telemetry pipeline (cloudTask).
+void mqttTask(void* param);
+
+// -----------------------------------------------------------------------------
+// syslogTask:
+// Sends the log records buffered by the Syslog module to the remote collector (only created when
+// SYSLOG_HOST is configured), in short bursts every SYSLOG_FLUSH_MS.
+void syslogTask(void* param);
+
+// -----------------------------------------------------------------------------
+// logExportTask:
+// Reads the persistent sample log in batches for the status server's /samples.csv export
+// (param: SampleLogExport*), so the lwIP thread that serves the request never waits for the EEPROM.
+void logExportTask(void* param);
+
 #endif // SYSTEM_TASKS_H
\ No newline at end of file
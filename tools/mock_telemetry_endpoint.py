@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""Local stand-in for the HTTP JSON telemetry sink (see src/cloud/http_sink_config.h).
+
+Accepts the JSON batches POSTed by the greenhouse controller, prints one line per
+request and the records per second received, and can inject failures so that the
+device's queueing, backoff and Retry-After handling can be watched without the
+internet:
+
+    python3 tools/mock_telemetry_endpoint.py --port 8080 --fail 0.2 --limit 0.1
+
+--stall reads a share of the requests but never answers them, so the device times out
+after its request was written. That request may have been processed, so the device must
+report the failure and back off instead of sending it again at once on a new connection.
+A batch that comes back sooner than --min-resend seconds after the device gave up is
+reported as a REPEATED request, and the run exits with status 1 on Ctrl-C:
+
+    python3 tools/mock_telemetry_endpoint.py --port 8080 --stall 0.3
+"""
+import argparse
+import hashlib
+import json
+import random
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+stats_lock = threading.Lock()
+stats = {"requests": 0, "records": 0, "failed": 0, "limited": 0, "stalled": 0, "repeated": 0,
+         "start": time.time()}
+stalled = {}    # body digest -> time the device closed the stalled connection
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"   # keep-alive, as used by the device
+
+    def do_POST(self):
+        length = int(self.headers.get("Content-Length", 0))
+        body = self.rfile.read(length)
+        digest = hashlib.sha1(body).hexdigest()
+        with stats_lock:
+            gave_up = stalled.pop(digest, None)
+        if gave_up is not None and time.time() - gave_up < self.server.min_resend:
+            with stats_lock:
+                stats["repeated"] += 1
+            print(f"{time.strftime('%H:%M:%S')} {self.client_address[0]} REPEATED: a stalled batch was sent "
+                  f"again {time.time() - gave_up:.2f}s after the device gave up on it")
+
+        if self.server.delay:
+            time.sleep(self.server.delay)
+
+        roll = random.random()
+        if roll < self.server.stall:
+            self.stall(digest)
+            return
+        roll -= self.server.stall
+        if roll < self.server.limit:
+            self.answer(429, {"Retry-After": str(self.server.retry_after)})
+            outcome = "429"
+            key = "limited"
+        elif roll < self.server.limit + self.server.fail:
+            self.answer(500)
+            outcome = "500"
+            key = "failed"
+        else:
+            try:
+                records = len(json.loads(body)["records"])
+            except (ValueError, KeyError, TypeError):
+                self.answer(400)
+                print(f"{self.client_address[0]} malformed body: {body[:80]!r}")
+                return
+            self.answer(200)
+            outcome = f"200 {records} records"
+            key = None
+
+        with stats_lock:
+            stats["requests"] += 1
+            if key:
+                stats[key] += 1
+            else:
+                stats["records"] += records
+            elapsed = max(time.time() - stats["start"], 1e-3)
+            rate = stats["records"] / elapsed
+        print(f"{time.strftime('%H:%M:%S')} {self.client_address[0]} {self.path}: {outcome} "
+              f"(total {stats['records']} records, {rate:.2f} records/s, "
+              f"{stats['failed']} failed, {stats['limited']} rate limited)")
+
+    def stall(self, digest):
+        # Keep the connection open without answering until the device closes it.
+        self.close_connection = True
+        try:
+            while self.rfile.read1(4096):
+                pass
+        except OSError:
+            pass
+        with stats_lock:
+            stats["stalled"] += 1
+            stalled[digest] = time.time()
+        print(f"{time.strftime('%H:%M:%S')} {self.client_address[0]} {self.path}: stalled until the device "
+              f"closed the connection ({stats['stalled']} stalled)")
+
+    def answer(self, status, headers=None):
+        payload = b"{}"
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(payload)))
+        for name, value in (headers or {}).items():
+            self.send_header(name, value)
+        self.end_headers()
+        self.wfile.write(payload)
+
+    def log_message(self, format, *args):
+        pass  # one line per request is printed by do_POST
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--fail", type=float, default=0.0, help="share of requests answered with 500")
+    parser.add_argument("--limit", type=float, default=0.0, help="share of requests answered with 429")
+    parser.add_argument("--retry-after", type=int, default=30, help="Retry-After of the 429 answers (s)")
+    parser.add_argument("--delay", type=float, default=0.0, help="seconds to hold every answer")
+    parser.add_argument("--stall", type=float, default=0.0, help="share of requests never answered")
+    parser.add_argument("--min-resend", type=float, default=1.0,
+                        help="a stalled batch sent again sooner than this (s) is reported as repeated")
+    args = parser.parse_args()
+
+    server = ThreadingHTTPServer(("", args.port), Handler)
+    server.fail, server.limit = args.fail, args.limit
+    server.retry_after, server.delay = args.retry_after, args.delay
+    server.stall, server.min_resend = args.stall, args.min_resend
+    print(f"Listening on port {args.port} (fail {args.fail:.0%}, 429 {args.limit:.0%}, "
+          f"stall {args.stall:.0%}, delay {args.delay}s)")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    if stats["repeated"]:
+        print(f"{stats['repeated']} stalled batches were repeated without backing off")
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()